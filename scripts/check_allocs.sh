@@ -0,0 +1,10 @@
+#!/bin/bash
+# Play headless with every allocation counted, aborting if any is made
+# after the warm-up frames. Extra arguments are passed on to the game.
+./scripts/clean_all.sh
+make -C ./src DEBUG=1 TRACK_ALLOCS=1
+
+FRAMES=2000
+WARMUP=600
+
+./src/main.exe --headless --software-blit -n $FRAMES --zero-alloc $WARMUP "$@"
\ No newline at end of file
@@ -0,0 +1,18 @@
+#!/bin/bash
+# Measure input-to-photon latency headless under different pacing
+# settings. Extra arguments are passed on to every run.
+./scripts/clean_all.sh
+make -C ./src
+
+FRAMES=3000
+PROBE=37
+
+run() {
+    ./src/main.exe --headless -n $FRAMES -p $PROBE "$@" 2>&1 | grep "Latency \["
+}
+
+run "${@}"
+run -v "${@}"
+run -r 144 "${@}"
+run -r 60 "${@}"
+run -r 30 "${@}"
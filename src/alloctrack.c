@@ -0,0 +1,380 @@
+#include "alloctrack.h"
+
+// The real functions, which the header redirects in TRACK_ALLOCS builds
+#undef malloc
+#undef calloc
+#undef realloc
+#undef free
+
+#ifndef TRACK_ALLOCS
+// Log message when only SDL's allocations can be seen
+static const char ALLOC_BUILD_LOG[] = "Allocations: only SDL's are tracked, build with TRACK_ALLOCS=1 for the game's";
+#endif
+// Log message when the memory functions could not be replaced
+static const char ALLOC_HOOK_LOG[] = "Allocations: could not track SDL's: %s";
+// Log message with the allocations made before the first frame
+static const char ALLOC_INIT_LOG[] = "Allocations: %llu (%llu bytes) before the first frame";
+// Log message with the allocations made in frames
+static const char ALLOC_FRAMES_LOG[] = "Allocations: %llu (%llu bytes) in %llu frames, %llu of them allocated, the last %llu";
+// Log message with one site's allocations made in frames
+static const char ALLOC_SITE_LOG[] = "  %s: %llu (%llu bytes), %.2f per frame, at most %llu (%llu bytes) in one, in %llu frames";
+// Log message when allocating after the warm-up frames
+static const char ALLOC_STEADY_LOG[] = "Allocation of %zu bytes at %s in frame %llu, none are allowed after %llu frames";
+// The site SDL's allocations are counted for
+static const char SDL_SITE[] = "SDL";
+// The site allocations are counted for once every site is taken
+static const char OTHER_SITE[] = "other sites";
+// The most sites logged
+static const int32_t ALLOC_LOG_SITES = 20;
+
+/**
+ * Struct:
+ *  AllocTracker
+ *
+ * Purpose:
+ *  What is known about the allocations made, one for the whole
+ *  program as malloc is.
+ *
+ * Fields:
+ *  - enabled:
+ *      Whether allocations are counted.
+ *  - in_frame:
+ *      Whether the first frame began.
+ *  - strict:
+ *      Whether allocating aborts.
+ *  - warmup:
+ *      The number of frames allocating is allowed in, 0 if always.
+ *  - frame:
+ *      The number of frames played when the current one began.
+ *  - lock:
+ *      Guards the counts, taken by whichever thread allocates.
+ *  - sdl_malloc, sdl_calloc, sdl_realloc, sdl_free:
+ *      SDL's memory functions before they were replaced.
+ *  - sites:
+ *      The sites that allocated in frames, hashed by their string's
+ *      address, which is the same for every allocation of a site.
+ *  - other:
+ *      The sites that didn't fit.
+ *  - init_count:
+ *      The number of allocations before the first frame.
+ *  - init_bytes:
+ *      The bytes allocated before the first frame.
+ *  - frames:
+ *      The number of frames that ended.
+ *  - allocating_frames:
+ *      The number of those that allocated.
+ *  - last_allocating:
+ *      The last of those.
+ */
+typedef struct {
+    bool                enabled;
+    bool                in_frame;
+    bool                strict;
+    uint64_t            warmup;
+    uint64_t            frame;
+    SDL_SpinLock        lock;
+    SDL_malloc_func     sdl_malloc;
+    SDL_calloc_func     sdl_calloc;
+    SDL_realloc_func    sdl_realloc;
+    SDL_free_func       sdl_free;
+    AllocSite           sites[ALLOC_MAX_SITES];
+    AllocSite           other;
+    uint64_t            init_count;
+    uint64_t            init_bytes;
+    uint64_t            frames;
+    uint64_t            allocating_frames;
+    uint64_t            last_allocating;
+} AllocTracker;
+
+// The allocations made, disabled until tracking starts
+static AllocTracker tracker;
+
+/**
+ * Function:
+ *  __count
+ *
+ * Purpose:
+ *  Count an allocation for its site, aborting if none are allowed.
+ *
+ * Parameters:
+ *  - size:
+ *      The number of bytes.
+ *  - site:
+ *      Where it is allocated.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __count(size_t size, const char* site);
+
+/**
+ * Function:
+ *  __find_site
+ *
+ * Purpose:
+ *  Find the counts of a site, adding them if it is new.
+ *
+ * Parameters:
+ *  - site:
+ *      Where it is allocated.
+ *
+ * Returns:
+ *  Its counts, those of every other site if there is no room left.
+ */
+static AllocSite* __find_site(const char* site);
+
+/**
+ * Function:
+ *  __end_frame
+ *
+ * Purpose:
+ *  Add the frame's counts to the most per frame and clear them.
+ *
+ * Parameters:
+ *  - site:
+ *      A site's counts.
+ *
+ * Returns:
+ *  Whether the site allocated this frame.
+ */
+static bool __end_frame(AllocSite* site);
+
+/**
+ * Function:
+ *  __compare_sites
+ *
+ * Purpose:
+ *  Order sites by the number of allocations, the most first.
+ *
+ * Parameters:
+ *  - a:
+ *      A site.
+ *  - b:
+ *      Another site.
+ *
+ * Returns:
+ *  Negative if a allocated more, positive if less, 0 otherwise.
+ */
+static int __compare_sites(const void* a, const void* b);
+
+/**
+ * Function:
+ *  __sdl_malloc, __sdl_calloc, __sdl_realloc, __sdl_free
+ *
+ * Purpose:
+ *  SDL's memory functions, counting for the SDL site before calling
+ *  the ones replaced.
+ *
+ * Parameters:
+ *  Those of the functions replaced.
+ *
+ * Returns:
+ *  What the functions replaced return.
+ */
+static void* __sdl_malloc(size_t size);
+static void* __sdl_calloc(size_t count, size_t size);
+static void* __sdl_realloc(void* memory, size_t size);
+static void __sdl_free(void* memory);
+
+/**
+ * SDL only lets its functions be replaced before it allocates with
+ * them. The ones replaced are still called, so memory allocated
+ * before is freed the same way.
+ */
+void init_alloc_tracking(uint64_t warmup) {
+    tracker.warmup = warmup;
+    tracker.other.site = OTHER_SITE;
+
+    SDL_GetMemoryFunctions(&tracker.sdl_malloc, &tracker.sdl_calloc, &tracker.sdl_realloc, &tracker.sdl_free);
+    if (SDL_SetMemoryFunctions(__sdl_malloc, __sdl_calloc, __sdl_realloc, __sdl_free) < 0) {
+        SDL_Log(ALLOC_HOOK_LOG, SDL_GetError());
+    }
+
+#ifndef TRACK_ALLOCS
+    SDL_Log(ALLOC_BUILD_LOG);
+#endif
+    tracker.enabled = true;
+}
+
+/**
+ * The allocations before the first frame, loading and such, are
+ * counted apart since they happen once. Allocations are forbidden
+ * from the frame after the warm-up ones.
+ */
+void begin_alloc_frame(uint64_t frame) {
+    SDL_AtomicLock(&tracker.lock);
+    if (tracker.in_frame) {
+        bool allocated = false;
+        for (int32_t i = 0; i < ALLOC_MAX_SITES; i++) {
+            if (tracker.sites[i].site && __end_frame(&tracker.sites[i])) allocated = true;
+        }
+        if (__end_frame(&tracker.other)) allocated = true;
+        if (allocated) {
+            tracker.allocating_frames++;
+            tracker.last_allocating = tracker.frame;
+        }
+        tracker.frames++;
+    }
+    tracker.in_frame = true;
+    tracker.frame = frame;
+    tracker.strict = tracker.warmup > 0 && frame >= tracker.warmup;
+    SDL_AtomicUnlock(&tracker.lock);
+}
+
+/**
+ * Ends the last frame and stops counting, so tearing the game down
+ * neither shows nor aborts.
+ */
+void log_alloc_tracking(void) {
+    SDL_AtomicLock(&tracker.lock);
+    tracker.enabled = false;
+    SDL_AtomicUnlock(&tracker.lock);
+    if (tracker.in_frame) begin_alloc_frame(tracker.frame + 1);
+
+    AllocSite sites[ALLOC_MAX_SITES + 1];
+    int32_t count = 0;
+    uint64_t allocations = 0, bytes = 0;
+    for (int32_t i = 0; i < ALLOC_MAX_SITES; i++) {
+        if (tracker.sites[i].site) sites[count++] = tracker.sites[i];
+    }
+    if (tracker.other.count > 0) sites[count++] = tracker.other;
+    for (int32_t i = 0; i < count; i++) {
+        allocations += sites[i].count;
+        bytes += sites[i].bytes;
+    }
+    qsort(sites, (size_t)count, sizeof(AllocSite), __compare_sites);
+
+    SDL_Log(ALLOC_INIT_LOG, (unsigned long long)tracker.init_count, (unsigned long long)tracker.init_bytes);
+    SDL_Log(
+        ALLOC_FRAMES_LOG,
+        (unsigned long long)allocations,
+        (unsigned long long)bytes,
+        (unsigned long long)tracker.frames,
+        (unsigned long long)tracker.allocating_frames,
+        (unsigned long long)tracker.last_allocating
+    );
+    for (int32_t i = 0; i < count && i < ALLOC_LOG_SITES; i++) {
+        AllocSite* site = &sites[i];
+        SDL_Log(
+            ALLOC_SITE_LOG,
+            site->site,
+            (unsigned long long)site->count,
+            (unsigned long long)site->bytes,
+            tracker.frames > 0 ? (double)site->count / tracker.frames : 0.0,
+            (unsigned long long)site->max_frame_count,
+            (unsigned long long)site->max_frame_bytes,
+            (unsigned long long)site->frames
+        );
+    }
+}
+
+void* tracked_malloc(size_t size, const char* site) {
+    __count(size, site);
+    return malloc(size);
+}
+
+void* tracked_calloc(size_t count, size_t size, const char* site) {
+    __count(count * size, site);
+    return calloc(count, size);
+}
+
+/**
+ * Counted even when shrinking, since realloc may move the memory.
+ */
+void* tracked_realloc(void* memory, size_t size, const char* site) {
+    __count(size, site);
+    return realloc(memory, size);
+}
+
+void tracked_free(void* memory) {
+    free(memory);
+}
+
+/**
+ * Whether tracking is on is read under the lock too, since other
+ * threads allocate while it is turned off. The lock is let go before
+ * logging, and counting stops, since SDL may allocate for the log
+ * and the allocation would abort again.
+ */
+static void __count(size_t size, const char* site) {
+    SDL_AtomicLock(&tracker.lock);
+    if (!tracker.enabled) {
+        SDL_AtomicUnlock(&tracker.lock);
+        return;
+    }
+
+    if (tracker.strict) {
+        tracker.enabled = false;
+        uint64_t frame = tracker.frame;
+        SDL_AtomicUnlock(&tracker.lock);
+        SDL_Log(ALLOC_STEADY_LOG, size, site, (unsigned long long)frame, (unsigned long long)tracker.warmup);
+        abort();
+    }
+
+    if (tracker.in_frame) {
+        AllocSite* counts = __find_site(site);
+        counts->count++;
+        counts->bytes += size;
+        counts->frame_count++;
+        counts->frame_bytes += size;
+    } else {
+        tracker.init_count++;
+        tracker.init_bytes += size;
+    }
+    SDL_AtomicUnlock(&tracker.lock);
+}
+
+/**
+ * Open addressing, probing linearly from the address' hash. The
+ * table is never emptied, so a site is found before any free slot.
+ */
+static AllocSite* __find_site(const char* site) {
+    uint32_t hash = (uint32_t)((uintptr_t)site >> 3) * 2654435761u;
+    for (int32_t probe = 0; probe < ALLOC_MAX_SITES; probe++) {
+        AllocSite* slot = &tracker.sites[(hash + (uint32_t)probe) % ALLOC_MAX_SITES];
+        if (slot->site == site) return slot;
+        if (slot->site == NULL) {
+            slot->site = site;
+            return slot;
+        }
+    }
+    return &tracker.other;
+}
+
+static bool __end_frame(AllocSite* site) {
+    if (site->frame_count == 0) return false;
+    if (site->frame_count > site->max_frame_count) site->max_frame_count = site->frame_count;
+    if (site->frame_bytes > site->max_frame_bytes) site->max_frame_bytes = site->frame_bytes;
+    site->frames++;
+    site->frame_count = 0;
+    site->frame_bytes = 0;
+    return true;
+}
+
+/**
+ * Can't subtract since the difference may not fit an int.
+ */
+static int __compare_sites(const void* a, const void* b) {
+    uint64_t x = ((const AllocSite*)a)->count;
+    uint64_t y = ((const AllocSite*)b)->count;
+    return (x < y) - (x > y);
+}
+
+static void* __sdl_malloc(size_t size) {
+    __count(size, SDL_SITE);
+    return tracker.sdl_malloc(size);
+}
+
+static void* __sdl_calloc(size_t count, size_t size) {
+    __count(count * size, SDL_SITE);
+    return tracker.sdl_calloc(count, size);
+}
+
+static void* __sdl_realloc(void* memory, size_t size) {
+    __count(size, SDL_SITE);
+    return tracker.sdl_realloc(memory, size);
+}
+
+static void __sdl_free(void* memory) {
+    tracker.sdl_free(memory);
+}
\ No newline at end of file
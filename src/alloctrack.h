@@ -0,0 +1,191 @@
+#ifndef Hq2Rj6NsLc_ALLOCTRACK_H
+#define Hq2Rj6NsLc_ALLOCTRACK_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+
+#include <SDL2/SDL.h>
+
+// The most call sites told apart, later ones are counted together
+#define ALLOC_MAX_SITES 512
+
+// Turn a macro's value into a string
+#define ALLOC_STRING(x) ALLOC_STRING_VALUE(x)
+#define ALLOC_STRING_VALUE(x) #x
+// The file and line of an allocation
+#define ALLOC_SITE __FILE__ ":" ALLOC_STRING(__LINE__)
+
+/**
+ * Struct:
+ *  AllocSite
+ *
+ * Purpose:
+ *  The allocations made at one place in the code.
+ *
+ * Fields:
+ *  - site:
+ *      The file and line, "SDL" for SDL's own allocations.
+ *  - count:
+ *      The number of allocations.
+ *  - bytes:
+ *      The bytes allocated.
+ *  - frame_count:
+ *      The number of allocations this frame.
+ *  - frame_bytes:
+ *      The bytes allocated this frame.
+ *  - max_frame_count:
+ *      The most allocations in a frame.
+ *  - max_frame_bytes:
+ *      The most bytes allocated in a frame.
+ *  - frames:
+ *      The number of frames it allocated in.
+ */
+typedef struct {
+    const char*     site;
+    uint64_t        count;
+    uint64_t        bytes;
+    uint64_t        frame_count;
+    uint64_t        frame_bytes;
+    uint64_t        max_frame_count;
+    uint64_t        max_frame_bytes;
+    uint64_t        frames;
+} AllocSite;
+
+/**
+ * Function:
+ *  init_alloc_tracking
+ *
+ * Purpose:
+ *  Start counting allocations, SDL's through its memory functions
+ *  and the game's when built with TRACK_ALLOCS. It must be called
+ *  before SDL is initialized.
+ *
+ * Parameters:
+ *  - warmup:
+ *      The number of frames allocating is allowed in, after which any
+ *      allocation is logged and aborts the game, 0 to always allow it.
+ *
+ * Returns:
+ *  Nothing.
+ */
+void init_alloc_tracking(uint64_t warmup);
+
+/**
+ * Function:
+ *  begin_alloc_frame
+ *
+ * Purpose:
+ *  Close the frame's counts and start counting the next one's.
+ *
+ * Parameters:
+ *  - frame:
+ *      The number of frames played so far.
+ *
+ * Returns:
+ *  Nothing.
+ */
+void begin_alloc_frame(uint64_t frame);
+
+/**
+ * Function:
+ *  log_alloc_tracking
+ *
+ * Purpose:
+ *  Log the sites that allocated the most, per frame and in total.
+ *
+ * Parameters:
+ *  None.
+ *
+ * Returns:
+ *  Nothing.
+ */
+void log_alloc_tracking(void);
+
+/**
+ * Function:
+ *  tracked_malloc
+ *
+ * Purpose:
+ *  malloc, counted for its site when tracking.
+ *
+ * Parameters:
+ *  - size:
+ *      The number of bytes.
+ *  - site:
+ *      Where it is allocated.
+ *
+ * Returns:
+ *  What malloc returns.
+ */
+void* tracked_malloc(size_t size, const char* site);
+
+/**
+ * Function:
+ *  tracked_calloc
+ *
+ * Purpose:
+ *  calloc, counted for its site when tracking.
+ *
+ * Parameters:
+ *  - count:
+ *      The number of elements.
+ *  - size:
+ *      The size of each.
+ *  - site:
+ *      Where it is allocated.
+ *
+ * Returns:
+ *  What calloc returns.
+ */
+void* tracked_calloc(size_t count, size_t size, const char* site);
+
+/**
+ * Function:
+ *  tracked_realloc
+ *
+ * Purpose:
+ *  realloc, counted for its site when tracking.
+ *
+ * Parameters:
+ *  - memory:
+ *      The memory to resize, may be NULL.
+ *  - size:
+ *      The new number of bytes.
+ *  - site:
+ *      Where it is allocated.
+ *
+ * Returns:
+ *  What realloc returns.
+ */
+void* tracked_realloc(void* memory, size_t size, const char* site);
+
+/**
+ * Function:
+ *  tracked_free
+ *
+ * Purpose:
+ *  free, which is not counted but kept beside the others.
+ *
+ * Parameters:
+ *  - memory:
+ *      The memory to free, may be NULL.
+ *
+ * Returns:
+ *  Nothing.
+ */
+void tracked_free(void* memory);
+
+// Builds with TRACK_ALLOCS include this header first in every file,
+// so the game's allocations go through the tracked functions
+#ifdef TRACK_ALLOCS
+#define malloc(size) tracked_malloc((size), ALLOC_SITE)
+#define calloc(count, size) tracked_calloc((count), (size), ALLOC_SITE)
+#define realloc(memory, size) tracked_realloc((memory), (size), ALLOC_SITE)
+#define free(memory) tracked_free(memory)
+#endif
+
+#endif
\ No newline at end of file
@@ -0,0 +1,152 @@
+#include "arena.h"
+
+// Log message when an arena grows to fit a frame that overflowed it
+static const char ARENA_GROW_LOG[] = "Arena: grew from %zu to %zu bytes";
+#ifdef DEBUG
+// What memory not handed out, new or taken back by a reset, is filled with
+static const int ARENA_POISON = 0xDD;
+#endif
+
+/**
+ * Function:
+ *  __spill
+ *
+ * Purpose:
+ *  Allocate what didn't fit the arena from the heap, keeping it
+ *  until the next reset.
+ *
+ * Parameters:
+ *  - arena:
+ *      The Arena object.
+ *  - size:
+ *      The number of bytes.
+ *  - alignment:
+ *      What the address is a multiple of, a power of two.
+ *
+ * Returns:
+ *  The memory.
+ */
+static void* __spill(Arena* arena, size_t size, size_t alignment);
+
+/**
+ * Function:
+ *  __free_spills
+ *
+ * Purpose:
+ *  Free the allocations that didn't fit the arena.
+ *
+ * Parameters:
+ *  - arena:
+ *      The Arena object.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __free_spills(Arena* arena);
+
+/**
+ * The capacity is rounded up to a multiple of 64 so it can be
+ * grown by doubling.
+ */
+Arena* init_arena(size_t capacity, ArenaOverflow overflow) {
+    Arena* arena = (Arena*)malloc(sizeof(Arena));
+    arena->capacity = (capacity + 63) & ~(size_t)63;
+    arena->memory = (uint8_t*)malloc(arena->capacity);
+#ifdef DEBUG
+    memset(arena->memory, ARENA_POISON, arena->capacity);
+#endif
+    arena->used = 0;
+    arena->spilled = 0;
+    arena->spills = NULL;
+    arena->high_water = 0;
+    arena->overflows = 0;
+    arena->overflow = overflow;
+    return arena;
+}
+
+/**
+ * The padding is found from the address rather than the offset, so
+ * alignments above what malloc gives hold too.
+ */
+void* arena_alloc(Arena* arena, size_t size, size_t alignment) {
+    uintptr_t address = (uintptr_t)(arena->memory + arena->used);
+    size_t padding = (size_t)(-address & (alignment - 1));
+
+    void* memory;
+    if (size <= arena->capacity - arena->used && padding <= arena->capacity - arena->used - size) {
+        memory = arena->memory + arena->used + padding;
+        arena->used += padding + size;
+    } else {
+        arena->overflows++;
+        if (arena->overflow == ARENA_OVERFLOW_FAIL) return NULL;
+        memory = __spill(arena, size, alignment);
+    }
+
+    size_t total = arena->used + arena->spilled;
+    if (total > arena->high_water) arena->high_water = total;
+    return memory;
+}
+
+/**
+ * Nothing allocated is in use anymore, so a grown arena is allocated
+ * anew rather than reallocated, which would copy it. A debug build
+ * poisons what was used, or all of the new buffer once grown.
+ */
+void reset_arena(Arena* arena) {
+    __free_spills(arena);
+#ifdef DEBUG
+    memset(arena->memory, ARENA_POISON, arena->used);
+#endif
+
+    size_t total = arena->used + arena->spilled;
+    if (total > arena->capacity) {
+        size_t capacity = arena->capacity;
+        while (capacity < total) capacity *= 2;
+        SDL_Log(ARENA_GROW_LOG, arena->capacity, capacity);
+        free(arena->memory);
+        arena->memory = (uint8_t*)malloc(capacity);
+        arena->capacity = capacity;
+#ifdef DEBUG
+        memset(arena->memory, ARENA_POISON, arena->capacity);
+#endif
+    }
+
+    arena->used = 0;
+    arena->spilled = 0;
+}
+
+/**
+ * Free everything spilled first.
+ */
+void destroy_arena(Arena* arena) {
+    __free_spills(arena);
+    free(arena->memory);
+    free(arena);
+}
+
+/**
+ * The memory follows the spill's header, padded to the alignment.
+ * Spilled bytes are counted with the padding, since the arena grows
+ * to fit them.
+ */
+static void* __spill(Arena* arena, size_t size, size_t alignment) {
+    size_t bytes = sizeof(ArenaSpill) + alignment - 1 + size;
+    ArenaSpill* spill = (ArenaSpill*)malloc(bytes);
+    spill->next = arena->spills;
+    arena->spills = spill;
+    arena->spilled += alignment - 1 + size;
+
+    uintptr_t address = (uintptr_t)(spill + 1);
+    return (void*)(address + (-address & (alignment - 1)));
+}
+
+/**
+ * Latest first, the order they are linked in.
+ */
+static void __free_spills(Arena* arena) {
+    while (arena->spills) {
+        ArenaSpill* spill = arena->spills;
+        arena->spills = spill->next;
+        free(spill);
+    }
+}
\ No newline at end of file
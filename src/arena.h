@@ -0,0 +1,162 @@
+#ifndef Vb8Kp3TxWm_ARENA_H
+#define Vb8Kp3TxWm_ARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <SDL2/SDL.h>
+
+// Allocate count objects of type from an arena, aligned for the type
+#define ARENA_NEW(arena, type, count) ((type*)arena_alloc((arena), sizeof(type) * (count), _Alignof(type)))
+
+/**
+ * Enum:
+ *  ArenaOverflow
+ *
+ * Purpose:
+ *  What an arena does when an allocation doesn't fit.
+ *
+ * Constants:
+ *  - ARENA_OVERFLOW_FAIL:
+ *      Return NULL.
+ *  - ARENA_OVERFLOW_GROW:
+ *      Allocate it from the heap until the next reset, which then
+ *      grows the arena to fit everything allocated since the last.
+ */
+typedef enum {
+    ARENA_OVERFLOW_FAIL = 0,
+    ARENA_OVERFLOW_GROW = 1
+} ArenaOverflow;
+
+/**
+ * Struct:
+ *  ArenaSpill
+ *
+ * Purpose:
+ *  An allocation that didn't fit the arena, taken from the heap,
+ *  its memory following it.
+ *
+ * Fields:
+ *  - next:
+ *      The allocation that spilled before it, NULL if none.
+ */
+typedef struct ArenaSpill {
+    struct ArenaSpill*  next;
+} ArenaSpill;
+
+/**
+ * Struct:
+ *  Arena
+ *
+ * Purpose:
+ *  Scratch memory handed out by bumping an offset and taken back
+ *  all at once by a reset, so memory needed for a frame costs no
+ *  malloc or free. It is not thread safe, allocate on one thread and
+ *  hand the memory to others.
+ *
+ * Fields:
+ *  - memory:
+ *      The arena's memory.
+ *  - capacity:
+ *      Its size in bytes.
+ *  - used:
+ *      The bytes handed out since the last reset, padding included.
+ *  - spilled:
+ *      The bytes allocated from the heap since the last reset.
+ *  - spills:
+ *      The allocations that didn't fit since the last reset, latest first.
+ *  - high_water:
+ *      The most bytes used and spilled between two resets.
+ *  - overflows:
+ *      The number of allocations that didn't fit.
+ *  - overflow:
+ *      What is done when an allocation doesn't fit.
+ */
+typedef struct {
+    uint8_t*        memory;
+    size_t          capacity;
+    size_t          used;
+    size_t          spilled;
+    ArenaSpill*     spills;
+    size_t          high_water;
+    uint64_t        overflows;
+    ArenaOverflow   overflow;
+} Arena;
+
+/**
+ * Function:
+ *  init_arena
+ *
+ * Purpose:
+ *  Create an Arena object.
+ *
+ * Parameters:
+ *  - capacity:
+ *      The arena's size in bytes.
+ *  - overflow:
+ *      What is done when an allocation doesn't fit.
+ *
+ * Returns:
+ *  The Arena object.
+ */
+Arena* init_arena(size_t capacity, ArenaOverflow overflow);
+
+/**
+ * Function:
+ *  arena_alloc
+ *
+ * Purpose:
+ *  Allocate memory that stays valid until the next reset.
+ *
+ * Parameters:
+ *  - arena:
+ *      The Arena object.
+ *  - size:
+ *      The number of bytes.
+ *  - alignment:
+ *      What the address is a multiple of, a power of two.
+ *
+ * Returns:
+ *  The memory, uninitialized, NULL if it didn't fit and the arena
+ *  doesn't grow.
+ */
+void* arena_alloc(Arena* arena, size_t size, size_t alignment);
+
+/**
+ * Function:
+ *  reset_arena
+ *
+ * Purpose:
+ *  Take back everything allocated, growing the arena first if it
+ *  overflowed. Debug builds fill the memory taken back with a
+ *  pattern, so reading it after the reset shows.
+ *
+ * Parameters:
+ *  - arena:
+ *      The Arena object.
+ *
+ * Returns:
+ *  Nothing.
+ */
+void reset_arena(Arena* arena);
+
+/**
+ * Function:
+ *  destroy_arena
+ *
+ * Purpose:
+ *  Release the Arena object.
+ *
+ * Parameters:
+ *  - arena:
+ *      The Arena object to destroy.
+ *
+ * Returns:
+ *  Nothing.
+ */
+void destroy_arena(Arena* arena);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,384 @@
+#include "atlas.h"
+
+// Error message when loading a sprite failed
+static const char LOAD_IMG_LOG[] = "Sprite not found: %s\n";
+// Error message when a sprite can't be converted or the atlas created
+static const char CREATE_SURFACE_LOG[] = "Could not create atlas surface: %s\n";
+// Error message when the sprites can't be packed
+static const char PACK_LOG[] = "Sprites do not fit in a %dx%d atlas\n";
+// Error message when fails to create texture
+static const char CREATE_TEXTURE_LOG[] = "Could not create texture from surface: %s\n";
+// Log message with how well the sprites were packed
+static const char ATLAS_LOG[] = "Atlas: %d sprites in %dx%d, %.1f%% filled, %.1f%% the size of the sprite files";
+// Log message with the atlas texture's format
+static const char ATLAS_FORMAT_LOG[] = "Atlas texture: %s, %s alpha";
+// The texture format when the renderer lists none fitting
+static const Uint32 FALLBACK_TEXTURE_FORMAT = SDL_PIXELFORMAT_ARGB8888;
+// Empty pixels around each sprite, so filtering never reads a neighbour
+static const int32_t ATLAS_PADDING = 1;
+// The widest (and tallest) atlas
+static const int32_t ATLAS_MAX_SIZE = 4096;
+
+/**
+ * Struct:
+ *  SpriteSource
+ *
+ * Purpose:
+ *  Where a sprite is loaded from.
+ *
+ * Fields:
+ *  - path:
+ *      The sprite file.
+ *  - rect:
+ *      The sprite's part of the file, all of it if empty.
+ */
+typedef struct {
+    const char*     path;
+    SDL_Rect        rect;
+} SpriteSource;
+
+// Each sprite's file and part of it, indexed by SpriteId
+static const SpriteSource SPRITE_SOURCES[SPRITE_COUNT] = {
+    { "assets/sprites/floortile.png",   { 0, 0, 0, 0 } },
+    { "assets/sprites/player.png",      { 0, 0, 0, 0 } },
+    // Done with: http://www.spritecow.com/
+    { "assets/sprites/enemy.png",       { 36, 22, 61, 62 } },
+    { "assets/sprites/enemy.png",       { 114, 23, 60, 62 } },
+    { "assets/sprites/enemy.png",       { 189, 26, 58, 62 } },
+    { "assets/sprites/enemy.png",       { 41, 98, 59, 61 } },
+    { "assets/sprites/enemy.png",       { 112, 99, 60, 61 } },
+    { "assets/sprites/enemy.png",       { 186, 101, 58, 61 } }
+};
+
+/**
+ * Function:
+ *  __load_sprites
+ *
+ * Purpose:
+ *  Load each sprite file once, in ARGB8888, and find each sprite's
+ *  part of its file.
+ *
+ * Parameters:
+ *  - atlas:
+ *      The Atlas object, which counts the pixels loaded.
+ *  - images:
+ *      Where each sprite's file is stored, sprites of the same file
+ *      sharing one surface.
+ *  - parts:
+ *      Where each sprite's part of its file is stored.
+ *
+ * Returns:
+ *  true if successful, false otherwise, in which case nothing stays loaded.
+ */
+static bool __load_sprites(Atlas* atlas, SDL_Surface** images, SDL_Rect* parts);
+
+/**
+ * Function:
+ *  __free_sprites
+ *
+ * Purpose:
+ *  Release the sprite files loaded, each once.
+ *
+ * Parameters:
+ *  - images:
+ *      Each sprite's file, NULL where none was loaded.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __free_sprites(SDL_Surface** images);
+
+/**
+ * Function:
+ *  __pack
+ *
+ * Purpose:
+ *  Place the sprites in the smallest atlas shelf packing finds.
+ *
+ * Parameters:
+ *  - atlas:
+ *      The Atlas object, given its rectangles and size.
+ *  - parts:
+ *      Each sprite's part of its file, for its size.
+ *
+ * Returns:
+ *  true if they fit, false otherwise.
+ */
+static bool __pack(Atlas* atlas, SDL_Rect* parts);
+
+/**
+ * Function:
+ *  __shelf
+ *
+ * Purpose:
+ *  Place sprites left to right in rows as tall as their first
+ *  sprite, starting a row when the next one doesn't fit.
+ *
+ * Parameters:
+ *  - parts:
+ *      Each sprite's part of its file, for its size.
+ *  - order:
+ *      The order the sprites are placed in, tallest first.
+ *  - width:
+ *      The atlas' width.
+ *  - rects:
+ *      Where each sprite's place is stored, NULL to only measure.
+ *
+ * Returns:
+ *  The atlas' height, -1 if a sprite is wider than it.
+ */
+static int32_t __shelf(SDL_Rect* parts, int32_t* order, int32_t width, SDL_Rect* rects);
+
+/**
+ * Function:
+ *  __premultiply
+ *
+ * Purpose:
+ *  Multiply each pixel's color channels by its alpha.
+ *
+ * Parameters:
+ *  - surface:
+ *      A surface of 32 bit pixels.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __premultiply(SDL_Surface* surface);
+
+/**
+ * Loading fails as a whole, which is where the log says what
+ * went wrong. The sprites are copied without blending, so their
+ * alpha ends up in the atlas as it was.
+ */
+Atlas* init_atlas(SDL_Renderer* renderer, Uint32 format) {
+    Atlas* atlas = (Atlas*)malloc(sizeof(Atlas));
+    atlas->texture = NULL;
+    atlas->surface = NULL;
+
+    SDL_Surface* images[SPRITE_COUNT];
+    SDL_Rect parts[SPRITE_COUNT];
+    if (!__load_sprites(atlas, images, parts)) {
+        free(atlas);
+        return NULL;
+    }
+
+    if (!__pack(atlas, parts)) {
+        SDL_Log(PACK_LOG, ATLAS_MAX_SIZE, ATLAS_MAX_SIZE);
+        __free_sprites(images);
+        free(atlas);
+        return NULL;
+    }
+
+    atlas->surface = SDL_CreateRGBSurfaceWithFormat(0, atlas->width, atlas->height, 32, SDL_PIXELFORMAT_ARGB8888);
+    if (atlas->surface == NULL) {
+        SDL_Log(CREATE_SURFACE_LOG, SDL_GetError());
+        __free_sprites(images);
+        free(atlas);
+        return NULL;
+    }
+    SDL_FillRect(atlas->surface, NULL, 0);
+    for (int32_t i = 0; i < SPRITE_COUNT; i++) {
+        SDL_SetSurfaceBlendMode(images[i], SDL_BLENDMODE_NONE);
+        SDL_BlitSurface(images[i], &parts[i], atlas->surface, &atlas->rects[i]);
+    }
+    __free_sprites(images);
+
+    bool premultiplied;
+    atlas->texture = create_native_texture(renderer, atlas->surface, format, &premultiplied);
+    if (atlas->texture == NULL) {
+        destroy_atlas(atlas);
+        return NULL;
+    }
+    SDL_Log(ATLAS_FORMAT_LOG, SDL_GetPixelFormatName(format), premultiplied ? "premultiplied" : "straight");
+
+    SDL_Log(
+        ATLAS_LOG,
+        SPRITE_COUNT,
+        atlas->width,
+        atlas->height,
+        100.0 * atlas->used / ((double)atlas->width * atlas->height),
+        100.0 * ((double)atlas->width * atlas->height) / atlas->loaded
+    );
+
+    return atlas;
+}
+
+/**
+ * Both may be missing if creating the texture failed.
+ */
+void destroy_atlas(Atlas* atlas) {
+    if (atlas->texture) SDL_DestroyTexture(atlas->texture);
+    if (atlas->surface) SDL_FreeSurface(atlas->surface);
+    free(atlas);
+}
+
+/**
+ * The renderer lists its formats best first. Those without alpha or
+ * with other sizes are skipped, since the sprites need the alpha and
+ * premultiplying works on 32 bit pixels.
+ */
+Uint32 native_texture_format(const SDL_RendererInfo* info) {
+    for (Uint32 i = 0; i < info->num_texture_formats; i++) {
+        Uint32 format = info->texture_formats[i];
+        if (!SDL_ISPIXELFORMAT_FOURCC(format) && SDL_ISPIXELFORMAT_ALPHA(format) && SDL_BITSPERPIXEL(format) == 32) return format;
+    }
+    return FALLBACK_TEXTURE_FORMAT;
+}
+
+/**
+ * Whether the renderer supports the premultiplied blend mode is only
+ * known by trying it, SDL's software renderer for one does not. The
+ * pixels are converted to a copy, so the surface stays straight for
+ * the software blitter.
+ */
+SDL_Texture* create_native_texture(SDL_Renderer* renderer, SDL_Surface* surface, Uint32 format, bool* premultiplied) {
+    SDL_Surface* converted = SDL_ConvertSurfaceFormat(surface, format, 0);
+    if (converted == NULL) {
+        SDL_Log(CREATE_SURFACE_LOG, SDL_GetError());
+        return NULL;
+    }
+
+    SDL_Texture* texture = SDL_CreateTexture(renderer, format, SDL_TEXTUREACCESS_STATIC, converted->w, converted->h);
+    if (texture == NULL) {
+        SDL_Log(CREATE_TEXTURE_LOG, SDL_GetError());
+        SDL_FreeSurface(converted);
+        return NULL;
+    }
+
+    SDL_BlendMode blend = SDL_ComposeCustomBlendMode(
+        SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SDL_BLENDOPERATION_ADD,
+        SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SDL_BLENDOPERATION_ADD
+    );
+    bool multiply = SDL_SetTextureBlendMode(texture, blend) == 0;
+    if (multiply) __premultiply(converted);
+    else SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+    if (premultiplied) *premultiplied = multiply;
+
+    if (SDL_UpdateTexture(texture, NULL, converted->pixels, converted->pitch) < 0) {
+        SDL_Log(CREATE_TEXTURE_LOG, SDL_GetError());
+        SDL_DestroyTexture(texture);
+        texture = NULL;
+    }
+    SDL_FreeSurface(converted);
+    return texture;
+}
+
+/**
+ * Sprites of the same file share its surface, found by comparing
+ * paths with the sprites before. An empty part is the whole file.
+ */
+static bool __load_sprites(Atlas* atlas, SDL_Surface** images, SDL_Rect* parts) {
+    atlas->loaded = 0;
+    for (int32_t i = 0; i < SPRITE_COUNT; i++) images[i] = NULL;
+
+    for (int32_t i = 0; i < SPRITE_COUNT; i++) {
+        const SpriteSource* source = &SPRITE_SOURCES[i];
+        for (int32_t j = 0; j < i && images[i] == NULL; j++) {
+            if (strcmp(SPRITE_SOURCES[j].path, source->path) == 0) images[i] = images[j];
+        }
+
+        if (images[i] == NULL) {
+            SDL_Surface* loaded = IMG_Load(source->path);
+            if (loaded == NULL) {
+                SDL_Log(LOAD_IMG_LOG, SDL_GetError());
+                __free_sprites(images);
+                return false;
+            }
+            images[i] = SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_ARGB8888, 0);
+            SDL_FreeSurface(loaded);
+            if (images[i] == NULL) {
+                SDL_Log(CREATE_SURFACE_LOG, SDL_GetError());
+                __free_sprites(images);
+                return false;
+            }
+            atlas->loaded += (int64_t)images[i]->w * images[i]->h;
+        }
+
+        parts[i] = source->rect.w > 0 ? source->rect : (SDL_Rect){ 0, 0, images[i]->w, images[i]->h };
+    }
+    return true;
+}
+
+/**
+ * A surface shared by several sprites is freed at its first.
+ */
+static void __free_sprites(SDL_Surface** images) {
+    for (int32_t i = 0; i < SPRITE_COUNT; i++) {
+        if (images[i] == NULL) continue;
+        bool first = true;
+        for (int32_t j = 0; j < i && first; j++) first = images[j] != images[i];
+        if (first) SDL_FreeSurface(images[i]);
+    }
+}
+
+/**
+ * Every power of two wide enough for the widest sprite is tried and
+ * the one giving the least area kept. There are few sprites, so they
+ * are ordered by insertion.
+ */
+static bool __pack(Atlas* atlas, SDL_Rect* parts) {
+    int32_t order[SPRITE_COUNT];
+    for (int32_t i = 0; i < SPRITE_COUNT; i++) {
+        int32_t j = i;
+        for (; j > 0 && parts[order[j - 1]].h < parts[i].h; j--) order[j] = order[j - 1];
+        order[j] = i;
+    }
+
+    int32_t best = -1;
+    int64_t best_area = 0;
+    for (int32_t width = 1; width <= ATLAS_MAX_SIZE; width *= 2) {
+        int32_t height = __shelf(parts, order, width, NULL);
+        if (height < 0 || height > ATLAS_MAX_SIZE) continue;
+        if (best < 0 || (int64_t)width * height < best_area) {
+            best = width;
+            best_area = (int64_t)width * height;
+        }
+    }
+    if (best < 0) return false;
+
+    atlas->width = best;
+    atlas->height = __shelf(parts, order, best, atlas->rects);
+    atlas->used = 0;
+    for (int32_t i = 0; i < SPRITE_COUNT; i++) atlas->used += (int64_t)parts[i].w * parts[i].h;
+    return true;
+}
+
+/**
+ * Sprites come tallest first, so each row is as tall as the sprite
+ * starting it. The padding goes between sprites and around the edge.
+ */
+static int32_t __shelf(SDL_Rect* parts, int32_t* order, int32_t width, SDL_Rect* rects) {
+    int32_t x = ATLAS_PADDING, y = ATLAS_PADDING, row_height = 0;
+    for (int32_t k = 0; k < SPRITE_COUNT; k++) {
+        SDL_Rect* part = &parts[order[k]];
+        if (part->w + 2 * ATLAS_PADDING > width) return -1;
+        if (x + part->w + ATLAS_PADDING > width) {
+            x = ATLAS_PADDING;
+            y += row_height + ATLAS_PADDING;
+            row_height = 0;
+        }
+        if (rects) rects[order[k]] = (SDL_Rect){ x, y, part->w, part->h };
+        x += part->w + ATLAS_PADDING;
+        if (part->h > row_height) row_height = part->h;
+    }
+    return y + row_height + ATLAS_PADDING;
+}
+
+/**
+ * Only runs once per texture at load, so going through SDL for the
+ * channels of whatever format it is costs nothing worth avoiding.
+ * Rounds to nearest.
+ */
+static void __premultiply(SDL_Surface* surface) {
+    for (int32_t y = 0; y < surface->h; y++) {
+        Uint32* row = (Uint32*)((Uint8*)surface->pixels + (ptrdiff_t)y * surface->pitch);
+        for (int32_t x = 0; x < surface->w; x++) {
+            Uint8 r, g, b, a;
+            SDL_GetRGBA(row[x], surface->format, &r, &g, &b, &a);
+            r = (Uint8)((r * a + 127) / 255);
+            g = (Uint8)((g * a + 127) / 255);
+            b = (Uint8)((b * a + 127) / 255);
+            row[x] = SDL_MapRGBA(surface->format, r, g, b, a);
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,153 @@
+#ifndef Zc4Ny7BgQe_ATLAS_H
+#define Zc4Ny7BgQe_ATLAS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+
+// The number of frames in the enemy's animation
+#define ENEMY_FRAMES 6
+
+/**
+ * Enum:
+ *  SpriteId
+ *
+ * Purpose:
+ *  The sprites packed into the atlas, indexing its rectangles.
+ *
+ * Constants:
+ *  - SPRITE_FLOOR:
+ *      A floor tile.
+ *  - SPRITE_PLAYER:
+ *      The player.
+ *  - SPRITE_ENEMY:
+ *      The enemy's first frame, the others follow in order.
+ *  - SPRITE_COUNT:
+ *      The number of sprites.
+ */
+typedef enum {
+    SPRITE_FLOOR    = 0,
+    SPRITE_PLAYER   = 1,
+    SPRITE_ENEMY    = 2,
+    SPRITE_COUNT    = SPRITE_ENEMY + ENEMY_FRAMES
+} SpriteId;
+
+/**
+ * Struct:
+ *  Atlas
+ *
+ * Purpose:
+ *  Every sprite of the game packed into one texture, so drawing
+ *  them in any order never switches textures. It is packed from the
+ *  sprite files each time the game starts, so it always matches them.
+ *
+ * Fields:
+ *  - texture:
+ *      The packed sprites, in the renderer's pixel format.
+ *  - surface:
+ *      Their pixels, ARGB8888, kept for drawing in software.
+ *  - rects:
+ *      Where each sprite is in the atlas, indexed by SpriteId.
+ *  - width:
+ *      The atlas' width.
+ *  - height:
+ *      The atlas' height.
+ *  - used:
+ *      The number of pixels the sprites cover.
+ *  - loaded:
+ *      The number of pixels of the sprite files, wasted space included.
+ */
+typedef struct {
+    SDL_Texture*    texture;
+    SDL_Surface*    surface;
+    SDL_Rect        rects[SPRITE_COUNT];
+    int32_t         width;
+    int32_t         height;
+    int64_t         used;
+    int64_t         loaded;
+} Atlas;
+
+/**
+ * Function:
+ *  init_atlas
+ *
+ * Purpose:
+ *  Load every sprite, pack them into one texture and log how much
+ *  of it they fill.
+ *
+ * Parameters:
+ *  - renderer:
+ *      A structure that contains a rendering state.
+ *  - format:
+ *      The pixel format of the texture, see native_texture_format.
+ *
+ * Returns:
+ *  The Atlas object, NULL if a sprite could not be loaded or the
+ *  texture could not be created.
+ */
+Atlas* init_atlas(SDL_Renderer* renderer, Uint32 format);
+
+/**
+ * Function:
+ *  destroy_atlas
+ *
+ * Purpose:
+ *  Release the Atlas object.
+ *
+ * Parameters:
+ *  - atlas:
+ *      The Atlas object to destroy.
+ *
+ * Returns:
+ *  Nothing.
+ */
+void destroy_atlas(Atlas* atlas);
+
+/**
+ * Function:
+ *  native_texture_format
+ *
+ * Purpose:
+ *  Find the pixel format a renderer draws textures with alpha from
+ *  without converting them, its first 32 bit one with alpha.
+ *
+ * Parameters:
+ *  - info:
+ *      The renderer's information.
+ *
+ * Returns:
+ *  The pixel format, ARGB8888 if the renderer lists none.
+ */
+Uint32 native_texture_format(const SDL_RendererInfo* info);
+
+/**
+ * Function:
+ *  create_native_texture
+ *
+ * Purpose:
+ *  Create a texture from a surface, converting its pixels to the
+ *  given format once here rather than on every copy. If the renderer
+ *  takes a premultiplied alpha blend mode, the pixels are premultiplied
+ *  and the texture blended so, otherwise it is blended as usual.
+ *
+ * Parameters:
+ *  - renderer:
+ *      A structure that contains a rendering state.
+ *  - surface:
+ *      The pixels, left as they are.
+ *  - format:
+ *      The texture's pixel format, 32 bits with alpha.
+ *  - premultiplied:
+ *      Where to store whether the alpha was premultiplied, may be NULL.
+ *
+ * Returns:
+ *  The texture, NULL if it could not be created.
+ */
+SDL_Texture* create_native_texture(SDL_Renderer* renderer, SDL_Surface* surface, Uint32 format, bool* premultiplied);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,2422 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include <SDL2/SDL.h>
+
+#include "gmath.h"
+#include "enemies.h"
+#include "flowfield.h"
+#include "tilemap.h"
+#include "camera.h"
+#include "collision.h"
+#include "jobs.h"
+#include "snapshot.h"
+#include "render.h"
+#include "blitter.h"
+#include "atlas.h"
+
+// A double representation of PI
+static const double PI = 3.14159265358979323846;
+// Names of the math backends, indexed by MathBackend
+static const char* BACKEND_NAMES[] = { "scalar", "SSE", "AVX2" };
+// Number of inputs the math accuracy is measured over
+static const int32_t ACCURACY_SAMPLES = 1<<20;
+// Number of elements per math throughput call, small enough to stay in cache
+static const int32_t THROUGHPUT_ELEMENTS = 1<<14;
+// Number of calls per math throughput measurement
+static const int32_t THROUGHPUT_ROUNDS = 2000;
+// Width of the simulated window for the enemy benchmarks
+static const int32_t BENCH_WIDTH = 1280;
+// Height of the simulated window for the enemy benchmarks
+static const int32_t BENCH_HEIGHT = 720;
+// Number of enemies in the enemy update benchmark
+static const int32_t UPDATE_ENEMIES = 10000;
+// Number of frames simulated in the enemy update benchmark
+static const int32_t UPDATE_FRAMES = 200;
+// Delta time of each simulated frame in milliseconds
+static const float BENCH_DT = 16.0f;
+// Scratch memory each drawing benchmark's frames start with, as in the game
+static const size_t BENCH_SCRATCH_SIZE = 1u<<20;
+// Number of enemies in the off-screen scene benchmark
+static const int32_t SCENE_ENEMIES = 10000;
+// Fraction of the scene's enemies that start within the window
+static const float SCENE_VISIBLE_FRACTION = 0.05f;
+// Number of frames simulated in the off-screen scene benchmark
+static const int32_t SCENE_FRAMES = 200;
+// Number of enemies in the level of detail benchmark
+static const int32_t LOD_ENEMIES = 200000;
+// Enemies in the level of detail benchmark are spread within this distance of the player
+static const float LOD_SPREAD = 8000.0f;
+// Number of frames simulated in the level of detail benchmark
+static const int32_t LOD_FRAMES = 200;
+// Radius of the circle the player walks in the level of detail benchmark
+static const float LOD_PLAYER_RADIUS = 200.0f;
+// How fast the player walks the circle, in radians per millisecond
+static const float LOD_PLAYER_SPEED = 0.001f;
+// Number of enemies in the flow field benchmark
+static const int32_t FLOW_ENEMIES = 100000;
+// How far beyond the window the flow field reaches, as in the game
+static const float FLOW_MARGIN = 640.0f;
+// The width (and height) of a flow field cell, as in the game
+static const float FLOW_CELL_SIZE = 32.0f;
+// Fraction of flow field cells blocked in the obstacle run
+static const float FLOW_BLOCKED_FRACTION = 0.1f;
+// Number of times the flow field is rebuilt or the enemies updated
+static const int32_t FLOW_ROUNDS = 100;
+// Enemy counts in the wall collision benchmark
+static const int32_t WALL_ENEMIES[] = { 10000, 100000 };
+// The width (and height) of a map tile, as in the game
+static const int32_t WALL_TILE_SIZE = 32;
+// Fraction of map tiles that are walls
+static const float WALL_FRACTION = 0.15f;
+// The radius of the box enemies keep out of walls, as in the game
+static const float WALL_ENEMY_RADIUS = 18.0f;
+// Number of frames simulated in the wall collision benchmark
+static const int32_t WALL_FRAMES = 100;
+// Number of positions tested for walls in the wall test throughput measurement
+static const int32_t WALL_TESTS = 1<<20;
+// Number of enemies in the world culling benchmark
+static const int32_t WORLD_ENEMIES = 1000000;
+// The width (and height) of the world in the world culling benchmark
+static const float WORLD_SIZE = 100000.0f;
+// Number of frames simulated in the world culling benchmark
+static const int32_t WORLD_FRAMES = 100;
+// Radius of the circle the player walks in the world culling benchmark
+static const float WORLD_PLAYER_RADIUS = 30000.0f;
+// Number of enemy slots in the wave benchmark
+static const int32_t WAVE_POOL = 100000;
+// The width (and height) of the world in the wave benchmark, small enough for enemies to arrive
+static const float WAVE_WORLD_SIZE = 2048.0f;
+// Number of frames simulated in the wave benchmark
+static const int32_t WAVE_FRAMES = 3000;
+// The spawn schedule of the wave benchmark, half the slots and then a wave every second
+static const EnemyWave BENCH_WAVES[] = { { 0.0f, 0.5f }, { 1000.0f, 0.05f } };
+// Number of enemies in the contact benchmark, all within the window
+static const int32_t CONTACT_ENEMIES = 100000;
+// Number of queries per contact measurement
+static const int32_t CONTACT_ROUNDS = 200;
+// Radius of the collider queried in the contact benchmark, about the player's
+static const float CONTACT_RADIUS = 30.0f;
+// Radius of the enemies in the contact benchmark, about the game's
+static const float CONTACT_ENEMY_RADIUS = 16.0f;
+// Number of entities in the ECS benchmark
+static const int32_t ECS_ENTITIES = 100000;
+// Number of frames simulated in the ECS benchmark
+static const int32_t ECS_FRAMES = 200;
+// How far an entity moves per millisecond in the ECS benchmark's movement system
+static const float ECS_SPEED = 0.1f;
+// Number of empty jobs per run when timing the job system's overhead
+static const int32_t JOB_OVERHEAD_JOBS = 4096;
+// Number of runs when timing the job system's overhead
+static const int32_t JOB_OVERHEAD_RUNS = 200;
+// Number of enemies in the job system benchmark
+static const int32_t JOB_ENEMIES = 100000;
+// Enemy rows per job, as in the game
+static const int32_t JOB_CHUNK = 1024;
+// Number of frames simulated in the job system benchmark
+static const int32_t JOB_FRAMES = 200;
+// Number of enemies in the pipeline benchmark
+static const int32_t PIPELINE_ENEMIES = 100000;
+// Fraction of the pipeline benchmark's enemies placed inside the window
+static const float PIPELINE_VISIBLE_FRACTION = 0.05f;
+// Number of frames played in the pipeline benchmark
+static const int32_t PIPELINE_FRAMES = 100;
+// Number of sprites per frame in the render buffer benchmark
+static const int32_t RENDER_SPRITES = 10000;
+// Number of textures the render buffer benchmark's sprites alternate between
+static const int32_t RENDER_TEXTURES = 4;
+// Number of frames in the render buffer benchmark
+static const int32_t RENDER_FRAMES = 200;
+// Visible enemies per frame in the blitter benchmark
+static const int32_t BLIT_ENEMIES[] = { 1000, 10000 };
+// Number of frames in the blitter benchmark
+static const int32_t BLIT_FRAMES = 20;
+// The size enemies are drawn at, as in the game
+static const int32_t BLIT_SPRITE_SIZE = 40;
+// Rotated enemies per frame in the tile benchmark, over a screen of floor tiles
+static const int32_t TILE_ENEMIES = 10000;
+// Number of frames in the tile benchmark
+static const int32_t TILE_FRAMES = 20;
+// The size of the floor tiles in the tile benchmark, as in the game
+static const int32_t TILE_FLOOR_SIZE = 32;
+// Moving enemies per frame in the dirty rectangle benchmark, over a still floor
+static const int32_t DIRTY_ENEMIES[] = { 10, 100, 1000, 10000 };
+// Number of frames in the dirty rectangle benchmark
+static const int32_t DIRTY_FRAMES = 50;
+// The number of sprites drawn per frame by the texture format benchmark
+static const int32_t FORMAT_SPRITES = 10000;
+// The number of frames the texture format benchmark draws
+static const int32_t FORMAT_FRAMES = 20;
+// Width of the texture standing in for the enemy spritesheet
+static const int32_t SHEET_WIDTH = 256;
+// Height of the texture standing in for the enemy spritesheet
+static const int32_t SHEET_HEIGHT = 192;
+// Enemies updated in each layout by the compact enemies benchmark
+static const int32_t COMPACT_ENEMIES = 1000000;
+// Width (and height) of the world the compact enemies benchmark spreads them over
+static const float COMPACT_WORLD_SIZE = 20000.0f;
+// Frames simulated by the compact enemies benchmark
+static const int32_t COMPACT_FRAMES = 100;
+// How far apart the layouts may move per update, in pixels, as documented in enemies.c
+static const float COMPACT_DRIFT_BOUND = 1.0f / 72.0f;
+// How far a packed heading may be from the way to the player, in degrees
+static const float COMPACT_HEADING_BOUND = 1.0f;
+// Names of the enemy layouts, floats and packed
+static const char* LAYOUT_NAMES[] = { "floats", "packed" };
+
+/**
+ * Struct:
+ *  BenchEnemy
+ *
+ * Purpose:
+ *  An enemy stored as one struct, the layout the ECS replaced,
+ *  kept to compare the two.
+ *
+ * Fields:
+ *  - position:
+ *      The enemy's position.
+ *  - facing:
+ *      The enemy's direction.
+ *  - phase:
+ *      The enemy's offset into its animation.
+ *  - updated:
+ *      The frame the enemy was last updated.
+ */
+typedef struct {
+    Point2d     position;
+    Vector2d    facing;
+    float       phase;
+    uint32_t    updated;
+} BenchEnemy;
+
+/**
+ * Struct:
+ *  BenchFrame
+ *
+ * Purpose:
+ *  What the tasks of the job system benchmark's frame work on.
+ *
+ * Fields:
+ *  - enemies:
+ *      The enemies.
+ *  - player:
+ *      The position of the player.
+ *  - rows:
+ *      The task updating the enemies' rows.
+ *  - camera:
+ *      The view the enemies are captured in.
+ *  - snapshot:
+ *      Where the enemies are captured, NULL to not capture them.
+ */
+typedef struct {
+    Enemies*    enemies;
+    Point2d     player;
+    Task*       rows;
+    Camera*     camera;
+    Snapshot*   snapshot;
+} BenchFrame;
+
+/**
+ * Struct:
+ *  Benchmark
+ *
+ * Purpose:
+ *  A named benchmark that can be picked from the command line.
+ *
+ * Fields:
+ *  - name:
+ *      The name used to select the benchmark.
+ *  - run:
+ *      Runs the benchmark and prints its results.
+ */
+typedef struct {
+    const char* name;
+    void        (*run)(void);
+} Benchmark;
+
+/**
+ * Function:
+ *  __bench_math
+ *
+ * Purpose:
+ *  Print the accuracy and throughput of the gmath approximations
+ *  for each supported backend.
+ *
+ * Parameters:
+ *  None.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __bench_math(void);
+
+/**
+ * Function:
+ *  __bench_enemy_update
+ *
+ * Purpose:
+ *  Print the cost of updating a single enemy.
+ *
+ * Parameters:
+ *  None.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __bench_enemy_update(void);
+
+/**
+ * Function:
+ *  __bench_offscreen_scene
+ *
+ * Purpose:
+ *  Print the per frame cost of updating and drawing a scene
+ *  where most enemies are outside the window.
+ *
+ * Parameters:
+ *  None.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __bench_offscreen_scene(void);
+
+/**
+ * Function:
+ *  __bench_lod_update
+ *
+ * Purpose:
+ *  Print the cost of updating a large crowd with and without level
+ *  of detail scheduling, and how far apart the two end up.
+ *
+ * Parameters:
+ *  None.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __bench_lod_update(void);
+
+/**
+ * Function:
+ *  __run_lod_update
+ *
+ * Purpose:
+ *  Simulate the level of detail benchmark with the player walking a circle.
+ *
+ * Parameters:
+ *  - enemies:
+ *      The Enemies object.
+ *  - player:
+ *      Set to the player's final position.
+ *
+ * Returns:
+ *  The seconds spent in update_enemies.
+ */
+static double __run_lod_update(Enemies* enemies, Point2d* player);
+
+/**
+ * Function:
+ *  __bench_flow_field
+ *
+ * Purpose:
+ *  Print the cost of building the flow field, with and without
+ *  obstacles, and of updating enemies that follow it.
+ *
+ * Parameters:
+ *  None.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __bench_flow_field(void);
+
+/**
+ * Function:
+ *  __run_flow_field
+ *
+ * Purpose:
+ *  Time rebuilding a flow field and updating enemies along it.
+ *
+ * Parameters:
+ *  - field:
+ *      The FlowField object.
+ *  - label:
+ *      What the field looks like, for the report.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __run_flow_field(FlowField* field, const char* label);
+
+/**
+ * Function:
+ *  __bench_walls
+ *
+ * Purpose:
+ *  Print the cost of testing for walls, and of updating enemies
+ *  that slide along walls compared to ones that walk through them.
+ *
+ * Parameters:
+ *  None.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __bench_walls(void);
+
+/**
+ * Function:
+ *  __bench_world_cull
+ *
+ * Purpose:
+ *  Print the cost of drawing and updating enemies spread over a
+ *  world much larger than the window, culled through the grid
+ *  and by testing every enemy.
+ *
+ * Parameters:
+ *  None.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __bench_world_cull(void);
+
+/**
+ * Function:
+ *  __bench_waves
+ *
+ * Purpose:
+ *  Print the cost of spawning waves of enemies that walk to the
+ *  player and die there, recycling their slots.
+ *
+ * Parameters:
+ *  None.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __bench_waves(void);
+
+/**
+ * Function:
+ *  __bench_contacts
+ *
+ * Purpose:
+ *  Print the cost of finding every enemy overlapping a collider
+ *  with each math backend, and of the single hit test.
+ *
+ * Parameters:
+ *  None.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __bench_contacts(void);
+
+/**
+ * Function:
+ *  __bench_ecs
+ *
+ * Purpose:
+ *  Print the cost of the enemy update and of a bare movement
+ *  system over the ECS's columns, against the same movement
+ *  over an array of structs.
+ *
+ * Parameters:
+ *  None.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __bench_ecs(void);
+
+/**
+ * Function:
+ *  __bench_jobs
+ *
+ * Purpose:
+ *  Print the job system's cost per job, and the enemy update
+ *  split into chunks on every core against one thread.
+ *
+ * Parameters:
+ *  None.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __bench_jobs(void);
+
+/**
+ * Function:
+ *  __bench_pipeline
+ *
+ * Purpose:
+ *  Print the time per frame of simulating and drawing one after
+ *  the other against drawing a frame while the next is simulated.
+ *
+ * Parameters:
+ *  None.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __bench_pipeline(void);
+
+/**
+ * Function:
+ *  __bench_render_buffer
+ *
+ * Purpose:
+ *  Print the cost of sorting draw commands, and the draw calls and
+ *  texture switches of drawing them sorted against in the order
+ *  they were added.
+ *
+ * Parameters:
+ *  None.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __bench_render_buffer(void);
+
+/**
+ * Function:
+ *  __bench_blit
+ *
+ * Purpose:
+ *  Print the time to draw rotated enemies with SDL's software
+ *  renderer and with the software blitter on each backend, and
+ *  check every backend draws the same pixels as the scalar one.
+ *
+ * Parameters:
+ *  None.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __bench_blit(void);
+
+/**
+ * Function:
+ *  __bench_tiles
+ *
+ * Purpose:
+ *  Print the time to draw a screen of floor tiles and rotated
+ *  enemies with the software blitter, without tiles and with its
+ *  tiles spread over 1 up to every core, and check the tiles draw
+ *  the same pixels.
+ *
+ * Parameters:
+ *  None.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __bench_tiles(void);
+
+/**
+ * Function:
+ *  __bench_dirty_rects
+ *
+ * Purpose:
+ *  Print the pixels redrawn and the time per frame of the software
+ *  blitter with a still floor and moving enemies, redrawing only
+ *  what changed against redrawing everything, at several enemy
+ *  counts, and check both end with the same pixels.
+ *
+ * Parameters:
+ *  None.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __bench_dirty_rects(void);
+
+/**
+ * Function:
+ *  __bench_texture_format
+ *
+ * Purpose:
+ *  Print the time for SDL's software renderer to draw sprites out
+ *  of a sheet in the format PNGs load in, ABGR8888, against the same
+ *  sheet converted once to the renderer's format, copied as they are
+ *  and rotated.
+ *
+ * Parameters:
+ *  None.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __bench_texture_format(void);
+
+/**
+ * Function:
+ *  __bench_compact_enemies
+ *
+ * Purpose:
+ *  Print the bytes per enemy and the update time of enemies kept in
+ *  floats against packed ones, and how far apart the two end up.
+ *
+ * Parameters:
+ *  None.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __bench_compact_enemies(void);
+
+/**
+ * Function:
+ *  __push_dirty_frame
+ *
+ * Purpose:
+ *  Add the commands of a frame of the dirty rectangle benchmark:
+ *  a screen of floor tiles and enemies that move and turn a little
+ *  every frame.
+ *
+ * Parameters:
+ *  - commands:
+ *      The RenderBuffer object.
+ *  - floor:
+ *      The floor's texture.
+ *  - enemy:
+ *      The enemies' texture.
+ *  - count:
+ *      The number of enemies.
+ *  - frame:
+ *      The frame, which the enemies' positions and angles follow from.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __push_dirty_frame(RenderBuffer* commands, SDL_Texture* floor, SDL_Texture* enemy, int32_t count, int32_t frame);
+
+/**
+ * Function:
+ *  __alloc_bench_sheet
+ *
+ * Purpose:
+ *  Create a surface standing in for the enemy spritesheet, with
+ *  random colors and about half of it see-through.
+ *
+ * Parameters:
+ *  None.
+ *
+ * Returns:
+ *  The surface, ARGB8888.
+ */
+static SDL_Surface* __alloc_bench_sheet(void);
+
+/**
+ * Function:
+ *  __add_bench_frame
+ *
+ * Purpose:
+ *  Add the tasks updating the enemies of a frame, with the same
+ *  graph as the game.
+ *
+ * Parameters:
+ *  - jobs:
+ *      The JobSystem object.
+ *  - frame:
+ *      The frame.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __add_bench_frame(JobSystem* jobs, BenchFrame* frame);
+
+/**
+ * Function:
+ *  __run_bench_frame
+ *
+ * Purpose:
+ *  Update the enemies of a frame through the job system.
+ *
+ * Parameters:
+ *  - jobs:
+ *      The JobSystem object.
+ *  - frame:
+ *      The frame.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __run_bench_frame(JobSystem* jobs, BenchFrame* frame);
+
+/**
+ * Function:
+ *  __bench_begin_job
+ *
+ * Purpose:
+ *  Starts the enemy update and sizes the row task.
+ *
+ * Parameters:
+ *  - data:
+ *      The BenchFrame.
+ *  - begin:
+ *      Unused.
+ *  - end:
+ *      Unused.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __bench_begin_job(void* data, int32_t begin, int32_t end);
+
+/**
+ * Function:
+ *  __bench_rows_job
+ *
+ * Purpose:
+ *  Updates a chunk of enemy rows.
+ *
+ * Parameters:
+ *  - data:
+ *      The BenchFrame.
+ *  - begin:
+ *      The first row.
+ *  - end:
+ *      One past the last row.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __bench_rows_job(void* data, int32_t begin, int32_t end);
+
+/**
+ * Function:
+ *  __bench_end_job
+ *
+ * Purpose:
+ *  Ends the enemy update.
+ *
+ * Parameters:
+ *  - data:
+ *      The BenchFrame.
+ *  - begin:
+ *      Unused.
+ *  - end:
+ *      Unused.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __bench_end_job(void* data, int32_t begin, int32_t end);
+
+/**
+ * Function:
+ *  __bench_capture_job
+ *
+ * Purpose:
+ *  Captures the enemies in view into the frame's snapshot.
+ *
+ * Parameters:
+ *  - data:
+ *      The BenchFrame.
+ *  - begin:
+ *      Unused.
+ *  - end:
+ *      Unused.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __bench_capture_job(void* data, int32_t begin, int32_t end);
+
+/**
+ * Function:
+ *  __bench_empty_job
+ *
+ * Purpose:
+ *  Does nothing, to time the job system alone.
+ *
+ * Parameters:
+ *  - data:
+ *      Unused.
+ *  - begin:
+ *      Unused.
+ *  - end:
+ *      Unused.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __bench_empty_job(void* data, int32_t begin, int32_t end);
+
+/**
+ * Function:
+ *  __alloc_bench_enemies
+ *
+ * Purpose:
+ *  Create an Enemies object without any textures, with enemies
+ *  spread around the simulated window like the game spawns them.
+ *
+ * Parameters:
+ *  - count:
+ *      The number of enemies.
+ *  - visible_fraction:
+ *      The fraction of enemies placed within the window instead.
+ *
+ * Returns:
+ *  The Enemies object, released with __free_bench_enemies.
+ */
+static Enemies* __alloc_bench_enemies(int32_t count, float visible_fraction);
+
+/**
+ * Function:
+ *  __alloc_bench_layout
+ *
+ * Purpose:
+ *  Create an Enemies object without any textures, with every
+ *  enemy alive and zeroed, in either layout.
+ *
+ * Parameters:
+ *  - count:
+ *      The number of enemies.
+ *  - compact:
+ *      Are enemies kept as PackedEnemy?
+ *
+ * Returns:
+ *  The Enemies object, released with __free_bench_enemies.
+ */
+static Enemies* __alloc_bench_layout(int32_t count, bool compact);
+
+/**
+ * Function:
+ *  __bench_position
+ *
+ * Purpose:
+ *  Find an enemy made by __alloc_bench_enemies by the order it
+ *  was made in, which is its entity's index, wherever its row is.
+ *
+ * Parameters:
+ *  - enemies:
+ *      The Enemies object.
+ *  - i:
+ *      The enemy's index.
+ *
+ * Returns:
+ *  The enemy's position, NULL if it has died.
+ */
+static Point2d* __bench_position(Enemies* enemies, int32_t i);
+
+/**
+ * Function:
+ *  __free_bench_enemies
+ *
+ * Purpose:
+ *  Release an Enemies object made by __alloc_bench_enemies.
+ *
+ * Parameters:
+ *  - enemies:
+ *      The Enemies object.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __free_bench_enemies(Enemies* enemies);
+
+/**
+ * Function:
+ *  __on_wall
+ *
+ * Purpose:
+ *  Check if the box around an enemy's collider touches a wall.
+ *
+ * Parameters:
+ *  - map:
+ *      The map with the walls.
+ *  - position:
+ *      The enemy's position, its top left corner.
+ *  - radius:
+ *      The enemy's collision radius.
+ *
+ * Returns:
+ *  true if any tile under the box is a wall, false otherwise.
+ */
+static bool __on_wall(TileMap* map, Point2d* position, float radius);
+
+/**
+ * Function:
+ *  __seconds_since
+ *
+ * Purpose:
+ *  Measure time elapsed since a performance counter value.
+ *
+ * Parameters:
+ *  - start:
+ *      The performance counter value to measure from.
+ *
+ * Returns:
+ *  The elapsed time in seconds.
+ */
+static double __seconds_since(Uint64 start);
+
+/**
+ * Function:
+ *  __random_float
+ *
+ * Purpose:
+ *  Pick a float uniformly from an interval.
+ *
+ * Parameters:
+ *  - lo:
+ *      The lower end of the interval.
+ *  - hi:
+ *      The upper end of the interval.
+ *
+ * Returns:
+ *  A random float in [lo, hi].
+ */
+static float __random_float(float lo, float hi);
+
+// All benchmarks, in the order they run
+static const Benchmark BENCHMARKS[] = {
+    { "math",           __bench_math },
+    { "enemy-update",   __bench_enemy_update },
+    { "offscreen-scene", __bench_offscreen_scene },
+    { "lod-update",     __bench_lod_update },
+    { "flow-field",     __bench_flow_field },
+    { "walls",          __bench_walls },
+    { "world-cull",     __bench_world_cull },
+    { "waves",          __bench_waves },
+    { "contacts",       __bench_contacts },
+    { "ecs",            __bench_ecs },
+    { "jobs",           __bench_jobs },
+    { "pipeline",       __bench_pipeline },
+    { "render-buffer",  __bench_render_buffer },
+    { "blit",           __bench_blit },
+    { "tiles",          __bench_tiles },
+    { "dirty-rects",    __bench_dirty_rects },
+    { "texture-format", __bench_texture_format },
+    { "compact-enemies", __bench_compact_enemies }
+};
+
+/**
+ * Function:
+ *  main
+ *
+ * Purpose:
+ *  Run the benchmarks named on the command line, or all of
+ *  them if none are named.
+ *
+ * Parameters:
+ * - argc:
+ *      The number of arguments.
+ * - argv:
+ *      The names of the benchmarks to run.
+ *
+ * returns:
+ *  0 on succcess, 1 if a benchmark name is unknown.
+ */
+int32_t main(int32_t argc, char** argv) {
+    srand(1);
+    int32_t count = (int32_t)(sizeof(BENCHMARKS) / sizeof(BENCHMARKS[0]));
+
+    if (argc < 2) {
+        for (int32_t i = 0; i < count; i++) BENCHMARKS[i].run();
+        return EXIT_SUCCESS;
+    }
+
+    for (int32_t a = 1; a < argc; a++) {
+        int32_t i = 0;
+        while (i < count && strcmp(argv[a], BENCHMARKS[i].name) != 0) i++;
+        if (i == count) {
+            fprintf(stderr, "Unknown benchmark: %s\n", argv[a]);
+            return EXIT_FAILURE;
+        }
+        BENCHMARKS[i].run();
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Accuracy is compared against libm in double precision. Inverse
+ * sqrt and normalize report relative error, the angles absolute
+ * error in radians. Throughput runs each function over a cache
+ * sized array many times.
+ */
+static void __bench_math(void) {
+    int32_t n = ACCURACY_SAMPLES;
+    float* a = (float*)malloc(sizeof(float) * n);
+    float* b = (float*)malloc(sizeof(float) * n);
+    float* c = (float*)malloc(sizeof(float) * n);
+    float* x = (float*)malloc(sizeof(float) * n);
+    float* y = (float*)malloc(sizeof(float) * n);
+
+    MathBackend original = get_math_backend();
+
+    printf("== math: accuracy vs libm over %d inputs ==\n", n);
+    printf("%-20s %-8s %12s %12s\n", "function", "backend", "max error", "mean error");
+    for (int32_t be = MATH_SCALAR; be <= MATH_AVX2; be++) {
+        if (!set_math_backend((MathBackend)be)) continue;
+        double max, sum;
+
+        // Lengths squared from a tenth of a pixel to ten thousand pixels
+        for (int32_t i = 0; i < n; i++) a[i] = powf(10.0f, __random_float(-2.0f, 8.0f));
+        inverse_sqrt_array(a, b, n);
+        max = sum = 0;
+        for (int32_t i = 0; i < n; i++) {
+            double e = fabs(b[i] * sqrt((double)a[i]) - 1.0);
+            sum += e;
+            if (e > max) max = e;
+        }
+        printf("%-20s %-8s %12.2e %12.2e\n", "inverse_sqrt", BACKEND_NAMES[be], max, sum / n);
+
+        for (int32_t i = 0; i < n; i++) a[i] = __random_float(-1.0f, 1.0f);
+        fast_acos_array(a, b, n);
+        max = sum = 0;
+        for (int32_t i = 0; i < n; i++) {
+            double e = fabs(b[i] - acos((double)a[i]));
+            sum += e;
+            if (e > max) max = e;
+        }
+        printf("%-20s %-8s %12.2e %12.2e\n", "acos", BACKEND_NAMES[be], max, sum / n);
+
+        for (int32_t i = 0; i < n; i++) {
+            x[i] = __random_float(-1000.0f, 1000.0f);
+            y[i] = __random_float(-1000.0f, 1000.0f);
+        }
+        fast_atan2_array(y, x, b, n);
+        max = sum = 0;
+        for (int32_t i = 0; i < n; i++) {
+            double e = fabs(b[i] - atan2((double)y[i], (double)x[i]));
+            if (e > PI) e = 2 * PI - e;
+            sum += e;
+            if (e > max) max = e;
+        }
+        printf("%-20s %-8s %12.2e %12.2e\n", "atan2", BACKEND_NAMES[be], max, sum / n);
+
+        normalize_array(x, y, n);
+        max = sum = 0;
+        for (int32_t i = 0; i < n; i++) {
+            double e = fabs(sqrt((double)x[i] * x[i] + (double)y[i] * y[i]) - 1.0);
+            sum += e;
+            if (e > max) max = e;
+        }
+        printf("%-20s %-8s %12.2e %12.2e\n", "normalize (length)", BACKEND_NAMES[be], max, sum / n);
+    }
+
+    n = THROUGHPUT_ELEMENTS;
+    double total = (double)n * THROUGHPUT_ROUNDS / 1e6;
+    for (int32_t i = 0; i < n; i++) {
+        a[i] = __random_float(1.0f, 1000.0f);
+        c[i] = __random_float(-1.0f, 1.0f);
+        x[i] = __random_float(-1000.0f, 1000.0f);
+        y[i] = __random_float(-1000.0f, 1000.0f);
+    }
+
+    printf("== math: throughput in million elements per second ==\n");
+    printf("%-8s %14s %14s %14s %14s\n", "backend", "inverse_sqrt", "acos", "atan2", "normalize");
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (int32_t r = 0; r < THROUGHPUT_ROUNDS; r++) for (int32_t i = 0; i < n; i++) b[i] = 1.0f / sqrtf(a[i]);
+    double t_isqrt = __seconds_since(start);
+    start = SDL_GetPerformanceCounter();
+    for (int32_t r = 0; r < THROUGHPUT_ROUNDS; r++) for (int32_t i = 0; i < n; i++) b[i] = acosf(c[i]);
+    double t_acos = __seconds_since(start);
+    start = SDL_GetPerformanceCounter();
+    for (int32_t r = 0; r < THROUGHPUT_ROUNDS; r++) for (int32_t i = 0; i < n; i++) b[i] = atan2f(y[i], x[i]);
+    double t_atan2 = __seconds_since(start);
+    printf("%-8s %14.0f %14.0f %14.0f %14s\n", "libm", total / t_isqrt, total / t_acos, total / t_atan2, "-");
+
+    for (int32_t be = MATH_SCALAR; be <= MATH_AVX2; be++) {
+        if (!set_math_backend((MathBackend)be)) continue;
+
+        start = SDL_GetPerformanceCounter();
+        for (int32_t r = 0; r < THROUGHPUT_ROUNDS; r++) inverse_sqrt_array(a, b, n);
+        t_isqrt = __seconds_since(start);
+
+        start = SDL_GetPerformanceCounter();
+        for (int32_t r = 0; r < THROUGHPUT_ROUNDS; r++) fast_acos_array(c, b, n);
+        t_acos = __seconds_since(start);
+
+        start = SDL_GetPerformanceCounter();
+        for (int32_t r = 0; r < THROUGHPUT_ROUNDS; r++) fast_atan2_array(y, x, b, n);
+        t_atan2 = __seconds_since(start);
+
+        // Normalizing twice in a row is the same work, unit vectors stay unit vectors
+        start = SDL_GetPerformanceCounter();
+        for (int32_t r = 0; r < THROUGHPUT_ROUNDS; r++) normalize_array(x, y, n);
+        double t_normalize = __seconds_since(start);
+
+        printf("%-8s %14.0f %14.0f %14.0f %14.0f\n", BACKEND_NAMES[be],
+            total / t_isqrt, total / t_acos, total / t_atan2, total / t_normalize);
+    }
+
+    set_math_backend(original);
+    free(a);
+    free(b);
+    free(c);
+    free(x);
+    free(y);
+}
+
+/**
+ * The player stands still in the middle of the window while the
+ * enemies walk towards it. Enemies start at least 100 pixels
+ * outside the window, so none reach it within the simulated frames.
+ */
+static void __bench_enemy_update(void) {
+    Enemies* enemies = __alloc_bench_enemies(UPDATE_ENEMIES, 0.0f);
+    Point2d player = { BENCH_WIDTH / 2.0f, BENCH_HEIGHT / 2.0f };
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (int32_t f = 0; f < UPDATE_FRAMES; f++) update_enemies(enemies, NULL, NULL, BENCH_DT, &player);
+    double seconds = __seconds_since(start);
+
+    printf("== enemy-update: %d enemies, %d frames ==\n", UPDATE_ENEMIES, UPDATE_FRAMES);
+    printf("%.2f ns per enemy update, %.3f ms per frame\n",
+        1e9 * seconds / ((double)UPDATE_ENEMIES * UPDATE_FRAMES), 1e3 * seconds / UPDATE_FRAMES);
+
+    __free_bench_enemies(enemies);
+}
+
+/**
+ * Draws into a software renderer backed by a plain surface, so no
+ * window or video driver is needed. The texture is blank, but blitting
+ * it costs the same. Update and draw are timed separately since only
+ * the visible enemies should cost anything when drawing.
+ */
+static void __bench_offscreen_scene(void) {
+    Enemies* enemies = __alloc_bench_enemies(SCENE_ENEMIES, SCENE_VISIBLE_FRACTION);
+    Point2d player = { BENCH_WIDTH / 2.0f, BENCH_HEIGHT / 2.0f };
+
+    SDL_Surface* target = SDL_CreateRGBSurfaceWithFormat(0, BENCH_WIDTH, BENCH_HEIGHT, 32, SDL_PIXELFORMAT_ARGB8888);
+    SDL_Renderer* renderer = SDL_CreateSoftwareRenderer(target);
+    RenderBuffer* commands = init_render_buffer();
+    Arena* scratch = init_arena(BENCH_SCRATCH_SIZE, ARENA_OVERFLOW_GROW);
+    enemies->texture = SDL_CreateTexture(
+        renderer,
+        SDL_PIXELFORMAT_ARGB8888,
+        SDL_TEXTUREACCESS_STATIC,
+        SHEET_WIDTH,
+        SHEET_HEIGHT
+    );
+    for (int32_t i = 0; i < 6; i++) enemies->texture_states[i] = (SDL_Rect){ 0, 0, 60, 62 };
+    Camera* camera = init_camera(BENCH_WIDTH, BENCH_HEIGHT, BENCH_WIDTH, BENCH_HEIGHT);
+    Snapshot* snapshot = init_snapshot(camera);
+
+    double update = 0, draw = 0;
+    for (int32_t f = 0; f < SCENE_FRAMES; f++) {
+        Uint64 start = SDL_GetPerformanceCounter();
+        update_enemies(enemies, NULL, NULL, BENCH_DT, &player);
+        update += __seconds_since(start);
+
+        start = SDL_GetPerformanceCounter();
+        clear_snapshot(snapshot, camera);
+        capture_enemies(enemies, snapshot);
+        draw_enemies(commands, enemies, snapshot);
+        reset_arena(scratch);
+        submit_render_buffer(commands, renderer, scratch);
+        draw += __seconds_since(start);
+    }
+
+    printf("== offscreen-scene: %d enemies, %.0f%% on screen, %d frames ==\n",
+        SCENE_ENEMIES, 100 * SCENE_VISIBLE_FRACTION, SCENE_FRAMES);
+    printf("update %.3f ms per frame, draw %.3f ms per frame\n",
+        1e3 * update / SCENE_FRAMES, 1e3 * draw / SCENE_FRAMES);
+
+    destroy_snapshot(snapshot);
+    destroy_camera(camera);
+    SDL_DestroyTexture(enemies->texture);
+    destroy_render_buffer(commands);
+    destroy_arena(scratch);
+    SDL_DestroyRenderer(renderer);
+    SDL_FreeSurface(target);
+    __free_bench_enemies(enemies);
+}
+
+/**
+ * Both runs start from the same enemies. The player keeps moving, so
+ * enemies that are updated less often aim at a stale position, which
+ * is what the deviation measures. Near is the distance within which
+ * every enemy is updated every frame, which covers the whole window.
+ */
+static void __bench_lod_update(void) {
+    Enemies* full = __alloc_bench_enemies(LOD_ENEMIES, 0.0f);
+    Enemies* lod = __alloc_bench_enemies(LOD_ENEMIES, 0.0f);
+    for (int32_t i = 0; i < LOD_ENEMIES; i++) {
+        float angle = __random_float(0.0f, 2 * PI);
+        float distance = LOD_SPREAD * sqrtf(__random_float(0.0f, 1.0f));
+        *__bench_position(full, i) = (Point2d){
+            BENCH_WIDTH / 2.0f + distance * cosf(angle),
+            BENCH_HEIGHT / 2.0f + distance * sinf(angle)
+        };
+        *__bench_position(lod, i) = *__bench_position(full, i);
+    }
+    full->lod = false;
+
+    Point2d player;
+    double full_seconds = __run_lod_update(full, &player);
+    double lod_seconds = __run_lod_update(lod, &player);
+
+    double due = 0, near_max = 0, all_max = 0;
+    uint8_t* periods = (uint8_t*)lod->archetype->columns[COMPONENT_LOD_PERIOD];
+    for (int32_t row = 0; row < lod->archetype->count; row++) due += 1.0 / periods[row];
+    for (int32_t i = 0; i < LOD_ENEMIES; i++) {
+        if (__bench_position(full, i) == NULL || __bench_position(lod, i) == NULL) continue;
+        Point2d a = *__bench_position(full, i), b = *__bench_position(lod, i);
+        double dev = sqrt((double)(a.x - b.x) * (a.x - b.x) + (double)(a.y - b.y) * (a.y - b.y));
+        double dx = a.x - player.x, dy = a.y - player.y;
+        if (dx * dx + dy * dy < lod->lod_near_squared && dev > near_max) near_max = dev;
+        if (dev > all_max) all_max = dev;
+    }
+
+    printf("== lod-update: %d enemies within %.0f px, %d frames ==\n", LOD_ENEMIES, LOD_SPREAD, LOD_FRAMES);
+    printf("every frame %.3f ms per frame, lod %.3f ms per frame, %.1f%% updated per frame\n",
+        1e3 * full_seconds / LOD_FRAMES, 1e3 * lod_seconds / LOD_FRAMES, 100 * due / LOD_ENEMIES);
+    printf("max deviation %.3f px near the player, %.3f px overall\n", near_max, all_max);
+
+    __free_bench_enemies(full);
+    __free_bench_enemies(lod);
+}
+
+/**
+ * Only update_enemies is timed, moving the player is not.
+ */
+static double __run_lod_update(Enemies* enemies, Point2d* player) {
+    double seconds = 0;
+    for (int32_t f = 0; f < LOD_FRAMES; f++) {
+        float angle = f * BENCH_DT * LOD_PLAYER_SPEED;
+        *player = (Point2d){
+            BENCH_WIDTH / 2.0f + LOD_PLAYER_RADIUS * cosf(angle),
+            BENCH_HEIGHT / 2.0f + LOD_PLAYER_RADIUS * sinf(angle)
+        };
+        Uint64 start = SDL_GetPerformanceCounter();
+        update_enemies(enemies, NULL, NULL, BENCH_DT, player);
+        seconds += __seconds_since(start);
+    }
+    return seconds;
+}
+
+/**
+ * The field covers the window and the band enemies spawn in, like
+ * in the game. Obstacles are scattered at random, away from the
+ * player, so some cells end up walled in and unreachable.
+ */
+static void __bench_flow_field(void) {
+    FlowField* field = init_flow_field(
+        (Point2d){ -FLOW_MARGIN, -FLOW_MARGIN },
+        BENCH_WIDTH + 2 * FLOW_MARGIN,
+        BENCH_HEIGHT + 2 * FLOW_MARGIN,
+        FLOW_CELL_SIZE
+    );
+
+    printf("== flow-field: %d x %d cells, %d enemies ==\n", field->cols, field->rows, FLOW_ENEMIES);
+    __run_flow_field(field, "open");
+
+    Point2d player = { BENCH_WIDTH / 2.0f, BENCH_HEIGHT / 2.0f };
+    int32_t player_col = (int32_t)((player.x + FLOW_MARGIN) / FLOW_CELL_SIZE);
+    int32_t player_row = (int32_t)((player.y + FLOW_MARGIN) / FLOW_CELL_SIZE);
+    for (int32_t row = 0; row < field->rows; row++) {
+        for (int32_t col = 0; col < field->cols; col++) {
+            bool near = abs(col - player_col) <= 2 && abs(row - player_row) <= 2;
+            if (!near && __random_float(0.0f, 1.0f) < FLOW_BLOCKED_FRACTION) {
+                set_flow_field_blocked(field, col, row, true);
+            }
+        }
+    }
+    __run_flow_field(field, "10% blocked");
+
+    destroy_flow_field(field);
+}
+
+/**
+ * The field is marked dirty before each rebuild, since it is
+ * otherwise skipped while the target stays in the same cell.
+ * Enemies are placed anywhere on the field, and their updates
+ * are timed following the field and walking straight.
+ */
+static void __run_flow_field(FlowField* field, const char* label) {
+    Point2d player = { BENCH_WIDTH / 2.0f, BENCH_HEIGHT / 2.0f };
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (int32_t r = 0; r < FLOW_ROUNDS; r++) {
+        field->dirty = true;
+        update_flow_field(field, &player);
+    }
+    double build = __seconds_since(start) / FLOW_ROUNDS;
+
+    // The target's own cell has no direction either
+    int32_t n = field->cols * field->rows, visible = 0, unreachable = -1;
+    for (int32_t i = 0; i < n; i++) {
+        visible += field->visible[i];
+        unreachable += !field->blocked[i] && field->directions[i].x == 0 && field->directions[i].y == 0;
+    }
+
+    Enemies* enemies = __alloc_bench_enemies(FLOW_ENEMIES, 0.0f);
+    for (int32_t i = 0; i < FLOW_ENEMIES; i++) {
+        *__bench_position(enemies, i) = (Point2d){
+            __random_float(field->origin.x, field->origin.x + field->cols * field->cell_size),
+            __random_float(field->origin.y, field->origin.y + field->rows * field->cell_size)
+        };
+    }
+
+    start = SDL_GetPerformanceCounter();
+    for (int32_t r = 0; r < FLOW_ROUNDS; r++) update_enemies(enemies, field, NULL, BENCH_DT, &player);
+    double follow = __seconds_since(start) / ((double)FLOW_ROUNDS * FLOW_ENEMIES);
+
+    start = SDL_GetPerformanceCounter();
+    for (int32_t r = 0; r < FLOW_ROUNDS; r++) update_enemies(enemies, NULL, NULL, BENCH_DT, &player);
+    double straight = __seconds_since(start) / ((double)FLOW_ROUNDS * FLOW_ENEMIES);
+
+    printf("%-12s build %.3f ms, %.1f%% cells visible, %d unreachable\n",
+        label, 1e3 * build, 100.0 * visible / n, unreachable);
+    printf("%-12s %.2f ns per enemy following the field, %.2f ns walking straight\n",
+        label, 1e9 * follow, 1e9 * straight);
+
+    __free_bench_enemies(enemies);
+}
+
+/**
+ * Walls are scattered at random over the window, and enemies placed
+ * anywhere within it, walking straight at the player in the middle.
+ * The same enemies are simulated with and without the map. Enemies
+ * still in a wall at the end are those that spawned in one and have
+ * not walked out yet.
+ */
+static void __bench_walls(void) {
+    TileMap* map = init_tile_map(BENCH_WIDTH / WALL_TILE_SIZE + 1, BENCH_HEIGHT / WALL_TILE_SIZE + 1, WALL_TILE_SIZE);
+    for (int32_t row = 0; row < map->rows; row++) {
+        for (int32_t col = 0; col < map->cols; col++) {
+            if (__random_float(0.0f, 1.0f) < WALL_FRACTION) set_wall(map, col, row, true);
+        }
+    }
+
+    float* x = (float*)malloc(sizeof(float) * WALL_TESTS);
+    float* y = (float*)malloc(sizeof(float) * WALL_TESTS);
+    for (int32_t i = 0; i < WALL_TESTS; i++) {
+        x[i] = __random_float(-100.0f, BENCH_WIDTH + 100.0f);
+        y[i] = __random_float(-100.0f, BENCH_HEIGHT + 100.0f);
+    }
+    int32_t hits = 0;
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (int32_t i = 0; i < WALL_TESTS; i++) hits += is_wall_at(map, x[i], y[i]);
+    double test = __seconds_since(start) / WALL_TESTS;
+    free(x);
+    free(y);
+
+    printf("== walls: %d x %d tiles, %.0f%% walls ==\n", map->cols, map->rows, 100 * WALL_FRACTION);
+    printf("%.2f ns per wall test (%d hits)\n", 1e9 * test, hits);
+
+    Point2d player = { BENCH_WIDTH / 2.0f, BENCH_HEIGHT / 2.0f };
+    for (size_t c = 0; c < sizeof(WALL_ENEMIES) / sizeof(WALL_ENEMIES[0]); c++) {
+        int32_t count = WALL_ENEMIES[c];
+        Enemies* free_walking = __alloc_bench_enemies(count, 1.0f);
+        Enemies* sliding = __alloc_bench_enemies(count, 0.0f);
+        memcpy(sliding->archetype->columns[COMPONENT_POSITION], free_walking->archetype->columns[COMPONENT_POSITION],
+            sizeof(Point2d) * count);
+        Point2d* positions = (Point2d*)sliding->archetype->columns[COMPONENT_POSITION];
+        bool* started_clear = (bool*)malloc(sizeof(bool) * count);
+        for (int32_t i = 0; i < count; i++) {
+            started_clear[i] = !__on_wall(map, &positions[i], WALL_ENEMY_RADIUS);
+        }
+
+        start = SDL_GetPerformanceCounter();
+        for (int32_t f = 0; f < WALL_FRAMES; f++) update_enemies(free_walking, NULL, NULL, BENCH_DT, &player);
+        double through = __seconds_since(start) / ((double)WALL_FRAMES * count);
+
+        start = SDL_GetPerformanceCounter();
+        for (int32_t f = 0; f < WALL_FRAMES; f++) update_enemies(sliding, NULL, map, BENCH_DT, &player);
+        double slide = __seconds_since(start) / ((double)WALL_FRAMES * count);
+
+        // Enemies that spawned on a wall walk off it, the rest should never touch one
+        int32_t clear = 0, onto = 0;
+        for (int32_t row = 0; row < sliding->archetype->count; row++) {
+            if (!started_clear[sliding->archetype->entities[row] & ENTITY_INDEX_MASK]) continue;
+            clear++;
+            onto += __on_wall(map, &positions[row], WALL_ENEMY_RADIUS);
+        }
+        free(started_clear);
+
+        printf("%6d enemies: %.2f ns per update sliding along walls, %.2f ns walking through, %d of %d clear got onto walls\n",
+            count, 1e9 * slide, 1e9 * through, onto, clear);
+
+        __free_bench_enemies(free_walking);
+        __free_bench_enemies(sliding);
+    }
+
+    destroy_tile_map(map);
+}
+
+/**
+ * Enemies are spread uniformly over the world and the player walks
+ * a wide circle around its middle, with the camera following. Two
+ * copies of the same enemies are simulated, one bucketed in a grid
+ * and one not, so both draw the same enemies each frame. The texture
+ * is blank, so what is timed is mostly finding what to draw.
+ */
+static void __bench_world_cull(void) {
+    Enemies* indexed = __alloc_bench_enemies(WORLD_ENEMIES, 0.0f);
+    Enemies* scanned = __alloc_bench_enemies(WORLD_ENEMIES, 0.0f);
+    for (int32_t i = 0; i < WORLD_ENEMIES; i++) {
+        *__bench_position(indexed, i) = (Point2d){ __random_float(0.0f, WORLD_SIZE), __random_float(0.0f, WORLD_SIZE) };
+    }
+    memcpy(scanned->archetype->columns[COMPONENT_POSITION], indexed->archetype->columns[COMPONENT_POSITION],
+        sizeof(Point2d) * WORLD_ENEMIES);
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    init_enemy_grid(indexed, WORLD_SIZE, WORLD_SIZE);
+    double build = __seconds_since(start);
+
+    SDL_Surface* target = SDL_CreateRGBSurfaceWithFormat(0, BENCH_WIDTH, BENCH_HEIGHT, 32, SDL_PIXELFORMAT_ARGB8888);
+    SDL_Renderer* renderer = SDL_CreateSoftwareRenderer(target);
+    RenderBuffer* commands = init_render_buffer();
+    Arena* scratch = init_arena(BENCH_SCRATCH_SIZE, ARENA_OVERFLOW_GROW);
+    SDL_Texture* texture = SDL_CreateTexture(
+        renderer,
+        SDL_PIXELFORMAT_ARGB8888,
+        SDL_TEXTUREACCESS_STATIC,
+        SHEET_WIDTH,
+        SHEET_HEIGHT
+    );
+    indexed->texture = scanned->texture = texture;
+    for (int32_t i = 0; i < 6; i++) {
+        indexed->texture_states[i] = scanned->texture_states[i] = (SDL_Rect){ 0, 0, 60, 62 };
+    }
+    Camera* camera = init_camera(BENCH_WIDTH, BENCH_HEIGHT, WORLD_SIZE, WORLD_SIZE);
+    Snapshot* snapshot = init_snapshot(camera);
+
+    double update_indexed = 0, update_scanned = 0, draw_indexed = 0, draw_scanned = 0;
+    int64_t shown = 0;
+    for (int32_t f = 0; f < WORLD_FRAMES; f++) {
+        float angle = f * BENCH_DT * LOD_PLAYER_SPEED;
+        Point2d player = {
+            WORLD_SIZE / 2.0f + WORLD_PLAYER_RADIUS * cosf(angle),
+            WORLD_SIZE / 2.0f + WORLD_PLAYER_RADIUS * sinf(angle)
+        };
+        update_camera(camera, &player);
+
+        start = SDL_GetPerformanceCounter();
+        update_enemies(indexed, NULL, NULL, BENCH_DT, &player);
+        update_indexed += __seconds_since(start);
+
+        start = SDL_GetPerformanceCounter();
+        update_enemies(scanned, NULL, NULL, BENCH_DT, &player);
+        update_scanned += __seconds_since(start);
+
+        start = SDL_GetPerformanceCounter();
+        clear_snapshot(snapshot, camera);
+        capture_enemies(indexed, snapshot);
+        draw_enemies(commands, indexed, snapshot);
+        reset_arena(scratch);
+        submit_render_buffer(commands, renderer, scratch);
+        draw_indexed += __seconds_since(start);
+
+        start = SDL_GetPerformanceCounter();
+        clear_snapshot(snapshot, camera);
+        capture_enemies(scanned, snapshot);
+        draw_enemies(commands, scanned, snapshot);
+        reset_arena(scratch);
+        submit_render_buffer(commands, renderer, scratch);
+        draw_scanned += __seconds_since(start);
+
+        Point2d* positions = (Point2d*)scanned->archetype->columns[COMPONENT_POSITION];
+        for (int32_t row = 0; row < scanned->archetype->count; row++) {
+            Point2d p = positions[row];
+            shown += p.x > camera->position.x - 40 && p.x < camera->position.x + BENCH_WIDTH
+                && p.y > camera->position.y - 40 && p.y < camera->position.y + BENCH_HEIGHT;
+        }
+    }
+
+    printf("== world-cull: %d enemies in a %.0f x %.0f world, %d frames ==\n",
+        WORLD_ENEMIES, WORLD_SIZE, WORLD_SIZE, WORLD_FRAMES);
+    printf("grid built in %.3f ms, %d x %d cells, %.1f enemies on screen per frame\n",
+        1e3 * build, indexed->grid->cols, indexed->grid->rows, (double)shown / WORLD_FRAMES);
+    printf("draw %.4f ms per frame through the grid, %.4f ms testing every enemy\n",
+        1e3 * draw_indexed / WORLD_FRAMES, 1e3 * draw_scanned / WORLD_FRAMES);
+    printf("update %.3f ms per frame keeping the grid, %.3f ms without\n",
+        1e3 * update_indexed / WORLD_FRAMES, 1e3 * update_scanned / WORLD_FRAMES);
+
+    destroy_snapshot(snapshot);
+    destroy_camera(camera);
+    SDL_DestroyTexture(texture);
+    destroy_render_buffer(commands);
+    destroy_arena(scratch);
+    SDL_DestroyRenderer(renderer);
+    SDL_FreeSurface(target);
+    __free_bench_enemies(indexed);
+    __free_bench_enemies(scanned);
+}
+
+/**
+ * The enemies are killed, like init_enemies leaves them, and the
+ * world is small enough for most to reach the player in the middle,
+ * where they die and their slots are taken by later waves. Spawning
+ * and updating are timed together, since a slot is recycled across
+ * both, and the update cost is also given per living enemy.
+ */
+static void __bench_waves(void) {
+    Enemies* enemies = __alloc_bench_enemies(WAVE_POOL, 0.0f);
+    while (enemies->archetype->count > 0) kill_enemy(enemies, enemies->archetype->entities[enemies->archetype->count - 1]);
+    init_enemy_grid(enemies, WAVE_WORLD_SIZE, WAVE_WORLD_SIZE);
+    set_enemy_waves(enemies, BENCH_WAVES, (int32_t)(sizeof(BENCH_WAVES) / sizeof(BENCH_WAVES[0])));
+
+    Camera* camera = init_camera(BENCH_WIDTH, BENCH_HEIGHT, WAVE_WORLD_SIZE, WAVE_WORLD_SIZE);
+    Point2d player = { WAVE_WORLD_SIZE / 2.0f, WAVE_WORLD_SIZE / 2.0f };
+    update_camera(camera, &player);
+
+    int64_t spawned = 0, killed = 0, live = 0;
+    int32_t peak = 0;
+    double spawn = 0, update = 0;
+    for (int32_t f = 0; f < WAVE_FRAMES; f++) {
+        int32_t before = enemies->archetype->count;
+        Uint64 start = SDL_GetPerformanceCounter();
+        spawn_enemy_waves(enemies, camera, BENCH_DT);
+        spawn += __seconds_since(start);
+        spawned += enemies->archetype->count - before;
+
+        before = enemies->archetype->count;
+        start = SDL_GetPerformanceCounter();
+        update_enemies(enemies, NULL, NULL, BENCH_DT, &player);
+        update += __seconds_since(start);
+        killed += before - enemies->archetype->count;
+
+        live += enemies->archetype->count;
+        if (enemies->archetype->count > peak) peak = enemies->archetype->count;
+    }
+
+    printf("== waves: %d slots in a %.0f x %.0f world, %d frames ==\n",
+        WAVE_POOL, WAVE_WORLD_SIZE, WAVE_WORLD_SIZE, WAVE_FRAMES);
+    printf("%lld spawned, %lld killed, %.0f alive on average, %d at most, %d at the end\n",
+        (long long)spawned, (long long)killed, (double)live / WAVE_FRAMES, peak, enemies->archetype->count);
+    printf("spawn %.3f ms per frame (%.1f ns per enemy), update %.3f ms per frame (%.2f ns per living enemy)\n",
+        1e3 * spawn / WAVE_FRAMES, spawned ? 1e9 * spawn / spawned : 0.0,
+        1e3 * update / WAVE_FRAMES, 1e9 * update / live);
+
+    destroy_camera(camera);
+    __free_bench_enemies(enemies);
+}
+
+/**
+ * Every enemy is in the window and the collider is in its middle,
+ * so a few hundred overlap it. Each backend must find the same
+ * contacts as scalar. The single hit test is timed with the
+ * collider out of reach, the worst case where it tests them all.
+ */
+static void __bench_contacts(void) {
+    Enemies* enemies = __alloc_bench_enemies(CONTACT_ENEMIES, 1.0f);
+    enemies->collision_radius = CONTACT_ENEMY_RADIUS;
+    Contact* contacts = (Contact*)malloc(sizeof(Contact) * CONTACT_ENEMIES);
+    Contact* expected = (Contact*)malloc(sizeof(Contact) * CONTACT_ENEMIES);
+    Collider collider = { { BENCH_WIDTH / 2.0f, BENCH_HEIGHT / 2.0f }, CONTACT_RADIUS };
+    MathBackend original = get_math_backend();
+
+    printf("== contacts: %d enemies, %d queries ==\n", CONTACT_ENEMIES, CONTACT_ROUNDS);
+    int32_t n_expected = 0;
+    double scalar = 0;
+    for (int32_t be = MATH_SCALAR; be <= MATH_AVX2; be++) {
+        if (!set_math_backend((MathBackend)be)) continue;
+        int32_t n = 0;
+        Uint64 start = SDL_GetPerformanceCounter();
+        for (int32_t r = 0; r < CONTACT_ROUNDS; r++) {
+            n = player_enemy_contacts(&collider, enemies, contacts, CONTACT_ENEMIES);
+        }
+        double t = __seconds_since(start) / CONTACT_ROUNDS;
+
+        if (be == MATH_SCALAR) {
+            n_expected = n;
+            scalar = t;
+            memcpy(expected, contacts, sizeof(Contact) * n);
+        }
+        bool same = n == n_expected && memcmp(contacts, expected, sizeof(Contact) * n) == 0;
+        printf("%-8s %.3f ms per query (%.2f ns per enemy), %d contacts, %.2fx scalar%s\n",
+            BACKEND_NAMES[be], 1e3 * t, 1e9 * t / CONTACT_ENEMIES, n, scalar / t,
+            same ? "" : ", DIFFERENT FROM SCALAR");
+    }
+    set_math_backend(original);
+
+    Collider away = { { -1000.0f, -1000.0f }, CONTACT_RADIUS };
+    bool hit = false;
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (int32_t r = 0; r < CONTACT_ROUNDS; r++) hit |= player_enemy_collision(&away, enemies);
+    double t = __seconds_since(start) / CONTACT_ROUNDS;
+    printf("single hit test, missing: %.3f ms per query (%.2f ns per enemy)%s\n",
+        1e3 * t, 1e9 * t / CONTACT_ENEMIES, hit ? ", hit" : "");
+
+    free(contacts);
+    free(expected);
+    __free_bench_enemies(enemies);
+}
+
+/**
+ * The movement system reads facings and writes positions, which
+ * the columns hold back to back while the structs interleave them
+ * with the fields it skips. A one entity archetype with a collider
+ * joins the query, as the player does in the game.
+ */
+static void __bench_ecs(void) {
+    Enemies* enemies = __alloc_bench_enemies(ECS_ENTITIES, 0.0f);
+    Point2d player = { BENCH_WIDTH / 2.0f, BENCH_HEIGHT / 2.0f };
+
+    printf("== ecs: %d entities, %d frames ==\n", ECS_ENTITIES, ECS_FRAMES);
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (int32_t f = 0; f < ECS_FRAMES; f++) update_enemies(enemies, NULL, NULL, BENCH_DT, &player);
+    double update = __seconds_since(start);
+    printf("enemy update:        %.2f ns per entity\n", 1e9 * update / ((double)ECS_ENTITIES * ECS_FRAMES));
+
+    World* world = init_world(ECS_ENTITIES + 1);
+    set_component_size(world, COMPONENT_COLLIDER, sizeof(Collider));
+    Archetype* movers = create_archetype(world, ENEMY_COMPONENTS, ECS_ENTITIES);
+    Archetype* player_archetype = create_archetype(world,
+        (1u << COMPONENT_POSITION) | (1u << COMPONENT_FACING) | (1u << COMPONENT_COLLIDER), 1);
+    BenchEnemy* structs = (BenchEnemy*)calloc(ECS_ENTITIES, sizeof(BenchEnemy));
+    for (int32_t i = 0; i < ECS_ENTITIES; i++) {
+        create_entity(world, movers);
+        float angle = __random_float(0.0f, 2.0f * (float)PI);
+        structs[i].position = (Point2d){ __random_float(0.0f, BENCH_WIDTH), __random_float(0.0f, BENCH_HEIGHT) };
+        structs[i].facing = (Vector2d){ cosf(angle), sinf(angle) };
+        ((Point2d*)movers->columns[COMPONENT_POSITION])[i] = structs[i].position;
+        ((Vector2d*)movers->columns[COMPONENT_FACING])[i] = structs[i].facing;
+    }
+    create_entity(world, player_archetype);
+    ((Point2d*)player_archetype->columns[COMPONENT_POSITION])[0] = player;
+    ((Vector2d*)player_archetype->columns[COMPONENT_FACING])[0] = (Vector2d){ 1.0f, 0.0f };
+
+    float step = ECS_SPEED * BENCH_DT;
+    start = SDL_GetPerformanceCounter();
+    for (int32_t f = 0; f < ECS_FRAMES; f++) {
+        Query query = query_world(world, (1u << COMPONENT_POSITION) | (1u << COMPONENT_FACING));
+        for (Archetype* a = next_archetype(&query); a != NULL; a = next_archetype(&query)) {
+            Point2d* positions = (Point2d*)a->columns[COMPONENT_POSITION];
+            Vector2d* facings = (Vector2d*)a->columns[COMPONENT_FACING];
+            for (int32_t row = 0; row < a->count; row++) {
+                positions[row].x += facings[row].x * step;
+                positions[row].y += facings[row].y * step;
+            }
+        }
+    }
+    double columns = __seconds_since(start);
+
+    start = SDL_GetPerformanceCounter();
+    for (int32_t f = 0; f < ECS_FRAMES; f++) {
+        for (int32_t i = 0; i < ECS_ENTITIES; i++) {
+            structs[i].position.x += structs[i].facing.x * step;
+            structs[i].position.y += structs[i].facing.y * step;
+        }
+    }
+    double aos = __seconds_since(start);
+
+    bool same = true;
+    for (int32_t i = 0; i < ECS_ENTITIES && same; i++) {
+        Point2d p = ((Point2d*)movers->columns[COMPONENT_POSITION])[i];
+        same = p.x == structs[i].position.x && p.y == structs[i].position.y;
+    }
+    printf("movement, columns:   %.2f ns per entity\n", 1e9 * columns / ((double)(ECS_ENTITIES + 1) * ECS_FRAMES));
+    printf("movement, structs:   %.2f ns per entity, %.2fx columns%s\n",
+        1e9 * aos / ((double)ECS_ENTITIES * ECS_FRAMES), aos / columns, same ? "" : ", DIFFERENT FROM COLUMNS");
+
+    free(structs);
+    destroy_world(world);
+    __free_bench_enemies(enemies);
+}
+
+/**
+ * Both enemy runs start from the same positions. With more than
+ * one thread the dying die in another order, which shuffles rows,
+ * so they are compared by entity. The oversubscribed run checks the
+ * stealing even on a machine with few cores.
+ */
+static void __bench_jobs(void) {
+    int32_t cores = SDL_GetCPUCount();
+    printf("== jobs: %d cores, %d enemies in chunks of %d, %d frames ==\n", cores, JOB_ENEMIES, JOB_CHUNK, JOB_FRAMES);
+
+    int32_t thread_counts[] = { 0, cores - 1, 2 * cores + 1 };
+    const char* labels[] = { "main thread only", "one per core", "oversubscribed" };
+    Enemies* serial = NULL;
+    double serial_time = 0;
+    for (int32_t t = 0; t < 3; t++) {
+        if (t == 1 && cores == 1) continue;
+        JobSystem* jobs = init_job_system(thread_counts[t]);
+
+        Uint64 start = SDL_GetPerformanceCounter();
+        for (int32_t r = 0; r < JOB_OVERHEAD_RUNS; r++) {
+            add_task(jobs, __bench_empty_job, NULL, JOB_OVERHEAD_JOBS, 1);
+            run_tasks(jobs);
+        }
+        double overhead = __seconds_since(start) / ((double)JOB_OVERHEAD_RUNS * JOB_OVERHEAD_JOBS);
+
+        srand(1);
+        BenchFrame frame = {
+            __alloc_bench_enemies(JOB_ENEMIES, 0.0f), { BENCH_WIDTH / 2.0f, BENCH_HEIGHT / 2.0f }, NULL, NULL, NULL
+        };
+        start = SDL_GetPerformanceCounter();
+        for (int32_t f = 0; f < JOB_FRAMES; f++) __run_bench_frame(jobs, &frame);
+        double update = __seconds_since(start) / JOB_FRAMES;
+
+        const char* check = "";
+        if (serial == NULL) {
+            serial = frame.enemies;
+            serial_time = update;
+        } else {
+            for (int32_t i = 0; i < JOB_ENEMIES; i++) {
+                Point2d* a = __bench_position(serial, i);
+                Point2d* b = __bench_position(frame.enemies, i);
+                if ((a == NULL) != (b == NULL) || (a && (a->x != b->x || a->y != b->y))) check = ", DIFFERENT FROM ONE THREAD";
+            }
+            __free_bench_enemies(frame.enemies);
+        }
+        printf("%-16s %2d threads: %.1f ns per job, update %.3f ms per frame, %.2fx one thread%s\n",
+            labels[t], jobs->worker_count, 1e9 * overhead, 1e3 * update, serial_time / update, check);
+        destroy_job_system(jobs);
+    }
+
+    JobSystem* jobs = init_job_system(0);
+    srand(1);
+    Enemies* enemies = __alloc_bench_enemies(JOB_ENEMIES, 0.0f);
+    Point2d player = { BENCH_WIDTH / 2.0f, BENCH_HEIGHT / 2.0f };
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (int32_t f = 0; f < JOB_FRAMES; f++) update_enemies(enemies, NULL, NULL, BENCH_DT, &player);
+    double plain = __seconds_since(start) / JOB_FRAMES;
+    printf("update_enemies without jobs: %.3f ms per frame\n", 1e3 * plain);
+    __free_bench_enemies(enemies);
+    destroy_job_system(jobs);
+
+    __free_bench_enemies(serial);
+}
+
+/**
+ * Both runs start from the same enemies, drawn as offscreen-scene
+ * draws them. The pipelined run draws the frame captured last time
+ * while the worker threads simulate the next, so it draws one frame
+ * behind, and its last frame is simulated but not drawn. It has at
+ * least one worker thread, or nothing would run while drawing.
+ */
+static void __bench_pipeline(void) {
+    int32_t cores = SDL_GetCPUCount();
+    printf("== pipeline: %d cores, %d enemies, %.0f%% on screen, %d frames ==\n",
+        cores, PIPELINE_ENEMIES, 100 * PIPELINE_VISIBLE_FRACTION, PIPELINE_FRAMES);
+
+    SDL_Surface* target = SDL_CreateRGBSurfaceWithFormat(0, BENCH_WIDTH, BENCH_HEIGHT, 32, SDL_PIXELFORMAT_ARGB8888);
+    SDL_Renderer* renderer = SDL_CreateSoftwareRenderer(target);
+    RenderBuffer* commands = init_render_buffer();
+    Arena* scratch = init_arena(BENCH_SCRATCH_SIZE, ARENA_OVERFLOW_GROW);
+    SDL_Texture* texture = SDL_CreateTexture(
+        renderer,
+        SDL_PIXELFORMAT_ARGB8888,
+        SDL_TEXTUREACCESS_STATIC,
+        SHEET_WIDTH,
+        SHEET_HEIGHT
+    );
+    Camera* camera = init_camera(BENCH_WIDTH, BENCH_HEIGHT, BENCH_WIDTH, BENCH_HEIGHT);
+    JobSystem* jobs = init_job_system(cores > 1 ? cores - 1 : 1);
+
+    const char* labels[] = { "serial", "pipelined" };
+    Enemies* serial = NULL;
+    double serial_time = 0;
+    for (int32_t pipelined = 0; pipelined < 2; pipelined++) {
+        srand(1);
+        Snapshot* snapshots[2] = { init_snapshot(camera), init_snapshot(camera) };
+        int32_t front = 0;
+        BenchFrame frame = {
+            __alloc_bench_enemies(PIPELINE_ENEMIES, PIPELINE_VISIBLE_FRACTION),
+            { BENCH_WIDTH / 2.0f, BENCH_HEIGHT / 2.0f }, NULL, camera, NULL
+        };
+        frame.enemies->texture = texture;
+        for (int32_t i = 0; i < 6; i++) frame.enemies->texture_states[i] = (SDL_Rect){ 0, 0, 60, 62 };
+
+        Uint64 start = SDL_GetPerformanceCounter();
+        for (int32_t f = 0; f < PIPELINE_FRAMES; f++) {
+            if (pipelined) {
+                wait_tasks(jobs);
+                front = 1 - front;
+            }
+            frame.snapshot = snapshots[1 - front];
+            __add_bench_frame(jobs, &frame);
+            if (pipelined) {
+                start_tasks(jobs);
+            } else {
+                run_tasks(jobs);
+                front = 1 - front;
+            }
+            draw_enemies(commands, frame.enemies, snapshots[front]);
+            reset_arena(scratch);
+            submit_render_buffer(commands, renderer, scratch);
+        }
+        wait_tasks(jobs);
+        double t = __seconds_since(start) / PIPELINE_FRAMES;
+
+        const char* check = "";
+        if (serial == NULL) {
+            serial = frame.enemies;
+            serial_time = t;
+        } else {
+            for (int32_t i = 0; i < PIPELINE_ENEMIES; i++) {
+                Point2d* a = __bench_position(serial, i);
+                Point2d* b = __bench_position(frame.enemies, i);
+                if ((a == NULL) != (b == NULL) || (a && (a->x != b->x || a->y != b->y))) check = ", DIFFERENT FROM SERIAL";
+            }
+            __free_bench_enemies(frame.enemies);
+        }
+        printf("%-9s %2d threads: %.3f ms per frame, %d enemies drawn, %.2fx serial%s\n",
+            labels[pipelined], jobs->worker_count, 1e3 * t, snapshots[front]->enemy_count, serial_time / t, check);
+        destroy_snapshot(snapshots[0]);
+        destroy_snapshot(snapshots[1]);
+    }
+
+    __free_bench_enemies(serial);
+    destroy_job_system(jobs);
+    destroy_camera(camera);
+    SDL_DestroyTexture(texture);
+    destroy_render_buffer(commands);
+    destroy_arena(scratch);
+    SDL_DestroyRenderer(renderer);
+    SDL_FreeSurface(target);
+}
+
+/**
+ * Sprites alternate between textures and are spread over two layers
+ * at random, the worst order for drawing them as they come. Drawing
+ * them as they come goes straight to SDL, as the draw functions did
+ * before the buffer. Sorting is also timed on its own, since with a
+ * software renderer the drawing dwarfs it. Submitting sorts again,
+ * which costs the same on sorted commands.
+ */
+static void __bench_render_buffer(void) {
+    printf("== render-buffer: %d sprites over %d textures and 2 layers, %d frames ==\n",
+        RENDER_SPRITES, RENDER_TEXTURES, RENDER_FRAMES);
+
+    SDL_Surface* target = SDL_CreateRGBSurfaceWithFormat(0, BENCH_WIDTH, BENCH_HEIGHT, 32, SDL_PIXELFORMAT_ARGB8888);
+    SDL_Renderer* renderer = SDL_CreateSoftwareRenderer(target);
+    RenderBuffer* commands = init_render_buffer();
+    Arena* scratch = init_arena(BENCH_SCRATCH_SIZE, ARENA_OVERFLOW_GROW);
+    SDL_Texture* textures[RENDER_TEXTURES];
+    for (int32_t t = 0; t < RENDER_TEXTURES; t++) {
+        textures[t] = SDL_CreateTexture(
+            renderer,
+            SDL_PIXELFORMAT_ARGB8888,
+            SDL_TEXTUREACCESS_STATIC,
+            SHEET_WIDTH,
+            SHEET_HEIGHT
+        );
+    }
+    SDL_Rect src = { 0, 0, 60, 62 };
+
+    double sort = 0, immediate = 0, sorted = 0;
+    uint64_t immediate_switches = 0;
+    for (int32_t f = 0; f < RENDER_FRAMES; f++) {
+        for (int32_t i = 0; i < RENDER_SPRITES; i++) {
+            SDL_Rect dst = {
+                (int)__random_float(0.0f, BENCH_WIDTH),
+                (int)__random_float(0.0f, BENCH_HEIGHT),
+                src.w,
+                src.h
+            };
+            RenderLayer layer = rand() % 2 ? LAYER_ENEMIES : LAYER_FLOOR;
+            push_sprite(commands, layer, textures[i % RENDER_TEXTURES], &src, &dst, __random_float(0.0f, 360.0f));
+        }
+
+        Uint64 start = SDL_GetPerformanceCounter();
+        SDL_Texture* bound = NULL;
+        for (int32_t i = 0; i < commands->count; i++) {
+            RenderCommand* command = &commands->commands[i];
+            immediate_switches += command->texture != bound;
+            bound = command->texture;
+            SDL_RenderCopyEx(renderer, command->texture, &command->src, &command->dst, command->angle, NULL, SDL_FLIP_NONE);
+        }
+        immediate += __seconds_since(start);
+
+        start = SDL_GetPerformanceCounter();
+        sort_render_buffer(commands);
+        sort += __seconds_since(start);
+
+        start = SDL_GetPerformanceCounter();
+        reset_arena(scratch);
+        submit_render_buffer(commands, renderer, scratch);
+        sorted += __seconds_since(start);
+    }
+
+    printf("sort %.2f ns per command\n", 1e9 * sort / ((double)RENDER_SPRITES * RENDER_FRAMES));
+    printf("as added: %.1f draw calls, %.1f texture switches, %.3f ms per frame\n",
+        (double)RENDER_SPRITES, (double)immediate_switches / RENDER_FRAMES, 1e3 * immediate / RENDER_FRAMES);
+    printf("sorted:   %.1f draw calls, %.1f texture switches, %.3f ms per frame, sort included\n",
+        (double)commands->total.draw_calls / commands->frames,
+        (double)commands->total.texture_switches / commands->frames, 1e3 * sorted / RENDER_FRAMES);
+
+    for (int32_t t = 0; t < RENDER_TEXTURES; t++) SDL_DestroyTexture(textures[t]);
+    destroy_render_buffer(commands);
+    destroy_arena(scratch);
+    SDL_DestroyRenderer(renderer);
+    SDL_FreeSurface(target);
+}
+
+/**
+ * The sheet is random so every blending path is taken. The same sprites are drawn each frame
+ * so the framebuffers can be compared. The blitter's time includes
+ * uploading the framebuffer, so both are whole frames.
+ */
+static void __bench_blit(void) {
+    SDL_Surface* target = SDL_CreateRGBSurfaceWithFormat(0, BENCH_WIDTH, BENCH_HEIGHT, 32, SDL_PIXELFORMAT_ARGB8888);
+    SDL_Renderer* renderer = SDL_CreateSoftwareRenderer(target);
+    SDL_Surface* sheet = __alloc_bench_sheet();
+    SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, sheet);
+    SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+    Blitter* blitter = init_blitter(renderer, NULL, BENCH_WIDTH, BENCH_HEIGHT);
+    blitter->track_dirty = false;
+    add_blit_image(blitter, texture, sheet);
+    RenderBuffer* commands = init_render_buffer();
+    Arena* scratch = init_arena(BENCH_SCRATCH_SIZE, ARENA_OVERFLOW_GROW);
+    SDL_Rect src = { 114, 23, 60, 62 };
+    SDL_Color white = { 255, 255, 255, 255 };
+    uint32_t* expected = (uint32_t*)malloc(sizeof(uint32_t) * BENCH_WIDTH * BENCH_HEIGHT);
+    MathBackend original = get_math_backend();
+
+    int32_t sizes = (int32_t)(sizeof(BLIT_ENEMIES) / sizeof(BLIT_ENEMIES[0]));
+    for (int32_t n = 0; n < sizes; n++) {
+        int32_t count = BLIT_ENEMIES[n];
+        printf("== blit: %d visible rotated %dx%d enemies drawn at %dx%d, %d frames ==\n",
+            count, src.w, src.h, BLIT_SPRITE_SIZE, BLIT_SPRITE_SIZE, BLIT_FRAMES);
+
+        SDL_Rect* dst = (SDL_Rect*)malloc(sizeof(SDL_Rect) * count);
+        float* angles = (float*)malloc(sizeof(float) * count);
+        for (int32_t i = 0; i < count; i++) {
+            dst[i] = (SDL_Rect){
+                (int)__random_float(-BLIT_SPRITE_SIZE, BENCH_WIDTH),
+                (int)__random_float(-BLIT_SPRITE_SIZE, BENCH_HEIGHT),
+                BLIT_SPRITE_SIZE,
+                BLIT_SPRITE_SIZE
+            };
+            angles[i] = __random_float(0.0f, 360.0f);
+        }
+
+        Uint64 start = SDL_GetPerformanceCounter();
+        for (int32_t f = 0; f < BLIT_FRAMES; f++) {
+            SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+            SDL_RenderClear(renderer);
+            for (int32_t i = 0; i < count; i++) push_sprite(commands, LAYER_ENEMIES, texture, &src, &dst[i], angles[i]);
+            reset_arena(scratch);
+            submit_render_buffer(commands, renderer, scratch);
+        }
+        double sdl = __seconds_since(start) / BLIT_FRAMES;
+        printf("%-8s %8.3f ms per frame\n", "SDL", 1e3 * sdl);
+
+        for (int32_t be = MATH_SCALAR; be <= MATH_AVX2; be++) {
+            if (!set_math_backend((MathBackend)be)) continue;
+            start = SDL_GetPerformanceCounter();
+            for (int32_t f = 0; f < BLIT_FRAMES; f++) {
+                clear_blitter(blitter, white);
+                for (int32_t i = 0; i < count; i++) push_sprite(commands, LAYER_ENEMIES, texture, &src, &dst[i], angles[i]);
+                blit_render_buffer(blitter, commands, renderer, NULL);
+            }
+            double t = __seconds_since(start) / BLIT_FRAMES;
+
+            size_t bytes = sizeof(uint32_t) * BENCH_WIDTH * BENCH_HEIGHT;
+            if (be == MATH_SCALAR) memcpy(expected, blitter->pixels, bytes);
+            bool same = memcmp(blitter->pixels, expected, bytes) == 0;
+            printf("%-8s %8.3f ms per frame (%.1f ns per enemy), %.2fx SDL%s\n",
+                BACKEND_NAMES[be], 1e3 * t, 1e9 * t / count, sdl / t, same ? "" : ", DIFFERENT FROM SCALAR");
+        }
+        set_math_backend(original);
+
+        free(dst);
+        free(angles);
+    }
+
+    free(expected);
+    destroy_render_buffer(commands);
+    destroy_arena(scratch);
+    destroy_blitter(blitter);
+    SDL_DestroyTexture(texture);
+    SDL_FreeSurface(sheet);
+    SDL_DestroyRenderer(renderer);
+    SDL_FreeSurface(target);
+}
+
+/**
+ * The floor is drawn as the game draws it, straight 32x32 tiles
+ * under the enemies. Only drawing is timed, the upload is the same
+ * whatever draws the framebuffer.
+ */
+static void __bench_tiles(void) {
+    int32_t cores = SDL_GetCPUCount();
+    printf("== tiles: %d cores, %dx%d floor tiles and %d rotated enemies, %d frames ==\n",
+        cores, TILE_FLOOR_SIZE, TILE_FLOOR_SIZE, TILE_ENEMIES, TILE_FRAMES);
+
+    SDL_Surface* target = SDL_CreateRGBSurfaceWithFormat(0, BENCH_WIDTH, BENCH_HEIGHT, 32, SDL_PIXELFORMAT_ARGB8888);
+    SDL_Renderer* renderer = SDL_CreateSoftwareRenderer(target);
+    SDL_Surface* sheet = __alloc_bench_sheet();
+    SDL_Texture* floor = SDL_CreateTextureFromSurface(renderer, sheet);
+    SDL_Texture* enemy = SDL_CreateTextureFromSurface(renderer, sheet);
+    Blitter* blitter = init_blitter(renderer, NULL, BENCH_WIDTH, BENCH_HEIGHT);
+    blitter->track_dirty = false;
+    add_blit_image(blitter, floor, sheet);
+    add_blit_image(blitter, enemy, sheet);
+    RenderBuffer* commands = init_render_buffer();
+    SDL_Rect tile = { 0, 0, TILE_FLOOR_SIZE, TILE_FLOOR_SIZE };
+    SDL_Rect src = { 114, 23, 60, 62 };
+    SDL_Color white = { 255, 255, 255, 255 };
+
+    SDL_Rect* dst = (SDL_Rect*)malloc(sizeof(SDL_Rect) * TILE_ENEMIES);
+    float* angles = (float*)malloc(sizeof(float) * TILE_ENEMIES);
+    for (int32_t i = 0; i < TILE_ENEMIES; i++) {
+        dst[i] = (SDL_Rect){
+            (int)__random_float(-BLIT_SPRITE_SIZE, BENCH_WIDTH),
+            (int)__random_float(-BLIT_SPRITE_SIZE, BENCH_HEIGHT),
+            BLIT_SPRITE_SIZE,
+            BLIT_SPRITE_SIZE
+        };
+        angles[i] = __random_float(0.0f, 360.0f);
+    }
+
+    size_t bytes = sizeof(uint32_t) * BENCH_WIDTH * BENCH_HEIGHT;
+    uint32_t* expected = (uint32_t*)malloc(bytes);
+    double untiled = 0, one = 0;
+    // Untiled first, then doubling the threads up to one per core
+    int32_t thread_counts[34], runs = 0;
+    thread_counts[runs++] = 0;
+    for (int32_t threads = 1; threads < cores && runs < 33; threads *= 2) thread_counts[runs++] = threads;
+    thread_counts[runs++] = cores;
+
+    for (int32_t r = 0; r < runs; r++) {
+        int32_t threads = thread_counts[r];
+        JobSystem* jobs = threads > 0 ? init_job_system(threads - 1) : NULL;
+        double t = 0;
+        for (int32_t f = 0; f < TILE_FRAMES; f++) {
+            clear_blitter(blitter, white);
+            for (int32_t y = 0; y < BENCH_HEIGHT; y += TILE_FLOOR_SIZE) {
+                for (int32_t x = 0; x < BENCH_WIDTH; x += TILE_FLOOR_SIZE) {
+                    SDL_Rect at = { x, y, TILE_FLOOR_SIZE, TILE_FLOOR_SIZE };
+                    push_sprite(commands, LAYER_FLOOR, floor, &tile, &at, 0.0f);
+                }
+            }
+            for (int32_t i = 0; i < TILE_ENEMIES; i++) push_sprite(commands, LAYER_ENEMIES, enemy, &src, &dst[i], angles[i]);
+
+            Uint64 start = SDL_GetPerformanceCounter();
+            draw_render_buffer(blitter, commands, jobs);
+            t += __seconds_since(start);
+            commands->count = 0;
+        }
+        t /= TILE_FRAMES;
+
+        if (jobs == NULL) {
+            untiled = t;
+            memcpy(expected, blitter->pixels, bytes);
+            printf("untiled     %8.3f ms per frame\n", 1e3 * t);
+            continue;
+        }
+        if (threads == 1) one = t;
+        bool same = memcmp(blitter->pixels, expected, bytes) == 0;
+        printf("%2d threads  %8.3f ms per frame, %.2fx one thread, %.2fx untiled%s\n",
+            threads, 1e3 * t, one / t, untiled / t, same ? "" : ", DIFFERENT FROM UNTILED");
+        destroy_job_system(jobs);
+    }
+
+    free(expected);
+    free(dst);
+    free(angles);
+    destroy_render_buffer(commands);
+    destroy_blitter(blitter);
+    SDL_DestroyTexture(floor);
+    SDL_DestroyTexture(enemy);
+    SDL_FreeSurface(sheet);
+    SDL_DestroyRenderer(renderer);
+    SDL_FreeSurface(target);
+}
+
+/**
+ * The camera stands still, as when the player does, so the floor is
+ * the same every frame. Both runs draw on the main thread.
+ */
+static void __bench_dirty_rects(void) {
+    SDL_Surface* target = SDL_CreateRGBSurfaceWithFormat(0, BENCH_WIDTH, BENCH_HEIGHT, 32, SDL_PIXELFORMAT_ARGB8888);
+    SDL_Renderer* renderer = SDL_CreateSoftwareRenderer(target);
+    SDL_Surface* sheet = __alloc_bench_sheet();
+    SDL_Texture* floor = SDL_CreateTextureFromSurface(renderer, sheet);
+    SDL_Texture* enemy = SDL_CreateTextureFromSurface(renderer, sheet);
+    RenderBuffer* commands = init_render_buffer();
+    size_t bytes = sizeof(uint32_t) * BENCH_WIDTH * BENCH_HEIGHT;
+    uint32_t* expected = (uint32_t*)malloc(bytes);
+    double screen = (double)BENCH_WIDTH * BENCH_HEIGHT;
+
+    printf("== dirty-rects: %dx%d window, still floor, moving enemies, %d frames ==\n",
+        BENCH_WIDTH, BENCH_HEIGHT, DIRTY_FRAMES);
+    int32_t densities = (int32_t)(sizeof(DIRTY_ENEMIES) / sizeof(DIRTY_ENEMIES[0]));
+    for (int32_t n = 0; n < densities; n++) {
+        double times[2];
+        for (int32_t track = 0; track < 2; track++) {
+            Blitter* blitter = init_blitter(renderer, NULL, BENCH_WIDTH, BENCH_HEIGHT);
+            add_blit_image(blitter, floor, sheet);
+            add_blit_image(blitter, enemy, sheet);
+            blitter->track_dirty = track == 1;
+
+            Uint64 start = SDL_GetPerformanceCounter();
+            for (int32_t f = 0; f < DIRTY_FRAMES; f++) {
+                __push_dirty_frame(commands, floor, enemy, DIRTY_ENEMIES[n], f);
+                blit_render_buffer(blitter, commands, renderer, NULL);
+            }
+            times[track] = __seconds_since(start) / DIRTY_FRAMES;
+
+            const char* check = "";
+            if (track == 0) memcpy(expected, blitter->pixels, bytes);
+            else if (memcmp(expected, blitter->pixels, bytes) != 0) check = ", DIFFERENT FROM FULL";
+            double pixels = (double)blitter->total.pixels / blitter->frames;
+            printf("%6d enemies, %-5s %9.0f pixels (%5.1f%%) in %5.1f rects, %8.3f ms per frame%s\n",
+                DIRTY_ENEMIES[n], track ? "dirty" : "full", pixels, 100.0 * pixels / screen,
+                (double)blitter->total.rects / blitter->frames, 1e3 * times[track], check);
+            destroy_blitter(blitter);
+        }
+        printf("%6d enemies, dirty rectangles %.2fx full\n", DIRTY_ENEMIES[n], times[0] / times[1]);
+    }
+
+    free(expected);
+    destroy_render_buffer(commands);
+    SDL_DestroyTexture(floor);
+    SDL_DestroyTexture(enemy);
+    SDL_FreeSurface(sheet);
+    SDL_DestroyRenderer(renderer);
+    SDL_FreeSurface(target);
+}
+
+/**
+ * SDL_CreateTextureFromSurface keeps a format the renderer lists, as
+ * ABGR8888 is, so the loaded sheet is what the game drew from before.
+ */
+static void __bench_texture_format(void) {
+    SDL_Surface* target = SDL_CreateRGBSurfaceWithFormat(0, BENCH_WIDTH, BENCH_HEIGHT, 32, SDL_PIXELFORMAT_ARGB8888);
+    SDL_Renderer* renderer = SDL_CreateSoftwareRenderer(target);
+    SDL_RendererInfo info;
+    if (SDL_GetRendererInfo(renderer, &info) < 0) info = (SDL_RendererInfo){ .name = "unknown" };
+    Uint32 native = native_texture_format(&info);
+
+    SDL_Surface* sheet = __alloc_bench_sheet();
+    SDL_Surface* loaded = SDL_ConvertSurfaceFormat(sheet, SDL_PIXELFORMAT_ABGR8888, 0);
+    SDL_Texture* textures[2];
+    textures[0] = SDL_CreateTextureFromSurface(renderer, loaded);
+    SDL_SetTextureBlendMode(textures[0], SDL_BLENDMODE_BLEND);
+    bool premultiplied;
+    textures[1] = create_native_texture(renderer, sheet, native, &premultiplied);
+    Uint32 formats[2] = { 0, native };
+    SDL_QueryTexture(textures[0], &formats[0], NULL, NULL, NULL);
+
+    SDL_Rect src = { 114, 23, 60, 62 };
+    SDL_Rect* dst = (SDL_Rect*)malloc(sizeof(SDL_Rect) * FORMAT_SPRITES);
+    double* angles = (double*)malloc(sizeof(double) * FORMAT_SPRITES);
+    for (int32_t i = 0; i < FORMAT_SPRITES; i++) {
+        dst[i] = (SDL_Rect){
+            (int)__random_float(-src.w, BENCH_WIDTH),
+            (int)__random_float(-src.h, BENCH_HEIGHT),
+            src.w,
+            src.h
+        };
+        angles[i] = __random_float(0.0f, 360.0f);
+    }
+    printf("== texture-format: %d %dx%d sprites with SDL's %s renderer, %d frames ==\n",
+        FORMAT_SPRITES, src.w, src.h, info.name, FORMAT_FRAMES);
+    const char* names[2] = { "copied", "rotated" };
+    for (int32_t rotated = 0; rotated < 2; rotated++) {
+        double times[2];
+        for (int32_t t = 0; t < 2; t++) {
+            Uint64 start = SDL_GetPerformanceCounter();
+            for (int32_t f = 0; f < FORMAT_FRAMES; f++) {
+                SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+                SDL_RenderClear(renderer);
+                for (int32_t i = 0; i < FORMAT_SPRITES; i++) {
+                    if (rotated) SDL_RenderCopyEx(renderer, textures[t], &src, &dst[i], angles[i], NULL, SDL_FLIP_NONE);
+                    else SDL_RenderCopy(renderer, textures[t], &src, &dst[i]);
+                }
+            }
+            times[t] = __seconds_since(start) / FORMAT_FRAMES;
+        }
+        printf("%-8s %s %8.3f ms per frame, %s %s alpha %8.3f ms per frame, %.2fx faster\n",
+            names[rotated],
+            SDL_GetPixelFormatName(formats[0]), 1e3 * times[0],
+            SDL_GetPixelFormatName(formats[1]), premultiplied ? "premultiplied" : "straight", 1e3 * times[1],
+            times[0] / times[1]);
+    }
+
+    free(dst);
+    free(angles);
+    SDL_DestroyTexture(textures[0]);
+    SDL_DestroyTexture(textures[1]);
+    SDL_FreeSurface(loaded);
+    SDL_FreeSurface(sheet);
+    SDL_DestroyRenderer(renderer);
+    SDL_FreeSurface(target);
+}
+
+/**
+ * Both layouts start with the same enemies, which are updated every
+ * frame so each row is read and written whole, making the bytes per
+ * enemy show. Entities are made in the same order in both worlds,
+ * so an enemy has the same index in each. Packed headings are
+ * compared to the float facings, whichever way round the circle.
+ */
+static void __bench_compact_enemies(void) {
+    Enemies* layouts[2] = {
+        __alloc_bench_layout(COMPACT_ENEMIES, false),
+        __alloc_bench_layout(COMPACT_ENEMIES, true)
+    };
+    for (int32_t i = 0; i < COMPACT_ENEMIES; i++) {
+        Point2d p = { __random_float(0.0f, COMPACT_WORLD_SIZE), __random_float(0.0f, COMPACT_WORLD_SIZE) };
+        set_enemy_position(layouts[0]->archetype, i, &p);
+        set_enemy_position(layouts[1]->archetype, i, &p);
+    }
+    Point2d player = { COMPACT_WORLD_SIZE / 2.0f, COMPACT_WORLD_SIZE / 2.0f };
+
+    printf("== compact-enemies: %d enemies, %d frames ==\n", COMPACT_ENEMIES, COMPACT_FRAMES);
+    double seconds[2];
+    for (int32_t l = 0; l < 2; l++) {
+        layouts[l]->lod = false;
+        Uint64 start = SDL_GetPerformanceCounter();
+        for (int32_t f = 0; f < COMPACT_FRAMES; f++) update_enemies(layouts[l], NULL, NULL, BENCH_DT, &player);
+        seconds[l] = __seconds_since(start);
+        printf("%s: %2zu bytes per enemy, %.2f ns per enemy update, %.3f ms per frame\n",
+            LAYOUT_NAMES[l],
+            row_size(layouts[l]->world, layouts[l]->components),
+            1e9 * seconds[l] / ((double)COMPACT_ENEMIES * COMPACT_FRAMES),
+            1e3 * seconds[l] / COMPACT_FRAMES
+        );
+    }
+    printf("packed: %.2fx floats\n", seconds[0] / seconds[1]);
+
+    // The packed heading is compared with the way it was taken from, the way to the player
+    World* floats = layouts[0]->world;
+    World* packed = layouts[1]->world;
+    float drift = 0.0f, turn = 0.0f;
+    int32_t apart = 0;
+    for (int32_t i = 0; i < COMPACT_ENEMIES; i++) {
+        bool alive = floats->archetype_of[i] != -1;
+        if (alive != (packed->archetype_of[i] != -1)) apart++;
+        if (!alive || packed->archetype_of[i] == -1) continue;
+
+        Point2d a = enemy_position(layouts[0]->archetype, floats->rows[i]);
+        Point2d b = enemy_position(layouts[1]->archetype, packed->rows[i]);
+        drift = fmaxf(drift, sqrtf((a.x - b.x) * (a.x - b.x) + (a.y - b.y) * (a.y - b.y)));
+
+        Vector2d g = enemy_facing(layouts[1]->archetype, packed->rows[i]);
+        float degrees = fabsf(rad_to_deg(atan2f(player.y - b.y, player.x - b.x) - atan2f(g.y, g.x)));
+        turn = fmaxf(turn, degrees > 180.0f ? 360.0f - degrees : degrees);
+    }
+    float drift_bound = COMPACT_FRAMES * COMPACT_DRIFT_BOUND;
+    printf("after %d frames: positions at most %.4f px apart (bound %.4f), packed headings within %.2f degrees "
+        "of the player (bound %.2f), %d enemies alive in one only%s\n",
+        COMPACT_FRAMES, drift, drift_bound, turn, COMPACT_HEADING_BOUND, apart,
+        drift <= drift_bound && turn <= COMPACT_HEADING_BOUND ? "" : ", PAST THE BOUND");
+
+    __free_bench_enemies(layouts[0]);
+    __free_bench_enemies(layouts[1]);
+}
+
+/**
+ * The enemies are spread by a fixed pattern rather than at random,
+ * so every run gets the same frames.
+ */
+static void __push_dirty_frame(RenderBuffer* commands, SDL_Texture* floor, SDL_Texture* enemy, int32_t count, int32_t frame) {
+    SDL_Rect tile = { 0, 0, TILE_FLOOR_SIZE, TILE_FLOOR_SIZE };
+    for (int32_t y = 0; y < BENCH_HEIGHT; y += TILE_FLOOR_SIZE) {
+        for (int32_t x = 0; x < BENCH_WIDTH; x += TILE_FLOOR_SIZE) {
+            SDL_Rect at = { x, y, TILE_FLOOR_SIZE, TILE_FLOOR_SIZE };
+            push_sprite(commands, LAYER_FLOOR, floor, &tile, &at, 0.0f);
+        }
+    }
+
+    SDL_Rect src = { 114, 23, 60, 62 };
+    for (int32_t i = 0; i < count; i++) {
+        uint32_t h = (uint32_t)i * 2654435761u;
+        SDL_Rect at = {
+            (int32_t)((h % (uint32_t)BENCH_WIDTH + (uint32_t)frame) % (uint32_t)BENCH_WIDTH) - BLIT_SPRITE_SIZE / 2,
+            (int32_t)((h >> 16) % (uint32_t)BENCH_HEIGHT) - BLIT_SPRITE_SIZE / 2,
+            BLIT_SPRITE_SIZE,
+            BLIT_SPRITE_SIZE
+        };
+        push_sprite(commands, LAYER_ENEMIES, enemy, &src, &at, (float)((i * 37 + frame * 3) % 360));
+    }
+}
+
+/**
+ * The same tasks as the game's frame, minus the player, and
+ * minus the capture if there is nowhere to capture to.
+ */
+static void __add_bench_frame(JobSystem* jobs, BenchFrame* frame) {
+    Task* begin = add_task(jobs, __bench_begin_job, frame, 1, 1);
+    frame->rows = add_task(jobs, __bench_rows_job, frame, frame->enemies->max_enemies, JOB_CHUNK);
+    Task* end = add_task(jobs, __bench_end_job, frame, 1, 1);
+    add_dependency(begin, frame->rows);
+    add_dependency(frame->rows, end);
+    if (frame->snapshot) add_dependency(end, add_task(jobs, __bench_capture_job, frame, 1, 1));
+}
+
+/**
+ * Runs the frame's tasks and waits for them.
+ */
+static void __run_bench_frame(JobSystem* jobs, BenchFrame* frame) {
+    __add_bench_frame(jobs, frame);
+    run_tasks(jobs);
+}
+
+/**
+ * The row count is only known once the update has begun.
+ */
+static void __bench_begin_job(void* data, int32_t begin, int32_t end) {
+    (void)begin;
+    (void)end;
+    BenchFrame* frame = (BenchFrame*)data;
+    begin_enemy_update(frame->enemies, BENCH_DT);
+    set_task_count(frame->rows, frame->enemies->archetype->count);
+}
+
+/**
+ * No flow field or walls, as in enemy-update.
+ */
+static void __bench_rows_job(void* data, int32_t begin, int32_t end) {
+    BenchFrame* frame = (BenchFrame*)data;
+    update_enemy_rows(frame->enemies, frame->enemies->archetype, begin, end, NULL, NULL, &frame->player);
+}
+
+/**
+ * Deaths and grid moves, on one thread.
+ */
+static void __bench_end_job(void* data, int32_t begin, int32_t end) {
+    (void)begin;
+    (void)end;
+    end_enemy_update(((BenchFrame*)data)->enemies);
+}
+
+/**
+ * The snapshot is cleared here, since the one drawn is the other.
+ */
+static void __bench_capture_job(void* data, int32_t begin, int32_t end) {
+    (void)begin;
+    (void)end;
+    BenchFrame* frame = (BenchFrame*)data;
+    clear_snapshot(frame->snapshot, frame->camera);
+    capture_enemies(frame->enemies, frame->snapshot);
+}
+
+/**
+ * Nothing to see here.
+ */
+static void __bench_empty_job(void* data, int32_t begin, int32_t end) {
+    (void)data;
+    (void)begin;
+    (void)end;
+}
+
+/**
+ * Enemies are zeroed, all alive, and then placed on a band 100 to 600
+ * pixels outside the window, apart from the visible fraction which is
+ * spread uniformly within it.
+ */
+static Enemies* __alloc_bench_enemies(int32_t count, float visible_fraction) {
+    Enemies* enemies = __alloc_bench_layout(count, false);
+    int32_t visible = (int32_t)(count * visible_fraction);
+    for (int32_t i = 0; i < count; i++) {
+        Point2d* p = __bench_position(enemies, i);
+        if (i < visible) {
+            *p = (Point2d){
+                __random_float(0.0f, BENCH_WIDTH),
+                __random_float(0.0f, BENCH_HEIGHT)
+            };
+            continue;
+        }
+        float margin = __random_float(100.0f, 600.0f);
+        float t = __random_float(0.0f, 1.0f);
+        switch (rand() % 4) {
+            case 0: *p = (Point2d){ t * BENCH_WIDTH, -margin }; break;
+            case 1: *p = (Point2d){ t * BENCH_WIDTH, BENCH_HEIGHT + margin }; break;
+            case 2: *p = (Point2d){ -margin, t * BENCH_HEIGHT }; break;
+            default: *p = (Point2d){ BENCH_WIDTH + margin, t * BENCH_HEIGHT }; break;
+        }
+    }
+
+    return enemies;
+}
+
+/**
+ * Rows are entity indices until an enemy dies. The lod schedule is
+ * set up for the simulated window.
+ */
+static Enemies* __alloc_bench_layout(int32_t count, bool compact) {
+    Enemies* enemies = (Enemies*)calloc(1, sizeof(Enemies));
+    enemies->world = init_world(count);
+    enemies->components = compact ? ENEMY_PACKED_COMPONENTS : ENEMY_COMPONENTS;
+    set_component_size(enemies->world, COMPONENT_PACKED, sizeof(PackedEnemy));
+    enemies->archetype = create_archetype(enemies->world, enemies->components, count);
+    enemies->dying = (Entity*)malloc(sizeof(Entity) * count);
+    enemies->moved = (EnemyMove*)malloc(sizeof(EnemyMove) * count);
+    enemies->max_enemies = count;
+    for (int32_t i = 0; i < count; i++) create_entity(enemies->world, enemies->archetype);
+    if (compact) {
+        memset(enemies->archetype->columns[COMPONENT_PACKED], 0, sizeof(PackedEnemy) * count);
+    } else {
+        memset(enemies->archetype->columns[COMPONENT_FACING], 0, sizeof(Vector2d) * count);
+        memset(enemies->archetype->columns[COMPONENT_PHASE], 0, sizeof(float) * count);
+    }
+    memset(enemies->archetype->columns[COMPONENT_UPDATED], 0, sizeof(uint32_t) * count);
+    init_enemy_lod(enemies, BENCH_WIDTH, BENCH_HEIGHT);
+    return enemies;
+}
+
+/**
+ * Entities are made in index order, but a death moves the
+ * last row into the hole, so the row is looked up.
+ */
+static Point2d* __bench_position(Enemies* enemies, int32_t i) {
+    if (enemies->world->archetype_of[i] == -1) return NULL;
+    return (Point2d*)enemies->archetype->columns[COMPONENT_POSITION] + enemies->world->rows[i];
+}
+
+/**
+ * Nothing but memory to release, any texture is the caller's.
+ */
+static void __free_bench_enemies(Enemies* enemies) {
+    free(enemies->dying);
+    free(enemies->moved);
+    if (enemies->grid) destroy_spatial_grid(enemies->grid);
+    destroy_world(enemies->world);
+    free(enemies);
+}
+
+/**
+ * The box is tested tile by tile, nothing left of or above the
+ * map is a wall.
+ */
+static bool __on_wall(TileMap* map, Point2d* position, float radius) {
+    float x = position->x + 20.0f, y = position->y + 20.0f;
+    int32_t col0 = x - radius < 0 ? -1 : (int32_t)((x - radius) * map->inverse_tile_size);
+    int32_t row0 = y - radius < 0 ? -1 : (int32_t)((y - radius) * map->inverse_tile_size);
+    int32_t col1 = x + radius < 0 ? -1 : (int32_t)((x + radius) * map->inverse_tile_size);
+    int32_t row1 = y + radius < 0 ? -1 : (int32_t)((y + radius) * map->inverse_tile_size);
+    for (int32_t row = row0; row <= row1; row++) {
+        for (int32_t col = col0; col <= col1; col++) {
+            if (is_wall(map, col, row)) return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Alpha is 0 or random in equal parts, so both the skipped and the
+ * blended pixels are common, and which comes next is unpredictable.
+ */
+static SDL_Surface* __alloc_bench_sheet(void) {
+    SDL_Surface* sheet = SDL_CreateRGBSurfaceWithFormat(0, SHEET_WIDTH, SHEET_HEIGHT, 32, SDL_PIXELFORMAT_ARGB8888);
+    uint32_t* texels = (uint32_t*)sheet->pixels;
+    for (int32_t i = 0; i < sheet->pitch / 4 * SHEET_HEIGHT; i++) {
+        uint32_t alpha = rand() % 2 ? 0 : (uint32_t)(rand() % 256);
+        texels[i] = alpha << 24 | (uint32_t)(rand() & 0xFFFFFF);
+    }
+    return sheet;
+}
+
+/**
+ * Converts performance counter ticks to seconds.
+ */
+static double __seconds_since(Uint64 start) {
+    return (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+}
+
+/**
+ * rand() is good enough for benchmark inputs.
+ */
+static float __random_float(float lo, float hi) {
+    return lo + (hi - lo) * ((float)rand() / (float)RAND_MAX);
+}
\ No newline at end of file
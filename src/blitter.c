@@ -0,0 +1,1264 @@
+#include "blitter.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define BLITTER_X86
+#include <immintrin.h>
+#endif
+
+// Message when the streaming texture cannot be created
+static const char CREATE_TARGET_LOG[] = "Could not create framebuffer texture: %s";
+// Message when a sprite's pixels cannot be converted
+static const char CONVERT_IMAGE_LOG[] = "Could not convert sprite for the blitter: %s";
+// Message when more textures are added than the blitter holds
+static const char TOO_MANY_IMAGES_LOG[] = "Too many sprites for the blitter";
+// Layers below this one are the background, cached while they stay the same
+static const uint32_t BACKGROUND_LAYERS = LAYER_ENEMIES;
+// The alpha of an opaque ARGB8888 pixel
+static const uint32_t OPAQUE = 0xFF000000u;
+
+/**
+ * Struct:
+ *  BlitSource
+ *
+ * Purpose:
+ *  The part of an image a rotated or scaled sprite is drawn from.
+ *
+ * Fields:
+ *  - pixels:
+ *      The image's pixels, ARGB8888.
+ *  - pitch:
+ *      The number of pixels from one row of the image to the next.
+ *  - left:
+ *      The first column of the part.
+ *  - top:
+ *      The first row of the part.
+ *  - right:
+ *      One past the last column of the part.
+ *  - bottom:
+ *      One past the last row of the part.
+ */
+typedef struct {
+    const uint32_t* pixels;
+    int32_t         pitch;
+    float           left;
+    float           top;
+    float           right;
+    float           bottom;
+} BlitSource;
+
+/**
+ * Struct:
+ *  BlitKernels
+ *
+ * Purpose:
+ *  The blending loops of a single backend.
+ *
+ * Fields:
+ *  - blend:
+ *      Blends a row of pixels over a row of the framebuffer.
+ *  - blend_mapped:
+ *      Blends pixels begin to end of a row of the framebuffer with
+ *      the pixels they map back to, pixel i mapping to
+ *      (u + i * du, v + i * dv) in the image.
+ */
+typedef struct {
+    void (*blend)(uint32_t* dst, const uint32_t* src, int32_t n);
+    void (*blend_mapped)(uint32_t* dst, int32_t begin, int32_t end, const BlitSource* source, float u, float v, float du, float dv);
+} BlitKernels;
+
+/**
+ * Function:
+ *  __background_changed
+ *
+ * Purpose:
+ *  Check if the background commands differ from the cached ones,
+ *  and keep them if so.
+ *
+ * Parameters:
+ *  - blitter:
+ *      The Blitter object.
+ *  - buffer:
+ *      The sorted RenderBuffer object.
+ *
+ * Returns:
+ *  true if the cached background cannot be used, false otherwise.
+ */
+static bool __background_changed(Blitter* blitter, RenderBuffer* buffer);
+
+/**
+ * Function:
+ *  __find_dirty_rects
+ *
+ * Purpose:
+ *  Find the rectangles redrawn this frame and count them.
+ *
+ * Parameters:
+ *  - blitter:
+ *      The Blitter object.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __find_dirty_rects(Blitter* blitter);
+
+/**
+ * Function:
+ *  __find_runs
+ *
+ * Purpose:
+ *  Cover the dirty cells of a block of cells with rectangles: each
+ *  run of dirty cells in a row, joined with the same run in the row
+ *  above if there is one.
+ *
+ * Parameters:
+ *  - blitter:
+ *      The Blitter object.
+ *  - cells:
+ *      The block, in cells.
+ *  - rects:
+ *      Where the rectangles are stored, in pixels, room for one per
+ *      cell of the block.
+ *  - runs:
+ *      Room for two indices per column of the block.
+ *
+ * Returns:
+ *  The number of rectangles.
+ */
+static int32_t __find_runs(Blitter* blitter, SDL_Rect* cells, SDL_Rect* rects, int32_t* runs);
+
+/**
+ * Function:
+ *  __overlaps
+ *
+ * Purpose:
+ *  Check if two rectangles share a pixel.
+ *
+ * Parameters:
+ *  - a:
+ *      A rectangle.
+ *  - b:
+ *      Another rectangle.
+ *
+ * Returns:
+ *  true if they do, false otherwise.
+ */
+static bool __overlaps(SDL_Rect* a, SDL_Rect* b);
+
+/**
+ * Function:
+ *  __present_window
+ *
+ * Purpose:
+ *  Copy the rectangles redrawn into the window's surface and
+ *  update them on screen.
+ *
+ * Parameters:
+ *  - blitter:
+ *      The Blitter object.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __present_window(Blitter* blitter);
+
+/**
+ * Function:
+ *  __copy_rect
+ *
+ * Purpose:
+ *  Copy a rectangle from one framebuffer sized buffer to another.
+ *
+ * Parameters:
+ *  - to:
+ *      The buffer copied to.
+ *  - from:
+ *      The buffer copied from.
+ *  - width:
+ *      The framebuffer's width.
+ *  - rect:
+ *      The rectangle.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __copy_rect(uint32_t* to, const uint32_t* from, int32_t width, SDL_Rect* rect);
+
+/**
+ * Function:
+ *  __clear_rect
+ *
+ * Purpose:
+ *  Fill a rectangle of the framebuffer with the clear color.
+ *
+ * Parameters:
+ *  - blitter:
+ *      The Blitter object.
+ *  - rect:
+ *      The rectangle.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __clear_rect(Blitter* blitter, SDL_Rect* rect);
+
+/**
+ * Function:
+ *  __find_image
+ *
+ * Purpose:
+ *  Find the pixels of a texture.
+ *
+ * Parameters:
+ *  - blitter:
+ *      The Blitter object.
+ *  - texture:
+ *      The texture.
+ *
+ * Returns:
+ *  The pixels, NULL if the texture was never added.
+ */
+static SDL_Surface* __find_image(Blitter* blitter, SDL_Texture* texture);
+
+/**
+ * Function:
+ *  __prepare_commands
+ *
+ * Purpose:
+ *  Find the pixels and the box of every command, so the tiles
+ *  only read them.
+ *
+ * Parameters:
+ *  - blitter:
+ *      The Blitter object.
+ *  - buffer:
+ *      The sorted RenderBuffer object.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __prepare_commands(Blitter* blitter, RenderBuffer* buffer);
+
+/**
+ * Function:
+ *  __bin_commands
+ *
+ * Purpose:
+ *  List the commands of each tile, in the order they are drawn.
+ *
+ * Parameters:
+ *  - blitter:
+ *      The Blitter object, its commands prepared.
+ *  - count:
+ *      The number of commands.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __bin_commands(Blitter* blitter, int32_t count);
+
+/**
+ * Function:
+ *  __draw_tiles
+ *
+ * Purpose:
+ *  The job drawing the commands of a range of tiles.
+ *
+ * Parameters:
+ *  - data:
+ *      The Blitter object.
+ *  - begin:
+ *      The first tile.
+ *  - end:
+ *      One past the last tile.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __draw_tiles(void* data, int32_t begin, int32_t end);
+
+/**
+ * Function:
+ *  __draw_command
+ *
+ * Purpose:
+ *  Draw the part of a command within a rectangle.
+ *
+ * Parameters:
+ *  - blitter:
+ *      The Blitter object, its commands prepared.
+ *  - kernels:
+ *      The blending loops to use.
+ *  - index:
+ *      The command's index in the buffer drawn.
+ *  - clip:
+ *      The rectangle, within the framebuffer.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __draw_command(Blitter* blitter, const BlitKernels* kernels, int32_t index, SDL_Rect* clip);
+
+/**
+ * Function:
+ *  __is_straight
+ *
+ * Purpose:
+ *  Check if a command is drawn without rotating or scaling.
+ *
+ * Parameters:
+ *  - command:
+ *      The command.
+ *
+ * Returns:
+ *  true for fills and sprites drawn as they are, false otherwise.
+ */
+static bool __is_straight(RenderCommand* command);
+
+/**
+ * Function:
+ *  __command_box
+ *
+ * Purpose:
+ *  Find the pixels a command may cover, the box around it once
+ *  rotated, not clipped to the framebuffer.
+ *
+ * Parameters:
+ *  - command:
+ *      The command.
+ *  - box:
+ *      Where the box is stored.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __command_box(RenderCommand* command, SDL_Rect* box);
+
+/**
+ * Function:
+ *  __fill
+ *
+ * Purpose:
+ *  Draw the part of a fill command within a rectangle.
+ *
+ * Parameters:
+ *  - blitter:
+ *      The Blitter object.
+ *  - command:
+ *      The command.
+ *  - clip:
+ *      The rectangle, within the framebuffer.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __fill(Blitter* blitter, RenderCommand* command, SDL_Rect* clip);
+
+/**
+ * Function:
+ *  __blit_sprite
+ *
+ * Purpose:
+ *  Draw the part of a sprite command within a rectangle.
+ *
+ * Parameters:
+ *  - blitter:
+ *      The Blitter object.
+ *  - kernels:
+ *      The blending loops to use.
+ *  - image:
+ *      The pixels of the command's texture.
+ *  - command:
+ *      The command.
+ *  - box:
+ *      The command's box.
+ *  - clip:
+ *      The rectangle, within the framebuffer.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __blit_sprite(Blitter* blitter, const BlitKernels* kernels, SDL_Surface* image, RenderCommand* command, SDL_Rect* box, SDL_Rect* clip);
+
+/**
+ * Function:
+ *  __narrow_span
+ *
+ * Purpose:
+ *  Narrow the pixels of a row to those whose image coordinate,
+ *  p + i * dp, may lie in [lo, hi). It errs on the wide side, the
+ *  kernels still test every pixel.
+ *
+ * Parameters:
+ *  - p:
+ *      The coordinate at the start of the row.
+ *  - dp:
+ *      How much it moves per pixel.
+ *  - lo:
+ *      The lowest coordinate inside the image.
+ *  - hi:
+ *      One past the highest.
+ *  - begin:
+ *      The first pixel of the span, moved up.
+ *  - end:
+ *      One past the last, moved down.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __narrow_span(float p, float dp, float lo, float hi, int32_t* begin, int32_t* end);
+
+/**
+ * Function:
+ *  __blend_pixel
+ *
+ * Purpose:
+ *  Blend a pixel over an opaque one by its alpha.
+ *
+ * Parameters:
+ *  - s:
+ *      The pixel drawn.
+ *  - d:
+ *      The pixel drawn over.
+ *
+ * Returns:
+ *  The opaque result.
+ */
+static inline uint32_t __blend_pixel(uint32_t s, uint32_t d);
+
+/**
+ * Scanlines are drawn in memory the blitter owns rather than in the
+ * locked texture or window surface, whose memory may be slow to read
+ * back from, and blending reads every pixel it writes. The first
+ * frame is drawn in full.
+ */
+Blitter* init_blitter(SDL_Renderer* renderer, SDL_Window* window, int32_t width, int32_t height) {
+    Blitter* blitter = (Blitter*)calloc(1, sizeof(Blitter));
+    blitter->window = window;
+    blitter->target = NULL;
+    if (window == NULL) {
+        blitter->target = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, width, height);
+        if (blitter->target == NULL) {
+            SDL_Log(CREATE_TARGET_LOG, SDL_GetError());
+            free(blitter);
+            return NULL;
+        }
+    }
+    blitter->pixels = (uint32_t*)malloc(sizeof(uint32_t) * width * height);
+    blitter->width = width;
+    blitter->height = height;
+    blitter->image_count = 0;
+    blitter->last_texture = NULL;
+    blitter->last_image = NULL;
+
+    blitter->tile_columns = (width + BLIT_TILE_SIZE - 1) / BLIT_TILE_SIZE;
+    blitter->tile_rows = (height + BLIT_TILE_SIZE - 1) / BLIT_TILE_SIZE;
+    int32_t tiles = blitter->tile_columns * blitter->tile_rows;
+    blitter->tile_starts = (int32_t*)malloc(sizeof(int32_t) * (tiles + 1));
+    blitter->tile_cursors = (int32_t*)malloc(sizeof(int32_t) * tiles);
+    blitter->tile_commands = NULL;
+    blitter->tile_capacity = 0;
+    blitter->cell_columns = (width + BLIT_CELL_SIZE - 1) / BLIT_CELL_SIZE;
+    blitter->cell_rows = (height + BLIT_CELL_SIZE - 1) / BLIT_CELL_SIZE;
+    int32_t cells = blitter->cell_columns * blitter->cell_rows;
+    blitter->cell_states = (uint8_t*)calloc(cells, sizeof(uint8_t));
+    blitter->command_images = NULL;
+    blitter->command_boxes = NULL;
+    blitter->command_capacity = 0;
+    blitter->drawing = NULL;
+    blitter->backend = MATH_SCALAR;
+
+    blitter->clear = OPAQUE;
+    blitter->track_dirty = true;
+    blitter->background = (uint32_t*)malloc(sizeof(uint32_t) * width * height);
+    blitter->background_commands = NULL;
+    blitter->background_count = 0;
+    blitter->background_capacity = 0;
+    blitter->background_valid = false;
+    blitter->first_foreground = 0;
+    blitter->full = true;
+    blitter->dirty_rects = (SDL_Rect*)malloc(sizeof(SDL_Rect) * cells);
+    blitter->dirty_count = 0;
+    blitter->run_rects = (int32_t*)malloc(sizeof(int32_t) * 2 * blitter->cell_columns);
+    blitter->frame = (BlitStats){ 0, 0 };
+    blitter->total = (BlitStats){ 0, 0 };
+    blitter->frames = 0;
+    return blitter;
+}
+
+/**
+ * The copy is converted once here, so the blending loops only
+ * ever see one pixel format.
+ */
+bool add_blit_image(Blitter* blitter, SDL_Texture* texture, SDL_Surface* surface) {
+    if (blitter->image_count == RENDER_MAX_TEXTURES) {
+        SDL_Log(TOO_MANY_IMAGES_LOG);
+        return false;
+    }
+    SDL_Surface* image = SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_ARGB8888, 0);
+    if (image == NULL) {
+        SDL_Log(CONVERT_IMAGE_LOG, SDL_GetError());
+        return false;
+    }
+    blitter->textures[blitter->image_count] = texture;
+    blitter->images[blitter->image_count] = image;
+    blitter->image_count++;
+    return true;
+}
+
+/**
+ * The cached background was drawn over the old color, so a new
+ * one means drawing it again.
+ */
+void clear_blitter(Blitter* blitter, SDL_Color color) {
+    uint32_t pixel = OPAQUE | (uint32_t)color.r << 16 | (uint32_t)color.g << 8 | color.b;
+    if (pixel != blitter->clear) blitter->background_valid = false;
+    blitter->clear = pixel;
+}
+
+/**
+ * Only the rectangles redrawn are copied into the window's surface
+ * or uploaded to the texture, the rest is as it was.
+ */
+void blit_render_buffer(Blitter* blitter, RenderBuffer* buffer, SDL_Renderer* renderer, JobSystem* jobs) {
+    draw_render_buffer(blitter, buffer, jobs);
+    if (blitter->window) {
+        __present_window(blitter);
+    } else {
+        for (int32_t i = 0; i < blitter->dirty_count; i++) {
+            SDL_Rect* rect = &blitter->dirty_rects[i];
+            SDL_UpdateTexture(
+                blitter->target,
+                rect,
+                blitter->pixels + rect->y * blitter->width + rect->x,
+                blitter->width * (int)sizeof(uint32_t)
+            );
+        }
+        SDL_RenderCopy(renderer, blitter->target, NULL, NULL);
+    }
+
+    RenderStats stats = { (uint64_t)buffer->count, 1, 1 };
+    finish_render_buffer(buffer, &stats);
+}
+
+/*********************
+ * Scalar fallbacks  *
+ *********************/
+
+/**
+ * Rows are blended one pixel at a time.
+ */
+static void __blend_row_scalar(uint32_t* dst, const uint32_t* src, int32_t n) {
+    for (int32_t i = 0; i < n; i++) dst[i] = __blend_pixel(src[i], dst[i]);
+}
+
+/**
+ * The image position is worked out from the start of the row for
+ * every pixel, rather than added up, so the SIMD loops can work it
+ * out the same way and get the same pixels.
+ */
+static void __blend_mapped_scalar(uint32_t* dst, int32_t begin, int32_t end, const BlitSource* source, float u, float v, float du, float dv) {
+    for (int32_t i = begin; i < end; i++) {
+        float fu = u + (float)i * du;
+        float fv = v + (float)i * dv;
+        if (fu < source->left || fu >= source->right || fv < source->top || fv >= source->bottom) continue;
+        dst[i] = __blend_pixel(source->pixels[(int32_t)fv * source->pitch + (int32_t)fu], dst[i]);
+    }
+}
+
+#ifdef BLITTER_X86
+
+/*****************
+ * SSE2 backend  *
+ *****************/
+
+/**
+ * Each channel widens to 16 bits, where s * a + d * (255 - a) fits,
+ * and the division by 255 is rounded the way __blend_pixel does it.
+ */
+__attribute__((target("sse2")))
+static inline __m128i __blend_epi32(__m128i s, __m128i d) {
+    __m128i zero = _mm_setzero_si128();
+    __m128i max = _mm_set1_epi16(255);
+    __m128i half = _mm_set1_epi16(128);
+
+    __m128i s_lo = _mm_unpacklo_epi8(s, zero), s_hi = _mm_unpackhi_epi8(s, zero);
+    __m128i d_lo = _mm_unpacklo_epi8(d, zero), d_hi = _mm_unpackhi_epi8(d, zero);
+    __m128i a_lo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s_lo, 0xFF), 0xFF);
+    __m128i a_hi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s_hi, 0xFF), 0xFF);
+
+    __m128i t_lo = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(s_lo, a_lo),
+        _mm_mullo_epi16(d_lo, _mm_sub_epi16(max, a_lo))), half);
+    __m128i t_hi = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(s_hi, a_hi),
+        _mm_mullo_epi16(d_hi, _mm_sub_epi16(max, a_hi))), half);
+    t_lo = _mm_srli_epi16(_mm_add_epi16(t_lo, _mm_srli_epi16(t_lo, 8)), 8);
+    t_hi = _mm_srli_epi16(_mm_add_epi16(t_hi, _mm_srli_epi16(t_hi, 8)), 8);
+
+    return _mm_or_si128(_mm_packus_epi16(t_lo, t_hi), _mm_set1_epi32((int32_t)OPAQUE));
+}
+
+__attribute__((target("sse2")))
+static void __blend_row_sse(uint32_t* dst, const uint32_t* src, int32_t n) {
+    int32_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+        _mm_storeu_si128((__m128i*)(dst + i), __blend_epi32(s, d));
+    }
+    __blend_row_scalar(dst + i, src + i, n - i);
+}
+
+/**
+ * SSE2 has no gather, so the pixels inside the image are loaded
+ * one at a time, and those outside are left transparent.
+ */
+__attribute__((target("sse2")))
+static void __blend_mapped_sse(uint32_t* dst, int32_t begin, int32_t end, const BlitSource* source, float u, float v, float du, float dv) {
+    __m128 steps = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+    __m128 u0 = _mm_set1_ps(u), v0 = _mm_set1_ps(v);
+    __m128 du4 = _mm_set1_ps(du), dv4 = _mm_set1_ps(dv);
+    __m128 left = _mm_set1_ps(source->left), right = _mm_set1_ps(source->right);
+    __m128 top = _mm_set1_ps(source->top), bottom = _mm_set1_ps(source->bottom);
+
+    int32_t i = begin;
+    for (; i + 4 <= end; i += 4) {
+        __m128 fi = _mm_add_ps(_mm_set1_ps((float)i), steps);
+        __m128 fu = _mm_add_ps(u0, _mm_mul_ps(fi, du4));
+        __m128 fv = _mm_add_ps(v0, _mm_mul_ps(fi, dv4));
+        __m128 inside = _mm_and_ps(
+            _mm_and_ps(_mm_cmpge_ps(fu, left), _mm_cmplt_ps(fu, right)),
+            _mm_and_ps(_mm_cmpge_ps(fv, top), _mm_cmplt_ps(fv, bottom))
+        );
+        int32_t mask = _mm_movemask_ps(inside);
+        if (mask == 0) continue;
+
+        int32_t us[4], vs[4];
+        uint32_t texels[4];
+        _mm_storeu_si128((__m128i*)us, _mm_cvttps_epi32(fu));
+        _mm_storeu_si128((__m128i*)vs, _mm_cvttps_epi32(fv));
+        for (int32_t k = 0; k < 4; k++) {
+            texels[k] = (mask >> k) & 1 ? source->pixels[vs[k] * source->pitch + us[k]] : 0;
+        }
+        __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+        _mm_storeu_si128((__m128i*)(dst + i), __blend_epi32(_mm_loadu_si128((const __m128i*)texels), d));
+    }
+    __blend_mapped_scalar(dst, i, end, source, u, v, du, dv);
+}
+
+/*****************
+ * AVX2 backend  *
+ *****************/
+
+/**
+ * As __blend_epi32, eight pixels at a time. Unpacking and packing
+ * both work within 128 bit lanes, so the pixels come out in order.
+ */
+__attribute__((target("avx2,fma")))
+static inline __m256i __blend_epi32_256(__m256i s, __m256i d) {
+    __m256i zero = _mm256_setzero_si256();
+    __m256i max = _mm256_set1_epi16(255);
+    __m256i half = _mm256_set1_epi16(128);
+
+    __m256i s_lo = _mm256_unpacklo_epi8(s, zero), s_hi = _mm256_unpackhi_epi8(s, zero);
+    __m256i d_lo = _mm256_unpacklo_epi8(d, zero), d_hi = _mm256_unpackhi_epi8(d, zero);
+    __m256i a_lo = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(s_lo, 0xFF), 0xFF);
+    __m256i a_hi = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(s_hi, 0xFF), 0xFF);
+
+    __m256i t_lo = _mm256_add_epi16(_mm256_add_epi16(_mm256_mullo_epi16(s_lo, a_lo),
+        _mm256_mullo_epi16(d_lo, _mm256_sub_epi16(max, a_lo))), half);
+    __m256i t_hi = _mm256_add_epi16(_mm256_add_epi16(_mm256_mullo_epi16(s_hi, a_hi),
+        _mm256_mullo_epi16(d_hi, _mm256_sub_epi16(max, a_hi))), half);
+    t_lo = _mm256_srli_epi16(_mm256_add_epi16(t_lo, _mm256_srli_epi16(t_lo, 8)), 8);
+    t_hi = _mm256_srli_epi16(_mm256_add_epi16(t_hi, _mm256_srli_epi16(t_hi, 8)), 8);
+
+    return _mm256_or_si256(_mm256_packus_epi16(t_lo, t_hi), _mm256_set1_epi32((int32_t)OPAQUE));
+}
+
+__attribute__((target("avx2,fma")))
+static void __blend_row_avx2(uint32_t* dst, const uint32_t* src, int32_t n) {
+    int32_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i s = _mm256_loadu_si256((const __m256i*)(src + i));
+        __m256i d = _mm256_loadu_si256((const __m256i*)(dst + i));
+        _mm256_storeu_si256((__m256i*)(dst + i), __blend_epi32_256(s, d));
+    }
+    __blend_row_sse(dst + i, src + i, n - i);
+}
+
+/**
+ * The gather only loads the pixels inside the image, the others
+ * stay zero, which is transparent.
+ */
+__attribute__((target("avx2,fma")))
+static void __blend_mapped_avx2(uint32_t* dst, int32_t begin, int32_t end, const BlitSource* source, float u, float v, float du, float dv) {
+    __m256 steps = _mm256_set_ps(7.0f, 6.0f, 5.0f, 4.0f, 3.0f, 2.0f, 1.0f, 0.0f);
+    __m256 u0 = _mm256_set1_ps(u), v0 = _mm256_set1_ps(v);
+    __m256 du8 = _mm256_set1_ps(du), dv8 = _mm256_set1_ps(dv);
+    __m256 left = _mm256_set1_ps(source->left), right = _mm256_set1_ps(source->right);
+    __m256 top = _mm256_set1_ps(source->top), bottom = _mm256_set1_ps(source->bottom);
+    __m256i pitch = _mm256_set1_epi32(source->pitch);
+
+    int32_t i = begin;
+    for (; i + 8 <= end; i += 8) {
+        __m256 fi = _mm256_add_ps(_mm256_set1_ps((float)i), steps);
+        __m256 fu = _mm256_add_ps(u0, _mm256_mul_ps(fi, du8));
+        __m256 fv = _mm256_add_ps(v0, _mm256_mul_ps(fi, dv8));
+        __m256 inside = _mm256_and_ps(
+            _mm256_and_ps(_mm256_cmp_ps(fu, left, _CMP_GE_OQ), _mm256_cmp_ps(fu, right, _CMP_LT_OQ)),
+            _mm256_and_ps(_mm256_cmp_ps(fv, top, _CMP_GE_OQ), _mm256_cmp_ps(fv, bottom, _CMP_LT_OQ))
+        );
+        if (_mm256_movemask_ps(inside) == 0) continue;
+
+        __m256i index = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_cvttps_epi32(fv), pitch), _mm256_cvttps_epi32(fu));
+        __m256i texels = _mm256_mask_i32gather_epi32(
+            _mm256_setzero_si256(), (const int*)source->pixels, index, _mm256_castps_si256(inside), 4);
+        __m256i d = _mm256_loadu_si256((const __m256i*)(dst + i));
+        _mm256_storeu_si256((__m256i*)(dst + i), __blend_epi32_256(texels, d));
+    }
+    if (i == end) return;
+
+    // The last few pixels are loaded and stored masked, the pixels
+    // past the end may belong to another thread's tile
+    __m256i lanes = _mm256_add_epi32(_mm256_set1_epi32(i), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+    __m256i live = _mm256_cmpgt_epi32(_mm256_set1_epi32(end), lanes);
+    __m256 fi = _mm256_cvtepi32_ps(lanes);
+    __m256 fu = _mm256_add_ps(u0, _mm256_mul_ps(fi, du8));
+    __m256 fv = _mm256_add_ps(v0, _mm256_mul_ps(fi, dv8));
+    __m256 inside = _mm256_and_ps(
+        _mm256_and_ps(_mm256_cmp_ps(fu, left, _CMP_GE_OQ), _mm256_cmp_ps(fu, right, _CMP_LT_OQ)),
+        _mm256_and_ps(_mm256_cmp_ps(fv, top, _CMP_GE_OQ), _mm256_cmp_ps(fv, bottom, _CMP_LT_OQ))
+    );
+    inside = _mm256_and_ps(inside, _mm256_castsi256_ps(live));
+    if (_mm256_movemask_ps(inside) == 0) return;
+
+    __m256i index = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_cvttps_epi32(fv), pitch), _mm256_cvttps_epi32(fu));
+    __m256i texels = _mm256_mask_i32gather_epi32(
+        _mm256_setzero_si256(), (const int*)source->pixels, index, _mm256_castps_si256(inside), 4);
+    __m256i d = _mm256_maskload_epi32((const int*)(dst + i), live);
+    _mm256_maskstore_epi32((int*)(dst + i), live, __blend_epi32_256(texels, d));
+}
+
+#endif
+
+/************
+ * Dispatch *
+ ************/
+
+// Kernels for each backend, indexed by MathBackend
+static const BlitKernels KERNELS[] = {
+    { __blend_row_scalar, __blend_mapped_scalar },
+#ifdef BLITTER_X86
+    { __blend_row_sse, __blend_mapped_sse },
+    { __blend_row_avx2, __blend_mapped_avx2 }
+#endif
+};
+
+/**
+ * The backend is the one chosen for the math arrays, so a machine
+ * only has one notion of which instructions it may use. Every tile
+ * covers its own pixels, so they are drawn without locks, and each
+ * command is drawn the same whichever tiles it is split over. The
+ * background is drawn first, being the lowest layers, so it ends at
+ * the first command of a higher layer. Without tracking or threads
+ * there is no use for tiles.
+ */
+void draw_render_buffer(Blitter* blitter, RenderBuffer* buffer, JobSystem* jobs) {
+    sort_render_buffer(buffer);
+    blitter->drawing = buffer;
+    blitter->backend = get_math_backend();
+    __prepare_commands(blitter, buffer);
+
+    int32_t first = 0;
+    while (first < buffer->count && buffer->commands[first].key >> 8 < BACKGROUND_LAYERS) first++;
+    blitter->first_foreground = first;
+    blitter->full = !blitter->track_dirty || __background_changed(blitter, buffer);
+
+    if (!blitter->track_dirty && jobs == NULL) {
+        SDL_Rect clip = { 0, 0, blitter->width, blitter->height };
+        const BlitKernels* kernels = &KERNELS[blitter->backend];
+        __clear_rect(blitter, &clip);
+        for (int32_t i = 0; i < buffer->count; i++) __draw_command(blitter, kernels, i, &clip);
+        blitter->background_valid = false;
+    } else {
+        int32_t tiles = blitter->tile_columns * blitter->tile_rows;
+        __bin_commands(blitter, buffer->count);
+        if (jobs) {
+            add_task(jobs, __draw_tiles, blitter, tiles, 1);
+            run_tasks(jobs);
+        } else {
+            __draw_tiles(blitter, 0, tiles);
+        }
+        blitter->background_valid = blitter->track_dirty;
+    }
+
+    __find_dirty_rects(blitter);
+    blitter->total.pixels += blitter->frame.pixels;
+    blitter->total.rects += blitter->frame.rects;
+    blitter->frames++;
+}
+
+void destroy_blitter(Blitter* blitter) {
+    for (int32_t i = 0; i < blitter->image_count; i++) SDL_FreeSurface(blitter->images[i]);
+    if (blitter->target) SDL_DestroyTexture(blitter->target);
+    free(blitter->pixels);
+    free(blitter->tile_starts);
+    free(blitter->tile_cursors);
+    free(blitter->tile_commands);
+    free(blitter->cell_states);
+    free(blitter->command_images);
+    free(blitter->command_boxes);
+    free(blitter->background);
+    free(blitter->background_commands);
+    free(blitter->dirty_rects);
+    free(blitter->run_rects);
+    free(blitter);
+}
+
+/**
+ * The floor follows the camera, so the background changes whenever
+ * the player moves and only stays while it stands still. Commands
+ * are compared field by field, padding is never written.
+ */
+static bool __background_changed(Blitter* blitter, RenderBuffer* buffer) {
+    int32_t count = blitter->first_foreground;
+    bool changed = !blitter->background_valid || count != blitter->background_count;
+    for (int32_t i = 0; i < count && !changed; i++) {
+        RenderCommand* a = &buffer->commands[i];
+        RenderCommand* b = &blitter->background_commands[i];
+        changed = a->texture != b->texture || a->angle != b->angle
+            || a->src.x != b->src.x || a->src.y != b->src.y || a->src.w != b->src.w || a->src.h != b->src.h
+            || a->dst.x != b->dst.x || a->dst.y != b->dst.y || a->dst.w != b->dst.w || a->dst.h != b->dst.h
+            || a->color.r != b->color.r || a->color.g != b->color.g
+            || a->color.b != b->color.b || a->color.a != b->color.a;
+    }
+    if (!changed) return false;
+
+    if (count > blitter->background_capacity) {
+        blitter->background_capacity = buffer->capacity;
+        blitter->background_commands = (RenderCommand*)realloc(
+            blitter->background_commands, sizeof(RenderCommand) * blitter->background_capacity);
+    }
+    memcpy(blitter->background_commands, buffer->commands, sizeof(RenderCommand) * count);
+    blitter->background_count = count;
+    return true;
+}
+
+/**
+ * A full frame is one rectangle. Otherwise a cell is redrawn if
+ * something moving covers it now, or did last frame and has to be
+ * wiped off.
+ */
+static void __find_dirty_rects(Blitter* blitter) {
+    if (blitter->full) {
+        blitter->dirty_rects[0] = (SDL_Rect){ 0, 0, blitter->width, blitter->height };
+        blitter->dirty_count = 1;
+        blitter->frame = (BlitStats){ (uint64_t)blitter->width * blitter->height, 1 };
+        return;
+    }
+
+    SDL_Rect cells = { 0, 0, blitter->cell_columns, blitter->cell_rows };
+    blitter->dirty_count = __find_runs(blitter, &cells, blitter->dirty_rects, blitter->run_rects);
+    blitter->frame = (BlitStats){ 0, (uint64_t)blitter->dirty_count };
+    for (int32_t i = 0; i < blitter->dirty_count; i++) {
+        blitter->frame.pixels += (uint64_t)blitter->dirty_rects[i].w * blitter->dirty_rects[i].h;
+    }
+}
+
+/**
+ * The rectangles touched by the row above are kept in one half of
+ * runs, those of this row in the other, and a run only joins one
+ * that ended on the row above with the same columns. Everything
+ * dirty is then a rectangle per block.
+ */
+static int32_t __find_runs(Blitter* blitter, SDL_Rect* cells, SDL_Rect* rects, int32_t* runs) {
+    int32_t count = 0, above = 0;
+    int32_t* last = runs;
+    int32_t* current = runs + cells->w;
+    for (int32_t cy = cells->y; cy < cells->y + cells->h; cy++) {
+        uint8_t* states = blitter->cell_states + cy * blitter->cell_columns;
+        int32_t y = cy * BLIT_CELL_SIZE;
+        int32_t h = y + BLIT_CELL_SIZE > blitter->height ? blitter->height - y : BLIT_CELL_SIZE;
+        int32_t row = 0;
+
+        int32_t cx = cells->x;
+        while (cx < cells->x + cells->w) {
+            if (states[cx] == 0) {
+                cx++;
+                continue;
+            }
+            int32_t begin = cx;
+            while (cx < cells->x + cells->w && states[cx] != 0) cx++;
+
+            int32_t x = begin * BLIT_CELL_SIZE;
+            int32_t w = (cx * BLIT_CELL_SIZE > blitter->width ? blitter->width : cx * BLIT_CELL_SIZE) - x;
+            int32_t joined = -1;
+            for (int32_t i = 0; i < above && joined < 0; i++) {
+                SDL_Rect* r = &rects[last[i]];
+                if (r->x == x && r->w == w && r->y + r->h == y) joined = last[i];
+            }
+            if (joined < 0) {
+                joined = count++;
+                rects[joined] = (SDL_Rect){ x, y, w, 0 };
+            }
+            rects[joined].h += h;
+            current[row++] = joined;
+        }
+
+        int32_t* swap = last;
+        last = current;
+        current = swap;
+        above = row;
+    }
+    return count;
+}
+
+static bool __overlaps(SDL_Rect* a, SDL_Rect* b) {
+    return a->x < b->x + b->w && b->x < a->x + a->w && a->y < b->y + b->h && b->y < a->y + a->h;
+}
+
+/**
+ * The surface may not be ARGB8888, usually it is XRGB8888, which
+ * SDL copies as it is.
+ */
+static void __present_window(Blitter* blitter) {
+    if (blitter->dirty_count == 0) return;
+    SDL_Surface* surface = SDL_GetWindowSurface(blitter->window);
+    if (surface == NULL) return;
+
+    if (SDL_MUSTLOCK(surface)) SDL_LockSurface(surface);
+    int32_t bytes = surface->format->BytesPerPixel;
+    for (int32_t i = 0; i < blitter->dirty_count; i++) {
+        SDL_Rect* rect = &blitter->dirty_rects[i];
+        SDL_ConvertPixels(
+            rect->w,
+            rect->h,
+            SDL_PIXELFORMAT_ARGB8888,
+            blitter->pixels + rect->y * blitter->width + rect->x,
+            blitter->width * (int)sizeof(uint32_t),
+            surface->format->format,
+            (uint8_t*)surface->pixels + rect->y * surface->pitch + rect->x * bytes,
+            surface->pitch
+        );
+    }
+    if (SDL_MUSTLOCK(surface)) SDL_UnlockSurface(surface);
+    SDL_UpdateWindowSurfaceRects(blitter->window, blitter->dirty_rects, blitter->dirty_count);
+}
+
+static void __copy_rect(uint32_t* to, const uint32_t* from, int32_t width, SDL_Rect* rect) {
+    for (int32_t y = rect->y; y < rect->y + rect->h; y++) {
+        memcpy(to + y * width + rect->x, from + y * width + rect->x, sizeof(uint32_t) * rect->w);
+    }
+}
+
+static void __clear_rect(Blitter* blitter, SDL_Rect* rect) {
+    for (int32_t y = rect->y; y < rect->y + rect->h; y++) {
+        uint32_t* row = blitter->pixels + y * blitter->width;
+        for (int32_t x = rect->x; x < rect->x + rect->w; x++) row[x] = blitter->clear;
+    }
+}
+
+/**
+ * Commands are sorted by texture, so the last one found usually
+ * matches.
+ */
+static SDL_Surface* __find_image(Blitter* blitter, SDL_Texture* texture) {
+    if (texture == blitter->last_texture) return blitter->last_image;
+    for (int32_t i = 0; i < blitter->image_count; i++) {
+        if (blitter->textures[i] == texture) {
+            blitter->last_texture = texture;
+            blitter->last_image = blitter->images[i];
+            return blitter->last_image;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * The lookup caches the last texture in the blitter, which the
+ * tiles' threads must not share, so it is done up front.
+ */
+static void __prepare_commands(Blitter* blitter, RenderBuffer* buffer) {
+    if (buffer->count > blitter->command_capacity) {
+        blitter->command_capacity = buffer->capacity;
+        blitter->command_images = (SDL_Surface**)realloc(blitter->command_images, sizeof(SDL_Surface*) * blitter->command_capacity);
+        blitter->command_boxes = (SDL_Rect*)realloc(blitter->command_boxes, sizeof(SDL_Rect) * blitter->command_capacity);
+    }
+    for (int32_t i = 0; i < buffer->count; i++) {
+        RenderCommand* command = &buffer->commands[i];
+        blitter->command_images[i] = command->texture ? __find_image(blitter, command->texture) : NULL;
+        __command_box(command, &blitter->command_boxes[i]);
+    }
+}
+
+/**
+ * A counting sort: each tile's commands are counted, the counts
+ * summed into where each tile's list starts, and the commands
+ * placed in order, so a tile draws them as they were sorted. Unless
+ * the whole frame is redrawn, the background comes from the cache
+ * and only the commands over it are binned. Counting also marks the
+ * cells those cover.
+ */
+static void __bin_commands(Blitter* blitter, int32_t count) {
+    int32_t tiles = blitter->tile_columns * blitter->tile_rows;
+    int32_t* starts = blitter->tile_starts;
+    memset(starts, 0, sizeof(int32_t) * (tiles + 1));
+    int32_t cells = blitter->cell_columns * blitter->cell_rows;
+    for (int32_t c = 0; c < cells; c++) blitter->cell_states[c] = (uint8_t)((blitter->cell_states[c] & 1) << 1);
+
+    int32_t first = blitter->full ? 0 : blitter->first_foreground;
+    for (int32_t pass = 0; pass < 2; pass++) {
+        for (int32_t i = first; i < count; i++) {
+            SDL_Rect* box = &blitter->command_boxes[i];
+            if (blitter->drawing->commands[i].texture && blitter->command_images[i] == NULL) continue;
+
+            int32_t x0 = box->x < 0 ? 0 : box->x;
+            int32_t y0 = box->y < 0 ? 0 : box->y;
+            int32_t x1 = box->x + box->w > blitter->width ? blitter->width : box->x + box->w;
+            int32_t y1 = box->y + box->h > blitter->height ? blitter->height : box->y + box->h;
+            if (x0 >= x1 || y0 >= y1) continue;
+
+            if (pass == 0 && i >= blitter->first_foreground) {
+                for (int32_t cy = y0 / BLIT_CELL_SIZE; cy <= (y1 - 1) / BLIT_CELL_SIZE; cy++) {
+                    for (int32_t cx = x0 / BLIT_CELL_SIZE; cx <= (x1 - 1) / BLIT_CELL_SIZE; cx++) {
+                        blitter->cell_states[cy * blitter->cell_columns + cx] |= 1;
+                    }
+                }
+            }
+
+            for (int32_t ty = y0 / BLIT_TILE_SIZE; ty <= (y1 - 1) / BLIT_TILE_SIZE; ty++) {
+                for (int32_t tx = x0 / BLIT_TILE_SIZE; tx <= (x1 - 1) / BLIT_TILE_SIZE; tx++) {
+                    int32_t tile = ty * blitter->tile_columns + tx;
+                    if (pass == 1) {
+                        blitter->tile_commands[blitter->tile_cursors[tile]++] = i;
+                        continue;
+                    }
+                    starts[tile + 1]++;
+                }
+            }
+        }
+
+        if (pass == 0) {
+            for (int32_t t = 0; t < tiles; t++) starts[t + 1] += starts[t];
+            if (starts[tiles] > blitter->tile_capacity) {
+                blitter->tile_capacity = starts[tiles] * 2;
+                blitter->tile_commands = (int32_t*)realloc(blitter->tile_commands, sizeof(int32_t) * blitter->tile_capacity);
+            }
+            memcpy(blitter->tile_cursors, starts, sizeof(int32_t) * tiles);
+        }
+    }
+}
+
+/**
+ * Tiles on the framebuffer's right and bottom edges are cut short.
+ * A full frame clears each tile and draws its background, which is
+ * kept while tracking, and then the commands over it. Otherwise only
+ * the rectangles of dirty cells are restored from the cache and the
+ * commands over the background drawn within them.
+ */
+static void __draw_tiles(void* data, int32_t begin, int32_t end) {
+    Blitter* blitter = (Blitter*)data;
+    const BlitKernels* kernels = &KERNELS[blitter->backend];
+    for (int32_t t = begin; t < end; t++) {
+        int32_t x = t % blitter->tile_columns * BLIT_TILE_SIZE;
+        int32_t y = t / blitter->tile_columns * BLIT_TILE_SIZE;
+        SDL_Rect clip = {
+            x,
+            y,
+            x + BLIT_TILE_SIZE > blitter->width ? blitter->width - x : BLIT_TILE_SIZE,
+            y + BLIT_TILE_SIZE > blitter->height ? blitter->height - y : BLIT_TILE_SIZE
+        };
+        int32_t first = blitter->tile_starts[t], last = blitter->tile_starts[t + 1];
+        if (blitter->full) {
+            __clear_rect(blitter, &clip);
+            int32_t k = first;
+            for (; k < last && blitter->tile_commands[k] < blitter->first_foreground; k++) {
+                __draw_command(blitter, kernels, blitter->tile_commands[k], &clip);
+            }
+            if (blitter->track_dirty) __copy_rect(blitter->background, blitter->pixels, blitter->width, &clip);
+            for (; k < last; k++) __draw_command(blitter, kernels, blitter->tile_commands[k], &clip);
+            continue;
+        }
+
+        SDL_Rect cells = {
+            clip.x / BLIT_CELL_SIZE,
+            clip.y / BLIT_CELL_SIZE,
+            (clip.w + BLIT_CELL_SIZE - 1) / BLIT_CELL_SIZE,
+            (clip.h + BLIT_CELL_SIZE - 1) / BLIT_CELL_SIZE
+        };
+        SDL_Rect rects[(BLIT_TILE_SIZE / BLIT_CELL_SIZE) * (BLIT_TILE_SIZE / BLIT_CELL_SIZE)];
+        int32_t runs[2 * (BLIT_TILE_SIZE / BLIT_CELL_SIZE)];
+        int32_t count = __find_runs(blitter, &cells, rects, runs);
+        for (int32_t r = 0; r < count; r++) {
+            __copy_rect(blitter->pixels, blitter->background, blitter->width, &rects[r]);
+            for (int32_t k = first; k < last; k++) {
+                int32_t index = blitter->tile_commands[k];
+                if (__overlaps(&blitter->command_boxes[index], &rects[r])) __draw_command(blitter, kernels, index, &rects[r]);
+            }
+        }
+    }
+}
+
+/**
+ * Commands with textures never added are skipped.
+ */
+static void __draw_command(Blitter* blitter, const BlitKernels* kernels, int32_t index, SDL_Rect* clip) {
+    RenderCommand* command = &blitter->drawing->commands[index];
+    if (command->texture == NULL) {
+        __fill(blitter, command, clip);
+    } else if (blitter->command_images[index] != NULL) {
+        __blit_sprite(blitter, kernels, blitter->command_images[index], command, &blitter->command_boxes[index], clip);
+    }
+}
+
+static bool __is_straight(RenderCommand* command) {
+    return command->texture == NULL || (command->angle == 0.0f
+        && command->src.w == command->dst.w && command->src.h == command->dst.h);
+}
+
+/**
+ * A w by h box turned by the angle around its center spans
+ * |cos| w + |sin| h across and |sin| w + |cos| h down.
+ */
+static void __command_box(RenderCommand* command, SDL_Rect* box) {
+    SDL_Rect* dst = &command->dst;
+    if (__is_straight(command)) {
+        *box = *dst;
+        return;
+    }
+
+    float radians = deg_to_rad(command->angle);
+    float c = fast_cos(radians), s = fast_sin(radians);
+    float cx = dst->x + 0.5f * dst->w, cy = dst->y + 0.5f * dst->h;
+    float ac = c < 0 ? -c : c, as = s < 0 ? -s : s;
+    float hw = 0.5f * (ac * dst->w + as * dst->h), hh = 0.5f * (as * dst->w + ac * dst->h);
+
+    int32_t x0 = (int32_t)(cx - hw), y0 = (int32_t)(cy - hh);
+    box->x = x0;
+    box->y = y0;
+    box->w = (int32_t)(cx + hw) + 1 - x0;
+    box->h = (int32_t)(cy + hh) + 1 - y0;
+}
+
+/**
+ * Opaque fills are plain stores, which is all walls need.
+ */
+static void __fill(Blitter* blitter, RenderCommand* command, SDL_Rect* clip) {
+    SDL_Rect* dst = &command->dst;
+    int32_t x0 = dst->x < clip->x ? clip->x : dst->x;
+    int32_t y0 = dst->y < clip->y ? clip->y : dst->y;
+    int32_t x1 = dst->x + dst->w > clip->x + clip->w ? clip->x + clip->w : dst->x + dst->w;
+    int32_t y1 = dst->y + dst->h > clip->y + clip->h ? clip->y + clip->h : dst->y + dst->h;
+
+    SDL_Color c = command->color;
+    uint32_t pixel = (uint32_t)c.a << 24 | (uint32_t)c.r << 16 | (uint32_t)c.g << 8 | c.b;
+    for (int32_t y = y0; y < y1; y++) {
+        uint32_t* row = blitter->pixels + y * blitter->width;
+        if (c.a == 255) {
+            for (int32_t x = x0; x < x1; x++) row[x] = pixel;
+        } else {
+            for (int32_t x = x0; x < x1; x++) row[x] = __blend_pixel(pixel, row[x]);
+        }
+    }
+}
+
+/**
+ * Sprites drawn at their own size and unrotated, like floor tiles,
+ * are blended row by row straight from the image. Others are drawn
+ * over their box: each pixel's center is turned back by the angle
+ * around the sprite's center and scaled into the source rectangle,
+ * the nearest image pixel taken, as SDL does without filtering. The
+ * angle is clockwise on screen, so with y pointing down a window
+ * offset (x, y) comes from
+ *
+ *  u = x * cos + y * sin
+ *  v = y * cos - x * sin
+ *
+ * which only moves by (cos, -sin) from one pixel of a row to the next.
+ * Rows are stepped from the box's left edge, within the framebuffer,
+ * whatever the clip, so a sprite split over tiles gets the same pixels.
+ * Most of the box is outside the sprite, so each row is first narrowed
+ * to the pixels that can be inside it.
+ */
+static void __blit_sprite(Blitter* blitter, const BlitKernels* kernels, SDL_Surface* image, RenderCommand* command, SDL_Rect* box, SDL_Rect* clip) {
+    SDL_Rect* src = &command->src;
+    SDL_Rect* dst = &command->dst;
+    if (dst->w <= 0 || dst->h <= 0) return;
+
+    int32_t x0 = box->x < clip->x ? clip->x : box->x;
+    int32_t y0 = box->y < clip->y ? clip->y : box->y;
+    int32_t x1 = box->x + box->w > clip->x + clip->w ? clip->x + clip->w : box->x + box->w;
+    int32_t y1 = box->y + box->h > clip->y + clip->h ? clip->y + clip->h : box->y + box->h;
+    const uint32_t* pixels = (const uint32_t*)image->pixels;
+    int32_t pitch = image->pitch / (int32_t)sizeof(uint32_t);
+
+    if (__is_straight(command)) {
+        for (int32_t y = y0; y < y1; y++) {
+            kernels->blend(
+                blitter->pixels + y * blitter->width + x0,
+                pixels + (src->y + y - dst->y) * pitch + src->x + x0 - dst->x,
+                x1 - x0
+            );
+        }
+        return;
+    }
+
+    float radians = deg_to_rad(command->angle);
+    float c = fast_cos(radians), s = fast_sin(radians);
+    float sx = (float)src->w / dst->w, sy = (float)src->h / dst->h;
+    float cx = dst->x + 0.5f * dst->w, cy = dst->y + 0.5f * dst->h;
+
+    BlitSource source = {
+        pixels,
+        pitch,
+        (float)(src->x < 0 ? 0 : src->x),
+        (float)(src->y < 0 ? 0 : src->y),
+        (float)(src->x + src->w > image->w ? image->w : src->x + src->w),
+        (float)(src->y + src->h > image->h ? image->h : src->y + src->h)
+    };
+    int32_t origin = box->x < 0 ? 0 : box->x;
+    float uc = src->x + 0.5f * src->w, vc = src->y + 0.5f * src->h;
+    float du = c * sx, dv = -s * sy;
+    for (int32_t y = y0; y < y1; y++) {
+        float dx = origin + 0.5f - cx, dy = y + 0.5f - cy;
+        float u = uc + (dx * c + dy * s) * sx;
+        float v = vc + (dy * c - dx * s) * sy;
+        int32_t begin = x0 - origin, end = x1 - origin;
+        __narrow_span(u, du, source.left, source.right, &begin, &end);
+        __narrow_span(v, dv, source.top, source.bottom, &begin, &end);
+        if (begin < end) kernels->blend_mapped(blitter->pixels + y * blitter->width + origin, begin, end, &source, u, v, du, dv);
+    }
+}
+
+/**
+ * Solving lo <= p + i * dp < hi for i gives the span, widened by
+ * a pixel either way for rounding. Bounds are clamped to the row
+ * while still floats, where a small dp can put them far off.
+ */
+static void __narrow_span(float p, float dp, float lo, float hi, int32_t* begin, int32_t* end) {
+    if (dp == 0.0f) {
+        if (p < lo || p >= hi) *end = *begin;
+        return;
+    }
+    float a = (lo - p) / dp, b = (hi - p) / dp;
+    float first = (a < b ? a : b) - 1.0f, last = (a < b ? b : a) + 2.0f;
+    if (first > (float)*begin) *begin = first < (float)*end ? (int32_t)first : *end;
+    if (last < (float)*end) *end = last > (float)*begin ? (int32_t)last : *begin;
+}
+
+/**
+ * Red and blue are blended together in one word, green in another,
+ * with 255 * 255 + 128 fitting in each 16 bit field. Dividing by 255
+ * is (t + (t >> 8)) >> 8, which is exact for these t. The framebuffer
+ * is opaque, so fully transparent and fully opaque pixels give d
+ * and s as they are.
+ */
+static inline uint32_t __blend_pixel(uint32_t s, uint32_t d) {
+    uint32_t a = s >> 24;
+    if (a == 0) return d;
+    if (a == 255) return s;
+
+    uint32_t rb = (s & 0xFF00FFu) * a + (d & 0xFF00FFu) * (255 - a) + 0x800080u;
+    rb = ((rb + ((rb >> 8) & 0xFF00FFu)) >> 8) & 0xFF00FFu;
+    uint32_t g = (s & 0xFF00u) * a + (d & 0xFF00u) * (255 - a) + 0x8000u;
+    g = ((g + ((g >> 8) & 0xFF00u)) >> 8) & 0xFF00u;
+    return OPAQUE | rb | g;
+}
\ No newline at end of file
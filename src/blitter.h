@@ -0,0 +1,311 @@
+#ifndef Hv3sKp8ZwR_BLITTER_H
+#define Hv3sKp8ZwR_BLITTER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <SDL2/SDL.h>
+
+#include "gmath.h"
+#include "render.h"
+#include "jobs.h"
+
+// The width (and height) of the tiles each drawn by one thread
+#define BLIT_TILE_SIZE 128
+// The width (and height) of the cells redrawn when something moves over them
+#define BLIT_CELL_SIZE 32
+
+/**
+ * Struct:
+ *  BlitStats
+ *
+ * Purpose:
+ *  Counts how much of the framebuffer was redrawn and presented.
+ *
+ * Fields:
+ *  - pixels:
+ *      The number of pixels redrawn, and presented.
+ *  - rects:
+ *      The number of rectangles they were presented in.
+ */
+typedef struct {
+    uint64_t    pixels;
+    uint64_t    rects;
+} BlitStats;
+
+/**
+ * Struct:
+ *  Blitter
+ *
+ * Purpose:
+ *  Draws render commands into a framebuffer in memory instead of
+ *  through SDL, with SIMD alpha blending. Rotated and scaled sprites
+ *  are drawn by mapping each pixel of the window back onto the
+ *  texture. The framebuffer is split into tiles, each drawn by one
+ *  thread. The floor and walls are cached, and while they stay the
+ *  same only the cells the other sprites cover now or covered last
+ *  frame are redrawn and presented.
+ *
+ * Fields:
+ *  - window:
+ *      The window whose surface the changed cells are presented to,
+ *      NULL to upload them to target instead.
+ *  - target:
+ *      The streaming texture the framebuffer is uploaded to, NULL
+ *      when presenting to the window.
+ *  - pixels:
+ *      The framebuffer, ARGB8888, always opaque.
+ *  - width:
+ *      The framebuffer's width.
+ *  - height:
+ *      The framebuffer's height.
+ *  - textures:
+ *      The textures the blitter can draw.
+ *  - images:
+ *      Their pixels in ARGB8888, in the same order.
+ *  - image_count:
+ *      The number of textures.
+ *  - last_texture:
+ *      The texture looked up last.
+ *  - last_image:
+ *      Its pixels.
+ *  - tile_columns:
+ *      The number of tiles across.
+ *  - tile_rows:
+ *      The number of tiles down.
+ *  - tile_starts:
+ *      Where each tile's commands start in tile_commands, and where
+ *      the last tile's end.
+ *  - tile_cursors:
+ *      Where the next command of each tile goes while binning.
+ *  - tile_commands:
+ *      The indices of each tile's commands, tile after tile.
+ *  - tile_capacity:
+ *      The number of indices allocated.
+ *  - cell_columns:
+ *      The number of cells across.
+ *  - cell_rows:
+ *      The number of cells down.
+ *  - cell_states:
+ *      For each cell, whether sprites other than the background
+ *      cover it this frame (bit 0) and did last frame (bit 1).
+ *  - command_images:
+ *      The pixels of each command drawn, NULL for fills and for
+ *      textures never added.
+ *  - command_boxes:
+ *      The pixels each command drawn may cover.
+ *  - command_capacity:
+ *      The number of commands allocated.
+ *  - drawing:
+ *      The buffer being drawn.
+ *  - backend:
+ *      The backend it is drawn with.
+ *  - clear:
+ *      The pixel under everything drawn.
+ *  - track_dirty:
+ *      Redraw only what changed, true unless turned off.
+ *  - background:
+ *      The framebuffer as it was once the background was drawn.
+ *  - background_commands:
+ *      The background's commands, to tell when it changes.
+ *  - background_count:
+ *      The number of commands in the background.
+ *  - background_capacity:
+ *      The number of background commands allocated.
+ *  - background_valid:
+ *      Whether background holds the background of the commands kept.
+ *  - first_foreground:
+ *      The index of the first command drawn over the background.
+ *  - full:
+ *      Whether every tile is redrawn this frame.
+ *  - dirty_rects:
+ *      The rectangles redrawn this frame, runs of cells in a row
+ *      joined with the same runs in the rows below.
+ *  - dirty_count:
+ *      The number of rectangles.
+ *  - run_rects:
+ *      Where the last two rows' rectangles are noted while joining.
+ *  - frame:
+ *      The stats of the last frame.
+ *  - total:
+ *      The stats of every frame.
+ *  - frames:
+ *      The number of frames.
+ */
+typedef struct {
+    SDL_Window*     window;
+    SDL_Texture*    target;
+    uint32_t*       pixels;
+    int32_t         width;
+    int32_t         height;
+    SDL_Texture*    textures[RENDER_MAX_TEXTURES];
+    SDL_Surface*    images[RENDER_MAX_TEXTURES];
+    int32_t         image_count;
+    SDL_Texture*    last_texture;
+    SDL_Surface*    last_image;
+    int32_t         tile_columns;
+    int32_t         tile_rows;
+    int32_t*        tile_starts;
+    int32_t*        tile_cursors;
+    int32_t*        tile_commands;
+    int32_t         tile_capacity;
+    int32_t         cell_columns;
+    int32_t         cell_rows;
+    uint8_t*        cell_states;
+    SDL_Surface**   command_images;
+    SDL_Rect*       command_boxes;
+    int32_t         command_capacity;
+    RenderBuffer*   drawing;
+    MathBackend     backend;
+    uint32_t        clear;
+    bool            track_dirty;
+    uint32_t*       background;
+    RenderCommand*  background_commands;
+    int32_t         background_count;
+    int32_t         background_capacity;
+    bool            background_valid;
+    int32_t         first_foreground;
+    bool            full;
+    SDL_Rect*       dirty_rects;
+    int32_t         dirty_count;
+    int32_t*        run_rects;
+    BlitStats       frame;
+    BlitStats       total;
+    uint64_t        frames;
+} Blitter;
+
+/**
+ * Function:
+ *  init_blitter
+ *
+ * Purpose:
+ *  Create a Blitter and its framebuffer.
+ *
+ * Parameters:
+ *  - renderer:
+ *      A structure that contains a rendering state, unused when
+ *      presenting to a window.
+ *  - window:
+ *      The window to present to through its surface, NULL to upload
+ *      to a streaming texture copied to the renderer instead.
+ *  - width:
+ *      The framebuffer's width, the window's.
+ *  - height:
+ *      The framebuffer's height, the window's.
+ *
+ * Returns:
+ *  The Blitter object, NULL if the streaming texture could not be created.
+ */
+Blitter* init_blitter(SDL_Renderer* renderer, SDL_Window* window, int32_t width, int32_t height);
+
+/**
+ * Function:
+ *  add_blit_image
+ *
+ * Purpose:
+ *  Let the blitter draw a texture, from a copy of the surface it
+ *  was created from.
+ *
+ * Parameters:
+ *  - blitter:
+ *      The Blitter object.
+ *  - texture:
+ *      The texture, as render commands refer to it.
+ *  - surface:
+ *      Its pixels, in any format.
+ *
+ * Returns:
+ *  true if successful, false if the surface could not be converted
+ *  or RENDER_MAX_TEXTURES have been added.
+ */
+bool add_blit_image(Blitter* blitter, SDL_Texture* texture, SDL_Surface* surface);
+
+/**
+ * Function:
+ *  clear_blitter
+ *
+ * Purpose:
+ *  Set the color under everything drawn from the next frame on.
+ *  The framebuffer is cleared to it where it is redrawn.
+ *
+ * Parameters:
+ *  - blitter:
+ *      The Blitter object.
+ *  - color:
+ *      The color, its alpha ignored.
+ *
+ * Returns:
+ *  Nothing.
+ */
+void clear_blitter(Blitter* blitter, SDL_Color color);
+
+/**
+ * Function:
+ *  blit_render_buffer
+ *
+ * Purpose:
+ *  Sort the commands, draw them into the framebuffer, show the parts
+ *  redrawn, count what it took and empty the buffer. When presenting
+ *  to a window the window is updated, otherwise the texture is copied
+ *  to the renderer for the caller to present. Commands with textures
+ *  never added are skipped.
+ *
+ * Parameters:
+ *  - blitter:
+ *      The Blitter object.
+ *  - buffer:
+ *      The RenderBuffer object.
+ *  - renderer:
+ *      A structure that contains a rendering state.
+ *  - jobs:
+ *      The threads drawing the tiles, NULL to draw on the calling
+ *      thread only. No other run may be going on.
+ *
+ * Returns:
+ *  Nothing.
+ */
+void blit_render_buffer(Blitter* blitter, RenderBuffer* buffer, SDL_Renderer* renderer, JobSystem* jobs);
+
+/**
+ * Function:
+ *  draw_render_buffer
+ *
+ * Purpose:
+ *  Sort the commands and draw them into the framebuffer, leaving
+ *  them in the buffer, and find the rectangles redrawn. The pixels
+ *  are the same however they are drawn.
+ *
+ * Parameters:
+ *  - blitter:
+ *      The Blitter object.
+ *  - buffer:
+ *      The RenderBuffer object.
+ *  - jobs:
+ *      The threads drawing the tiles, NULL to draw on the calling
+ *      thread only, without tiles. No other run may be going on.
+ *
+ * Returns:
+ *  Nothing.
+ */
+void draw_render_buffer(Blitter* blitter, RenderBuffer* buffer, JobSystem* jobs);
+
+/**
+ * Function:
+ *  destroy_blitter
+ *
+ * Purpose:
+ *  Release the Blitter object.
+ *
+ * Parameters:
+ *  - blitter:
+ *      The Blitter object to destroy.
+ *
+ * Returns:
+ *  Nothing.
+ */
+void destroy_blitter(Blitter* blitter);
+
+#endif
\ No newline at end of file
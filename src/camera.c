@@ -0,0 +1,41 @@
+#include "camera.h"
+
+/**
+ * Allocate the camera and set its dimensions.
+ */
+Camera* init_camera(int32_t w, int32_t h, float world_w, float world_h) {
+    Camera* camera = (Camera*)malloc(sizeof(Camera));
+    camera->position = (Point2d){ 0.0f, 0.0f };
+    camera->width = w;
+    camera->height = h;
+    camera->world_width = world_w;
+    camera->world_height = world_h;
+    return camera;
+}
+
+/**
+ * The position is kept to whole pixels, so the floor tiles and
+ * sprites, which are drawn at integer positions, move together
+ * instead of drifting a pixel apart. A world smaller than the
+ * window is shown from its top left corner.
+ */
+void update_camera(Camera* camera, Point2d* focus) {
+    float x = focus->x - camera->width / 2.0f;
+    float y = focus->y - camera->height / 2.0f;
+    float max_x = camera->world_width - camera->width;
+    float max_y = camera->world_height - camera->height;
+
+    if (x > max_x) x = max_x;
+    if (y > max_y) y = max_y;
+    if (x < 0.0f) x = 0.0f;
+    if (y < 0.0f) y = 0.0f;
+
+    camera->position = (Point2d){ (float)(int32_t)x, (float)(int32_t)y };
+}
+
+/**
+ * Nothing but the camera itself to release.
+ */
+void destroy_camera(Camera* camera) {
+    free(camera);
+}
\ No newline at end of file
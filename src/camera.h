@@ -0,0 +1,96 @@
+#ifndef Zk4pWd9TfA_CAMERA_H
+#define Zk4pWd9TfA_CAMERA_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "gmath.h"
+
+/**
+ * Struct:
+ *  Camera
+ *
+ * Purpose:
+ *  The part of the world shown in the window. Everything lives in
+ *  world coordinates and is moved by the camera's position when drawn.
+ *
+ * Fields:
+ *  - position:
+ *      The world position of the window's top left corner.
+ *  - width:
+ *      The window's width.
+ *  - height:
+ *      The window's height.
+ *  - world_width:
+ *      The width of the world, starting at the origin.
+ *  - world_height:
+ *      The height of the world, starting at the origin.
+ */
+typedef struct {
+    Point2d     position;
+    int32_t     width;
+    int32_t     height;
+    float       world_width;
+    float       world_height;
+} Camera;
+
+/**
+ * Function:
+ *  init_camera
+ *
+ * Purpose:
+ *  Create a Camera object looking at the world's top left corner.
+ *
+ * Parameters:
+ *  - w:
+ *      The window's width.
+ *  - h:
+ *      The window's height.
+ *  - world_w:
+ *      The width of the world.
+ *  - world_h:
+ *      The height of the world.
+ *
+ * Returns:
+ *  The Camera object.
+ */
+Camera* init_camera(int32_t w, int32_t h, float world_w, float world_h);
+
+/**
+ * Function:
+ *  update_camera
+ *
+ * Purpose:
+ *  Center the camera on a position, without showing
+ *  anything beyond the world's edges.
+ *
+ * Parameters:
+ *  - camera:
+ *      The Camera object.
+ *  - focus:
+ *      The world position to center on.
+ *
+ * Returns:
+ *  Nothing.
+ */
+void update_camera(Camera* camera, Point2d* focus);
+
+/**
+ * Function:
+ *  destroy_camera
+ *
+ * Purpose:
+ *  Release the Camera object.
+ *
+ * Parameters:
+ *  - camera:
+ *      The Camera object to destroy.
+ *
+ * Returns:
+ *  Nothing.
+ */
+void destroy_camera(Camera* camera);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,435 @@
+#include "capture.h"
+
+// Error message when the thread saving frames can't be started
+static const char CREATE_THREAD_LOG[] = "Could not start frame capture thread: %s";
+// Error message when the lock or condition can't be created
+static const char CREATE_LOCK_LOG[] = "Could not create frame capture lock: %s";
+// Error message when a frame can't be read back
+static const char READ_PIXELS_LOG[] = "Capture: could not read back frame %llu: %s";
+// Error message when a frame or diff can't be written
+static const char SAVE_LOG[] = "Capture: could not save %s: %s";
+// Error message when a frame has no golden image to compare to
+static const char NO_GOLDEN_LOG[] = "Capture: frame %llu has no golden image %s: %s";
+// Error message when a frame and its golden image differ in size
+static const char SIZE_LOG[] = "Capture: frame %llu is %dx%d but %s is %dx%d";
+// Log message when a frame matches its golden image
+static const char MATCH_LOG[] = "Capture: frame %llu matches %s";
+// Error message when a frame differs from its golden image
+static const char DIFF_LOG[] = "Capture: frame %llu differs from %s in %d pixels, by up to %d, diff in %s";
+// Error message when there are no frames to capture
+static const char NO_FRAMES_LOG[] = "Capture: no frames to capture, give them with --capture-frames or the last with -n";
+// Error message when a frame listed was never reached
+static const char MISSED_LOG[] = "Capture: frame %llu was never reached";
+// Log message with how many frames matched
+static const char SUMMARY_LOG[] = "Capture: %d of %d frames match their golden images";
+// The name of the thread saving frames
+static const char THREAD_NAME[] = "capture";
+// The name of a captured frame, a golden image or a diff is given by its number
+static const char FRAME_NAME[] = "%s/frame_%06llu%s.png";
+// Where diffs go when frames are not saved
+static const char DEFAULT_DIRECTORY[] = ".";
+// The color of the pixels that differ in a diff image
+static const uint32_t DIFF_COLOR = 0xFFFF0000u;
+
+/**
+ * Function:
+ *  __parse_frames
+ *
+ * Purpose:
+ *  Read the frames to capture, sorted and without repeats.
+ *
+ * Parameters:
+ *  - capture:
+ *      The FrameCapture object.
+ *  - frames:
+ *      The frames, numbers separated by commas, NULL for only the last one.
+ *  - last:
+ *      The number of the last frame, 0 if there is none.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __parse_frames(FrameCapture* capture, const char* frames, uint64_t last);
+
+/**
+ * Function:
+ *  __compare_frames
+ *
+ * Purpose:
+ *  Order frame numbers ascending for qsort.
+ *
+ * Parameters:
+ *  - a:
+ *      A pointer to the first frame number.
+ *  - b:
+ *      A pointer to the second frame number.
+ *
+ * Returns:
+ *  Negative if a < b, positive if a > b and 0 otherwise.
+ */
+static int __compare_frames(const void* a, const void* b);
+
+/**
+ * Function:
+ *  __capture_main
+ *
+ * Purpose:
+ *  Save and compare the frames as they are queued, until the
+ *  capture stops and every frame queued is done.
+ *
+ * Parameters:
+ *  - data:
+ *      The FrameCapture object.
+ *
+ * Returns:
+ *  0.
+ */
+static int __capture_main(void* data);
+
+/**
+ * Function:
+ *  __process_frame
+ *
+ * Purpose:
+ *  Save a frame and compare it to its golden image.
+ *
+ * Parameters:
+ *  - capture:
+ *      The FrameCapture object.
+ *  - frame:
+ *      The frame read back.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __process_frame(FrameCapture* capture, CapturedFrame* frame);
+
+/**
+ * Function:
+ *  __compare_golden
+ *
+ * Purpose:
+ *  Compare a frame to its golden image and write a diff image if
+ *  they differ by more than the tolerance.
+ *
+ * Parameters:
+ *  - capture:
+ *      The FrameCapture object.
+ *  - frame:
+ *      The frame read back.
+ *
+ * Returns:
+ *  true if they match, false otherwise.
+ */
+static bool __compare_golden(FrameCapture* capture, CapturedFrame* frame);
+
+/**
+ * Function:
+ *  __channel_distance
+ *
+ * Purpose:
+ *  The largest difference between the red, green or blue channels
+ *  of two pixels.
+ *
+ * Parameters:
+ *  - a:
+ *      A pixel, ARGB8888.
+ *  - b:
+ *      Another pixel, ARGB8888.
+ *
+ * Returns:
+ *  The difference, 0 to 255.
+ */
+static int32_t __channel_distance(uint32_t a, uint32_t b);
+
+/**
+ * Function:
+ *  __save_pixels
+ *
+ * Purpose:
+ *  Write pixels to a PNG file.
+ *
+ * Parameters:
+ *  - path:
+ *      The file written.
+ *  - pixels:
+ *      The pixels, ARGB8888.
+ *  - width:
+ *      Their width.
+ *  - height:
+ *      Their height.
+ *
+ * Returns:
+ *  true if successful, false otherwise.
+ */
+static bool __save_pixels(const char* path, uint32_t* pixels, int32_t width, int32_t height);
+
+/**
+ * The frames are known up front, so there is a slot for each and
+ * the queue never wraps. Returns NULL if there are no frames, since
+ * a run would then pass without comparing anything, or if the
+ * thread can't be started.
+ */
+FrameCapture* init_frame_capture(const char* frames, uint64_t last, const char* directory, const char* golden, int32_t tolerance) {
+    FrameCapture* capture = (FrameCapture*)malloc(sizeof(FrameCapture));
+    capture->directory = directory;
+    capture->golden = golden;
+    capture->tolerance = tolerance;
+    capture->next = 0;
+    capture->queued = 0;
+    capture->done = 0;
+    capture->failures = 0;
+    capture->stopping = false;
+    capture->lock = NULL;
+    capture->ready = NULL;
+    capture->thread = NULL;
+    __parse_frames(capture, frames, last);
+    if (capture->frame_count == 0) {
+        SDL_Log(NO_FRAMES_LOG);
+        destroy_frame_capture(capture);
+        return NULL;
+    }
+
+    capture->lock = SDL_CreateMutex();
+    capture->ready = SDL_CreateCond();
+    if (capture->lock == NULL || capture->ready == NULL) {
+        SDL_Log(CREATE_LOCK_LOG, SDL_GetError());
+        destroy_frame_capture(capture);
+        return NULL;
+    }
+
+    capture->thread = SDL_CreateThread(__capture_main, THREAD_NAME, capture);
+    if (capture->thread == NULL) {
+        SDL_Log(CREATE_THREAD_LOG, SDL_GetError());
+        destroy_frame_capture(capture);
+        return NULL;
+    }
+
+    return capture;
+}
+
+/**
+ * Only the copy out of the renderer happens here, SDL's renderer
+ * may not be used from other threads. The frame's slot is filled
+ * before it is counted as queued, under the lock, so the thread
+ * never sees it half written. A frame that can't be read back is
+ * queued without pixels, and fails.
+ */
+void capture_frame(FrameCapture* capture, SDL_Renderer* renderer, uint64_t frame) {
+    if (capture->next == capture->frame_count || capture->frames[capture->next] != frame) return;
+    capture->next++;
+
+    int32_t width, height;
+    uint32_t* pixels = NULL;
+    if (SDL_GetRendererOutputSize(renderer, &width, &height) == 0) {
+        pixels = (uint32_t*)malloc(sizeof(uint32_t) * width * height);
+        if (SDL_RenderReadPixels(renderer, NULL, SDL_PIXELFORMAT_ARGB8888, pixels, width * (int32_t)sizeof(uint32_t)) < 0) {
+            free(pixels);
+            pixels = NULL;
+        }
+    }
+    if (pixels == NULL) SDL_Log(READ_PIXELS_LOG, (unsigned long long)frame, SDL_GetError());
+
+    capture->queue[capture->queued] = (CapturedFrame){ frame, width, height, pixels };
+    SDL_LockMutex(capture->lock);
+    capture->queued++;
+    SDL_CondSignal(capture->ready);
+    SDL_UnlockMutex(capture->lock);
+}
+
+/**
+ * Once the thread is joined, what it counted can be read. Frames
+ * listed but never reached, the run ended or was quit before them,
+ * fail, so a check can't pass without comparing them.
+ */
+int32_t finish_frame_capture(FrameCapture* capture) {
+    if (capture->thread == NULL) return capture->failures;
+
+    SDL_LockMutex(capture->lock);
+    capture->stopping = true;
+    SDL_CondSignal(capture->ready);
+    SDL_UnlockMutex(capture->lock);
+    SDL_WaitThread(capture->thread, NULL);
+    capture->thread = NULL;
+
+    for (int32_t i = capture->next; i < capture->frame_count; i++) {
+        SDL_Log(MISSED_LOG, (unsigned long long)capture->frames[i]);
+    }
+    capture->failures += capture->frame_count - capture->next;
+    capture->next = capture->frame_count;
+
+    if (capture->golden) SDL_Log(SUMMARY_LOG, capture->frame_count - capture->failures, capture->frame_count);
+    return capture->failures;
+}
+
+/**
+ * The thread finishes what is queued first, which is at most the
+ * few frames asked for.
+ */
+void destroy_frame_capture(FrameCapture* capture) {
+    if (capture->thread) finish_frame_capture(capture);
+    if (capture->ready) SDL_DestroyCond(capture->ready);
+    if (capture->lock) SDL_DestroyMutex(capture->lock);
+    free(capture);
+}
+
+/**
+ * Anything that is not a positive number is skipped, and frames past
+ * the most allowed are dropped.
+ */
+static void __parse_frames(FrameCapture* capture, const char* frames, uint64_t last) {
+    capture->frame_count = 0;
+    if (frames == NULL) {
+        if (last > 0) capture->frames[capture->frame_count++] = last;
+        return;
+    }
+
+    const char* p = frames;
+    while (*p && capture->frame_count < MAX_CAPTURE_FRAMES) {
+        char* end;
+        unsigned long long frame = strtoull(p, &end, 10);
+        if (end != p && frame > 0) capture->frames[capture->frame_count++] = frame;
+        p = *end ? end + 1 : end;
+    }
+
+    qsort(capture->frames, capture->frame_count, sizeof(uint64_t), __compare_frames);
+    int32_t count = 0;
+    for (int32_t i = 0; i < capture->frame_count; i++) {
+        if (count == 0 || capture->frames[count - 1] != capture->frames[i]) capture->frames[count++] = capture->frames[i];
+    }
+    capture->frame_count = count;
+}
+
+/**
+ * Can't subtract since the difference may not fit an int.
+ */
+static int __compare_frames(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * The lock is only held to wait for the next frame, saving and
+ * comparing it runs while the game goes on.
+ */
+static int __capture_main(void* data) {
+    FrameCapture* capture = (FrameCapture*)data;
+    for (;;) {
+        SDL_LockMutex(capture->lock);
+        while (capture->done == capture->queued && !capture->stopping) SDL_CondWait(capture->ready, capture->lock);
+        bool more = capture->done < capture->queued;
+        SDL_UnlockMutex(capture->lock);
+        if (!more) return 0;
+
+        CapturedFrame* frame = &capture->queue[capture->done];
+        __process_frame(capture, frame);
+        free(frame->pixels);
+        frame->pixels = NULL;
+        capture->done++;
+    }
+}
+
+/**
+ * Renderers may leave alpha undefined, so every pixel is made opaque
+ * before anything is written or compared.
+ */
+static void __process_frame(FrameCapture* capture, CapturedFrame* frame) {
+    if (frame->pixels == NULL) {
+        capture->failures++;
+        return;
+    }
+
+    int32_t pixels = frame->width * frame->height;
+    for (int32_t i = 0; i < pixels; i++) frame->pixels[i] |= 0xFF000000u;
+
+    if (capture->directory) {
+        char path[1024];
+        snprintf(path, sizeof(path), FRAME_NAME, capture->directory, (unsigned long long)frame->frame, "");
+        __save_pixels(path, frame->pixels, frame->width, frame->height);
+    }
+
+    if (capture->golden && !__compare_golden(capture, frame)) capture->failures++;
+}
+
+/**
+ * The golden image may be in any format, so it is converted first.
+ * The diff is the frame at a quarter of its brightness with every
+ * pixel that differs by more than the tolerance in red.
+ */
+static bool __compare_golden(FrameCapture* capture, CapturedFrame* frame) {
+    unsigned long long number = (unsigned long long)frame->frame;
+    char path[1024];
+    snprintf(path, sizeof(path), FRAME_NAME, capture->golden, number, "");
+
+    SDL_Surface* loaded = IMG_Load(path);
+    SDL_Surface* golden = loaded ? SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_ARGB8888, 0) : NULL;
+    if (loaded) SDL_FreeSurface(loaded);
+    if (golden == NULL) {
+        SDL_Log(NO_GOLDEN_LOG, number, path, SDL_GetError());
+        return false;
+    }
+    if (golden->w != frame->width || golden->h != frame->height) {
+        SDL_Log(SIZE_LOG, number, frame->width, frame->height, path, golden->w, golden->h);
+        SDL_FreeSurface(golden);
+        return false;
+    }
+
+    int32_t pixels = frame->width * frame->height;
+    uint32_t* diff = (uint32_t*)malloc(sizeof(uint32_t) * pixels);
+    int32_t differing = 0, largest = 0;
+    for (int32_t y = 0; y < frame->height; y++) {
+        uint32_t* expected = (uint32_t*)((uint8_t*)golden->pixels + y * golden->pitch);
+        for (int32_t x = 0; x < frame->width; x++) {
+            int32_t i = y * frame->width + x;
+            int32_t distance = __channel_distance(frame->pixels[i], expected[x]);
+            if (distance > largest) largest = distance;
+            if (distance > capture->tolerance) {
+                differing++;
+                diff[i] = DIFF_COLOR;
+            } else {
+                diff[i] = 0xFF000000u | (frame->pixels[i] >> 2 & 0x3F3F3F);
+            }
+        }
+    }
+    SDL_FreeSurface(golden);
+
+    if (differing == 0) {
+        SDL_Log(MATCH_LOG, number, path);
+        free(diff);
+        return true;
+    }
+
+    char diff_path[1024];
+    const char* directory = capture->directory ? capture->directory : DEFAULT_DIRECTORY;
+    snprintf(diff_path, sizeof(diff_path), FRAME_NAME, directory, number, "_diff");
+    __save_pixels(diff_path, diff, frame->width, frame->height);
+    SDL_Log(DIFF_LOG, number, path, differing, largest, diff_path);
+    free(diff);
+    return false;
+}
+
+/**
+ * Alpha is left out, every frame is opaque.
+ */
+static int32_t __channel_distance(uint32_t a, uint32_t b) {
+    int32_t largest = 0;
+    for (int32_t shift = 0; shift < 24; shift += 8) {
+        int32_t d = (int32_t)(a >> shift & 0xFF) - (int32_t)(b >> shift & 0xFF);
+        if (d < 0) d = -d;
+        if (d > largest) largest = d;
+    }
+    return largest;
+}
+
+/**
+ * The surface only borrows the pixels.
+ */
+static bool __save_pixels(const char* path, uint32_t* pixels, int32_t width, int32_t height) {
+    SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormatFrom(
+        pixels, width, height, 32, width * (int32_t)sizeof(uint32_t), SDL_PIXELFORMAT_ARGB8888
+    );
+    bool saved = surface && IMG_SavePNG(surface, path) == 0;
+    if (!saved) SDL_Log(SAVE_LOG, path, SDL_GetError());
+    if (surface) SDL_FreeSurface(surface);
+    return saved;
+}
\ No newline at end of file
@@ -0,0 +1,181 @@
+#ifndef Tn5Wq8RcYd_CAPTURE_H
+#define Tn5Wq8RcYd_CAPTURE_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+
+// The most frames a capture reads back
+#define MAX_CAPTURE_FRAMES 256
+
+/**
+ * Struct:
+ *  CapturedFrame
+ *
+ * Purpose:
+ *  The pixels of one frame read back, waiting to be saved or compared.
+ *
+ * Fields:
+ *  - frame:
+ *      The frame's number, the first presented being 1.
+ *  - width:
+ *      The frame's width.
+ *  - height:
+ *      The frame's height.
+ *  - pixels:
+ *      Its pixels, ARGB8888.
+ */
+typedef struct {
+    uint64_t    frame;
+    int32_t     width;
+    int32_t     height;
+    uint32_t*   pixels;
+} CapturedFrame;
+
+/**
+ * Struct:
+ *  FrameCapture
+ *
+ * Purpose:
+ *  Reads back chosen frames from the renderer and hands them to a
+ *  thread of its own, which saves them as PNG and compares them to
+ *  golden images, so the frames being timed only pay for the copy.
+ *
+ * Fields:
+ *  - directory:
+ *      Where frames and diff images are written, NULL to only
+ *      compare, in which case diffs go to the working directory.
+ *  - golden:
+ *      Where the golden images are read from, NULL to only save.
+ *  - tolerance:
+ *      How far apart a channel of a pixel may be from the golden one.
+ *  - frames:
+ *      The numbers of the frames captured, ascending.
+ *  - frame_count:
+ *      The number of frames captured.
+ *  - next:
+ *      The index of the next frame to capture.
+ *  - queue:
+ *      The frames read back, in the order of frames.
+ *  - queued:
+ *      The number of frames read back.
+ *  - done:
+ *      The number of frames saved and compared.
+ *  - failures:
+ *      The number of frames that differed from their golden image,
+ *      or were never reached once the capture is finished.
+ *  - stopping:
+ *      Whether no more frames will be queued.
+ *  - lock:
+ *      Guards queued and stopping.
+ *  - ready:
+ *      Signaled when a frame is queued or the capture stops.
+ *  - thread:
+ *      The thread saving and comparing.
+ */
+typedef struct {
+    const char*     directory;
+    const char*     golden;
+    int32_t         tolerance;
+    uint64_t        frames[MAX_CAPTURE_FRAMES];
+    int32_t         frame_count;
+    int32_t         next;
+    CapturedFrame   queue[MAX_CAPTURE_FRAMES];
+    int32_t         queued;
+    int32_t         done;
+    int32_t         failures;
+    bool            stopping;
+    SDL_mutex*      lock;
+    SDL_cond*       ready;
+    SDL_Thread*     thread;
+} FrameCapture;
+
+/**
+ * Function:
+ *  init_frame_capture
+ *
+ * Purpose:
+ *  Create a FrameCapture and start its thread.
+ *
+ * Parameters:
+ *  - frames:
+ *      The frames to capture, numbers separated by commas, NULL for
+ *      only the last one.
+ *  - last:
+ *      The number of the last frame, 0 if the game runs until quit.
+ *  - directory:
+ *      Where frames and diff images are written, NULL to not save
+ *      the frames.
+ *  - golden:
+ *      Where the golden images are read from, NULL to not compare.
+ *  - tolerance:
+ *      How far apart a channel of a pixel may be from the golden one.
+ *
+ * Returns:
+ *  A FrameCapture object if successful, NULL if there are no frames
+ *  to capture or the thread can't be started.
+ */
+FrameCapture* init_frame_capture(const char* frames, uint64_t last, const char* directory, const char* golden, int32_t tolerance);
+
+/**
+ * Function:
+ *  capture_frame
+ *
+ * Purpose:
+ *  Read back what the renderer drew, if the frame is one captured,
+ *  before it is presented.
+ *
+ * Parameters:
+ *  - capture:
+ *      The FrameCapture object.
+ *  - renderer:
+ *      A structure that contains a rendering state.
+ *  - frame:
+ *      The frame's number, the first presented being 1.
+ *
+ * Returns:
+ *  Nothing.
+ */
+void capture_frame(FrameCapture* capture, SDL_Renderer* renderer, uint64_t frame);
+
+/**
+ * Function:
+ *  finish_frame_capture
+ *
+ * Purpose:
+ *  Wait until every frame read back is saved and compared, and log
+ *  how many matched their golden images.
+ *
+ * Parameters:
+ *  - capture:
+ *      The FrameCapture object.
+ *
+ * Returns:
+ *  The number of frames that did not match, had no golden image or
+ *  were never reached.
+ */
+int32_t finish_frame_capture(FrameCapture* capture);
+
+/**
+ * Function:
+ *  destroy_frame_capture
+ *
+ * Purpose:
+ *  Finish the capture if it was not, and release the FrameCapture
+ *  object.
+ *
+ * Parameters:
+ *  - capture:
+ *      The FrameCapture object to destroy.
+ *
+ * Returns:
+ *  Nothing.
+ */
+void destroy_frame_capture(FrameCapture* capture);
+
+#endif
\ No newline at end of file
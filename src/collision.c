@@ -1,5 +1,101 @@
 #include "collision.h"
 
+#if defined(__x86_64__) || defined(__i386__)
+#define COLLISION_X86
+#include <immintrin.h>
+#endif
+
+/**
+ * Function:
+ *  __add_contacts
+ *
+ * Purpose:
+ *  Test a few enemies of one 64 row block against a collider
+ *  and append those overlapping it.
+ *
+ * Parameters:
+ *  - p_collider:
+ *      The collider.
+ *  - radius:
+ *      The enemies' collision radius.
+ *  - archetype:
+ *      An archetype of enemies.
+ *  - base:
+ *      The block's first row.
+ *  - bits:
+ *      One bit for each row of the block to test.
+ *  - contacts:
+ *      The contacts so far.
+ *  - count:
+ *      The number of contacts so far.
+ *  - capacity:
+ *      The most contacts written.
+ *
+ * Returns:
+ *  The number of contacts after appending.
+ */
+static int32_t __add_contacts(Collider* p_collider, float radius, Archetype* archetype, int32_t base, uint64_t bits,
+    Contact* contacts, int32_t count, int32_t capacity);
+
+/**
+ * Function:
+ *  __contacts_scalar
+ *
+ * Purpose:
+ *  Append the contacts within one archetype, one enemy at a time.
+ *
+ * Parameters:
+ *  Those of __add_contacts, but base and bits.
+ *
+ * Returns:
+ *  The number of contacts after appending.
+ */
+static int32_t __contacts_scalar(Collider* p_collider, float radius, Archetype* archetype,
+    Contact* contacts, int32_t count, int32_t capacity);
+
+#ifdef COLLISION_X86
+/**
+ * Function:
+ *  __contacts_sse
+ *
+ * Purpose:
+ *  Append the contacts within one archetype, four enemies at a time.
+ *
+ * Parameters:
+ *  Those of __add_contacts, but base and bits.
+ *
+ * Returns:
+ *  The number of contacts after appending.
+ */
+static int32_t __contacts_sse(Collider* p_collider, float radius, Archetype* archetype,
+    Contact* contacts, int32_t count, int32_t capacity);
+
+/**
+ * Function:
+ *  __contacts_avx2
+ *
+ * Purpose:
+ *  Append the contacts within one archetype, eight enemies at a time.
+ *
+ * Parameters:
+ *  Those of __add_contacts, but base and bits.
+ *
+ * Returns:
+ *  The number of contacts after appending.
+ */
+static int32_t __contacts_avx2(Collider* p_collider, float radius, Archetype* archetype,
+    Contact* contacts, int32_t count, int32_t capacity);
+#endif
+
+// Implementations of the contact test, indexed by MathBackend
+static int32_t (*const CONTACT_KERNELS[])(Collider*, float, Archetype*, Contact*, int32_t, int32_t) = {
+    __contacts_scalar,
+#ifdef COLLISION_X86
+    __contacts_sse,
+    __contacts_avx2
+#endif
+};
+
 static bool __collide(Collider* c1, Collider* c2);
 static bool __collide(Collider* c1, Collider* c2) {
     Vector2d c1c2 = {c2->center.x - c1->center.x, c2->center.y - c1->center.y };
@@ -15,10 +111,151 @@ static bool __collide(Collider* c1, Collider* c2) {
 bool player_enemy_collision(Collider* p_collider, Enemies* enemies) {
     Collider e_collider;
     e_collider.radius = enemies->collision_radius;
-    for (int32_t i = 0; i < enemies->max_enemies; i++) {
-        e_collider.center.x = enemies->enemies[i].position.x + e_collider.radius;
-        e_collider.center.y = enemies->enemies[i].position.y + e_collider.radius;
-        if (__collide(p_collider, &e_collider)) return true;
+    Query query = query_world(enemies->world, enemies->components);
+    for (Archetype* a = next_archetype(&query); a != NULL; a = next_archetype(&query)) {
+        for (int32_t row = 0; row < a->count; row++) {
+            Point2d position = enemy_position(a, row);
+            e_collider.center.x = position.x + e_collider.radius;
+            e_collider.center.y = position.y + e_collider.radius;
+            if (__collide(p_collider, &e_collider)) return true;
+        }
     }
     return false;
-}
\ No newline at end of file
+}
+
+/**
+ * The backends share the math backend's choice, so the
+ * bench and any caller pick both with set_math_backend.
+ * Each archetype of enemies is tested in turn. The SIMD
+ * backends load floats, so packed enemies are always tested
+ * by the scalar one.
+ */
+int32_t player_enemy_contacts(Collider* p_collider, Enemies* enemies, Contact* contacts, int32_t capacity) {
+    int32_t count = 0;
+    Query query = query_world(enemies->world, enemies->components);
+    for (Archetype* a = next_archetype(&query); a != NULL && count < capacity; a = next_archetype(&query)) {
+        MathBackend backend = a->columns[COMPONENT_PACKED] ? MATH_SCALAR : get_math_backend();
+        count = CONTACT_KERNELS[backend](p_collider, enemies->collision_radius, a, contacts, count, capacity);
+    }
+    return count;
+}
+
+/**
+ * Every backend ends up here with the candidates, so they all
+ * agree on what overlaps down to the last bit. The depth and
+ * normal need the distance, which only the few hits pay for.
+ */
+static int32_t __add_contacts(Collider* p_collider, float radius, Archetype* archetype, int32_t base, uint64_t bits,
+    Contact* contacts, int32_t count, int32_t capacity) {
+    float reach = p_collider->radius + radius;
+    while (bits && count < capacity) {
+        int32_t row = base + __builtin_ctzll(bits);
+        bits &= bits - 1;
+
+        Point2d position = enemy_position(archetype, row);
+        Vector2d d = {
+            position.x + radius - p_collider->center.x,
+            position.y + radius - p_collider->center.y
+        };
+        float len_sq = length_squared(&d);
+        if (len_sq >= reach * reach) continue;
+
+        Contact* c = &contacts[count++];
+        c->entity = archetype->entities[row];
+        if (len_sq > 0.0f) {
+            float inv = carmack_inverse_sqrt(len_sq);
+            c->depth = reach - len_sq * inv;
+            c->normal = (Vector2d){ d.x * inv, d.y * inv };
+        } else {
+            c->depth = reach;
+            c->normal = (Vector2d){ 1.0f, 0.0f };
+        }
+    }
+    return count;
+}
+
+/**
+ * Rows are tested 64 at a time, like the SIMD backends, so
+ * they all find the contacts in the same order.
+ */
+static int32_t __contacts_scalar(Collider* p_collider, float radius, Archetype* archetype,
+    Contact* contacts, int32_t count, int32_t capacity) {
+    for (int32_t base = 0; base < archetype->count && count < capacity; base += 64) {
+        int32_t n = archetype->count - base < 64 ? archetype->count - base : 64;
+        uint64_t bits = n == 64 ? ~0ull : (1ull << n) - 1;
+        count = __add_contacts(p_collider, radius, archetype, base, bits, contacts, count, capacity);
+    }
+    return count;
+}
+
+#ifdef COLLISION_X86
+
+/**
+ * The positions are pairs of x and y, so two loads hold four
+ * enemies and a shuffle splits them into x's and y's. The lanes
+ * do the same arithmetic as __add_contacts, without fused
+ * multiply-adds, so the candidates are exactly its hits. Rows
+ * past the last group of four are left to __add_contacts.
+ */
+static int32_t __contacts_sse(Collider* p_collider, float radius, Archetype* archetype,
+    Contact* contacts, int32_t count, int32_t capacity) {
+    const float* positions = (const float*)archetype->columns[COMPONENT_POSITION];
+    float reach = p_collider->radius + radius;
+    __m128 vr = _mm_set1_ps(radius);
+    __m128 cx = _mm_set1_ps(p_collider->center.x);
+    __m128 cy = _mm_set1_ps(p_collider->center.y);
+    __m128 reach_sq = _mm_set1_ps(reach * reach);
+
+    for (int32_t base = 0; base < archetype->count && count < capacity; base += 64) {
+        int32_t n = archetype->count - base < 64 ? archetype->count - base : 64;
+        uint64_t hits = 0;
+        int32_t lane = 0;
+        for (; lane + 4 <= n; lane += 4) {
+            const float* p = positions + 2 * (base + lane);
+            __m128 lo = _mm_loadu_ps(p), hi = _mm_loadu_ps(p + 4);
+            __m128 dx = _mm_sub_ps(_mm_add_ps(_mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0)), vr), cx);
+            __m128 dy = _mm_sub_ps(_mm_add_ps(_mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1)), vr), cy);
+            __m128 len_sq = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+            hits |= (uint64_t)_mm_movemask_ps(_mm_cmplt_ps(len_sq, reach_sq)) << lane;
+        }
+        if (lane < n) hits |= ((n == 64 ? ~0ull : (1ull << n) - 1) >> lane) << lane;
+        if (hits) count = __add_contacts(p_collider, radius, archetype, base, hits, contacts, count, capacity);
+    }
+    return count;
+}
+
+/**
+ * Same as the SSE version, eight enemies at a time. The shuffle
+ * works within each half of the registers, which leaves the pairs
+ * of enemies out of order until they are permuted back.
+ */
+__attribute__((target("avx2,fma")))
+static int32_t __contacts_avx2(Collider* p_collider, float radius, Archetype* archetype,
+    Contact* contacts, int32_t count, int32_t capacity) {
+    const float* positions = (const float*)archetype->columns[COMPONENT_POSITION];
+    float reach = p_collider->radius + radius;
+    __m256 vr = _mm256_set1_ps(radius);
+    __m256 cx = _mm256_set1_ps(p_collider->center.x);
+    __m256 cy = _mm256_set1_ps(p_collider->center.y);
+    __m256 reach_sq = _mm256_set1_ps(reach * reach);
+
+    for (int32_t base = 0; base < archetype->count && count < capacity; base += 64) {
+        int32_t n = archetype->count - base < 64 ? archetype->count - base : 64;
+        uint64_t hits = 0;
+        int32_t lane = 0;
+        for (; lane + 8 <= n; lane += 8) {
+            const float* p = positions + 2 * (base + lane);
+            __m256 lo = _mm256_loadu_ps(p), hi = _mm256_loadu_ps(p + 8);
+            __m256 dx = _mm256_sub_ps(_mm256_add_ps(_mm256_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0)), vr), cx);
+            __m256 dy = _mm256_sub_ps(_mm256_add_ps(_mm256_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1)), vr), cy);
+            __m256 len_sq = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+            len_sq = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(len_sq), _MM_SHUFFLE(3, 1, 2, 0)));
+            hits |= (uint64_t)_mm256_movemask_ps(_mm256_cmp_ps(len_sq, reach_sq, _CMP_LT_OQ)) << lane;
+        }
+        if (lane < n) hits |= ((n == 64 ? ~0ull : (1ull << n) - 1) >> lane) << lane;
+        if (hits) count = __add_contacts(p_collider, radius, archetype, base, hits, contacts, count, capacity);
+    }
+    return count;
+}
+
+#endif
\ No newline at end of file
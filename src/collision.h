@@ -2,6 +2,8 @@
 #define a3Km81rPm0_COLLISION_H
 
 #include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
 
 #include "gmath.h"
 #include "enemies.h"
@@ -11,7 +13,53 @@ typedef struct {
     float   radius;
 } Collider;
 
+/**
+ * Struct:
+ *  Contact
+ *
+ * Purpose:
+ *  An enemy overlapping a collider.
+ *
+ * Fields:
+ *  - entity:
+ *      The enemy.
+ *  - depth:
+ *      How far the circles overlap, the distance the enemy must
+ *      move along the normal to only touch the collider.
+ *  - normal:
+ *      A unit vector pointing from the collider's center to the
+ *      enemy's, (1, 0) if they are at the same point.
+ */
+typedef struct {
+    Entity      entity;
+    float       depth;
+    Vector2d    normal;
+} Contact;
+
 bool player_enemy_collision(Collider* p_collider, Enemies* enemies);
 
+/**
+ * Function:
+ *  player_enemy_contacts
+ *
+ * Purpose:
+ *  Find every living enemy overlapping a collider. The circles are
+ *  tested with the math backend in use, eight at a time with AVX2.
+ *
+ * Parameters:
+ *  - p_collider:
+ *      The collider, usually the player's.
+ *  - enemies:
+ *      The Enemies object.
+ *  - contacts:
+ *      Where the contacts are written.
+ *  - capacity:
+ *      The most contacts written, the rest are not looked for.
+ *
+ * Returns:
+ *  The number of contacts written, capacity if there may be more.
+ */
+int32_t player_enemy_contacts(Collider* p_collider, Enemies* enemies, Contact* contacts, int32_t capacity);
+
 
 #endif
\ No newline at end of file
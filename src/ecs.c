@@ -0,0 +1,202 @@
+#include "ecs.h"
+#include "gmath.h"
+
+/**
+ * Function:
+ *  __grow
+ *
+ * Purpose:
+ *  Make room for more rows in an archetype.
+ *
+ * Parameters:
+ *  - world:
+ *      The World object.
+ *  - archetype:
+ *      The archetype.
+ *  - capacity:
+ *      The number of rows, at least the current capacity.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __grow(World* world, Archetype* archetype, int32_t capacity);
+
+/**
+ * Every index is free, stacked so the lowest is used first. Only
+ * the plain types' sizes are known here, so the world does not
+ * depend on the modules defining the others.
+ */
+World* init_world(int32_t max_entities) {
+    World* world = (World*)malloc(sizeof(World));
+    world->archetype_count = 0;
+    world->max_entities = max_entities;
+    world->generations = (uint8_t*)calloc(max_entities, sizeof(uint8_t));
+    world->archetype_of = (int8_t*)malloc(sizeof(int8_t) * max_entities);
+    world->rows = (int32_t*)malloc(sizeof(int32_t) * max_entities);
+    world->free_indices = (uint32_t*)malloc(sizeof(uint32_t) * max_entities);
+    for (int32_t i = 0; i < max_entities; i++) {
+        world->archetype_of[i] = -1;
+        world->free_indices[i] = (uint32_t)(max_entities - 1 - i);
+    }
+    world->free_count = max_entities;
+    memset(world->component_sizes, 0, sizeof(world->component_sizes));
+    world->component_sizes[COMPONENT_POSITION] = sizeof(Point2d);
+    world->component_sizes[COMPONENT_FACING] = sizeof(Vector2d);
+    world->component_sizes[COMPONENT_PHASE] = sizeof(float);
+    world->component_sizes[COMPONENT_UPDATED] = sizeof(uint32_t);
+    world->component_sizes[COMPONENT_LOD_PERIOD] = sizeof(uint8_t);
+    return world;
+}
+
+/**
+ * Columns already allocated keep the size they were made with,
+ * so a size must not change once an archetype uses it.
+ */
+void set_component_size(World* world, Component component, size_t size) {
+    world->component_sizes[component] = size;
+}
+
+/**
+ * Archetypes are few, so finding one is a plain search.
+ */
+Archetype* create_archetype(World* world, ComponentMask mask, int32_t capacity) {
+    for (int32_t i = 0; i < world->archetype_count; i++) {
+        if (world->archetypes[i].mask == mask) return &world->archetypes[i];
+    }
+    if (world->archetype_count == ECS_MAX_ARCHETYPES) return NULL;
+    for (int32_t c = 0; c < COMPONENT_COUNT; c++) {
+        if ((mask & (1u << c)) && world->component_sizes[c] == 0) return NULL;
+    }
+
+    Archetype* archetype = &world->archetypes[world->archetype_count++];
+    archetype->mask = mask;
+    archetype->count = 0;
+    archetype->capacity = 0;
+    archetype->entities = NULL;
+    for (int32_t c = 0; c < COMPONENT_COUNT; c++) archetype->columns[c] = NULL;
+    __grow(world, archetype, capacity > 0 ? capacity : 1);
+    return archetype;
+}
+
+/**
+ * A full archetype doubles, which is the only time creating
+ * an entity allocates.
+ */
+Entity create_entity(World* world, Archetype* archetype) {
+    if (world->free_count == 0) return ENTITY_NONE;
+    if (archetype->count == archetype->capacity) __grow(world, archetype, 2 * archetype->capacity);
+
+    uint32_t index = world->free_indices[--world->free_count];
+    Entity entity = ((uint32_t)world->generations[index] << ENTITY_INDEX_BITS) | index;
+    int32_t row = archetype->count++;
+    archetype->entities[row] = entity;
+    world->archetype_of[index] = (int8_t)(archetype - world->archetypes);
+    world->rows[index] = row;
+    return entity;
+}
+
+/**
+ * The last row fills the hole, so the rows stay dense. Entities
+ * are not ordered within an archetype, so nothing else moves.
+ */
+void destroy_entity(World* world, Entity entity) {
+    if (!is_entity_alive(world, entity)) return;
+
+    uint32_t index = entity & ENTITY_INDEX_MASK;
+    Archetype* archetype = &world->archetypes[world->archetype_of[index]];
+    int32_t row = world->rows[index];
+    int32_t last = --archetype->count;
+    if (row != last) {
+        for (int32_t c = 0; c < COMPONENT_COUNT; c++) {
+            if (archetype->columns[c] == NULL) continue;
+            size_t size = world->component_sizes[c];
+            memcpy((char*)archetype->columns[c] + row * size, (char*)archetype->columns[c] + last * size, size);
+        }
+        Entity moved = archetype->entities[last];
+        archetype->entities[row] = moved;
+        world->rows[moved & ENTITY_INDEX_MASK] = row;
+    }
+
+    world->archetype_of[index] = -1;
+    world->generations[index]++;
+    world->free_indices[world->free_count++] = index;
+}
+
+/**
+ * The generation tells a handle to the entity now at the
+ * index apart from one to an earlier, destroyed one.
+ */
+bool is_entity_alive(World* world, Entity entity) {
+    uint32_t index = entity & ENTITY_INDEX_MASK;
+    return entity != ENTITY_NONE
+        && index < (uint32_t)world->max_entities
+        && world->archetype_of[index] != -1
+        && world->generations[index] == (uint8_t)(entity >> ENTITY_INDEX_BITS);
+}
+
+/**
+ * Two lookups, one for the archetype and one for the row.
+ */
+void* get_component(World* world, Entity entity, Component component) {
+    uint32_t index = entity & ENTITY_INDEX_MASK;
+    Archetype* archetype = &world->archetypes[world->archetype_of[index]];
+    if (archetype->columns[component] == NULL) return NULL;
+    return (char*)archetype->columns[component] + world->rows[index] * world->component_sizes[component];
+}
+
+/**
+ * Nothing is looked at until next_archetype.
+ */
+Query query_world(World* world, ComponentMask mask) {
+    return (Query){ world, mask, 0 };
+}
+
+/**
+ * Empty archetypes are skipped, so systems never see them.
+ */
+Archetype* next_archetype(Query* query) {
+    while (query->next < query->world->archetype_count) {
+        Archetype* archetype = &query->world->archetypes[query->next++];
+        if ((archetype->mask & query->mask) == query->mask && archetype->count > 0) return archetype;
+    }
+    return NULL;
+}
+
+/**
+ * The same sizes the columns are allocated with.
+ */
+size_t row_size(World* world, ComponentMask mask) {
+    size_t size = sizeof(Entity);
+    for (int32_t c = 0; c < COMPONENT_COUNT; c++) {
+        if (mask & (1u << c)) size += world->component_sizes[c];
+    }
+    return size;
+}
+
+/**
+ * Release every column of every archetype, then the tables.
+ */
+void destroy_world(World* world) {
+    for (int32_t i = 0; i < world->archetype_count; i++) {
+        free(world->archetypes[i].entities);
+        for (int32_t c = 0; c < COMPONENT_COUNT; c++) free(world->archetypes[i].columns[c]);
+    }
+    free(world->generations);
+    free(world->archetype_of);
+    free(world->rows);
+    free(world->free_indices);
+    free(world);
+}
+
+/**
+ * Only the columns in the mask are allocated.
+ */
+static void __grow(World* world, Archetype* archetype, int32_t capacity) {
+    archetype->entities = (Entity*)realloc(archetype->entities, sizeof(Entity) * capacity);
+    for (int32_t c = 0; c < COMPONENT_COUNT; c++) {
+        if (archetype->mask & (1u << c)) {
+            archetype->columns[c] = realloc(archetype->columns[c], world->component_sizes[c] * capacity);
+        }
+    }
+    archetype->capacity = capacity;
+}
\ No newline at end of file
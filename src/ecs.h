@@ -0,0 +1,362 @@
+#ifndef Wm8Fq2LcZs_ECS_H
+#define Wm8Fq2LcZs_ECS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+// The most archetypes a world holds
+#define ECS_MAX_ARCHETYPES 16
+// The low bits of an Entity index the world's tables, the high bits count reuses of the index
+#define ENTITY_INDEX_BITS 24
+// Masks an Entity down to its index
+#define ENTITY_INDEX_MASK ((1u << ENTITY_INDEX_BITS) - 1u)
+// An Entity that never refers to anything
+#define ENTITY_NONE UINT32_MAX
+
+/**
+ * Enum:
+ *  Component
+ *
+ * Purpose:
+ *  The kinds of data an entity can have, each kept in its own
+ *  column. The type stored for each is given below. The world
+ *  knows the size of the plain types, the module defining any
+ *  other type sets its size with set_component_size.
+ *
+ * Constants:
+ *  - COMPONENT_POSITION:
+ *      Point2d, the top left corner of the entity.
+ *  - COMPONENT_FACING:
+ *      Vector2d, the direction the entity faces, as a unit vector.
+ *  - COMPONENT_PHASE:
+ *      float, the entity's offset into its animation.
+ *  - COMPONENT_UPDATED:
+ *      uint32_t, the frame the entity was last updated.
+ *  - COMPONENT_LOD_PERIOD:
+ *      uint8_t, how many frames apart the entity is updated.
+ *  - COMPONENT_COLLIDER:
+ *      Collider, the circle the entity collides with.
+ *  - COMPONENT_PACKED:
+ *      PackedEnemy, an enemy's position, facing and phase quantized,
+ *      in place of those three components.
+ *  - COMPONENT_COUNT:
+ *      The number of components.
+ */
+typedef enum {
+    COMPONENT_POSITION      = 0,
+    COMPONENT_FACING        = 1,
+    COMPONENT_PHASE         = 2,
+    COMPONENT_UPDATED       = 3,
+    COMPONENT_LOD_PERIOD    = 4,
+    COMPONENT_COLLIDER      = 5,
+    COMPONENT_PACKED        = 6,
+    COMPONENT_COUNT         = 7
+} Component;
+
+// A set of components, bit c set for Component c
+typedef uint32_t ComponentMask;
+
+// A handle to an entity, which stops being alive once the entity is destroyed
+typedef uint32_t Entity;
+
+/**
+ * Struct:
+ *  Archetype
+ *
+ * Purpose:
+ *  Holds every entity with one exact set of components. Each
+ *  component is a dense array indexed by row, so a system walks
+ *  the columns it needs from the first row to the last without
+ *  skipping anything. Destroying an entity moves the last row
+ *  into its place.
+ *
+ * Fields:
+ *  - mask:
+ *      The components of the entities.
+ *  - count:
+ *      The number of entities, which are rows 0 to count-1.
+ *  - capacity:
+ *      The number of rows allocated.
+ *  - entities:
+ *      The entity in each row.
+ *  - columns:
+ *      An array per component, NULL for those not in the mask.
+ */
+typedef struct {
+    ComponentMask   mask;
+    int32_t         count;
+    int32_t         capacity;
+    Entity*         entities;
+    void*           columns[COMPONENT_COUNT];
+} Archetype;
+
+/**
+ * Struct:
+ *  World
+ *
+ * Purpose:
+ *  Holds on to all archetypes and finds any entity's row.
+ *
+ * Fields:
+ *  - archetypes:
+ *      The archetypes, which never move, so pointers to them stay valid.
+ *  - archetype_count:
+ *      The number of archetypes.
+ *  - max_entities:
+ *      The most entities alive at once.
+ *  - generations:
+ *      How many times each index has been destroyed, part of the
+ *      entity, so old handles to a reused index are not alive.
+ *  - archetype_of:
+ *      The archetype of the entity at each index, -1 if none.
+ *  - rows:
+ *      The row of the entity at each index within its archetype.
+ *  - free_indices:
+ *      A stack of the indices without an entity.
+ *  - free_count:
+ *      The number of indices on the free stack.
+ *  - component_sizes:
+ *      The bytes each component takes, 0 until its size is set.
+ */
+typedef struct {
+    Archetype       archetypes[ECS_MAX_ARCHETYPES];
+    int32_t         archetype_count;
+    int32_t         max_entities;
+    uint8_t*        generations;
+    int8_t*         archetype_of;
+    int32_t*        rows;
+    uint32_t*       free_indices;
+    int32_t         free_count;
+    size_t          component_sizes[COMPONENT_COUNT];
+} World;
+
+/**
+ * Struct:
+ *  Query
+ *
+ * Purpose:
+ *  Walks the archetypes that have a set of components.
+ *
+ * Fields:
+ *  - world:
+ *      The World object.
+ *  - mask:
+ *      The components looked for.
+ *  - next:
+ *      The index of the next archetype to look at.
+ */
+typedef struct {
+    World*          world;
+    ComponentMask   mask;
+    int32_t         next;
+} Query;
+
+/**
+ * Function:
+ *  init_world
+ *
+ * Purpose:
+ *  Create a World without any archetypes or entities.
+ *
+ * Parameters:
+ *  - max_entities:
+ *      The most entities alive at once, at most ENTITY_INDEX_MASK.
+ *
+ * Returns:
+ *  The World object.
+ */
+World* init_world(int32_t max_entities);
+
+/**
+ * Function:
+ *  set_component_size
+ *
+ * Purpose:
+ *  Tell the world the size of a component's type, before creating
+ *  any archetype with it. Setting the same size again does nothing.
+ *
+ * Parameters:
+ *  - world:
+ *      The World object.
+ *  - component:
+ *      The component.
+ *  - size:
+ *      The bytes the component's type takes.
+ *
+ * Returns:
+ *  Nothing.
+ */
+void set_component_size(World* world, Component component, size_t size);
+
+/**
+ * Function:
+ *  create_archetype
+ *
+ * Purpose:
+ *  Find the archetype with a set of components, creating
+ *  it if there is none.
+ *
+ * Parameters:
+ *  - world:
+ *      The World object.
+ *  - mask:
+ *      The components.
+ *  - capacity:
+ *      How many rows to allocate up front, so that many entities
+ *      are created without allocating.
+ *
+ * Returns:
+ *  The archetype, NULL if the world has no room for another or
+ *  the size of one of the components has not been set.
+ */
+Archetype* create_archetype(World* world, ComponentMask mask, int32_t capacity);
+
+/**
+ * Function:
+ *  create_entity
+ *
+ * Purpose:
+ *  Add an entity to the last row of an archetype. Its components
+ *  are left for the caller to set.
+ *
+ * Parameters:
+ *  - world:
+ *      The World object.
+ *  - archetype:
+ *      The archetype the entity belongs to.
+ *
+ * Returns:
+ *  The entity, ENTITY_NONE if the world is full.
+ */
+Entity create_entity(World* world, Archetype* archetype);
+
+/**
+ * Function:
+ *  destroy_entity
+ *
+ * Purpose:
+ *  Remove an entity, if it is alive.
+ *
+ * Parameters:
+ *  - world:
+ *      The World object.
+ *  - entity:
+ *      The entity.
+ *
+ * Returns:
+ *  Nothing.
+ */
+void destroy_entity(World* world, Entity entity);
+
+/**
+ * Function:
+ *  is_entity_alive
+ *
+ * Purpose:
+ *  Check if an entity has been created and not destroyed.
+ *
+ * Parameters:
+ *  - world:
+ *      The World object.
+ *  - entity:
+ *      The entity.
+ *
+ * Returns:
+ *  true if the entity is alive, false otherwise.
+ */
+bool is_entity_alive(World* world, Entity entity);
+
+/**
+ * Function:
+ *  get_component
+ *
+ * Purpose:
+ *  Find one component of an entity. The pointer is only good until
+ *  an entity of the same archetype is created or destroyed.
+ *
+ * Parameters:
+ *  - world:
+ *      The World object.
+ *  - entity:
+ *      A living entity.
+ *  - component:
+ *      The component.
+ *
+ * Returns:
+ *  The component, NULL if the entity does not have it.
+ */
+void* get_component(World* world, Entity entity, Component component);
+
+/**
+ * Function:
+ *  query_world
+ *
+ * Purpose:
+ *  Start walking the archetypes with a set of components.
+ *
+ * Parameters:
+ *  - world:
+ *      The World object.
+ *  - mask:
+ *      The components, archetypes may have others as well.
+ *
+ * Returns:
+ *  The query, to be passed to next_archetype.
+ */
+Query query_world(World* world, ComponentMask mask);
+
+/**
+ * Function:
+ *  next_archetype
+ *
+ * Purpose:
+ *  Find the next archetype of a query that has any entities.
+ *
+ * Parameters:
+ *  - query:
+ *      The query.
+ *
+ * Returns:
+ *  The archetype, NULL once there are no more.
+ */
+Archetype* next_archetype(Query* query);
+
+/**
+ * Function:
+ *  row_size
+ *
+ * Purpose:
+ *  Find the bytes one row takes over every column of an archetype
+ *  with a set of components.
+ *
+ * Parameters:
+ *  - world:
+ *      The World object.
+ *  - mask:
+ *      The components.
+ *
+ * Returns:
+ *  The bytes per row, the entity included.
+ */
+size_t row_size(World* world, ComponentMask mask);
+
+/**
+ * Function:
+ *  destroy_world
+ *
+ * Purpose:
+ *  Release the World object along with every archetype.
+ *
+ * Parameters:
+ *  - world:
+ *      The World object to destroy.
+ *
+ * Returns:
+ *  Nothing.
+ */
+void destroy_world(World* world);
+
+#endif
\ No newline at end of file
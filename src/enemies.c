@@ -3,25 +3,37 @@
 /*************
  * Bit masks *
  *************/
-// Release SDL surface data
-static const uint32_t FREE_SURFACE = 1u<<0;
-// Free Enemies object and its Enemy array
-static const uint32_t FREE_MEMORY = 1u<<1;
-// Release SDL texture data
-static const uint32_t FREE_TEXTURE = 1u<<2;
-
-// Path to sprite file
-static const char SPRITE_PATH[] = "assets/sprites/enemy.png";
-// Error message when loading image failed
-static const char LOAD_IMG_LOG[] = "Enemy sprite not found: %s\n";
-// Error message when fails to create surface
-static const char CREATE_TEXTURE_LOG[] = "Could not create texture from surface: %s\n";
+// Free Enemies object and its arrays
+static const uint32_t FREE_MEMORY = 1u<<0;
+
+// Error message when the world has no room for the enemies
+static const char ARCHETYPE_LOG[] = "Could not add the enemies to the world\n";
 // How fast the enemy animates
 static const float ENEMY_ANIMATION_SPEED = 0.01f;
+// Number of textures in the enemy animation
+static const float ENEMY_ANIMATION_LENGTH = (float)ENEMY_FRAMES;
 // How fast the enemy walks
 static const float ENEMY_WALKING_SPEED = 0.05f;
 // Enemy size
 static const int32_t ENEMY_SIZE = 40;
+// The width (and height) of the cells enemies are bucketed in, a few per window
+static const float GRID_CELL_SIZE = 512.0f;
+// The radius of the circle an enemy collides with, a little inside its sprite
+static const float COLLISION_RADIUS = 18.0f;
+// How close an enemy gets to the player before it is spent and dies
+static const float CONTACT_DISTANCE = 10.0f;
+// How many random spots are tried for an enemy before spawning it next to the view
+static const int32_t SPAWN_ATTEMPTS = 16;
+// Steps of a packed coordinate per pixel
+static const float PACKED_STEPS = 64.0f;
+// How far left of and above the world packed positions reach, one cell
+static const float PACKED_ORIGIN = 1024.0f;
+// The largest packed coordinate, the last step of the last cell
+static const int32_t PACKED_MAX = (1 << 24) - 1;
+// Steps of a packed heading per unit of diamond angle, which is 4 per turn
+static const float HEADING_STEPS = 64.0f;
+// Animation frames per step of a packed phase
+static const float PHASE_FRAMES = ENEMY_FRAMES / 256.0f;
 
 /**
  * Function:
@@ -29,80 +41,99 @@ static const int32_t ENEMY_SIZE = 40;
  *
  * Purpose:
  *  Allocate memory for the Enemies object and initialize
- *  some of its values.
+ *  some of its values, with no enemy alive.
  *
  * Parameters:
+ *  atlas:
+ *      The sprites, the enemy's frames among them.
  *  max_enemies:
- *      How large the array of enemies should be.
+ *      The most enemies alive at once.
+ *  world:
+ *      The entities.
+ *  compact:
+ *      Are enemies kept as PackedEnemy?
  *
  * Returns:
- *  The Enemies object allocated.
+ *  The Enemies object allocated, without an archetype if
+ *  the world had no room for one.
  */
-static Enemies* __alloc_and_set_enemies(int32_t max_enemies);
+static Enemies* __alloc_and_set_enemies(Atlas* atlas, int32_t max_enemies, World* world, bool compact);
 
 /**
  * Function:
- *  __create_texture
+ *  __destroy
  *
  * Purpose:
- *  Create a texture from an existing surface.
+ *  Release resources of the Enemies object.
  *
  * Parameters:
- *  - renderer:
- *      A structure that contains a rendering state.
- *  - surface:
- *      A structure that contains a collection of pixels used in software blitting.
  *  - enemies:
  *      The Enemies object.
+ *  - mask:
+ *      A mask to choose which resources are destroyed.
+ *      FREE_MEMORY
  *
  * Returns:
- *  true if successful, false otherwise.
+ *  Nothing.
  */
-static bool __create_texture(SDL_Renderer* renderer, SDL_Surface* surface, Enemies* enemies);
+static void __destroy(Enemies* enemies, uint32_t mask);
 
 /**
  * Function:
- *  __destroy
+ *  __init_enemy
  *
  * Purpose:
- *  Release resources of the Enemies object.
+ *  Initialize the enemy's position, facing and phase.
  *
  * Parameters:
- *  - enemies:
- *      The Enemies object.
- *  - surface:
- *      SDL_Surface that only lives in function scopes.
- *  - mask:
- *      A mask to choose which resources are destroyed.
- *      FREE_SURFACE
- *      FREE_MEMORY
- *      FREE_TEXTURE
- *      FREE_TEXTURE
+ *  - archetype:
+ *      The enemies' archetype.
+ *  - row:
+ *      The enemy's row.
+ *  - camera:
+ *      The camera, which the enemy spawns out of view of.
  *
  * Returns:
  *  Nothing.
  */
-static void __destroy(Enemies* enemies, SDL_Surface* surface, uint32_t mask);
+static void __init_enemy(Archetype* archetype, int32_t row, Camera* camera);
 
 /**
  * Function:
- *  __init_enemy
+ *  __spawn_in_world
  *
  * Purpose:
- *  Initialize the enemy's position.
+ *  Place the enemy anywhere in the world outside the camera's view.
  *
  * Parameters:
- *  - enemy:
- *      The Enemy object.
- *  - w:
- *      The width of the window.
- *  - h:
- *      The height of the window.
+ *  - position:
+ *      The enemy's position.
+ *  - camera:
+ *      The camera.
  *
  * Returns:
- *  Nothing.
+ *  true if a spot was found, false if the view takes up
+ *  too much of the world to find one.
+ */
+static bool __spawn_in_world(Point2d* position, Camera* camera);
+
+/**
+ * Function:
+ *  __in_view
+ *
+ * Purpose:
+ *  Check if any part of an enemy at a position is within the camera's view.
+ *
+ * Parameters:
+ *  - position:
+ *      The enemy's position.
+ *  - camera:
+ *      The camera.
+ *
+ * Returns:
+ *  true if the enemy would be seen, false otherwise.
  */
-static void __init_enemy(Enemy* enemy, int32_t w, int32_t h);
+static bool __in_view(Point2d* position, Camera* camera);
 
 /**
  * Function:
@@ -113,8 +144,8 @@ static void __init_enemy(Enemy* enemy, int32_t w, int32_t h);
  *  on the choice of x so they spawn outside the window.
  *
  * Parameters:
- *  - enemy:
- *      The Enemy object.
+ *  - position:
+ *      The enemy's position.
  *  - w:
  *      The width of the window.
  *  - h:
@@ -123,7 +154,7 @@ static void __init_enemy(Enemy* enemy, int32_t w, int32_t h);
  * Returns:
  *  Nothing.
  */
-static void __pick_x_first(Enemy* enemy, int32_t w, int32_t h);
+static void __pick_x_first(Point2d* position, int32_t w, int32_t h);
 
 /**
  * Function:
@@ -134,8 +165,8 @@ static void __pick_x_first(Enemy* enemy, int32_t w, int32_t h);
  *  on the choice of y so they spawn outside the window.
  *
  * Parameters:
- *  - enemy:
- *      The Enemy object.
+ *  - position:
+ *      The enemy's position.
  *  - w:
  *      The width of the window.
  *  - h:
@@ -144,166 +175,771 @@ static void __pick_x_first(Enemy* enemy, int32_t w, int32_t h);
  * Returns:
  *  Nothing.
  */
-static void __pick_y_first(Enemy* enemy, int32_t w, int32_t h);
+static void __pick_y_first(Point2d* position, int32_t w, int32_t h);
 
 /**
  * Function:
  *  __update_enemy
  *
  * Purpose:
- *  Update enemy's animation, position and rotation base
+ *  Update enemy's position and facing based
  *  on time and player position.
  *
  * Parameters:
- *  - enemy:
- *      The Enemy object.
+ *  - position:
+ *      The enemy's position.
+ *  - facing:
+ *      The enemy's facing.
+ *  - flow:
+ *      The flow field leading to the player, or NULL.
+ *  - map:
+ *      The map with walls to slide along, or NULL.
  *  - dt:
- *      Delta time.
+ *      Time since the enemy was last updated.
  *  - p_pos:
  *      The position of the player.
  *
  * Returns:
+ *  The squared distance to the player before moving.
+ */
+static float __update_enemy(Point2d* position, Vector2d* facing, FlowField* flow, TileMap* map, float dt, Point2d* p_pos);
+
+/**
+ * Function:
+ *  __due_rows
+ *
+ * Purpose:
+ *  Find which enemies of a block of up to 64 rows are due for an
+ *  update this frame.
+ *
+ * Parameters:
+ *  - entities:
+ *      The entities of the block's rows.
+ *  - periods:
+ *      The update periods of the block's rows.
+ *  - n:
+ *      The number of rows in the block.
+ *  - frame:
+ *      The frame being updated.
+ *
+ * Returns:
+ *  Bit j set if the block's row j is due.
+ */
+static uint64_t __due_rows(Entity* entities, uint8_t* periods, int32_t n, uint32_t frame);
+
+/**
+ * Function:
+ *  __update_packed_rows
+ *
+ * Purpose:
+ *  update_enemy_rows for an archetype of packed enemies.
+ *
+ * Parameters:
+ *  Those of update_enemy_rows.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __update_packed_rows(Enemies* enemies, Archetype* a, int32_t begin, int32_t end,
+    FlowField* flow, TileMap* map, Point2d* p_pos);
+
+/**
+ * Function:
+ *  __to_fixed
+ *
+ * Purpose:
+ *  Turn a coordinate into a packed one, the nearest that fits.
+ *
+ * Parameters:
+ *  - coordinate:
+ *      The coordinate in pixels.
+ *
+ * Returns:
+ *  The coordinate in steps from the packed origin, 24 bits.
+ */
+static inline int32_t __to_fixed(float coordinate);
+
+/**
+ * Function:
+ *  __from_fixed
+ *
+ * Purpose:
+ *  Turn a packed coordinate back into pixels.
+ *
+ * Parameters:
+ *  - steps:
+ *      The coordinate in steps from the packed origin.
+ *
+ * Returns:
+ *  The coordinate in pixels.
+ */
+static inline float __from_fixed(int32_t steps);
+
+/**
+ * Function:
+ *  __round_steps
+ *
+ * Purpose:
+ *  Round a distance in steps to the nearest whole step.
+ *
+ * Parameters:
+ *  - steps:
+ *      The distance in steps, either way.
+ *
+ * Returns:
+ *  The nearest whole number of steps, halves away from zero.
+ */
+static inline int32_t __round_steps(float steps);
+
+/**
+ * Function:
+ *  __pack_steps
+ *
+ * Purpose:
+ *  Set a packed enemy's cells and offsets to a packed position.
+ *
+ * Parameters:
+ *  - packed:
+ *      The packed enemy.
+ *  - x:
+ *      The horizontal coordinate in steps, 24 bits.
+ *  - y:
+ *      The vertical coordinate in steps, 24 bits.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static inline void __pack_steps(PackedEnemy* packed, int32_t x, int32_t y);
+
+/**
+ * Function:
+ *  __pack_position
+ *
+ * Purpose:
+ *  Set a packed enemy's cells and offsets to a position.
+ *
+ * Parameters:
+ *  - packed:
+ *      The packed enemy.
+ *  - position:
+ *      The position.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static inline void __pack_position(PackedEnemy* packed, Point2d* position);
+
+/**
+ * Function:
+ *  __unpack_position
+ *
+ * Purpose:
+ *  Find where a packed enemy is.
+ *
+ * Parameters:
+ *  - packed:
+ *      The packed enemy.
+ *
+ * Returns:
+ *  The position.
+ */
+static inline Point2d __unpack_position(const PackedEnemy* packed);
+
+/**
+ * Function:
+ *  __pack_heading
+ *
+ * Purpose:
+ *  Find the packed heading nearest to a facing.
+ *
+ * Parameters:
+ *  - facing:
+ *      The facing.
+ *
+ * Returns:
+ *  The heading, in 256ths of a turn.
+ */
+static inline uint8_t __pack_heading(Vector2d* facing);
+
+/**
+ * Function:
+ *  __slide
+ *
+ * Purpose:
+ *  Keep a move from taking an enemy's box into a wall by dropping
+ *  the part of it that goes into the wall.
+ *
+ * Parameters:
+ *  - map:
+ *      The map with the walls.
+ *  - from:
+ *      The enemy's center before moving.
+ *  - to:
+ *      The enemy's center after moving, changed to stay out of walls.
+ *
+ * Returns:
  *  Nothing.
  */
-static void __update_enemy(Enemy* enemy, float dt, Point2d* p_pos);
+static void __slide(TileMap* map, Point2d* from, Point2d* to);
+
+/**
+ * Function:
+ *  __hits_wall
+ *
+ * Purpose:
+ *  Check if any tile under an edge of an enemy's box, or the whole
+ *  box, is a wall.
+ *
+ * Parameters:
+ *  - map:
+ *      The map with the walls.
+ *  - x0, y0:
+ *      The top left corner.
+ *  - x1, y1:
+ *      The bottom right corner, level with the top left for an edge.
+ *
+ * Returns:
+ *  true if a tile the edge (or box) touches is a wall, false
+ *  otherwise.
+ */
+static bool __hits_wall(TileMap* map, float x0, float y0, float x1, float y1);
+
+static inline int32_t __box_tile(TileMap* map, float edge);
+
+/**
+ * Function:
+ *  __lod_period
+ *
+ * Purpose:
+ *  Choose how many frames apart an enemy is updated.
+ *
+ * Parameters:
+ *  - enemies:
+ *      The Enemies object.
+ *  - distance_squared:
+ *      The squared distance from the enemy to the player.
+ *
+ * Returns:
+ *  The update period, a power of two.
+ */
+static uint8_t __lod_period(Enemies* enemies, float distance_squared);
 
 /**
  * Function:
- *  __draw_enemy
+ *  __capture_enemy
  *
  * Purpose:
- *  Draw the enemy in his current animation state.
+ *  Add the enemy in its current animation state to a snapshot.
  *
  * Parameters:
- *  - renderer:
- *      A structure that contains a rendering state.
  *  - enemies:
  *      The Enemies object.
- *  - enemy_index:
- *      The index of the enemy to update in the enemy array.
+ *  - row:
+ *      The enemy's row.
+ *  - snapshot:
+ *      The Snapshot object.
  *
  * Returns:
  *  Nothing.
  */
-static void __draw_enemy(SDL_Renderer* renderer, Enemies* enemies, int32_t enemy_index);
+static void __capture_enemy(Enemies* enemies, int32_t row, Snapshot* snapshot);
+
+/**
+ * Function:
+ *  __compare_entities
+ *
+ * Purpose:
+ *  Order entities ascending for qsort.
+ *
+ * Parameters:
+ *  - a:
+ *      A pointer to the first entity.
+ *  - b:
+ *      A pointer to the second entity.
+ *
+ * Returns:
+ *  Negative if a < b, positive if a > b and 0 otherwise.
+ */
+static int __compare_entities(const void* a, const void* b);
+
+/**
+ * Function:
+ *  __compare_moves
+ *
+ * Purpose:
+ *  Order moves by their entity, ascending, for qsort.
+ *
+ * Parameters:
+ *  - a:
+ *      A pointer to the first move.
+ *  - b:
+ *      A pointer to the second move.
+ *
+ * Returns:
+ *  Negative if a's entity is smaller, positive if larger and 0 otherwise.
+ */
+static int __compare_moves(const void* a, const void* b);
 
 /**
- * We begin by loading image and if that fails, we stop there.
- * At any point when the initialization fails, we must release
- * previously allocated resources at that point. SDL_Surface
- * does not need to be stored. Each enemy is then initalized
- * separately.
+ * If the world has no room for the enemies, we release what was
+ * allocated and stop there. Everything an enemy will ever need
+ * is allocated here, rows included, so spawning and dying never
+ * allocate. No enemy is alive until spawned.
  */
-Enemies* init_enemies(SDL_Renderer* renderer, int32_t max_enemies, int32_t w, int32_t h) {
-    SDL_Surface* surface = IMG_Load(SPRITE_PATH);
-    if (surface == NULL) {
-        SDL_Log(LOAD_IMG_LOG, SDL_GetError());
+Enemies* init_enemies(Atlas* atlas, int32_t max_enemies, Camera* camera, World* world, bool compact) {
+    Enemies* e = __alloc_and_set_enemies(atlas, max_enemies, world, compact);
+    if (e->archetype == NULL) {
+        SDL_Log(ARCHETYPE_LOG);
+        __destroy(e, FREE_MEMORY);
         return NULL;
     }
 
-    Enemies* e = __alloc_and_set_enemies(max_enemies);
+    init_enemy_lod(e, camera->width, camera->height);
+    init_enemy_grid(e, camera->world_width, camera->world_height);
 
-    if (!__create_texture(renderer, surface, e)) return NULL;
+    return e;
+}
 
-    SDL_FreeSurface(surface);
+/**
+ * Any enemy on screen is within a window diagonal of the player,
+ * so everything that can be seen is updated every frame.
+ */
+void init_enemy_lod(Enemies* enemies, int32_t w, int32_t h) {
+    float near = SDL_sqrtf((float)(w * w + h * h)) + ENEMY_SIZE;
+    enemies->lod = true;
+    enemies->lod_near_squared = near * near;
+    enemies->frame = 0;
+    for (int32_t n = 0; n < ENEMY_LOD_HISTORY; n++) enemies->elapsed[n] = 0.0f;
 
-    for (int32_t i = 0; i < e->max_enemies; i++) {
-        __init_enemy(e->enemies + i, w, h);
+    Archetype* a = enemies->archetype;
+    uint32_t* updated = (uint32_t*)a->columns[COMPONENT_UPDATED];
+    uint8_t* periods = (uint8_t*)a->columns[COMPONENT_LOD_PERIOD];
+    for (int32_t row = 0; row < a->count; row++) {
+        updated[row] = enemies->frame - 1;
+        periods[row] = 1;
     }
+}
 
-    return e;
+/**
+ * The first wave spawns once its delay has passed, counted
+ * from this call.
+ */
+void set_enemy_waves(Enemies* enemies, const EnemyWave* waves, int32_t count) {
+    enemies->waves = waves;
+    enemies->wave_count = count;
+    enemies->wave = 0;
+    enemies->wave_timer = count > 0 ? waves[0].delay : 0.0f;
+}
+
+/**
+ * Several waves may be due within a long frame. Once the schedule
+ * is through, the last wave keeps repeating, unless its delay would
+ * make it repeat forever within a single frame.
+ */
+void spawn_enemy_waves(Enemies* enemies, Camera* camera, float dt) {
+    if (enemies->waves == NULL || enemies->wave >= enemies->wave_count) return;
+
+    enemies->wave_timer -= dt;
+    while (enemies->wave_timer <= 0.0f) {
+        const EnemyWave* wave = &enemies->waves[enemies->wave];
+        spawn_enemies(enemies, camera, (int32_t)(wave->fraction * enemies->max_enemies));
+
+        if (enemies->wave + 1 < enemies->wave_count) {
+            enemies->wave++;
+        } else if (wave->delay <= 0.0f) {
+            enemies->wave = enemies->wave_count;
+            return;
+        }
+        enemies->wave_timer += enemies->waves[enemies->wave].delay;
+    }
+}
+
+/**
+ * New enemies go in the last rows, right after the living ones.
+ * The world may be full before max_enemies are alive if it is
+ * shared with more than it was sized for. A spawned enemy is due
+ * on the next update and has only missed the frame it spawned in.
+ */
+int32_t spawn_enemies(Enemies* enemies, Camera* camera, int32_t count) {
+    Archetype* a = enemies->archetype;
+    if (count > enemies->max_enemies - a->count) count = enemies->max_enemies - a->count;
+
+    for (int32_t n = 0; n < count; n++) {
+        Entity enemy = create_entity(enemies->world, a);
+        if (enemy == ENTITY_NONE) return n;
+        int32_t row = a->count - 1;
+        __init_enemy(a, row, camera);
+        ((uint32_t*)a->columns[COMPONENT_UPDATED])[row] = enemies->frame;
+        ((uint8_t*)a->columns[COMPONENT_LOD_PERIOD])[row] = 1;
+        if (enemies->grid) {
+            Point2d position = enemy_position(a, row);
+            insert_into_spatial_grid(enemies->grid, enemy & ENTITY_INDEX_MASK, &position);
+        }
+    }
+
+    return count;
+}
+
+/**
+ * The last enemy takes the dead one's row, the grid does not
+ * notice since it goes by entity.
+ */
+void kill_enemy(Enemies* enemies, Entity enemy) {
+    if (!is_enemy_alive(enemies, enemy)) return;
+    if (enemies->grid) remove_from_spatial_grid(enemies->grid, enemy & ENTITY_INDEX_MASK);
+    destroy_entity(enemies->world, enemy);
+}
+
+/**
+ * Alive and in the enemies' archetype, which tells
+ * enemies apart from the player.
+ */
+bool is_enemy_alive(Enemies* enemies, Entity enemy) {
+    World* world = enemies->world;
+    return is_entity_alive(world, enemy)
+        && &world->archetypes[world->archetype_of[enemy & ENTITY_INDEX_MASK]] == enemies->archetype;
+}
+
+/**
+ * Packed enemies are decoded on the way out, so callers need not
+ * know which layout they got.
+ */
+Point2d enemy_position(Archetype* archetype, int32_t row) {
+    if (archetype->columns[COMPONENT_PACKED]) {
+        return __unpack_position((PackedEnemy*)archetype->columns[COMPONENT_PACKED] + row);
+    }
+    return ((Point2d*)archetype->columns[COMPONENT_POSITION])[row];
+}
+
+/**
+ * A packed enemy ends up at the nearest position it can hold.
+ */
+void set_enemy_position(Archetype* archetype, int32_t row, Point2d* position) {
+    if (archetype->columns[COMPONENT_PACKED]) {
+        __pack_position((PackedEnemy*)archetype->columns[COMPONENT_PACKED] + row, position);
+    } else {
+        ((Point2d*)archetype->columns[COMPONENT_POSITION])[row] = *position;
+    }
+}
+
+/**
+ * A packed heading is turned back into a point on the diamond it
+ * was taken from, then scaled to a unit vector.
+ */
+Vector2d enemy_facing(Archetype* archetype, int32_t row) {
+    if (archetype->columns[COMPONENT_PACKED] == NULL) {
+        return ((Vector2d*)archetype->columns[COMPONENT_FACING])[row];
+    }
+
+    int8_t heading = (int8_t)((PackedEnemy*)archetype->columns[COMPONENT_PACKED])[row].heading;
+    float d = heading / HEADING_STEPS;
+    float y = d > 1.0f ? 2.0f - d : d < -1.0f ? -2.0f - d : d;
+    float x = (1.0f - (y < 0 ? -y : y)) * (d > 1.0f || d < -1.0f ? -1.0f : 1.0f);
+    float norm_factor = carmack_inverse_sqrt(x * x + y * y);
+    return (Vector2d){ x * norm_factor, y * norm_factor };
+}
+
+/**
+ * Enemies are bucketed by their top left corner, like the
+ * culling in capture_enemies tests them. Items are entity indices,
+ * which do not change when rows move, so the grid holds as many
+ * as the world.
+ */
+void init_enemy_grid(Enemies* enemies, float world_w, float world_h) {
+    Archetype* a = enemies->archetype;
+    enemies->grid = init_spatial_grid(world_w, world_h, GRID_CELL_SIZE, enemies->world->max_entities);
+    for (int32_t row = 0; row < a->count; row++) {
+        Point2d position = enemy_position(a, row);
+        insert_into_spatial_grid(enemies->grid, a->entities[row] & ENTITY_INDEX_MASK, &position);
+    }
+}
+
+/**
+ * The three parts run one after the other on this thread,
+ * each archetype's rows in one go.
+ */
+void update_enemies(Enemies* enemies, FlowField* flow, TileMap* map, float dt, Point2d* p_pos) {
+    begin_enemy_update(enemies, dt);
+    Query query = query_world(enemies->world, enemies->components);
+    for (Archetype* a = next_archetype(&query); a != NULL; a = next_archetype(&query)) {
+        update_enemy_rows(enemies, a, 0, a->count, flow, map, p_pos);
+    }
+    end_enemy_update(enemies);
+}
+
+/**
+ * The clock is shared by every enemy, so it moves once a frame
+ * and the rows only read it.
+ */
+void begin_enemy_update(Enemies* enemies, float dt) {
+    enemies->animation_clock += dt * ENEMY_ANIMATION_SPEED;
+    if (enemies->animation_clock >= ENEMY_ANIMATION_LENGTH) {
+        enemies->animation_clock -= ENEMY_ANIMATION_LENGTH * (int)(enemies->animation_clock / ENEMY_ANIMATION_LENGTH);
+    }
+
+    ++enemies->frame;
+    for (int32_t n = ENEMY_LOD_HISTORY - 1; n > 0; n--) {
+        enemies->elapsed[n] = enemies->elapsed[n - 1] + dt;
+    }
+    SDL_AtomicSet(&enemies->dying_count, 0);
+    SDL_AtomicSet(&enemies->moved_count, 0);
+}
+
+/**
+ * Calls update for each enemy of the range that is due. No enemy
+ * animates on its own, its texture is derived from the clock only
+ * if it is drawn.
+ *
+ * An enemy with period p is due when (i + frame) is a multiple of p,
+ * where i is its entity's index, so each frame updates a constant
+ * fraction of every tier rather than all of them at once. That also
+ * means no enemy waits more than the longest period, however its
+ * period or row changes. A due enemy moves by all the time it missed,
+ * so its trajectory stays the same. Frames are counted with wrap
+ * around, so the unsigned difference is right even when the counter
+ * overflows. Only enemies that moved can change cells in the grid, so
+ * keeping it current costs nothing for the rest.
+ *
+ * Each row is only written by the range it is in. The dying and
+ * moved enemies are shared, so they are appended with an atomic add,
+ * which is rare: an enemy dies once and crosses a cell every few
+ * dozen frames. Packed enemies have a kernel of their own.
+ */
+void update_enemy_rows(Enemies* enemies, Archetype* a, int32_t begin, int32_t end,
+    FlowField* flow, TileMap* map, Point2d* p_pos) {
+    if (a->columns[COMPONENT_PACKED]) {
+        __update_packed_rows(enemies, a, begin, end, flow, map, p_pos);
+        return;
+    }
+
+    uint32_t frame = enemies->frame;
+    Entity* entities = a->entities;
+    Point2d* positions = (Point2d*)a->columns[COMPONENT_POSITION];
+    Vector2d* facings = (Vector2d*)a->columns[COMPONENT_FACING];
+    uint32_t* updated = (uint32_t*)a->columns[COMPONENT_UPDATED];
+    uint8_t* periods = (uint8_t*)a->columns[COMPONENT_LOD_PERIOD];
+
+    for (int32_t block = begin; block < end; block += 64) {
+        int32_t n = end - block < 64 ? end - block : 64;
+        uint64_t due = __due_rows(entities + block, periods + block, n, frame);
+        while (due) {
+            int32_t row = block + __builtin_ctzll(due);
+            due &= due - 1;
+
+            Point2d from = positions[row];
+            float distance_squared = __update_enemy(
+                &positions[row], &facings[row], flow, map, enemies->elapsed[frame - updated[row]], p_pos
+            );
+            if (distance_squared < CONTACT_DISTANCE * CONTACT_DISTANCE) {
+                enemies->dying[SDL_AtomicAdd(&enemies->dying_count, 1)] = entities[row];
+                continue;
+            }
+            updated[row] = frame;
+            if (enemies->grid && !is_same_cell(enemies->grid, &from, &positions[row])) {
+                enemies->moved[SDL_AtomicAdd(&enemies->moved_count, 1)] = (EnemyMove){ entities[row], from };
+            }
+            periods[row] = enemies->lod ? __lod_period(enemies, distance_squared) : 1;
+        }
+    }
+}
+
+/**
+ * Moves go first, every moved enemy is still alive then. Killing
+ * moves rows, which is why it waits until no range is walked. Both
+ * were appended in whatever order the threads got to them, so they
+ * are sorted first: the order of a grid cell's enemies and of the
+ * rows after a death is then the same every run, and so is the
+ * order enemies are drawn in.
+ */
+void end_enemy_update(Enemies* enemies) {
+    World* world = enemies->world;
+    int32_t moved = SDL_AtomicGet(&enemies->moved_count);
+    qsort(enemies->moved, moved, sizeof(EnemyMove), __compare_moves);
+    for (int32_t i = 0; i < moved; i++) {
+        int32_t index = enemies->moved[i].entity & ENTITY_INDEX_MASK;
+        Point2d position = enemy_position(&world->archetypes[world->archetype_of[index]], world->rows[index]);
+        move_in_spatial_grid(enemies->grid, index, &enemies->moved[i].from, &position);
+    }
+
+    int32_t dying = SDL_AtomicGet(&enemies->dying_count);
+    qsort(enemies->dying, dying, sizeof(Entity), __compare_entities);
+    for (int32_t i = 0; i < dying; i++) kill_enemy(enemies, enemies->dying[i]);
 }
 
 /**
- * Calls update for each enemy.
+ * Captures each enemy, given they are visible. With a grid,
+ * only the cells overlapping the view are walked, so the cost
+ * follows the number of enemies near the camera rather than in
+ * the world. Enemies in those cells may still be just out of view,
+ * so each is tested all the same. Without one, every living enemy is
+ * tested. The grid holds entity indices, which the world turns into rows.
  */
-void update_enemies(Enemies* enemies, float dt, Point2d* p_pos) {
-    for (int32_t i = 0; i < enemies->max_enemies; i++) {
-        __update_enemy(enemies->enemies + i, dt, p_pos);
+void capture_enemies(Enemies* enemies, Snapshot* snapshot) {
+    SpatialGrid* grid = enemies->grid;
+    Camera* camera = &snapshot->camera;
+    Archetype* a = enemies->archetype;
+    if (grid == NULL) {
+        for (int32_t row = 0; row < a->count; row++) {
+            Point2d position = enemy_position(a, row);
+            if (__in_view(&position, camera)) __capture_enemy(enemies, row, snapshot);
+        }
+        return;
+    }
+
+    int32_t* rows = enemies->world->rows;
+    GridRange range = spatial_grid_range(
+        grid,
+        camera->position.x - ENEMY_SIZE,
+        camera->position.y - ENEMY_SIZE,
+        camera->width + ENEMY_SIZE,
+        camera->height + ENEMY_SIZE
+    );
+    for (int32_t row = range.row0; row <= range.row1; row++) {
+        for (int32_t col = range.col0; col <= range.col1; col++) {
+            for (int32_t i = grid->heads[row * grid->cols + col]; i != -1; i = grid->next[i]) {
+                Point2d position = enemy_position(a, rows[i]);
+                if (__in_view(&position, camera)) __capture_enemy(enemies, rows[i], snapshot);
+            }
+        }
     }
 }
 
 /**
- * Calls draw for each enemy, given they are visible.
+ * Everything was worked out when capturing, so all that is
+ * left is moving by the camera.
  */
-void draw_enemies(SDL_Renderer* renderer, Enemies* enemies, int32_t w, int32_t h) {
-    for (int32_t i = 0; i < enemies->max_enemies; i++) {
-        bool visible = enemies->enemies[i].position.x > -ENEMY_SIZE
-            && enemies->enemies[i].position.x < w + ENEMY_SIZE
-            && enemies->enemies[i].position.y > -ENEMY_SIZE
-            && enemies->enemies[i].position.y < h + ENEMY_SIZE;
-        if (visible) __draw_enemy(renderer, enemies, i);
+void draw_enemies(RenderBuffer* commands, Enemies* enemies, Snapshot* snapshot) {
+    Point2d camera = snapshot->camera.position;
+    for (int32_t i = 0; i < snapshot->enemy_count; i++) {
+        Sprite* sprite = &snapshot->enemies[i];
+        SDL_Rect rect = {
+            sprite->position.x - camera.x,
+            sprite->position.y - camera.y,
+            ENEMY_SIZE,
+            ENEMY_SIZE
+        };
+        push_sprite(
+            commands,
+            LAYER_ENEMIES,
+            enemies->texture,
+            &enemies->texture_states[sprite->state],
+            &rect,
+            sprite->angle
+        );
     }
 }
 
 /**
  * Releases all resources related to enemies that have
- * been stored in the Enemies object.
+ * been stored in the Enemies object, the atlas aside.
  */
 void destroy_enemies(Enemies* enemies) {
-    __destroy(enemies, NULL, FREE_TEXTURE | FREE_MEMORY);
+    __destroy(enemies, FREE_MEMORY);
 }
 
 /**
- * Allocate memory for Enemies and its Enemy array. Set the
- * texture states array to the rectangles surrounding each
- * image within the sprite sheet.
+ * Allocate memory for Enemies and the rows of every enemy
+ * that can be alive at once. Set the texture states array to
+ * the rectangles surrounding each frame within the atlas.
  */
-static Enemies* __alloc_and_set_enemies(int32_t max_enemies) {
+static Enemies* __alloc_and_set_enemies(Atlas* atlas, int32_t max_enemies, World* world, bool compact) {
     Enemies* e = (Enemies*)malloc(sizeof(Enemies));
-    e->enemies = (Enemy*)malloc(sizeof(Enemy) * max_enemies);
+    e->world = world;
+    e->components = compact ? ENEMY_PACKED_COMPONENTS : ENEMY_COMPONENTS;
+    set_component_size(world, COMPONENT_PACKED, sizeof(PackedEnemy));
+    e->archetype = create_archetype(world, e->components, max_enemies);
+    e->dying = (Entity*)malloc(sizeof(Entity) * max_enemies);
+    e->moved = (EnemyMove*)malloc(sizeof(EnemyMove) * max_enemies);
+    SDL_AtomicSet(&e->dying_count, 0);
+    SDL_AtomicSet(&e->moved_count, 0);
+    e->waves = NULL;
+    e->wave_count = 0;
+    e->wave = 0;
+    e->wave_timer = 0.0f;
 
-    // Done with: http://www.spritecow.com/
-    e->texture_states[0] = (SDL_Rect){ 36, 22, 61, 62 };
-    e->texture_states[1] = (SDL_Rect){ 114, 23, 60, 62 };
-    e->texture_states[2] = (SDL_Rect){ 189, 26, 58, 62 };
-    e->texture_states[3] = (SDL_Rect){ 41, 98, 59, 61 };
-    e->texture_states[4] = (SDL_Rect){ 112, 99, 60, 61 };
-    e->texture_states[5] = (SDL_Rect){ 186, 101, 58, 61 };
+    e->texture = atlas->texture;
+    for (int32_t i = 0; i < ENEMY_FRAMES; i++) e->texture_states[i] = atlas->rects[SPRITE_ENEMY + i];
 
     e->max_enemies = max_enemies;
-    e->collision_radius = 0.9f * ENEMY_SIZE/2.0f;
+    e->collision_radius = COLLISION_RADIUS;
+    e->animation_clock = 0.0f;
+    e->grid = NULL;
 
     return e;
 }
 
 /**
- * Releases the surface resources and Enemies memory if we fail
- * to create the texture.
+ * Check each resources against mask before releasing. The
+ * enemies' rows belong to the world, which outlives them.
  */
-static bool __create_texture(SDL_Renderer* renderer, SDL_Surface* surface, Enemies* enemies) {
-    enemies->texture = SDL_CreateTextureFromSurface(renderer, surface);
-    if (enemies->texture == NULL) {
-        SDL_Log(CREATE_TEXTURE_LOG, SDL_GetError());
-        __destroy(enemies, surface, FREE_SURFACE | FREE_MEMORY);
-        return false;
+static void __destroy(Enemies* enemies, uint32_t mask) {
+    if (FREE_MEMORY & mask) {
+        free(enemies->dying);
+        free(enemies->moved);
+        if (enemies->grid) destroy_spatial_grid(enemies->grid);
+        free(enemies);
     }
-    return true;
 }
 
 /**
- * Check each resources against mask before releasing.
+ * Initialize an enemy to a random position within the world,
+ * outside the view of the player. If the world is not much
+ * larger than the view, the enemy spawns on a band around the
+ * view instead, outside of it but not too far off. Packed enemies
+ * draw the same random numbers, so a seed spawns the same enemies
+ * in either layout.
  */
-static void __destroy(Enemies* enemies, SDL_Surface* surface, uint32_t mask) {
-    if (FREE_SURFACE & mask) SDL_FreeSurface(surface);
-    if (FREE_TEXTURE & mask) SDL_DestroyTexture(enemies->texture);
-    if (FREE_MEMORY & mask) {
-        free(enemies->enemies);
-        free(enemies);
+static void __init_enemy(Archetype* archetype, int32_t row, Camera* camera) {
+    Point2d position;
+    if (!__spawn_in_world(&position, camera)) {
+        if (rand() % 2) {
+            __pick_x_first(&position, camera->width, camera->height);
+        } else {
+            __pick_y_first(&position, camera->width, camera->height);
+        }
+        position.x += camera->position.x;
+        position.y += camera->position.y;
+    }
+    set_enemy_position(archetype, row, &position);
+
+    float phase = (rand() % 600) / 100.0f;
+    Vector2d facing = { 0.0f, 1.0f };
+    if (archetype->columns[COMPONENT_PACKED]) {
+        PackedEnemy* packed = (PackedEnemy*)archetype->columns[COMPONENT_PACKED] + row;
+        packed->phase = (uint8_t)(int32_t)(phase / PHASE_FRAMES + 0.5f);
+        packed->heading = __pack_heading(&facing);
+    } else {
+        ((float*)archetype->columns[COMPONENT_PHASE])[row] = phase;
+        ((Vector2d*)archetype->columns[COMPONENT_FACING])[row] = facing;
     }
 }
 
 /**
- * Initialize an enemy to a random position within the world,
- * outside the view of the player but not too far off.
+ * Spots are picked uniformly and retried while in view. The view
+ * is a small part of a large world, so the first spot almost always
+ * does. rand() may only have 15 bits, which still puts enemies a
+ * few pixels apart in the largest worlds.
  */
-static void __init_enemy(Enemy* enemy, int32_t w, int32_t h) {
-    if (rand() % 2) {
-        __pick_x_first(enemy, w, h);
-    } else {
-        __pick_y_first(enemy, w, h);
+static bool __spawn_in_world(Point2d* position, Camera* camera) {
+    for (int32_t attempt = 0; attempt < SPAWN_ATTEMPTS; attempt++) {
+        *position = (Point2d){
+            (camera->world_width - ENEMY_SIZE) * ((float)rand() / (float)RAND_MAX),
+            (camera->world_height - ENEMY_SIZE) * ((float)rand() / (float)RAND_MAX)
+        };
+        if (!__in_view(position, camera)) return true;
     }
-    enemy->state = 0.0f;
+    return false;
+}
+
+/**
+ * Positions are the enemy's top left corner, so an enemy
+ * up to its size left of or above the view still shows.
+ */
+static bool __in_view(Point2d* position, Camera* camera) {
+    return position->x > camera->position.x - ENEMY_SIZE
+        && position->x < camera->position.x + camera->width
+        && position->y > camera->position.y - ENEMY_SIZE
+        && position->y < camera->position.y + camera->height;
 }
 
 /**
@@ -311,17 +947,17 @@ static void __init_enemy(Enemy* enemy, int32_t w, int32_t h) {
  * vertical position based on that, so they always spawn
  * outside the window.
  */
-static void __pick_x_first(Enemy* enemy, int32_t w, int32_t h) {
+static void __pick_x_first(Point2d* position, int32_t w, int32_t h) {
     // Pick x uniform from [-500,w+500]
-    enemy->position.x = (rand() % (w+1000) - 500);
+    position->x = (rand() % (w+1000) - 500);
 
     // If x is within the window boundary (with a little leeway)
-    if (enemy->position.x >= -ENEMY_SIZE && enemy->position.x <= w + ENEMY_SIZE) {
+    if (position->x >= -ENEMY_SIZE && position->x <= w + ENEMY_SIZE) {
         // Pick y to be outside the window boundary
-        enemy->position.y = rand() % 2 ? -(100 + (rand() % 500)) : h + (100 + (rand() % 500));
+        position->y = rand() % 2 ? -(100 + (rand() % 500)) : h + (100 + (rand() % 500));
     } else {
         // Pick y uniformly from [-500,h+500]
-        enemy->position.y = (rand() % (h+1000) - 500);
+        position->y = (rand() % (h+1000) - 500);
     }
 }
 
@@ -330,55 +966,335 @@ static void __pick_x_first(Enemy* enemy, int32_t w, int32_t h) {
  * horizontal position based on that, so they always spawn
  * outside the window.
  */
-static void __pick_y_first(Enemy* enemy, int32_t w, int32_t h) {
+static void __pick_y_first(Point2d* position, int32_t w, int32_t h) {
     // Pick y uniformly from [-500,h+500]
-    enemy->position.y = (rand() % (h+1000) - 500);
+    position->y = (rand() % (h+1000) - 500);
 
     // If y is within the window boundary (with a little leeway)
-    if (enemy->position.y >= -ENEMY_SIZE && enemy->position.y <= h + ENEMY_SIZE) {
+    if (position->y >= -ENEMY_SIZE && position->y <= h + ENEMY_SIZE) {
         // Pick x to be outside the window boundary
-        enemy->position.x = rand() % 2 ? -(100 + (rand() % 500)) : w + (100 + (rand() % 500));
+        position->x = rand() % 2 ? -(100 + (rand() % 500)) : w + (100 + (rand() % 500));
     } else {
         // Pick y uniformly from [-500,h+500]
-        enemy->position.x = (rand() % (w+1000) - 500);
+        position->x = (rand() % (w+1000) - 500);
     }
 }
 
 /**
- * Update animation state and move the enemy a little closer to the player,
- * also rotate the texture to be facing the player.
+ * Move the enemy a little closer to the player, also turn the enemy to
+ * be facing the way it walks. The facing is the normalized vector we walk
+ * along anyway, so no angle is computed here. The way is read from the
+ * flow field, unless the enemy is outside it or right next to the player,
+ * in which case it walks straight at the player. The field is sampled
+ * at the enemy's center, the middle of the box kept out of walls.
  */
-static void __update_enemy(Enemy* enemy, float dt, Point2d* p_pos) {
-    // Animate
-    enemy->state += dt * ENEMY_ANIMATION_SPEED;
-    if (enemy->state >= 6.0f) enemy->state -= (float)((int)enemy->state);
-
+static float __update_enemy(Point2d* position, Vector2d* facing, FlowField* flow, TileMap* map, float dt, Point2d* p_pos) {
     // Math
-    Vector2d e_to_p = {p_pos->x - enemy->position.x, p_pos->y - enemy->position.y};
-    float norm_factor = carmack_inverse_sqrt(length_squared(&e_to_p));
-    float scale = norm_factor * dt * ENEMY_WALKING_SPEED;
+    Vector2d e_to_p = {p_pos->x - position->x, p_pos->y - position->y};
+    float distance_squared = length_squared(&e_to_p);
+    Point2d center = { position->x + ENEMY_SIZE / 2.0f, position->y + ENEMY_SIZE / 2.0f };
+
+    // Face
+    if (flow == NULL || !flow_direction(flow, &center, facing)) {
+        float norm_factor = carmack_inverse_sqrt(distance_squared);
+        *facing = (Vector2d){ e_to_p.x * norm_factor, e_to_p.y * norm_factor };
+    }
 
     // Move
-    enemy->position = (Point2d){enemy->position.x + e_to_p.x * scale, enemy->position.y + e_to_p.y * scale };
+    float step = dt * ENEMY_WALKING_SPEED;
+    Point2d next = { center.x + facing->x * step, center.y + facing->y * step };
+    if (map != NULL) __slide(map, &center, &next);
+    *position = (Point2d){ next.x - ENEMY_SIZE / 2.0f, next.y - ENEMY_SIZE / 2.0f };
 
-    // Rotate
-    enemy->rotation = sign(-e_to_p.x) * rad_to_deg(fast_acos(e_to_p.y * norm_factor)) + 180;
+    return distance_squared;
 }
 
 /**
- * Draw the enemy. The animation state dictates which part
- * of the spritesheet is drawn.
+ * Found without branching, since neighbouring rows rarely share
+ * a period.
  */
-static void __draw_enemy(SDL_Renderer* renderer, Enemies* enemies, int32_t enemy_index) {
-    Enemy e = enemies->enemies[enemy_index];
-    SDL_Rect rect = { e.position.x, e.position.y,  ENEMY_SIZE, ENEMY_SIZE } ;
-    SDL_RenderCopyEx(
-        renderer,
-        enemies->texture,
-        &enemies->texture_states[(int)e.state],
-        &rect,
-        e.rotation,
-        NULL,
-        SDL_FLIP_NONE
-    );
+static uint64_t __due_rows(Entity* entities, uint8_t* periods, int32_t n, uint32_t frame) {
+    uint64_t due = 0;
+    for (int32_t j = 0; j < n; j++) {
+        uint32_t skip = ((entities[j] & ENTITY_INDEX_MASK) + frame) & (periods[j] - 1u);
+        due |= (uint64_t)(skip == 0) << j;
+    }
+    return due;
+}
+
+/**
+ * The same schedule and movement as __update_enemy, worked in
+ * steps of the packed position instead of decoding it to pixels and
+ * encoding it back. The way to the player is measured in steps from
+ * the player's position in steps, found once, and the step along the
+ * facing is rounded to whole steps and added to the stored position,
+ * so a row is read and written as 8 bytes. Pixels are only needed
+ * for the flow field, walls and the grid, and sliding along a wall
+ * only ever drops an axis of the move. Enemies that die are not
+ * moved, as the floats move them but don't store it.
+ *
+ * Rounding the step puts an enemy within 1/128 pixel on each axis of
+ * where the exact step would, and the floats of either layout round
+ * their way to the player by well under 1/1024 pixel in worlds below
+ * 32768 pixels, so an update moves the layouts at most 10/1024 pixel
+ * on each axis, under 1/72 pixel all told, apart. Walking straight
+ * at the player never pulls two nearby enemies further apart as long
+ * as the step is shorter than the distance left, so those offsets
+ * add up rather than compound, and after n updates the layouts are
+ * at most n/72 pixels apart, which the compact-enemies bench checks.
+ * Flow fields point whole cells one way, so near a cell's edge an
+ * enemy may turn an update earlier or later than the floats. The
+ * heading only turns the sprite, nothing is steered by it, so it is
+ * coarse, see __pack_heading. The grid is checked against the
+ * position stored, which is what end_enemy_update buckets it by.
+ */
+static void __update_packed_rows(Enemies* enemies, Archetype* a, int32_t begin, int32_t end,
+    FlowField* flow, TileMap* map, Point2d* p_pos) {
+    uint32_t frame = enemies->frame;
+    Entity* entities = a->entities;
+    PackedEnemy* packed = (PackedEnemy*)a->columns[COMPONENT_PACKED];
+    uint32_t* updated = (uint32_t*)a->columns[COMPONENT_UPDATED];
+    uint8_t* periods = (uint8_t*)a->columns[COMPONENT_LOD_PERIOD];
+    Point2d player = { (p_pos->x + PACKED_ORIGIN) * PACKED_STEPS, (p_pos->y + PACKED_ORIGIN) * PACKED_STEPS };
+    float contact_squared = CONTACT_DISTANCE * CONTACT_DISTANCE * PACKED_STEPS * PACKED_STEPS;
+
+    for (int32_t block = begin; block < end; block += 64) {
+        int32_t n = end - block < 64 ? end - block : 64;
+        uint64_t due = __due_rows(entities + block, periods + block, n, frame);
+        while (due) {
+            int32_t row = block + __builtin_ctzll(due);
+            due &= due - 1;
+
+            // Math
+            int32_t x = (int32_t)packed[row].cell_x << 16 | packed[row].x;
+            int32_t y = (int32_t)packed[row].cell_y << 16 | packed[row].y;
+            Vector2d e_to_p = { player.x - (float)x, player.y - (float)y };
+            float steps_squared = e_to_p.x * e_to_p.x + e_to_p.y * e_to_p.y;
+            if (steps_squared < contact_squared) {
+                enemies->dying[SDL_AtomicAdd(&enemies->dying_count, 1)] = entities[row];
+                continue;
+            }
+            Point2d from = { __from_fixed(x), __from_fixed(y) };
+            Point2d center = { from.x + ENEMY_SIZE / 2.0f, from.y + ENEMY_SIZE / 2.0f };
+
+            // Face
+            Vector2d facing;
+            if (flow == NULL || !flow_direction(flow, &center, &facing)) {
+                float norm_factor = carmack_inverse_sqrt(steps_squared);
+                facing = (Vector2d){ e_to_p.x * norm_factor, e_to_p.y * norm_factor };
+            }
+
+            // Move
+            float step = enemies->elapsed[frame - updated[row]] * ENEMY_WALKING_SPEED * PACKED_STEPS;
+            int32_t dx = __round_steps(facing.x * step), dy = __round_steps(facing.y * step);
+            if (map != NULL) {
+                Point2d next = { center.x + dx / PACKED_STEPS, center.y + dy / PACKED_STEPS };
+                __slide(map, &center, &next);
+                if (next.x == center.x) dx = 0;
+                if (next.y == center.y) dy = 0;
+            }
+            int32_t to_x = x + dx, to_y = y + dy;
+            to_x = to_x < 0 ? 0 : to_x > PACKED_MAX ? PACKED_MAX : to_x;
+            to_y = to_y < 0 ? 0 : to_y > PACKED_MAX ? PACKED_MAX : to_y;
+            __pack_steps(&packed[row], to_x, to_y);
+            packed[row].heading = __pack_heading(&facing);
+            updated[row] = frame;
+
+            if (enemies->grid) {
+                Point2d to = { __from_fixed(to_x), __from_fixed(to_y) };
+                if (!is_same_cell(enemies->grid, &from, &to)) {
+                    enemies->moved[SDL_AtomicAdd(&enemies->moved_count, 1)] = (EnemyMove){ entities[row], from };
+                }
+            }
+            float distance_squared = steps_squared / (PACKED_STEPS * PACKED_STEPS);
+            periods[row] = enemies->lod ? __lod_period(enemies, distance_squared) : 1;
+        }
+    }
+}
+
+/**
+ * Rounds to the nearest step, adding a half before truncating
+ * since the steps are never negative. Positions past either end,
+ * more than a cell outside the world or in worlds wider than 255
+ * cells, are held at the end.
+ */
+static inline int32_t __to_fixed(float coordinate) {
+    float steps = (coordinate + PACKED_ORIGIN) * PACKED_STEPS + 0.5f;
+    if (steps < 0.0f) return 0;
+    if (steps > (float)PACKED_MAX) return PACKED_MAX;
+    return (int32_t)steps;
+}
+
+/**
+ * Every 24 bit step count is exact in a float, and so is dividing
+ * by a power of two, so only moving back to the origin rounds.
+ * Past 131072 pixels a float is no finer than a step anyway.
+ */
+static inline float __from_fixed(int32_t steps) {
+    return steps / PACKED_STEPS - PACKED_ORIGIN;
+}
+
+/**
+ * Adding a half with the distance's sign before truncating rounds
+ * either way alike, so enemies walking left and right step the same.
+ */
+static inline int32_t __round_steps(float steps) {
+    return (int32_t)(steps + __builtin_copysignf(0.5f, steps));
+}
+
+/**
+ * The cell is the high 8 bits of the fixed point coordinate, the
+ * offset the low 16.
+ */
+static inline void __pack_steps(PackedEnemy* packed, int32_t x, int32_t y) {
+    packed->x = (uint16_t)(x & 0xFFFF);
+    packed->y = (uint16_t)(y & 0xFFFF);
+    packed->cell_x = (uint8_t)(x >> 16);
+    packed->cell_y = (uint8_t)(y >> 16);
+}
+
+/**
+ * Each coordinate is rounded to the nearest step on its own.
+ */
+static inline void __pack_position(PackedEnemy* packed, Point2d* position) {
+    __pack_steps(packed, __to_fixed(position->x), __to_fixed(position->y));
+}
+
+/**
+ * The cell and offset are put back together before scaling.
+ */
+static inline Point2d __unpack_position(const PackedEnemy* packed) {
+    int32_t x = (int32_t)packed->cell_x << 16 | packed->x;
+    int32_t y = (int32_t)packed->cell_y << 16 | packed->y;
+    return (Point2d){ __from_fixed(x), __from_fixed(y) };
+}
+
+/**
+ * The heading is a diamond angle rather than a true one, which
+ * takes no arctangent: the facing is scaled onto the diamond
+ * |x| + |y| = 1, whose y runs from -1 to 1 down the right half,
+ * and is folded on to 2 and -2 around the left. The steps are
+ * widest at the diagonals, 1.8 degrees, so the heading is within
+ * 0.9 degrees of the facing. A turn is added so the steps are
+ * positive before rounding, and the cast to 8 bits wraps a whole
+ * turn back to 0. Enemies face every which way, so the halves are
+ * picked by arithmetic rather than branches, which would mispredict
+ * half the time. A zero facing, which flow fields give where the
+ * player can't be reached, heads east like its angle of 0.
+ */
+static inline uint8_t __pack_heading(Vector2d* facing) {
+    float sum = __builtin_fabsf(facing->x) + __builtin_fabsf(facing->y);
+    if (sum == 0.0f) return 0;
+
+    float t = facing->y / sum;
+    float d = t + (float)(facing->x < 0) * (__builtin_copysignf(2.0f, facing->y) - 2.0f * t);
+    return (uint8_t)(int32_t)(d * HEADING_STEPS + 4.0f * HEADING_STEPS + 0.5f);
+}
+
+/**
+ * Enemies are kept out of walls by the box around their collider,
+ * like the player, so neither sinks into a wall further than the
+ * other. Each axis of the move is tested on the box's leading edge,
+ * and only once that edge crosses into a new row or column of
+ * tiles, so the common case costs two compares. A step is far
+ * shorter than a tile, so it crosses at most one. The vertical
+ * edge is tested where the horizontal move ended, so cutting a
+ * corner diagonally is caught too. An enemy whose box is already
+ * on a wall, say one that spawned there, walks through walls until
+ * it is clear of them, and that is only looked up when it bumps
+ * into one.
+ */
+static void __slide(TileMap* map, Point2d* from, Point2d* to) {
+    float r = COLLISION_RADIUS;
+    float dx = to->x > from->x ? r : -r, dy = to->y > from->y ? r : -r;
+    bool block_x = __box_tile(map, to->x + dx) != __box_tile(map, from->x + dx)
+        && __hits_wall(map, to->x + dx, from->y - r, to->x + dx, from->y + r);
+    bool block_y = __box_tile(map, to->y + dy) != __box_tile(map, from->y + dy)
+        && __hits_wall(map, to->x - r, to->y + dy, to->x + r, to->y + dy);
+    if (!block_x && !block_y) return;
+    if (__hits_wall(map, from->x - r, from->y - r, from->x + r, from->y + r)) return;
+
+    if (block_x) {
+        to->x = from->x;
+        block_y = __box_tile(map, to->y + dy) != __box_tile(map, from->y + dy)
+            && __hits_wall(map, to->x - r, to->y + dy, to->x + r, to->y + dy);
+    }
+    if (block_y) to->y = from->y;
+}
+
+/**
+ * Every tile is tested, rather than the corners, since the box is
+ * wider than a tile and a wall one tile thick could fit between
+ * them. That is at most 3 tiles for an edge, 9 for the box, with
+ * 32 pixel tiles.
+ */
+static bool __hits_wall(TileMap* map, float x0, float y0, float x1, float y1) {
+    int32_t col1 = __box_tile(map, x1), row1 = __box_tile(map, y1);
+    for (int32_t row = __box_tile(map, y0); row <= row1; row++) {
+        for (int32_t col = __box_tile(map, x0); col <= col1; col++) {
+            if (is_wall(map, col, row)) return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Truncating rounds towards zero, so anything left of or above
+ * the origin is put in the out of bounds tile -1 first, which
+ * is_wall rules out.
+ */
+static inline int32_t __box_tile(TileMap* map, float edge) {
+    return edge < 0 ? -1 : (int32_t)(edge * map->inverse_tile_size);
+}
+
+/**
+ * Tiers are multiples of the near distance. Comparing squared
+ * distances avoids a square root, so the multiples are squared.
+ * Neighbouring enemies rarely share a tier, so the comparisons
+ * are summed rather than branched on.
+ */
+static uint8_t __lod_period(Enemies* enemies, float distance_squared) {
+    int32_t tier = (distance_squared >= enemies->lod_near_squared)
+        + (distance_squared >= 4.0f * enemies->lod_near_squared)
+        + (distance_squared >= 9.0f * enemies->lod_near_squared);
+    return (uint8_t)(1u << tier);
+}
+
+/**
+ * The animation clock plus the enemy's phase dictates which part
+ * of the spritesheet is drawn, both are below the animation length
+ * so one subtraction wraps their sum. The angle is only needed for
+ * enemies that survived culling, and is worked out here, off the
+ * thread that draws, as is decoding a packed enemy. The sprite
+ * faces north with no rotation, hence the quarter turn.
+ */
+static void __capture_enemy(Enemies* enemies, int32_t row, Snapshot* snapshot) {
+    Archetype* a = enemies->archetype;
+    Vector2d facing = enemy_facing(a, row);
+    float phase = a->columns[COMPONENT_PACKED]
+        ? ((PackedEnemy*)a->columns[COMPONENT_PACKED])[row].phase * PHASE_FRAMES
+        : ((float*)a->columns[COMPONENT_PHASE])[row];
+
+    float state = enemies->animation_clock + phase;
+    if (state >= ENEMY_ANIMATION_LENGTH) state -= ENEMY_ANIMATION_LENGTH;
+    *add_enemy_sprite(snapshot) = (Sprite){
+        enemy_position(a, row),
+        rad_to_deg(fast_atan2(facing.y, facing.x)) + 90,
+        (int32_t)state
+    };
+}
+
+/**
+ * Can't subtract since the difference may not fit an int.
+ */
+static int __compare_entities(const void* a, const void* b) {
+    Entity x = *(const Entity*)a, y = *(const Entity*)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Entities are unique, so moves never tie.
+ */
+static int __compare_moves(const void* a, const void* b) {
+    return __compare_entities(&((const EnemyMove*)a)->entity, &((const EnemyMove*)b)->entity);
 }
\ No newline at end of file
@@ -10,27 +10,93 @@
 #include <SDL2/SDL_image.h>
 
 #include "gmath.h"
+#include "flowfield.h"
+#include "tilemap.h"
+#include "camera.h"
+#include "spatialgrid.h"
+#include "ecs.h"
+#include "snapshot.h"
+#include "render.h"
+#include "atlas.h"
+
+// How many frames of elapsed time are kept, must exceed the longest update period
+#define ENEMY_LOD_HISTORY 16
+// The components of an enemy: where it is, where it faces, its offset into the
+// animation, the frame it was last updated and how many frames apart it is updated
+#define ENEMY_COMPONENTS ((1u << COMPONENT_POSITION) | (1u << COMPONENT_FACING) | (1u << COMPONENT_PHASE) \
+    | (1u << COMPONENT_UPDATED) | (1u << COMPONENT_LOD_PERIOD))
+// The components of a compact enemy, its position, facing and phase packed into one
+#define ENEMY_PACKED_COMPONENTS ((1u << COMPONENT_PACKED) | (1u << COMPONENT_UPDATED) | (1u << COMPONENT_LOD_PERIOD))
 
 /**
  * Struct:
- *  Enemy
+ *  EnemyWave
  *
  * Purpose:
- *  Holds on to all resources needed for a single enemy.
+ *  An entry of the spawn schedule.
  *
  * Fields:
- *  - position:
- *      The 2d position of the enemy.
- *  - rotation:
- *      The direction the enemy is facing.
- *  - state:
- *      Which texture to render.
+ *  - delay:
+ *      Milliseconds after the previous wave, or the start, that the wave spawns.
+ *  - fraction:
+ *      The share of max_enemies the wave spawns, as far as there is room.
  */
 typedef struct {
-    Point2d     position;
-    float       rotation;
-    float       state;
-} Enemy;
+    float       delay;
+    float       fraction;
+} EnemyWave;
+
+/**
+ * Struct:
+ *  PackedEnemy
+ *
+ * Purpose:
+ *  An enemy's position, facing and phase in 8 bytes rather than 20.
+ *  Each coordinate is a 24 bit fixed point number of 1/64 pixels,
+ *  counted from one cell left of and above the world, split into
+ *  the cell of 1024 pixels it is in and the offset within it.
+ *
+ * Fields:
+ *  - x:
+ *      The offset within the cell, left to right.
+ *  - y:
+ *      The offset within the cell, top to bottom.
+ *  - cell_x:
+ *      The cell's column.
+ *  - cell_y:
+ *      The cell's row.
+ *  - heading:
+ *      The direction the enemy faces, in 256ths of a turn, as a
+ *      diamond angle.
+ *  - phase:
+ *      The offset into the animation, in 256ths of its length.
+ */
+typedef struct {
+    uint16_t    x;
+    uint16_t    y;
+    uint8_t     cell_x;
+    uint8_t     cell_y;
+    uint8_t     heading;
+    uint8_t     phase;
+} PackedEnemy;
+
+/**
+ * Struct:
+ *  EnemyMove
+ *
+ * Purpose:
+ *  An enemy that left its grid cell during an update.
+ *
+ * Fields:
+ *  - entity:
+ *      The enemy.
+ *  - from:
+ *      Where it was before the update, which it is bucketed by.
+ */
+typedef struct {
+    Entity      entity;
+    Point2d     from;
+} EnemyMove;
 
 /**
  * Struct:
@@ -42,24 +108,80 @@ typedef struct {
  *
  * Fields:
  *  - texture:
- *      A structure that contains an efficient, driver-specific
- *      representation of pixel data for the enemy spritesheet.
+ *      The atlas the enemies are drawn from, not owned.
  *  - texture_states:
- *      The positions of the enemy textures within the
- *      spritesheet in order.
- *  - enemies:
- *      An array of enemies.
+ *      The positions of the enemy's animation frames within the
+ *      atlas in order.
+ *  - world:
+ *      The entities, shared with the player.
+ *  - archetype:
+ *      The living enemies, one row each. Rows move when enemies
+ *      die, entities do not.
+ *  - components:
+ *      The components of every enemy, ENEMY_COMPONENTS, or
+ *      ENEMY_PACKED_COMPONENTS when they are compact.
  *  - max_enemies:
- *      The element count of the enemies array.
+ *      The most enemies alive at once, all allocated up front.
+ *  - dying:
+ *      The enemies that reached the player during an update, killed
+ *      once it is done so no row moves while the rows are walked.
+ *  - dying_count:
+ *      The number of dying enemies, added to by every thread updating rows.
+ *  - moved:
+ *      The enemies that left their grid cell during an update, moved
+ *      in the grid once it is done, as threads cannot share the grid.
+ *  - moved_count:
+ *      The number of moved enemies, added to like dying_count.
+ *  - waves:
+ *      The spawn schedule, NULL if nothing spawns on its own. The
+ *      last wave repeats for as long as its delay is positive.
+ *  - wave_count:
+ *      The number of waves in the schedule.
+ *  - wave:
+ *      The index of the next wave to spawn.
+ *  - wave_timer:
+ *      Milliseconds until the next wave spawns.
  *  - collision_radius:
  *      The width (or height) of the enemy, divided by 2.
+ *  - animation_clock:
+ *      How far all enemies are into the animation, in textures,
+ *      before their own phase is added.
+ *  - lod:
+ *      Are enemies far from the player updated less often?
+ *  - lod_near_squared:
+ *      The squared distance from the player within which enemies
+ *      are updated every frame.
+ *  - frame:
+ *      The number of updates so far.
+ *  - elapsed:
+ *      The time passed over the last n frames, indexed by n.
+ *  - grid:
+ *      The enemies bucketed by position, with the index of each
+ *      entity as its item, so only those near the camera are looked
+ *      at when drawing. NULL to look at all of them.
  */
 typedef struct {
     SDL_Texture*    texture;
-    SDL_Rect        texture_states[6];
-    Enemy*          enemies;
+    SDL_Rect        texture_states[ENEMY_FRAMES];
+    World*          world;
+    Archetype*      archetype;
+    ComponentMask   components;
     int32_t         max_enemies;
+    Entity*         dying;
+    SDL_atomic_t    dying_count;
+    EnemyMove*      moved;
+    SDL_atomic_t    moved_count;
+    const EnemyWave* waves;
+    int32_t         wave_count;
+    int32_t         wave;
+    float           wave_timer;
     float           collision_radius;
+    float           animation_clock;
+    bool            lod;
+    float           lod_near_squared;
+    uint32_t        frame;
+    float           elapsed[ENEMY_LOD_HISTORY];
+    SpatialGrid*    grid;
 } Enemies;
 
 /**
@@ -67,31 +189,235 @@ typedef struct {
  *  init_enemies
  *
  * Purpose:
+ *  Create room for the enemies, none of them alive until spawned.
  *
  * Parameters:
- *  - renderer:
- *      A structure that contains a rendering state.
+ *  - atlas:
+ *      The sprites, the enemy's frames among them.
  *  - max_enemies:
+ *      The most enemies alive at once.
+ *  - camera:
+ *      The camera, which holds the world's size.
+ *  - world:
+ *      The entities, with room for max_enemies more.
+ *  - compact:
+ *      Are enemies kept as PackedEnemy rather than in floats?
+ *
+ * Returns:
+ *  Enemies object if successful, NULL otherwise.
+ */
+Enemies* init_enemies(Atlas* atlas, int32_t max_enemies, Camera* camera, World* world, bool compact);
+
+/**
+ * Function:
+ *  init_enemy_lod
+ *
+ * Purpose:
+ *  Set up the level of detail schedule for a window size,
+ *  with every enemy due for an update the next frame.
+ *
+ * Parameters:
+ *  - enemies:
+ *      The Enemies object.
  *  - w:
  *      The window's width.
  *  - h:
  *      The window's height.
  *
  * Returns:
- *  Enemies object if successful, NULL otherwise.
+ *  Nothing.
+ */
+void init_enemy_lod(Enemies* enemies, int32_t w, int32_t h);
+
+/**
+ * Function:
+ *  set_enemy_waves
+ *
+ * Purpose:
+ *  Start a spawn schedule from its first wave.
+ *
+ * Parameters:
+ *  - enemies:
+ *      The Enemies object.
+ *  - waves:
+ *      The waves in order, which must outlive the enemies.
+ *  - count:
+ *      The number of waves.
+ *
+ * Returns:
+ *  Nothing.
+ */
+void set_enemy_waves(Enemies* enemies, const EnemyWave* waves, int32_t count);
+
+/**
+ * Function:
+ *  spawn_enemy_waves
+ *
+ * Purpose:
+ *  Spawn the waves that are due by the schedule.
+ *
+ * Parameters:
+ *  - enemies:
+ *      The Enemies object.
+ *  - camera:
+ *      The camera, which enemies spawn out of view of.
+ *  - dt:
+ *      Delta time.
+ *
+ * Returns:
+ *  Nothing.
+ */
+void spawn_enemy_waves(Enemies* enemies, Camera* camera, float dt);
+
+/**
+ * Function:
+ *  spawn_enemies
+ *
+ * Purpose:
+ *  Create enemies at random spots in the world, outside the camera's view.
+ *
+ * Parameters:
+ *  - enemies:
+ *      The Enemies object.
+ *  - camera:
+ *      The camera, which enemies spawn out of view of.
+ *  - count:
+ *      The number of enemies to spawn.
+ *
+ * Returns:
+ *  The number spawned, fewer than asked if max_enemies are alive.
+ */
+int32_t spawn_enemies(Enemies* enemies, Camera* camera, int32_t count);
+
+/**
+ * Function:
+ *  kill_enemy
+ *
+ * Purpose:
+ *  Destroy an enemy, if it is alive, making room for a later spawn.
+ *
+ * Parameters:
+ *  - enemies:
+ *      The Enemies object.
+ *  - enemy:
+ *      The enemy's entity.
+ *
+ * Returns:
+ *  Nothing.
+ */
+void kill_enemy(Enemies* enemies, Entity enemy);
+
+/**
+ * Function:
+ *  is_enemy_alive
+ *
+ * Purpose:
+ *  Check if an entity is a living enemy.
+ *
+ * Parameters:
+ *  - enemies:
+ *      The Enemies object.
+ *  - enemy:
+ *      The entity.
+ *
+ * Returns:
+ *  true if the enemy is alive, false otherwise.
+ */
+bool is_enemy_alive(Enemies* enemies, Entity enemy);
+
+/**
+ * Function:
+ *  enemy_position
+ *
+ * Purpose:
+ *  Find where an enemy is, whichever way its archetype keeps it.
+ *
+ * Parameters:
+ *  - archetype:
+ *      An archetype with the enemy or packed enemy components.
+ *  - row:
+ *      The enemy's row.
+ *
+ * Returns:
+ *  The enemy's position.
+ */
+Point2d enemy_position(Archetype* archetype, int32_t row);
+
+/**
+ * Function:
+ *  enemy_facing
+ *
+ * Purpose:
+ *  Find where an enemy faces, whichever way its archetype keeps it.
+ *
+ * Parameters:
+ *  - archetype:
+ *      An archetype with the enemy or packed enemy components.
+ *  - row:
+ *      The enemy's row.
+ *
+ * Returns:
+ *  The enemy's facing, as a unit vector.
+ */
+Vector2d enemy_facing(Archetype* archetype, int32_t row);
+
+/**
+ * Function:
+ *  set_enemy_position
+ *
+ * Purpose:
+ *  Move an enemy, whichever way its archetype keeps it, without
+ *  moving it in the grid.
+ *
+ * Parameters:
+ *  - archetype:
+ *      An archetype with the enemy or packed enemy components.
+ *  - row:
+ *      The enemy's row.
+ *  - position:
+ *      The enemy's new position.
+ *
+ * Returns:
+ *  Nothing.
  */
-Enemies* init_enemies(SDL_Renderer* renderer, int32_t max_enemies, int32_t w, int32_t h);
+void set_enemy_position(Archetype* archetype, int32_t row, Point2d* position);
+
+/**
+ * Function:
+ *  init_enemy_grid
+ *
+ * Purpose:
+ *  Bucket the living enemies by their current positions, which
+ *  update_enemies, spawns and kills keep up to date from then on.
+ *
+ * Parameters:
+ *  - enemies:
+ *      The Enemies object, without a grid.
+ *  - world_w:
+ *      The width of the world.
+ *  - world_h:
+ *      The height of the world.
+ *
+ * Returns:
+ *  Nothing.
+ */
+void init_enemy_grid(Enemies* enemies, float world_w, float world_h);
 
 /**
  * Function:
  *  update_enemies
  *
  * Purpose:
- *  Update the enemies within the game.
+ *  Update the living enemies within the game. Enemies that
+ *  reach the player are spent and die.
  *
  * Parameters:
  *  - enemies:
  *      The Enemies object to update.
+ *  - flow:
+ *      The flow field leading to the player, NULL to walk straight at the player.
+ *  - map:
+ *      The map with walls to slide along, NULL to walk through everything.
  *  - dt:
  *      Delta time.
  *  - p_pos:
@@ -100,29 +426,114 @@ Enemies* init_enemies(SDL_Renderer* renderer, int32_t max_enemies, int32_t w, in
  * Returns:
  *  Nothing.
  */
-void update_enemies(Enemies* enemies, float dt, Point2d* p_pos);
+void update_enemies(Enemies* enemies, FlowField* flow, TileMap* map, float dt, Point2d* p_pos);
+
+/**
+ * Function:
+ *  begin_enemy_update
+ *
+ * Purpose:
+ *  Advance the enemies' clocks, the part of update_enemies done
+ *  once per frame before any rows are updated.
+ *
+ * Parameters:
+ *  - enemies:
+ *      The Enemies object to update.
+ *  - dt:
+ *      Delta time.
+ *
+ * Returns:
+ *  Nothing.
+ */
+void begin_enemy_update(Enemies* enemies, float dt);
+
+/**
+ * Function:
+ *  update_enemy_rows
+ *
+ * Purpose:
+ *  Update a range of an archetype's rows, the part of update_enemies
+ *  that can be split up. Threads may update disjoint ranges at once,
+ *  between begin_enemy_update and end_enemy_update.
+ *
+ * Parameters:
+ *  - enemies:
+ *      The Enemies object to update.
+ *  - archetype:
+ *      An archetype with the enemy or packed enemy components.
+ *  - begin:
+ *      The first row.
+ *  - end:
+ *      One past the last row.
+ *  - flow:
+ *      The flow field leading to the player, NULL to walk straight at the player.
+ *  - map:
+ *      The map with walls to slide along, NULL to walk through everything.
+ *  - p_pos:
+ *      The position of the player.
+ *
+ * Returns:
+ *  Nothing.
+ */
+void update_enemy_rows(Enemies* enemies, Archetype* archetype, int32_t begin, int32_t end,
+    FlowField* flow, TileMap* map, Point2d* p_pos);
+
+/**
+ * Function:
+ *  end_enemy_update
+ *
+ * Purpose:
+ *  Move the enemies that changed cells in the grid and kill those
+ *  that reached the player, the part of update_enemies done once
+ *  all rows are updated.
+ *
+ * Parameters:
+ *  - enemies:
+ *      The Enemies object to update.
+ *
+ * Returns:
+ *  Nothing.
+ */
+void end_enemy_update(Enemies* enemies);
+
+/**
+ * Function:
+ *  capture_enemies
+ *
+ * Purpose:
+ *  Add the enemies in view of a snapshot's camera to it. This
+ *  should always be called after update_enemies.
+ *
+ * Parameters:
+ *  - enemies:
+ *      The Enemies object.
+ *  - snapshot:
+ *      The Snapshot object, with the camera set.
+ *
+ * Returns:
+ *  Nothing.
+ */
+void capture_enemies(Enemies* enemies, Snapshot* snapshot);
 
 /**
  * Function:
  *  draw_enemies
  *
  * Purpose:
- *  Draw the enemies. This should always be called after update_enemies.
+ *  Draw the enemies of a snapshot.
  *
  * Parameters:
- *  - renderer:
- *      A structure that contains a rendering state.
+ *  - commands:
+ *      The RenderBuffer the enemies are drawn into.
  *  - enemies:
- *      The Enemies object to draw.
- *  - w:
- *      The window's width.
- *  - h:
- *      The window's height.
+ *      The Enemies object, for its texture.
+ *  - snapshot:
+ *      The Snapshot object, which the enemies were captured into.
  *
  * Returns:
  *  Nothing.
  */
-void draw_enemies(SDL_Renderer* renderer, Enemies* enemies, int32_t w, int32_t h);
+void draw_enemies(RenderBuffer* commands, Enemies* enemies, Snapshot* snapshot);
 
 /**
  * Function:
@@ -9,6 +9,11 @@
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
 
+#include "tilemap.h"
+#include "camera.h"
+#include "render.h"
+#include "atlas.h"
+
 /**
  * Struct:
  *  Floor
@@ -18,15 +23,17 @@
  * 
  * Fields:
  *  - texture:
- *      A structure that contains an efficient, driver-specific 
- *      representation of pixel data for the floor.
+ *      The atlas the floor is drawn from, not owned.
+ *  - sprite:
+ *      The floor tile's part of the atlas.
  *  - texture_width:
- *      The width of the player texture in pixels.
+ *      The width of the floor tile in pixels.
  *  - texture_height:
- *      The height of the player texture in pixels.
+ *      The height of the floor tile in pixels.
  */
 typedef struct {
     SDL_Texture*    texture;
+    SDL_Rect        sprite;
     int32_t         texture_width;
     int32_t         texture_height;
 } Floor;
@@ -39,35 +46,36 @@ typedef struct {
  *  Create and initialize a Floor object.
  * 
  * Parameters:
- *  - renderer:
- *      A structure that contains a rendering state.
+ *  - atlas:
+ *      The sprites, the floor tile among them.
  * 
  * Returns:
  *  The Floor object.
  */
-Floor* init_floor(SDL_Renderer* renderer);
+Floor* init_floor(Atlas* atlas);
 
 /**
  * Function:
  *  draw_floor
  * 
  * Purpose:
- *  Fills the entire window with floor tiles.
+ *  Fills the entire window with floor tiles, then
+ *  draws the map's walls within the view over them.
  * 
  * Parameters:
- *  - renderer:
- *      A structure that contains a rendering state.
+ *  - commands:
+ *      The RenderBuffer the floor is drawn into.
  *  - floor:
  *      The floor object to draw.
- *  - w:
- *      The window's width.
- *  - h:
- *      The window's height.
+ *  - map:
+ *      The map whose walls to draw.
+ *  - camera:
+ *      The part of the world to draw.
  * 
  * Returns:
  *  Nothing.
  */
-void draw_floor(SDL_Renderer* renderer, Floor* floor, int32_t w, int32_t h);
+void draw_floor(RenderBuffer* commands, Floor* floor, TileMap* map, Camera* camera);
 
 /**
  * Function:
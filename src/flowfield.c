@@ -0,0 +1,374 @@
+#include "flowfield.h"
+
+// Cost of stepping to a horizontal or vertical neighbour
+static const int32_t STRAIGHT_COST = 5;
+// Cost of stepping to a diagonal neighbour, about sqrt(2) times the straight cost
+static const int32_t DIAGONAL_COST = 7;
+// Cost of cells the wave never reached
+static const int32_t UNREACHED = INT32_MAX;
+// One over the square root of two
+static const float DIAGONAL = 0.70710678118654752f;
+// Column offsets of the neighbours, straight ones first
+static const int32_t NEIGHBOUR_COLS[8] = { 1, -1, 0, 0, 1, 1, -1, -1 };
+// Row offsets of the neighbours, straight ones first
+static const int32_t NEIGHBOUR_ROWS[8] = { 0, 0, 1, -1, 1, -1, 1, -1 };
+
+/**
+ * Function:
+ *  __cell_of
+ *
+ * Purpose:
+ *  Find the cell a position is in.
+ *
+ * Parameters:
+ *  - field:
+ *      The FlowField object.
+ *  - position:
+ *      The position.
+ *  - col:
+ *      Set to the cell's column.
+ *  - row:
+ *      Set to the cell's row.
+ *
+ * Returns:
+ *  true if the position is within the grid, false otherwise.
+ */
+static bool __cell_of(FlowField* field, Point2d* position, int32_t* col, int32_t* row);
+
+/**
+ * Function:
+ *  __can_step
+ *
+ * Purpose:
+ *  Check if a neighbour can be walked to from a cell.
+ *
+ * Parameters:
+ *  - field:
+ *      The FlowField object.
+ *  - col:
+ *      The cell's column.
+ *  - row:
+ *      The cell's row.
+ *  - k:
+ *      The index of the neighbour in NEIGHBOUR_COLS and NEIGHBOUR_ROWS.
+ *
+ * Returns:
+ *  true if the neighbour is within the grid and can be walked to, false otherwise.
+ */
+static bool __can_step(FlowField* field, int32_t col, int32_t row, int32_t k);
+
+/**
+ * Function:
+ *  __spread_wave
+ *
+ * Purpose:
+ *  Compute the cost of walking to the target from every cell.
+ *
+ * Parameters:
+ *  - field:
+ *      The FlowField object.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __spread_wave(FlowField* field);
+
+/**
+ * Function:
+ *  __trace_visibility
+ *
+ * Purpose:
+ *  Find the cells with a straight path to the target.
+ *
+ * Parameters:
+ *  - field:
+ *      The FlowField object.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __trace_visibility(FlowField* field);
+
+/**
+ * Function:
+ *  __is_visible
+ *
+ * Purpose:
+ *  Decide if a cell has a straight path to the target, given
+ *  that all cells closer to the target have been decided.
+ *
+ * Parameters:
+ *  - field:
+ *      The FlowField object.
+ *  - col:
+ *      The cell's column.
+ *  - row:
+ *      The cell's row.
+ *
+ * Returns:
+ *  1 if the cell is visible from the target, 0 otherwise.
+ */
+static uint8_t __is_visible(FlowField* field, int32_t col, int32_t row);
+
+/**
+ * Function:
+ *  __point_directions
+ *
+ * Purpose:
+ *  Set the direction of every cell from the costs and visibility.
+ *
+ * Parameters:
+ *  - field:
+ *      The FlowField object.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __point_directions(FlowField* field);
+
+/**
+ * The grid is rounded up to whole cells, so it covers at
+ * least the rectangle given.
+ */
+FlowField* init_flow_field(Point2d origin, float w, float h, float cell_size) {
+    FlowField* field = (FlowField*)malloc(sizeof(FlowField));
+    field->cols = (int32_t)(w / cell_size) + 1;
+    field->rows = (int32_t)(h / cell_size) + 1;
+    field->cell_size = cell_size;
+    field->inverse_cell_size = 1.0f / cell_size;
+    field->origin = origin;
+
+    int32_t n = field->cols * field->rows;
+    field->blocked = (uint8_t*)calloc(n, sizeof(uint8_t));
+    field->cost = (int32_t*)malloc(sizeof(int32_t) * n);
+    field->visible = (uint8_t*)malloc(sizeof(uint8_t) * n);
+    field->directions = (Vector2d*)malloc(sizeof(Vector2d) * n);
+    field->queue = (int32_t*)malloc(sizeof(int32_t) * n);
+    field->queued = (uint8_t*)malloc(sizeof(uint8_t) * n);
+    field->target_col = -1;
+    field->target_row = -1;
+    field->dirty = true;
+
+    return field;
+}
+
+/**
+ * Cells outside the grid are ignored.
+ */
+void set_flow_field_blocked(FlowField* field, int32_t col, int32_t row, bool blocked) {
+    if (col < 0 || col >= field->cols || row < 0 || row >= field->rows) return;
+    field->blocked[row * field->cols + col] = blocked;
+    field->dirty = true;
+}
+
+/**
+ * Blocked cells are relative to the grid, so they no longer
+ * match the world once it moves and are all cleared.
+ */
+void set_flow_field_origin(FlowField* field, Point2d origin) {
+    field->origin = origin;
+    memset(field->blocked, 0, (size_t)field->cols * field->rows);
+    field->dirty = true;
+}
+
+/**
+ * A target outside the grid is moved to the closest cell. The
+ * work only depends on the number of cells and is skipped as
+ * long as the target stays within the same cell.
+ */
+void update_flow_field(FlowField* field, Point2d* target) {
+    int32_t col, row;
+    __cell_of(field, target, &col, &row);
+    col = col < 0 ? 0 : (col >= field->cols ? field->cols - 1 : col);
+    row = row < 0 ? 0 : (row >= field->rows ? field->rows - 1 : row);
+
+    if (!field->dirty && col == field->target_col && row == field->target_row) return;
+
+    field->target_col = col;
+    field->target_row = row;
+    field->dirty = false;
+
+    __spread_wave(field);
+    __trace_visibility(field);
+    __point_directions(field);
+}
+
+/**
+ * Within one cell of the target the cell is too coarse to aim with.
+ */
+bool flow_direction(FlowField* field, Point2d* position, Vector2d* direction) {
+    int32_t col, row;
+    if (!__cell_of(field, position, &col, &row)) return false;
+    if (abs(col - field->target_col) <= 1 && abs(row - field->target_row) <= 1) return false;
+
+    *direction = field->directions[row * field->cols + col];
+    return true;
+}
+
+/**
+ * Release all arrays and then the field.
+ */
+void destroy_flow_field(FlowField* field) {
+    free(field->blocked);
+    free(field->cost);
+    free(field->visible);
+    free(field->directions);
+    free(field->queue);
+    free(field->queued);
+    free(field);
+}
+
+/**
+ * The column and row are set even when outside the grid,
+ * so callers can clamp them.
+ */
+static bool __cell_of(FlowField* field, Point2d* position, int32_t* col, int32_t* row) {
+    float x = (position->x - field->origin.x) * field->inverse_cell_size;
+    float y = (position->y - field->origin.y) * field->inverse_cell_size;
+    *col = x < 0 ? -1 : (int32_t)x;
+    *row = y < 0 ? -1 : (int32_t)y;
+    return *col >= 0 && *col < field->cols && *row >= 0 && *row < field->rows;
+}
+
+/**
+ * A diagonal step is only allowed when both straight neighbours
+ * next to it are open, so paths never cut the corner of a wall.
+ */
+static bool __can_step(FlowField* field, int32_t col, int32_t row, int32_t k) {
+    int32_t c = col + NEIGHBOUR_COLS[k], r = row + NEIGHBOUR_ROWS[k];
+    if (c < 0 || c >= field->cols || r < 0 || r >= field->rows) return false;
+    if (field->blocked[r * field->cols + c]) return false;
+    if (k < 4) return true;
+    return !field->blocked[row * field->cols + c] && !field->blocked[r * field->cols + col];
+}
+
+/**
+ * The wave starts at the target and passes on to each neighbour
+ * whose cost it lowers. With only two step costs, cells are rarely
+ * lowered more than once, so this stays close to a breadth first
+ * search. A cell is never in the queue twice, so a queue the size
+ * of the grid is enough when used as a ring.
+ */
+static void __spread_wave(FlowField* field) {
+    int32_t n = field->cols * field->rows;
+    for (int32_t i = 0; i < n; i++) {
+        field->cost[i] = UNREACHED;
+        field->queued[i] = 0;
+    }
+
+    int32_t start = field->target_row * field->cols + field->target_col;
+    int32_t head = 0, tail = 0, count = 0;
+    field->cost[start] = 0;
+    field->queue[tail++] = start;
+    field->queued[start] = 1;
+    count++;
+
+    while (count > 0) {
+        int32_t cell = field->queue[head];
+        head = head + 1 == n ? 0 : head + 1;
+        count--;
+        field->queued[cell] = 0;
+
+        int32_t col = cell % field->cols, row = cell / field->cols;
+        for (int32_t k = 0; k < 8; k++) {
+            if (!__can_step(field, col, row, k)) continue;
+
+            int32_t next = (row + NEIGHBOUR_ROWS[k]) * field->cols + col + NEIGHBOUR_COLS[k];
+            int32_t cost = field->cost[cell] + (k < 4 ? STRAIGHT_COST : DIAGONAL_COST);
+            if (cost >= field->cost[next]) continue;
+
+            field->cost[next] = cost;
+            if (!field->queued[next]) {
+                field->queue[tail] = next;
+                tail = tail + 1 == n ? 0 : tail + 1;
+                field->queued[next] = 1;
+                count++;
+            }
+        }
+    }
+}
+
+/**
+ * Rows are visited moving away from the target, and within each row
+ * the columns too, so the neighbours a cell depends on, which are
+ * closer to the target along both axes, are always decided first.
+ */
+static void __trace_visibility(FlowField* field) {
+    for (int32_t dr = 0; dr < field->rows; dr++) {
+        for (int32_t sr = -1; sr <= 1; sr += 2) {
+            int32_t row = field->target_row + sr * dr;
+            if (row < 0 || row >= field->rows || (dr == 0 && sr > 0)) continue;
+
+            for (int32_t dc = 0; dc < field->cols; dc++) {
+                for (int32_t sc = -1; sc <= 1; sc += 2) {
+                    int32_t col = field->target_col + sc * dc;
+                    if (col < 0 || col >= field->cols || (dc == 0 && sc > 0)) continue;
+                    field->visible[row * field->cols + col] = __is_visible(field, col, row);
+                }
+            }
+        }
+    }
+}
+
+/**
+ * A straight line from the target to the cell passes through the
+ * neighbour one step closer along the longer axis, and possibly
+ * the diagonal one. The cell is visible only if those are, which
+ * is conservative: shadows behind walls are a little wider than
+ * they really are, but nothing is seen through a wall.
+ */
+static uint8_t __is_visible(FlowField* field, int32_t col, int32_t row) {
+    int32_t cols = field->cols;
+    if (field->blocked[row * cols + col]) return 0;
+
+    int32_t dc = col - field->target_col, dr = row - field->target_row;
+    if (dc == 0 && dr == 0) return 1;
+
+    int32_t sc = (dc > 0) - (dc < 0), sr = (dr > 0) - (dr < 0);
+    uint8_t diagonal = dc != 0 && dr != 0 ? field->visible[(row - sr) * cols + col - sc] : 1;
+
+    if (abs(dc) == abs(dr)) {
+        return diagonal && !field->blocked[(row - sr) * cols + col] && !field->blocked[row * cols + col - sc];
+    }
+    if (abs(dc) > abs(dr)) {
+        return diagonal && field->visible[row * cols + col - sc];
+    }
+    return diagonal && field->visible[(row - sr) * cols + col];
+}
+
+/**
+ * Visible cells, and blocked ones so anything stuck inside a wall
+ * walks out, aim straight at the center of the target's cell.
+ * Other cells step to the neighbour closest to the target, or
+ * stand still if the target can't be reached.
+ */
+static void __point_directions(FlowField* field) {
+    int32_t start = field->target_row * field->cols + field->target_col;
+    for (int32_t row = 0; row < field->rows; row++) {
+        for (int32_t col = 0; col < field->cols; col++) {
+            int32_t cell = row * field->cols + col;
+            Vector2d direction = { 0.0f, 0.0f };
+
+            if (cell != start && (field->visible[cell] || field->blocked[cell])) {
+                direction = (Vector2d){
+                    (float)((field->target_col - col) * field->cell_size),
+                    (float)((field->target_row - row) * field->cell_size)
+                };
+                float norm_factor = carmack_inverse_sqrt(length_squared(&direction));
+                direction = (Vector2d){ direction.x * norm_factor, direction.y * norm_factor };
+            } else if (field->cost[cell] != UNREACHED) {
+                int32_t best = field->cost[cell];
+                for (int32_t k = 0; k < 8; k++) {
+                    if (!__can_step(field, col, row, k)) continue;
+                    int32_t next = (row + NEIGHBOUR_ROWS[k]) * field->cols + col + NEIGHBOUR_COLS[k];
+                    if (field->cost[next] >= best) continue;
+                    best = field->cost[next];
+                    float scale = k < 4 ? 1.0f : DIAGONAL;
+                    direction = (Vector2d){ NEIGHBOUR_COLS[k] * scale, NEIGHBOUR_ROWS[k] * scale };
+                }
+            }
+
+            field->directions[cell] = direction;
+        }
+    }
+}
\ No newline at end of file
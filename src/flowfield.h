@@ -0,0 +1,190 @@
+#ifndef Vn8rKq2XpT_FLOWFIELD_H
+#define Vn8rKq2XpT_FLOWFIELD_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "gmath.h"
+
+/**
+ * Struct:
+ *  FlowField
+ *
+ * Purpose:
+ *  A coarse grid over the world where each cell holds the direction
+ *  to walk to reach a target, computed by a wave from the target's
+ *  cell. Anything navigating only needs to look up its cell, however
+ *  many there are.
+ *
+ * Fields:
+ *  - cols:
+ *      The number of cells along the horizontal axis.
+ *  - rows:
+ *      The number of cells along the vertical axis.
+ *  - cell_size:
+ *      The width (and height) of a cell in pixels.
+ *  - inverse_cell_size:
+ *      One over the cell size, to find cells without dividing.
+ *  - origin:
+ *      The world position of the top left corner of the grid.
+ *  - blocked:
+ *      1 for cells that can't be walked through, 0 otherwise.
+ *  - cost:
+ *      The cost of walking from each cell to the target.
+ *  - visible:
+ *      1 for cells with a straight path to the target, 0 otherwise.
+ *  - directions:
+ *      The unit vector to walk along from each cell.
+ *  - queue:
+ *      Cells waiting to pass the wave on to their neighbours.
+ *  - queued:
+ *      1 for cells in the queue, 0 otherwise.
+ *  - target_col:
+ *      The column of the target's cell, -1 before the first update.
+ *  - target_row:
+ *      The row of the target's cell, -1 before the first update.
+ *  - dirty:
+ *      Has a cell changed since the field was last computed?
+ */
+typedef struct {
+    int32_t     cols;
+    int32_t     rows;
+    float       cell_size;
+    float       inverse_cell_size;
+    Point2d     origin;
+    uint8_t*    blocked;
+    int32_t*    cost;
+    uint8_t*    visible;
+    Vector2d*   directions;
+    int32_t*    queue;
+    uint8_t*    queued;
+    int32_t     target_col;
+    int32_t     target_row;
+    bool        dirty;
+} FlowField;
+
+/**
+ * Function:
+ *  init_flow_field
+ *
+ * Purpose:
+ *  Create a FlowField covering a rectangle of the world, with no blocked cells.
+ *
+ * Parameters:
+ *  - origin:
+ *      The world position of the rectangle's top left corner.
+ *  - w:
+ *      The width of the rectangle.
+ *  - h:
+ *      The height of the rectangle.
+ *  - cell_size:
+ *      The width (and height) of a cell.
+ *
+ * Returns:
+ *  The FlowField object.
+ */
+FlowField* init_flow_field(Point2d origin, float w, float h, float cell_size);
+
+/**
+ * Function:
+ *  set_flow_field_blocked
+ *
+ * Purpose:
+ *  Mark a cell as blocked or open. The field is recomputed on the next update.
+ *
+ * Parameters:
+ *  - field:
+ *      The FlowField object.
+ *  - col:
+ *      The cell's column.
+ *  - row:
+ *      The cell's row.
+ *  - blocked:
+ *      Should the cell be blocked?
+ *
+ * Returns:
+ *  Nothing.
+ */
+void set_flow_field_blocked(FlowField* field, int32_t col, int32_t row, bool blocked);
+
+/**
+ * Function:
+ *  set_flow_field_origin
+ *
+ * Purpose:
+ *  Move the grid to cover another part of the world. All cells are
+ *  opened, so the caller blocks them again for the new position, and
+ *  the field is recomputed on the next update.
+ *
+ * Parameters:
+ *  - field:
+ *      The FlowField object.
+ *  - origin:
+ *      The world position of the grid's new top left corner.
+ *
+ * Returns:
+ *  Nothing.
+ */
+void set_flow_field_origin(FlowField* field, Point2d origin);
+
+/**
+ * Function:
+ *  update_flow_field
+ *
+ * Purpose:
+ *  Recompute the field if the target moved to another cell
+ *  or any cell changed since the last update.
+ *
+ * Parameters:
+ *  - field:
+ *      The FlowField object.
+ *  - target:
+ *      The position everything navigates to.
+ *
+ * Returns:
+ *  Nothing.
+ */
+void update_flow_field(FlowField* field, Point2d* target);
+
+/**
+ * Function:
+ *  flow_direction
+ *
+ * Purpose:
+ *  Look up which way to walk from a position.
+ *
+ * Parameters:
+ *  - field:
+ *      The FlowField object.
+ *  - position:
+ *      The position to walk from.
+ *  - direction:
+ *      Set to the unit vector to walk along, or the zero vector
+ *      if the target can't be reached from the position.
+ *
+ * Returns:
+ *  false if the position is outside the grid or right next to the
+ *  target, where walking straight at the target is better, true otherwise.
+ */
+bool flow_direction(FlowField* field, Point2d* position, Vector2d* direction);
+
+/**
+ * Function:
+ *  destroy_flow_field
+ *
+ * Purpose:
+ *  Release the FlowField object.
+ *
+ * Parameters:
+ *  - field:
+ *      The FlowField object to destroy.
+ *
+ * Returns:
+ *  Nothing.
+ */
+void destroy_flow_field(FlowField* field);
+
+#endif
\ No newline at end of file
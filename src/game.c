@@ -27,6 +27,32 @@ static const uint32_t FREE_PLAYER = 1u<<8;
 static const uint32_t FREE_ENEMIES = 1u<<9;
 // Destroy Floor object
 static const uint32_t FREE_FLOOR = 1u<<10;
+// Destroy LatencyProbe object
+static const uint32_t FREE_LATENCY = 1u<<11;
+// Destroy FlowField object
+static const uint32_t FREE_FLOW = 1u<<12;
+// Destroy TileMap object
+static const uint32_t FREE_MAP = 1u<<13;
+// Destroy Camera object
+static const uint32_t FREE_CAMERA = 1u<<14;
+// Release the entities
+static const uint32_t FREE_WORLD = 1u<<15;
+// Stop the worker threads
+static const uint32_t FREE_JOBS = 1u<<16;
+// Destroy both Snapshot objects
+static const uint32_t FREE_SNAPSHOTS = 1u<<17;
+// Destroy RenderBuffer object
+static const uint32_t FREE_COMMANDS = 1u<<18;
+// Destroy Blitter object
+static const uint32_t FREE_BLITTER = 1u<<19;
+// Stop the threads drawing the blitter's tiles
+static const uint32_t FREE_DRAW_JOBS = 1u<<20;
+// Destroy FrameCapture object
+static const uint32_t FREE_CAPTURE = 1u<<21;
+// Destroy Atlas object
+static const uint32_t FREE_ATLAS = 1u<<22;
+// Destroy the scratch Arena object
+static const uint32_t FREE_SCRATCH = 1u<<23;
 
 // Error message when initializing SDL fails
 static const char INIT_SDL_LOG[] = "Unable to initialize SDL: %s";
@@ -38,6 +64,10 @@ static const char DISPLAY_MODE_LOG[] = "Getting screen resolution failed: %s";
 static const char CREATE_WIN_LOG[] = "Could not create window: %s\n";
 // Error message when we fail to create renderer
 static const char CREATE_RENDERER_LOG[] = "Could not create renderer: %s\n";
+// Log message with the renderer and the pixel format its textures are loaded in
+static const char RENDERER_LOG[] = "Renderer: %s, textures in %s";
+// Info message when the blitter uploads to a texture since window surfaces are not vsynced
+static const char VSYNC_BLIT_LOG[] = "Software blit: presenting through a texture to keep vsync";
 // Game's title
 static const char TITLE[] = "Top dow shooter in C";
 // Default width if no or invalid argument
@@ -51,11 +81,71 @@ static const int32_t DEFAULT_ENEMY_COUNT = 10;
 // The smallest possible amount of enemies
 static const int32_t MIN_ENEMY_COUNT = 1;
 // The largest possible amount of enemies
-static const int32_t MAX_ENEMY_COUNT = 10000;
+static const int32_t MAX_ENEMY_COUNT = 1000000;
 // Number of audio channels (2 = stereo)
 static const int32_t AUDIO_CHANNELS = 2;
-// Bytes used per output sample (audio)
-static const int32_t AUDIO_CHUNK_SIZE = 1<<12;
+// Default output frequency (audio)
+static const int32_t DEFAULT_AUDIO_FREQUENCY = MIX_DEFAULT_FREQUENCY;
+// Lowest allowed output frequency (audio)
+static const int32_t MIN_AUDIO_FREQUENCY = 8000;
+// Highest allowed output frequency (audio)
+static const int32_t MAX_AUDIO_FREQUENCY = 192000;
+// Default sample frames per mixer buffer (audio)
+static const int32_t DEFAULT_AUDIO_CHUNK_SIZE = 1<<12;
+// Smallest allowed sample frames per mixer buffer (audio)
+static const int32_t MIN_AUDIO_CHUNK_SIZE = 1<<6;
+// Largest allowed sample frames per mixer buffer (audio)
+static const int32_t MAX_AUDIO_CHUNK_SIZE = 1<<13;
+// Output frequency of the low latency preset (audio)
+static const int32_t LOW_LATENCY_FREQUENCY = 48000;
+// Sample frames per mixer buffer of the low latency preset (~10.7ms)
+static const int32_t LOW_LATENCY_CHUNK_SIZE = 1<<9;
+// The lowest frame rate cap allowed
+static const int32_t MIN_FPS_CAP = 10;
+// The highest frame rate cap allowed
+static const int32_t MAX_FPS_CAP = 1000;
+// The shortest allowed time between latency probe events in milliseconds
+static const int32_t MIN_PROBE_INTERVAL = 10;
+// The longest allowed time between latency probe events in milliseconds
+static const int32_t MAX_PROBE_INTERVAL = 10000;
+// How far beyond the view the flow field reaches, enemies further out walk straight at the player
+static const int32_t FLOW_FIELD_MARGIN = 640;
+// The width (and height) of map tiles and flow field cells in pixels
+static const int32_t TILE_SIZE = 32;
+// Default world width (and height) if no or invalid argument
+static const int32_t DEFAULT_WORLD_SIZE = 10000;
+// The largest allowed world width (and height)
+static const int32_t MAX_WORLD_SIZE = 200000;
+// The map played if none is given
+static const char DEFAULT_MAP_PATH[] = "assets/maps/arena.txt";
+// The enemy spawn schedule, every slot is filled at the start and the last wave repeats
+static const EnemyWave ENEMY_WAVES[] = {
+    { 0.0f,     1.0f },
+    { 10000.0f, 0.1f },
+    { 5000.0f,  0.05f }
+};
+// Log message with the average cost of submitting a frame's draw commands
+static const char RENDER_STATS_LOG[] = "Render: %.1f commands, %.1f draw calls, %.1f texture switches per frame";
+// Log message with the average share of the window the software blitter redrew
+static const char BLIT_STATS_LOG[] = "Blit: %.0f pixels (%.1f%% of the window) in %.1f rectangles per frame";
+// Log message with how much of the scratch arena a frame used at most
+static const char SCRATCH_STATS_LOG[] = "Scratch: at most %zu of %zu bytes in a frame, %llu allocations overflowed";
+// Scratch memory a frame starts with, grown if a frame needs more
+static const size_t SCRATCH_SIZE = 1u<<20;
+// Log message with the requested audio configuration
+static const char AUDIO_CONFIG_LOG[] = "Audio: requested %d Hz, %d frames per buffer (%.1f ms)";
+// Fewest threads updating a frame
+static const int32_t MIN_THREADS = 1;
+// Most threads updating a frame
+static const int32_t MAX_THREADS = 256;
+// Enemy rows per job, enough work to hide the cost of scheduling it
+static const int32_t ENEMY_CHUNK = 1024;
+// The time between frames of a seeded run in milliseconds, as if at 60 fps
+static const float FIXED_STEP = 1000.0f / 60.0f;
+// The largest tolerance allowed when comparing to golden images
+static const int32_t MAX_CAPTURE_TOLERANCE = 255;
+// Fewest warm-up frames before allocating is forbidden
+static const int32_t MIN_ALLOC_WARMUP = 1;
 // Maximum ratio of resolution before switching to full screen
 static const float MAX_DIM_RATIO = 0.9f;
 
@@ -64,15 +154,33 @@ static const float MAX_DIM_RATIO = 0.9f;
  *  __init_SDL
  *
  * Purpose:
- *  Initialize SDL2 and SDL2_mixer.
+ *  Initialize SDL2, with the dummy drivers if running headless.
  *
  * Parameters:
- *  None.
+ *  - game:
+ *      The Game object.
  *
  * Returns:
  *  Nothing.
  */
-static void __init_SDL(void);
+static void __init_SDL(Game* game);
+
+/**
+ * Function:
+ *  __init_audio
+ *
+ * Purpose:
+ *  Open the audio device through SDL2_mixer with the
+ *  configured frequency and buffer size.
+ *
+ * Parameters:
+ *  - game:
+ *      The Game object.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __init_audio(Game* game);
 
 /**
  * Function:
@@ -95,9 +203,22 @@ static void __init_SDL(void);
  *      FREE_CLOCK
  *      FREE_WINDOW
  *      FREE_RENDERER
+ *      FREE_ATLAS
  *      FREE_PLAYER
  *      FREE_ENEMIES
  *      FREE_FLOOR
+ *      FREE_LATENCY
+ *      FREE_FLOW
+ *      FREE_MAP
+ *      FREE_CAMERA
+ *      FREE_WORLD
+ *      FREE_JOBS
+ *      FREE_SNAPSHOTS
+ *      FREE_COMMANDS
+ *      FREE_BLITTER
+ *      FREE_DRAW_JOBS
+ *      FREE_CAPTURE
+ *      FREE_SCRATCH
  *
  * Returns:
  *  Nothing.
@@ -112,6 +233,8 @@ static void __destroy(Game* game, uint32_t mask);
  *  Get the maximum window width and height the running machine supports.
  *
  * Parameters:
+ *  - game:
+ *      The Game object.
  *  - w:
  *      An integer to set width.
  *  - h:
@@ -120,7 +243,7 @@ static void __destroy(Game* game, uint32_t mask);
  * Returns:
  *  Nothing.
  */
-static void __get_screen_resolution(int* w, int* h);
+static void __get_screen_resolution(Game* game, int* w, int* h);
 
 /**
  * Function:
@@ -152,17 +275,13 @@ static Game* __alloc_and_set_game(void);
  *      The number of arguments.
  *  - argv:
  *      A list of arguments.
- *  - w:
- *      The screen resolution's width.
- *  - h:
- *      The screen resolution's height.
  *  - z:
  *      An integer to store number of enemies.
  *
  * Returns:
  *  Nothing.
  */
-static void __parse_arguments(Game* game, int32_t argc, char** argv, int32_t w, int32_t h, int32_t* z);
+static void __parse_arguments(Game* game, int32_t argc, char** argv, int32_t* z);
 
 /**
  * Function:
@@ -189,7 +308,8 @@ static void __init_window(Game* game, int32_t w, int32_t h);
  *  __init_renderer
  *
  * Purpose:
- *  Create a 2d rendering context for the window.
+ *  Create a 2d rendering context for the window and find the pixel
+ *  format its textures are loaded in.
  *
  * Parameters:
  *  - game:
@@ -200,6 +320,22 @@ static void __init_window(Game* game, int32_t w, int32_t h);
  */
 static void __init_renderer(Game* game);
 
+/**
+ * Function:
+ *  __init_atlas
+ *
+ * Purpose:
+ *  Pack every sprite into one texture.
+ *
+ * Parameters:
+ *  - game:
+ *      The Game object.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __init_atlas(Game* game);
+
 /**
  * Function:
  *  __init_sound
@@ -236,6 +372,22 @@ static void __init_sound(Game* game);
  */
 static void __init_player(Game* game, float x, float y);
 
+/**
+ * Function:
+ *  __init_camera
+ *
+ * Purpose:
+ *  Create the camera and point it at the player.
+ *
+ * Parameters:
+ *  - game:
+ *      The Game object.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __init_camera(Game* game);
+
 /**
  * Function:
  *  __init_enemies
@@ -247,7 +399,7 @@ static void __init_player(Game* game, float x, float y);
  *  - game:
  *      The Game object.
  *  - count:
- *      The number of enemies the game should contain.
+ *      The most enemies alive at once.
  *
  * Returns:
  *  Nothing.
@@ -270,6 +422,288 @@ static void __init_enemies(Game* game, int32_t count);
  */
 static void __init_floor(Game* game);
 
+/**
+ * Function:
+ *  __init_tile_map
+ *
+ * Purpose:
+ *  Load the level's walls.
+ *
+ * Parameters:
+ *  - game:
+ *      The Game object.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __init_tile_map(Game* game);
+
+/**
+ * Function:
+ *  __init_flow_field
+ *
+ * Purpose:
+ *  Create the flow field around the view, blocked where the walls are.
+ *
+ * Parameters:
+ *  - game:
+ *      The Game object.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __init_flow_field(Game* game);
+
+/**
+ * Function:
+ *  __flow_field_origin
+ *
+ * Purpose:
+ *  Find where the flow field should start for the camera's position.
+ *
+ * Parameters:
+ *  - game:
+ *      The Game object.
+ *
+ * Returns:
+ *  The world position of the field's top left corner, on a tile's corner.
+ */
+static Point2d __flow_field_origin(Game* game);
+
+/**
+ * Function:
+ *  __block_walls
+ *
+ * Purpose:
+ *  Block the flow field's cells that are on the map's walls.
+ *
+ * Parameters:
+ *  - game:
+ *      The Game object.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __block_walls(Game* game);
+
+/**
+ * Function:
+ *  __follow_player
+ *
+ * Purpose:
+ *  Center the camera on the player and move the flow field along with it.
+ *
+ * Parameters:
+ *  - game:
+ *      The Game object.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __follow_player(Game* game);
+
+/**
+ * Function:
+ *  __init_latency_probe
+ *
+ * Purpose:
+ *  Start the input latency probe if it was requested.
+ *
+ * Parameters:
+ *  - game:
+ *      The Game object.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __init_latency_probe(Game* game);
+
+/**
+ * Function:
+ *  __init_jobs
+ *
+ * Purpose:
+ *  Start the threads that update each frame.
+ *
+ * Parameters:
+ *  - game:
+ *      The Game object.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __init_jobs(Game* game);
+
+/**
+ * Function:
+ *  __worker_threads
+ *
+ * Purpose:
+ *  The threads a job system gets besides the main thread, so the
+ *  update and the blitter together stay within the threads asked for.
+ *
+ * Parameters:
+ *  - game:
+ *      The Game object.
+ *  - drawing:
+ *      Whether the threads are the blitter's rather than the update's.
+ *
+ * Returns:
+ *  The number of threads.
+ */
+static int32_t __worker_threads(Game* game, bool drawing);
+
+/**
+ * Function:
+ *  __init_snapshots
+ *
+ * Purpose:
+ *  Create the snapshots, both showing the game as it starts.
+ *
+ * Parameters:
+ *  - game:
+ *      The Game object.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __init_snapshots(Game* game);
+
+/**
+ * Function:
+ *  __init_blitter
+ *
+ * Purpose:
+ *  Create the software blitter, give it the pixels of every
+ *  texture drawn and start the threads drawing its tiles, if
+ *  software blitting was asked for.
+ *
+ * Parameters:
+ *  - game:
+ *      The Game object.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __init_blitter(Game* game);
+
+/**
+ * Function:
+ *  __init_capture
+ *
+ * Purpose:
+ *  Start reading back frames if they are to be saved or compared
+ *  to golden images.
+ *
+ * Parameters:
+ *  - game:
+ *      The Game object.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __init_capture(Game* game);
+
+/**
+ * Function:
+ *  __prepare_frame
+ *
+ * Purpose:
+ *  The task updating everything the enemies depend on: the player,
+ *  the camera, the spawns and the flow field.
+ *
+ * Parameters:
+ *  - data:
+ *      The Game object.
+ *  - begin:
+ *      Unused, the task has a single item.
+ *  - end:
+ *      Unused, the task has a single item.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __prepare_frame(void* data, int32_t begin, int32_t end);
+
+/**
+ * Function:
+ *  __update_enemy_chunk
+ *
+ * Purpose:
+ *  The task updating the enemies, a chunk of rows at a time.
+ *
+ * Parameters:
+ *  - data:
+ *      The Game object.
+ *  - begin:
+ *      The first row.
+ *  - end:
+ *      One past the last row.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __update_enemy_chunk(void* data, int32_t begin, int32_t end);
+
+/**
+ * Function:
+ *  __finish_frame
+ *
+ * Purpose:
+ *  The task applying what the enemy chunks could not do at once,
+ *  grid moves and deaths.
+ *
+ * Parameters:
+ *  - data:
+ *      The Game object.
+ *  - begin:
+ *      Unused, the task has a single item.
+ *  - end:
+ *      Unused, the task has a single item.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __finish_frame(void* data, int32_t begin, int32_t end);
+
+/**
+ * Function:
+ *  __capture_frame
+ *
+ * Purpose:
+ *  The task copying what the frame shows into the snapshot not
+ *  being drawn.
+ *
+ * Parameters:
+ *  - data:
+ *      The Game object.
+ *  - begin:
+ *      Unused, the task has a single item.
+ *  - end:
+ *      Unused, the task has a single item.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __capture_frame(void* data, int32_t begin, int32_t end);
+
+/**
+ * Function:
+ *  __end_simulation
+ *
+ * Purpose:
+ *  Act on a frame once it is simulated and make its snapshot the
+ *  one drawn.
+ *
+ * Parameters:
+ *  - game:
+ *      The Game object.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __end_simulation(Game* game);
+
 /**
  * Function:
  *  __process_events
@@ -324,26 +758,42 @@ static void __render(Game* game);
  * allocated resources and exit with 1.
  */
 Game* init_game(int32_t argc, char** argv) {
-    // Seed the random generator based on current time
-    srand(time(NULL));
+    int32_t w, h, z = DEFAULT_ENEMY_COUNT;
+    Game* game = __alloc_and_set_game();
 
-    __init_SDL();
+    __parse_arguments(game, argc, argv, &z);
 
-    int32_t w, h, z = DEFAULT_ENEMY_COUNT;
-    __get_screen_resolution(&w, &h);
+    // Seed the random generator based on current time, unless given a seed
+    srand(game->seeded ? game->seed : (uint32_t)time(NULL));
 
-    Game* game = __alloc_and_set_game();
+    // SDL's memory functions can only be replaced before it allocates
+    if (game->track_allocs) init_alloc_tracking(game->alloc_warmup);
 
-    __parse_arguments(game, argc, argv, w, h, &z);
+    __init_SDL(game);
+    __get_screen_resolution(game, &w, &h);
+    __init_audio(game);
     __init_window(game, w, h);
     __init_renderer(game);
+    __init_atlas(game);
     __init_sound(game);
+    game->world = init_world(z + 1);
     __init_player(game, game->width / 2.0f, game->height / 2.0f);
+    __init_camera(game);
     __init_enemies(game, z);
     __init_floor(game);
+    __init_tile_map(game);
 
     game->gevts = init_game_events();
     game->gclock = init_game_clock();
+    __init_flow_field(game);
+    __init_snapshots(game);
+    game->commands = init_render_buffer();
+    game->scratch = init_arena(SCRATCH_SIZE, ARENA_OVERFLOW_GROW);
+    __init_blitter(game);
+
+    __init_jobs(game);
+    __init_capture(game);
+    __init_latency_probe(game);
 
     return game;
 }
@@ -353,15 +803,77 @@ Game* init_game(int32_t argc, char** argv) {
  * 2. Map SDL2 events to our game specific events
  * 3. Update all game objects
  * 4. Render all game objects
+ * 5. Wait out the frame if the frame rate is capped
+ *
+ * The latency probe, if any, is told when each of these stages
+ * is done, with the player's position in the window as drawn, where
+ * the probe's mouse events are. The loop also ends after a fixed
+ * number of frames if one was given. When pipelined, the last frame
+ * is still being simulated once the loop ends. What drawing cost on
+ * average, and how much the software blitter redrew, is logged at
+ * the end, as are the allocations made if tracked. The scratch arena
+ * is reset as each frame starts, so what a frame allocates from it
+ * lives until the next one begins. Tasks simulating the next frame
+ * run past that and must not keep any. A seeded run steps each frame
+ * by the same time, however long it took, so it plays out the same
+ * every time, and waits for the captured frames to be compared before
+ * returning.
  */
-void start_game(Game* game) {
+int32_t start_game(Game* game) {
     // GAME LOOP
     while (game->running) {
+        if (game->track_allocs) begin_alloc_frame(game->frame);
+        reset_arena(game->scratch);
         update_game_clock(game->gclock);
+        if (game->seeded) game->gclock->dt = FIXED_STEP;
+        if (game->latency) {
+            Snapshot* snapshot = game->snapshots[game->front];
+            Point2d anchor = {
+                snapshot->player.position.x - snapshot->camera.position.x,
+                snapshot->player.position.y - snapshot->camera.position.y
+            };
+            latency_frame_begin(game->latency, &anchor);
+        }
         __process_events(game);
         __update(game);
         __render(game);
+        if (game->latency) latency_after_present(game->latency);
+        if (game->fps_cap > 0) limit_frame_rate(game->gclock, game->fps_cap);
+        if (++game->frame == game->max_frames) game->running = false;
+    }
+    wait_tasks(game->jobs);
+    if (game->track_allocs) log_alloc_tracking();
+
+    RenderBuffer* commands = game->commands;
+    if (commands->frames > 0) {
+        SDL_Log(
+            RENDER_STATS_LOG,
+            (double)commands->total.commands / commands->frames,
+            (double)commands->total.draw_calls / commands->frames,
+            (double)commands->total.texture_switches / commands->frames
+        );
+    }
+
+    Blitter* blitter = game->blitter;
+    if (blitter && blitter->frames > 0) {
+        double pixels = (double)blitter->total.pixels / blitter->frames;
+        SDL_Log(
+            BLIT_STATS_LOG,
+            pixels,
+            100.0 * pixels / ((double)blitter->width * blitter->height),
+            (double)blitter->total.rects / blitter->frames
+        );
     }
+
+    SDL_Log(
+        SCRATCH_STATS_LOG,
+        game->scratch->high_water,
+        game->scratch->capacity,
+        (unsigned long long)game->scratch->overflows
+    );
+
+    if (game->capture && finish_frame_capture(game->capture) > 0) return EXIT_FAILURE;
+    return EXIT_SUCCESS;
 }
 
 /**
@@ -372,22 +884,40 @@ void destroy_game(Game* game) {
 }
 
 /**
- * Initialize SDL2 and SDL2_mixer. If the first fails, we won't
- * bother with the second and if the latter fails, we clean the
- * resources of the first one. In the case where either fail,
- * we terminate the program.
+ * Initialize SDL2, if it fails we release the game object and
+ * terminate the program. Headless runs use SDL's dummy video and
+ * audio drivers, which must be chosen before initializing.
  */
-static void __init_SDL(void) {
-    // Initialize SDL2
-    if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO) < 0) {
+static void __init_SDL(Game* game) {
+    if (game->headless) {
+        SDL_setenv("SDL_VIDEODRIVER", "dummy", 1);
+        SDL_setenv("SDL_AUDIODRIVER", "dummy", 1);
+    }
+
+    if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_TIMER) < 0) {
         SDL_Log(INIT_SDL_LOG, SDL_GetError());
+        __destroy(game, FREE_MEMORY);
         exit(EXIT_FAILURE);
     }
+}
 
-    // Initialize SDL2_mixer
-    if (Mix_OpenAudio(MIX_DEFAULT_FREQUENCY, MIX_DEFAULT_FORMAT, AUDIO_CHANNELS, AUDIO_CHUNK_SIZE) == -1) {
+/**
+ * Initialize SDL2_mixer. If it fails, we clean the resources
+ * of SDL2 and the game object and terminate the program. The
+ * buffer size is in sample frames, so its duration depends on
+ * the frequency.
+ */
+static void __init_audio(Game* game) {
+    SDL_Log(
+        AUDIO_CONFIG_LOG,
+        game->audio_frequency,
+        game->audio_chunk_size,
+        1000.0f * game->audio_chunk_size / game->audio_frequency
+    );
+
+    if (Mix_OpenAudio(game->audio_frequency, MIX_DEFAULT_FORMAT, AUDIO_CHANNELS, game->audio_chunk_size) == -1) {
         SDL_Log(OPEN_AUDIO_LOG, SDL_GetError());
-        __destroy(NULL, FREE_SDL);
+        __destroy(game, FREE_MEMORY | FREE_SDL);
         exit(EXIT_FAILURE);
     }
 }
@@ -396,9 +926,25 @@ static void __init_SDL(void) {
  * Check each resources against mask before releasing.
  */
 static void __destroy(Game* game, uint32_t mask) {
+    if ((FREE_CAPTURE & mask) && game->capture) destroy_frame_capture(game->capture);
+    if (FREE_JOBS & mask) destroy_job_system(game->jobs);
+    if ((FREE_DRAW_JOBS & mask) && game->draw_jobs) destroy_job_system(game->draw_jobs);
+    if ((FREE_BLITTER & mask) && game->blitter) destroy_blitter(game->blitter);
+    if (FREE_SCRATCH & mask) destroy_arena(game->scratch);
+    if (FREE_COMMANDS & mask) destroy_render_buffer(game->commands);
+    if (FREE_SNAPSHOTS & mask) {
+        destroy_snapshot(game->snapshots[0]);
+        destroy_snapshot(game->snapshots[1]);
+    }
+    if ((FREE_LATENCY & mask) && game->latency) destroy_latency_probe(game->latency);
     if (FREE_FLOOR & mask) destroy_floor(game->floor);
+    if (FREE_FLOW & mask) destroy_flow_field(game->flow);
+    if (FREE_MAP & mask) destroy_tile_map(game->map);
     if (FREE_ENEMIES & mask) destroy_enemies(game->enemies);
+    if (FREE_CAMERA & mask) destroy_camera(game->camera);
     if (FREE_PLAYER & mask) destroy_player(game->player);
+    if (FREE_WORLD & mask) destroy_world(game->world);
+    if (FREE_ATLAS & mask) destroy_atlas(game->atlas);
     if (FREE_RENDERER & mask) SDL_DestroyRenderer(game->renderer);
     if (FREE_WINDOW & mask) SDL_DestroyWindow(game->window);
     if (FREE_CLOCK & mask) destroy_game_clock(game->gclock);
@@ -412,11 +958,11 @@ static void __destroy(Game* game, uint32_t mask) {
 /**
  * If getting display fails, we terminate here.
  */
-static void __get_screen_resolution(int* w, int* h) {
+static void __get_screen_resolution(Game* game, int* w, int* h) {
     SDL_DisplayMode DM;
     if (SDL_GetDesktopDisplayMode(0, &DM) < 0) {
         SDL_Log(DISPLAY_MODE_LOG, SDL_GetError());
-        __destroy(NULL, FREE_SDL_AUDIO | FREE_SDL);
+        __destroy(game, FREE_MEMORY | FREE_SDL);
         exit(EXIT_FAILURE);
     }
     *w = DM.w;
@@ -431,18 +977,85 @@ static Game* __alloc_and_set_game(void) {
     game->running = true;
     game->width = DEFAULT_WIDTH;
     game->height = DEFAULT_HEIGHT;
+    game->world_width = DEFAULT_WORLD_SIZE;
+    game->world_height = DEFAULT_WORLD_SIZE;
+    game->audio_frequency = DEFAULT_AUDIO_FREQUENCY;
+    game->audio_chunk_size = DEFAULT_AUDIO_CHUNK_SIZE;
+    game->headless = false;
+    game->vsync = false;
+    game->fps_cap = 0;
+    game->frame = 0;
+    game->max_frames = 0;
+    game->latency_interval = 0;
+    game->latency = NULL;
+    game->threads = -1;
+    game->pipelined = true;
+    game->front = 0;
+    game->software_blit = false;
+    game->window_surface = false;
+    game->blitter = NULL;
+    game->draw_jobs = NULL;
+    game->map_path = DEFAULT_MAP_PATH;
+    game->seed = 0;
+    game->seeded = false;
+    game->capture_frames = NULL;
+    game->capture_directory = NULL;
+    game->golden_directory = NULL;
+    game->capture_tolerance = 0;
+    game->capture = NULL;
+    game->track_allocs = false;
+    game->alloc_warmup = 0;
+    game->compact_enemies = false;
     return game;
 }
 
 /**
- * Parse flags -w, -h and -z with getopt. All are expected to have values.
- * If invalid (either non-numeric or too small/large), then we use default
- * values. All values have been set prior to this so if arguments are missing,
- * they are still initialized to some value.
+ * Parse flags -w, -h, -x, -y, -z, -f, -b, -l, -n, -v, -r, -p, -m, -j, -s,
+ * --headless, --no-pipeline, --software-blit, --capture, --capture-frames,
+ * --golden, --tolerance, --track-allocs, --zero-alloc and --compact-enemies
+ * (or their long forms) with getopt. The flags -l, -v, --headless,
+ * --no-pipeline, --software-blit, --track-allocs and --compact-enemies take
+ * no value while all others are expected to have values. If invalid (either
+ * non-numeric or too small/large), then we use default values. All values
+ * have been set prior to this so if arguments are missing, they are still
+ * initialized to some value. The world is only checked against the window
+ * once the window exists, since its size may still change. The low latency
+ * preset is applied before any explicit audio values, regardless of the order
+ * of the flags.
  */
-static void __parse_arguments(Game* game, int32_t argc, char** argv, int32_t w, int32_t h, int32_t* z) {
-    int32_t opt, v;
-    while ((opt = getopt(argc, argv, "w:h:z:")) != -1) {
+static void __parse_arguments(Game* game, int32_t argc, char** argv, int32_t* z) {
+    static const struct option long_options[] = {
+        { "width",          required_argument,  NULL,   'w' },
+        { "height",         required_argument,  NULL,   'h' },
+        { "world-width",    required_argument,  NULL,   'x' },
+        { "world-height",   required_argument,  NULL,   'y' },
+        { "enemies",        required_argument,  NULL,   'z' },
+        { "frequency",      required_argument,  NULL,   'f' },
+        { "buffer",         required_argument,  NULL,   'b' },
+        { "low-latency",    no_argument,        NULL,   'l' },
+        { "frames",         required_argument,  NULL,   'n' },
+        { "vsync",          no_argument,        NULL,   'v' },
+        { "fps-cap",        required_argument,  NULL,   'r' },
+        { "latency-probe",  required_argument,  NULL,   'p' },
+        { "map",            required_argument,  NULL,   'm' },
+        { "headless",       no_argument,        NULL,   'H' },
+        { "threads",        required_argument,  NULL,   'j' },
+        { "no-pipeline",    no_argument,        NULL,   'P' },
+        { "software-blit",  no_argument,        NULL,   'S' },
+        { "seed",           required_argument,  NULL,   's' },
+        { "capture",        required_argument,  NULL,   'C' },
+        { "capture-frames", required_argument,  NULL,   'F' },
+        { "golden",         required_argument,  NULL,   'G' },
+        { "tolerance",      required_argument,  NULL,   'T' },
+        { "track-allocs",   no_argument,        NULL,   'A' },
+        { "zero-alloc",     required_argument,  NULL,   'Z' },
+        { "compact-enemies", no_argument,       NULL,   'E' },
+        { NULL,             0,                  NULL,   0   }
+    };
+
+    int32_t opt, v, frequency = -1, chunk_size = -1;
+    char* end;
+    while ((opt = getopt_long(argc, argv, "w:h:x:y:z:f:b:ln:vr:p:m:j:s:", long_options, NULL)) != -1) {
         switch (opt) {
             case 'w':
                 v = string_to_int(optarg);
@@ -452,32 +1065,120 @@ static void __parse_arguments(Game* game, int32_t argc, char** argv, int32_t w,
                 v = string_to_int(optarg);
                 game->height = v < MIN_WINDOW_DIM ? MIN_WINDOW_DIM : v;
                 break;
+            case 'x':
+                v = string_to_int(optarg);
+                if (0 < v && v <= MAX_WORLD_SIZE) game->world_width = v;
+                break;
+            case 'y':
+                v = string_to_int(optarg);
+                if (0 < v && v <= MAX_WORLD_SIZE) game->world_height = v;
+                break;
             case 'z':
                 v = string_to_int(optarg);
                 if (MIN_ENEMY_COUNT <= v && v <= MAX_ENEMY_COUNT) *z = v;
                 break;
+            case 'f':
+                v = string_to_int(optarg);
+                if (MIN_AUDIO_FREQUENCY <= v && v <= MAX_AUDIO_FREQUENCY) frequency = v;
+                break;
+            case 'b':
+                v = string_to_int(optarg);
+                if (MIN_AUDIO_CHUNK_SIZE <= v && v <= MAX_AUDIO_CHUNK_SIZE) chunk_size = next_power_of_two(v);
+                break;
+            case 'l':
+                game->audio_frequency = LOW_LATENCY_FREQUENCY;
+                game->audio_chunk_size = LOW_LATENCY_CHUNK_SIZE;
+                break;
+            case 'n':
+                v = string_to_int(optarg);
+                if (v > 0) game->max_frames = v;
+                break;
+            case 'v':
+                game->vsync = true;
+                break;
+            case 'r':
+                v = string_to_int(optarg);
+                if (MIN_FPS_CAP <= v && v <= MAX_FPS_CAP) game->fps_cap = v;
+                break;
+            case 'p':
+                v = string_to_int(optarg);
+                if (MIN_PROBE_INTERVAL <= v && v <= MAX_PROBE_INTERVAL) game->latency_interval = v;
+                break;
+            case 'm':
+                game->map_path = optarg;
+                break;
+            case 'H':
+                game->headless = true;
+                break;
+            case 'j':
+                v = string_to_int(optarg);
+                if (MIN_THREADS <= v && v <= MAX_THREADS) game->threads = v;
+                break;
+            case 'P':
+                game->pipelined = false;
+                break;
+            case 'S':
+                game->software_blit = true;
+                break;
+            case 's':
+                v = string_to_int(optarg);
+                if (v > 0) {
+                    game->seed = (uint32_t)v;
+                    game->seeded = true;
+                }
+                break;
+            case 'C':
+                game->capture_directory = optarg;
+                break;
+            case 'F':
+                game->capture_frames = optarg;
+                break;
+            case 'G':
+                game->golden_directory = optarg;
+                break;
+            case 'T':
+                // string_to_int rejects 0, but a tolerance of 0 asks for an exact match
+                v = (int32_t)strtol(optarg, &end, 10);
+                if (end != optarg && *end == '\0' && 0 <= v && v <= MAX_CAPTURE_TOLERANCE) game->capture_tolerance = v;
+                break;
+            case 'A':
+                game->track_allocs = true;
+                break;
+            case 'Z':
+                v = string_to_int(optarg);
+                if (v >= MIN_ALLOC_WARMUP) {
+                    game->alloc_warmup = (uint64_t)v;
+                    game->track_allocs = true;
+                }
+                break;
+            case 'E':
+                game->compact_enemies = true;
+                break;
             default:
                 break;
             }
     }
 
-    // If we reach a certain size, close to full screen, we set the window to full screen.
-    if (game->width > MAX_DIM_RATIO * w || game->height > MAX_DIM_RATIO * h) {
-        game->width = w;
-        game->height = h;
-    }
+    if (frequency != -1) game->audio_frequency = frequency;
+    if (chunk_size != -1) game->audio_chunk_size = chunk_size;
 }
 
 /**
- * If either the game width or height is at maximum for the screen,
- * we opt for full screen mode. If we fail to create the window, we
- * terminate right here but first release any previously allocated
- * resources.
+ * If we reach a certain size, close to the screen resolution, we opt
+ * for full screen mode. Headless runs have no real screen, so they
+ * always get the requested size and no OpenGL context. If we fail to
+ * create the window, we terminate right here but first release any
+ * previously allocated resources.
  */
 static void __init_window(Game* game, int32_t w, int32_t h) {
-    bool full_screen = game->width == w || game->height == h;
+    if (!game->headless && (game->width > MAX_DIM_RATIO * w || game->height > MAX_DIM_RATIO * h)) {
+        game->width = w;
+        game->height = h;
+    }
 
-    Uint32 flags = SDL_WINDOW_OPENGL;
+    bool full_screen = !game->headless && (game->width == w || game->height == h);
+
+    Uint32 flags = game->headless ? 0 : SDL_WINDOW_OPENGL;
     if (full_screen) flags |= SDL_WINDOW_FULLSCREEN_DESKTOP;
 
     game->window = SDL_CreateWindow(
@@ -497,16 +1198,47 @@ static void __init_window(Game* game, int32_t w, int32_t h) {
 }
 
 /**
- * If we fail to create renderer we terminate here but first release
- * any previously allocated resources.
+ * Headless runs render in software since there is no GPU context.
+ * Software blitting presents through the window's surface, so the
+ * renderer, which only loads the textures then, draws into it too,
+ * as SDL allows no other renderer with it. Updating the surface is
+ * not paced by vsync, so with vsync, or without a surface, the
+ * blitter uploads to a texture instead. If we fail to create
+ * renderer we terminate here but first release any previously
+ * allocated resources. Without the renderer's info the textures
+ * fall back to ARGB8888.
  */
 static void __init_renderer(Game* game) {
-    game->renderer = SDL_CreateRenderer(game->window, -1, SDL_RENDERER_ACCELERATED);
+    Uint32 flags = game->headless ? SDL_RENDERER_SOFTWARE : SDL_RENDERER_ACCELERATED;
+    if (game->vsync) flags |= SDL_RENDERER_PRESENTVSYNC;
+
+    SDL_Surface* surface = game->software_blit && !game->vsync ? SDL_GetWindowSurface(game->window) : NULL;
+    if (game->software_blit && game->vsync) SDL_Log(VSYNC_BLIT_LOG);
+    game->window_surface = surface != NULL;
+    game->renderer = surface ? SDL_CreateSoftwareRenderer(surface) : SDL_CreateRenderer(game->window, -1, flags);
     if (game->renderer == NULL) {
         SDL_Log(CREATE_RENDERER_LOG, SDL_GetError());
         __destroy(game, FREE_MEMORY | FREE_SDL | FREE_SDL_AUDIO | FREE_WINDOW);
         exit(EXIT_FAILURE);
     }
+
+    SDL_RendererInfo info;
+    if (SDL_GetRendererInfo(game->renderer, &info) < 0) info = (SDL_RendererInfo){ .name = "unknown" };
+    game->texture_format = native_texture_format(&info);
+    SDL_Log(RENDERER_LOG, info.name, SDL_GetPixelFormatName(game->texture_format));
+}
+
+/**
+ * The player, the enemies and the floor are drawn from the atlas.
+ * If we fail to pack it we terminate here but first release any
+ * previously allocated resources.
+ */
+static void __init_atlas(Game* game) {
+    game->atlas = init_atlas(game->renderer, game->texture_format);
+    if (game->atlas == NULL) {
+        __destroy(game, FREE_MEMORY | FREE_SDL | FREE_SDL_AUDIO | FREE_WINDOW | FREE_RENDERER);
+        exit(EXIT_FAILURE);
+    }
 }
 
 /**
@@ -516,7 +1248,7 @@ static void __init_renderer(Game* game) {
 static void __init_sound(Game* game) {
     game->sound = init_sound();
     if (game->sound == NULL) {
-        __destroy(game, FREE_MEMORY | FREE_SDL | FREE_SDL_AUDIO | FREE_WINDOW | FREE_RENDERER);
+        __destroy(game, FREE_MEMORY | FREE_SDL | FREE_SDL_AUDIO | FREE_WINDOW | FREE_RENDERER | FREE_ATLAS);
         exit(EXIT_FAILURE);
     }
 }
@@ -526,25 +1258,44 @@ static void __init_sound(Game* game) {
  * any previously allocated resources.
  */
 static void __init_player(Game* game, float x, float y) {
-    game->player = init_player(game->renderer, x, y);
+    game->player = init_player(game->atlas, game->world, x, y);
     if (game->player == NULL) {
         __destroy(game, FREE_MEMORY | FREE_SDL | FREE_SDL_AUDIO |
-            FREE_WINDOW | FREE_RENDERER | FREE_SOUND);
+            FREE_WINDOW | FREE_RENDERER | FREE_ATLAS | FREE_SOUND | FREE_WORLD);
         exit(EXIT_FAILURE);
     }
 }
 
+/**
+ * The world is grown to fit the window, which is final by now.
+ * The camera is placed before anything spawns, so enemies
+ * know what is in view.
+ */
+static void __init_camera(Game* game) {
+    if (game->world_width < game->width) game->world_width = game->width;
+    if (game->world_height < game->height) game->world_height = game->height;
+    game->camera = init_camera(game->width, game->height, game->world_width, game->world_height);
+    Point2d* position = player_position(game->player);
+    Point2d focus = {
+        position->x + game->player->texture_width / 2.0f,
+        position->y + game->player->texture_height / 2.0f
+    };
+    update_camera(game->camera, &focus);
+}
+
 /**
  * If we fail to create enemies we terminate here but first release
- * any previously allocated resources.
+ * any previously allocated resources. The first wave spawns on the
+ * first frame.
  */
 static void __init_enemies(Game* game, int32_t count) {
-    game->enemies = init_enemies(game->renderer, count, game->width, game->height);
+    game->enemies = init_enemies(game->atlas, count, game->camera, game->world, game->compact_enemies);
     if (game->enemies == NULL) {
         __destroy(game, FREE_MEMORY | FREE_SDL | FREE_SDL_AUDIO |
-            FREE_WINDOW | FREE_RENDERER | FREE_SOUND | FREE_PLAYER);
+            FREE_WINDOW | FREE_RENDERER | FREE_ATLAS | FREE_SOUND | FREE_PLAYER | FREE_CAMERA | FREE_WORLD);
         exit(EXIT_FAILURE);
     }
+    set_enemy_waves(game->enemies, ENEMY_WAVES, (int32_t)(sizeof(ENEMY_WAVES) / sizeof(ENEMY_WAVES[0])));
 }
 
 /**
@@ -552,10 +1303,192 @@ static void __init_enemies(Game* game, int32_t count) {
  * any previously allocated resources.
  */
 static void __init_floor(Game* game) {
-    game->floor = init_floor(game->renderer);
+    game->floor = init_floor(game->atlas);
     if (game->floor == NULL) {
         __destroy(game, FREE_MEMORY | FREE_SDL | FREE_SDL_AUDIO | FREE_WINDOW |
-            FREE_RENDERER | FREE_SOUND | FREE_PLAYER | FREE_ENEMIES);
+            FREE_RENDERER | FREE_ATLAS | FREE_SOUND | FREE_PLAYER | FREE_CAMERA | FREE_ENEMIES | FREE_WORLD);
+        exit(EXIT_FAILURE);
+    }
+}
+
+/**
+ * If we fail to load the map we terminate here but first release
+ * any previously allocated resources.
+ */
+static void __init_tile_map(Game* game) {
+    game->map = load_tile_map(game->map_path, TILE_SIZE);
+    if (game->map == NULL) {
+        __destroy(game, FREE_MEMORY | FREE_SDL | FREE_SDL_AUDIO | FREE_WINDOW |
+            FREE_RENDERER | FREE_ATLAS | FREE_SOUND | FREE_PLAYER | FREE_CAMERA | FREE_ENEMIES | FREE_FLOOR |
+            FREE_WORLD);
+        exit(EXIT_FAILURE);
+    }
+}
+
+/**
+ * The field covers the view and a margin around it, which is as
+ * much of the world as is worth routing through. Enemies beyond
+ * it walk straight at the player until they get closer.
+ */
+static void __init_flow_field(Game* game) {
+    game->flow = init_flow_field(
+        __flow_field_origin(game),
+        game->width + 2 * FLOW_FIELD_MARGIN,
+        game->height + 2 * FLOW_FIELD_MARGIN,
+        TILE_SIZE
+    );
+    __block_walls(game);
+}
+
+/**
+ * The camera's position is whole and never negative, so dividing
+ * rounds down to the tile under it. The margin is a whole number
+ * of tiles, so the field's cells are the map's tiles.
+ */
+static Point2d __flow_field_origin(Game* game) {
+    int32_t col = (int32_t)game->camera->position.x / TILE_SIZE - FLOW_FIELD_MARGIN / TILE_SIZE;
+    int32_t row = (int32_t)game->camera->position.y / TILE_SIZE - FLOW_FIELD_MARGIN / TILE_SIZE;
+    return (Point2d){ (float)(col * TILE_SIZE), (float)(row * TILE_SIZE) };
+}
+
+/**
+ * Each wall blocks exactly one cell. Tiles outside the map are
+ * never walls, so the field may reach past the map's edges.
+ */
+static void __block_walls(Game* game) {
+    int32_t col0 = (int32_t)game->flow->origin.x / TILE_SIZE;
+    int32_t row0 = (int32_t)game->flow->origin.y / TILE_SIZE;
+    for (int32_t row = 0; row < game->flow->rows; row++) {
+        for (int32_t col = 0; col < game->flow->cols; col++) {
+            if (is_wall(game->map, col0 + col, row0 + row)) set_flow_field_blocked(game->flow, col, row, true);
+        }
+    }
+}
+
+/**
+ * The camera follows the middle of the player's sprite. The field
+ * only moves once the camera has scrolled onto another tile, which
+ * is also when the player has likely changed cells and the field
+ * would be recomputed anyway.
+ */
+static void __follow_player(Game* game) {
+    Point2d* position = player_position(game->player);
+    Point2d focus = {
+        position->x + game->player->texture_width / 2.0f,
+        position->y + game->player->texture_height / 2.0f
+    };
+    update_camera(game->camera, &focus);
+
+    Point2d origin = __flow_field_origin(game);
+    if (origin.x != game->flow->origin.x || origin.y != game->flow->origin.y) {
+        set_flow_field_origin(game->flow, origin);
+        __block_walls(game);
+    }
+}
+
+/**
+ * If we fail to start the threads we terminate here but first
+ * release all other resources.
+ */
+static void __init_jobs(Game* game) {
+    game->jobs = init_job_system(__worker_threads(game, false));
+    if (game->jobs == NULL) {
+        __destroy(game, FREE_ALL & ~FREE_LATENCY & ~FREE_JOBS);
+        exit(EXIT_FAILURE);
+    }
+}
+
+/**
+ * Pipelined, the main thread blits while the update runs, so the
+ * other threads are split between the two, the update getting the
+ * odd one. Otherwise the two never run at once and each gets all of
+ * them, the idle ones sleeping.
+ */
+static int32_t __worker_threads(Game* game, bool drawing) {
+    int32_t others = (game->threads < 0 ? SDL_GetCPUCount() : game->threads) - 1;
+    if (others < 0) others = 0;
+    if (!game->pipelined || !game->software_blit) return others;
+    return drawing ? others / 2 : others - others / 2;
+}
+
+/**
+ * Nothing is simulated yet, so both snapshots show the first frame
+ * until the first simulated one replaces one of them.
+ */
+static void __init_snapshots(Game* game) {
+    for (int32_t i = 0; i < 2; i++) {
+        game->snapshots[i] = init_snapshot(game->camera);
+        capture_player(game->player, game->snapshots[i]);
+        capture_enemies(game->enemies, game->snapshots[i]);
+    }
+}
+
+/**
+ * The atlas kept its surface for this. The tiles share the threads
+ * with the update, see __worker_threads. If the blitter cannot be created, the atlas
+ * cannot be given to it or its threads cannot be started, we
+ * terminate here but first release all other resources.
+ */
+static void __init_blitter(Game* game) {
+    if (!game->software_blit) return;
+
+    game->blitter = init_blitter(game->renderer, game->window_surface ? game->window : NULL, game->width, game->height);
+    if (game->blitter == NULL
+        || !add_blit_image(game->blitter, game->atlas->texture, game->atlas->surface)) {
+        __destroy(game, FREE_ALL & ~FREE_LATENCY & ~FREE_JOBS);
+        exit(EXIT_FAILURE);
+    }
+
+    game->draw_jobs = init_job_system(__worker_threads(game, true));
+    if (game->draw_jobs == NULL) {
+        __destroy(game, FREE_ALL & ~FREE_LATENCY & ~FREE_JOBS);
+        exit(EXIT_FAILURE);
+    }
+}
+
+/**
+ * Frames are only read back if they go somewhere. If there are no
+ * frames to capture, or the capture cannot be started, we terminate
+ * here but first release all other resources.
+ */
+static void __init_capture(Game* game) {
+    if (game->capture_directory == NULL && game->golden_directory == NULL) return;
+
+    game->capture = init_frame_capture(
+        game->capture_frames,
+        game->max_frames,
+        game->capture_directory,
+        game->golden_directory,
+        game->capture_tolerance
+    );
+    if (game->capture == NULL) {
+        __destroy(game, FREE_ALL & ~FREE_LATENCY & ~FREE_CAPTURE);
+        exit(EXIT_FAILURE);
+    }
+}
+
+/**
+ * The probe's report is labeled with the pacing settings so runs
+ * with different settings can be told apart. If we fail to start
+ * the probe we terminate here but first release all other resources.
+ */
+static void __init_latency_probe(Game* game) {
+    if (game->latency_interval == 0) return;
+
+    char label[128];
+    snprintf(
+        label,
+        sizeof(label),
+        "%s, vsync %s, fps cap %d, %s",
+        game->headless ? "headless" : "windowed",
+        game->vsync ? "on" : "off",
+        game->fps_cap,
+        game->pipelined ? "pipelined" : "serial"
+    );
+
+    game->latency = init_latency_probe(game->latency_interval, label);
+    if (game->latency == NULL) {
+        __destroy(game, FREE_ALL & ~FREE_LATENCY);
         exit(EXIT_FAILURE);
     }
 }
@@ -569,26 +1502,129 @@ static void __process_events(Game* game) {
 }
 
 /**
- * Calls update on all update-able game objects.
+ * Calls update on all update-able game objects, as a graph of
+ * tasks: the player first, then the enemies in chunks spread over
+ * the threads, then what the chunks left for one thread, then the
+ * capture of what the frame shows. The graph is built anew each
+ * frame, which costs a few stores.
+ *
+ * When pipelined, the tasks are left running and the frame captured
+ * last time is drawn meanwhile. They are waited for at the start of
+ * the next frame, so input is seen a frame later. The simulation
+ * gets its own copy of the events and delta time, the only state it
+ * shares with the main thread while running.
  */
 static void __update(Game* game) {
 
-    // if (player_enemy_collision(&game->player->collider, game->enemies)) { ... game over stuff ... }
+    // if (player_enemy_collision(player_collider(game->player), game->enemies)) { ... game over stuff ... }
 
-    update_player(game->player, game->gevts, game->gclock->dt, game->width, game->height);
-    update_enemies(game->enemies, game->gclock->dt, &game->player->position);
+    if (game->pipelined) {
+        wait_tasks(game->jobs);
+        __end_simulation(game);
+    }
+
+    copy_game_events(&game->sim_events, game->gevts);
+    game->sim_dt = game->gclock->dt;
+
+    Task* prepare = add_task(game->jobs, __prepare_frame, game, 1, 1);
+    game->enemy_rows = add_task(game->jobs, __update_enemy_chunk, game, game->enemies->max_enemies, ENEMY_CHUNK);
+    Task* finish = add_task(game->jobs, __finish_frame, game, 1, 1);
+    Task* capture = add_task(game->jobs, __capture_frame, game, 1, 1);
+    add_dependency(prepare, game->enemy_rows);
+    add_dependency(game->enemy_rows, finish);
+    add_dependency(finish, capture);
+
+    if (game->pipelined) {
+        start_tasks(game->jobs);
+    } else {
+        run_tasks(game->jobs);
+        __end_simulation(game);
+    }
+}
+
+/**
+ * Sound goes through SDL and the probe reads the player, so both
+ * wait for the simulation to be done, on the main thread. The
+ * first pipelined frame swaps two snapshots of the same start.
+ */
+static void __end_simulation(Game* game) {
+    if (game->player->shots > 0) play_shot(game->sound);
+    if (game->latency) latency_after_update(game->latency, player_facing(game->player));
+    game->front = 1 - game->front;
+}
+
+/**
+ * The player moves first, so the camera and flow field follow it
+ * to where it is this frame, and enemies spawn out of that view.
+ * Spawning is done, so the number of rows is known here.
+ */
+static void __prepare_frame(void* data, int32_t begin, int32_t end) {
+    (void)begin;
+    (void)end;
+    Game* game = (Game*)data;
+    update_player(game->player, &game->sim_events, game->sim_dt, game->camera, game->map);
+    __follow_player(game);
+    spawn_enemy_waves(game->enemies, game->camera, game->sim_dt);
+    update_flow_field(game->flow, &player_collider(game->player)->center);
+    begin_enemy_update(game->enemies, game->sim_dt);
+    set_task_count(game->enemy_rows, game->enemies->archetype->count);
+}
+
+/**
+ * Chunks share nothing they write but the rows they are given.
+ */
+static void __update_enemy_chunk(void* data, int32_t begin, int32_t end) {
+    Game* game = (Game*)data;
+    update_enemy_rows(game->enemies, game->enemies->archetype, begin, end,
+        game->flow, game->map, player_position(game->player));
+}
+
+/**
+ * Runs once every chunk is done, so rows can move again.
+ */
+static void __finish_frame(void* data, int32_t begin, int32_t end) {
+    (void)begin;
+    (void)end;
+    end_enemy_update(((Game*)data)->enemies);
 }
 
 /**
- * We start by clearing the screen with black, then render all objects of the game.
+ * The snapshot not being drawn is the one drawn next.
+ */
+static void __capture_frame(void* data, int32_t begin, int32_t end) {
+    (void)begin;
+    (void)end;
+    Game* game = (Game*)data;
+    Snapshot* snapshot = game->snapshots[1 - game->front];
+    clear_snapshot(snapshot, game->camera);
+    capture_player(game->player, snapshot);
+    capture_enemies(game->enemies, snapshot);
+}
+
+/**
+ * We start by clearing the screen with black, then render all objects
+ * of the game as the front snapshot shows them. Only textures and the
+ * map, which no task changes, are read from the objects themselves.
+ * The objects only add commands, which are drawn layer by layer, with
+ * each layer grouped by texture, once all are in. A captured frame is
+ * read back before it is presented, while the renderer still holds it.
  */
 static void __render(Game* game) {
-    SDL_SetRenderDrawColor(game->renderer, 255, 255, 255, 255);
-    SDL_RenderClear(game->renderer);
+    Snapshot* snapshot = game->snapshots[game->front];
+
+    if (game->blitter) {
+        clear_blitter(game->blitter, (SDL_Color){ 255, 255, 255, 255 });
+    } else {
+        SDL_SetRenderDrawColor(game->renderer, 255, 255, 255, 255);
+        SDL_RenderClear(game->renderer);
+    }
 
-    draw_floor(game->renderer, game->floor, game->width, game->height);
-    draw_enemies(game->renderer, game->enemies, game->width, game->height);
-    draw_player(game->renderer, game->player);
+    draw_floor(game->commands, game->floor, game->map, &snapshot->camera);
+    draw_enemies(game->commands, game->enemies, snapshot);
+    draw_player(game->commands, game->player, snapshot);
+    if (game->blitter) blit_render_buffer(game->blitter, game->commands, game->renderer, game->draw_jobs);
+    else submit_render_buffer(game->commands, game->renderer, game->scratch);
+    if (game->capture) capture_frame(game->capture, game->renderer, game->frame + 1);
 
-    SDL_RenderPresent(game->renderer);
+    if (!game->window_surface) SDL_RenderPresent(game->renderer);
 }
\ No newline at end of file
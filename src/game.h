@@ -19,6 +19,19 @@
 #include "floor.h"
 #include "sound.h"
 #include "enemies.h"
+#include "latency.h"
+#include "flowfield.h"
+#include "tilemap.h"
+#include "camera.h"
+#include "ecs.h"
+#include "jobs.h"
+#include "snapshot.h"
+#include "render.h"
+#include "blitter.h"
+#include "capture.h"
+#include "atlas.h"
+#include "arena.h"
+#include "alloctrack.h"
 
 /**
  * Struct:
@@ -32,37 +45,176 @@
  *      The window's width.
  *  - height:
  *      The window's height
+ *  - world_width:
+ *      The width of the world, at least the window's.
+ *  - world_height:
+ *      The height of the world, at least the window's.
  *  - window:
  *      The type used to identify a window.
  *  - renderer:
  *      A structure that contains a rendering state.
+ *  - texture_format:
+ *      The pixel format textures are loaded in, one the renderer
+ *      draws from without converting.
+ *  - atlas:
+ *      Every sprite, in one texture.
  *  - running:
  *      Should the game loop keep running?
  *  - gclock:
  *      Keeps track of time between loops.
  *  - gevts:
  *      Maps SDL events to game specific events.
+ *  - world:
+ *      The entities, the player and the enemies.
  *  - player:
  *      Handles everything player related.
  *  - enemies:
  *      Handles everything enemy related.
+ *  - flow:
+ *      Leads the enemies to the player.
+ *  - map:
+ *      The level's walls.
+ *  - map_path:
+ *      The file the level is loaded from.
+ *  - camera:
+ *      The part of the world shown, following the player.
  *  - floor:
  *      To draw the background.
  *  - sound:
  *      The game's sound subsystem, which handles playing sounds.
+ *  - audio_frequency:
+ *      The requested audio output frequency in Hz.
+ *  - audio_chunk_size:
+ *      The requested number of sample frames per mixer buffer.
+ *  - headless:
+ *      Run with SDL's dummy drivers and the software renderer.
+ *  - vsync:
+ *      Synchronize presenting with the display's refresh rate.
+ *  - fps_cap:
+ *      The highest frame rate allowed, 0 if uncapped.
+ *  - frame:
+ *      The number of frames played so far.
+ *  - max_frames:
+ *      Stop after this many frames, 0 to keep going until quit.
+ *  - latency_interval:
+ *      Milliseconds between latency probe events, 0 if not probing.
+ *  - latency:
+ *      Measures input-to-photon latency, NULL if not probing.
+ *  - threads:
+ *      The number of threads updating and blitting a frame, the main
+ *      one included, -1 for one per core.
+ *  - jobs:
+ *      Runs each frame's update as a graph of tasks on those threads,
+ *      or on its share of them while the blitter draws.
+ *  - enemy_rows:
+ *      The task updating the enemies' rows this frame, told how many
+ *      there are by the task before it.
+ *  - pipelined:
+ *      Simulate the next frame while the current one is drawn.
+ *  - snapshots:
+ *      What the last two simulated frames show, one drawn while the
+ *      other is captured.
+ *  - front:
+ *      The index of the snapshot being drawn.
+ *  - sim_events:
+ *      The events the frame being simulated reads, copied so the
+ *      next frame's can be polled meanwhile.
+ *  - sim_dt:
+ *      The delta time of the frame being simulated.
+ *  - commands:
+ *      The frame's draw commands, sorted and submitted at once.
+ *  - scratch:
+ *      Memory for the frame being played, taken back when the next
+ *      one starts.
+ *  - software_blit:
+ *      Draw the commands on the CPU and upload the frame as one texture.
+ *  - window_surface:
+ *      Whether the renderer draws into the window's surface, which
+ *      the blitter then presents to, only when software_blit is set.
+ *  - blitter:
+ *      Draws the commands when software_blit is set, NULL otherwise.
+ *  - draw_jobs:
+ *      The threads drawing the blitter's tiles, apart from jobs since
+ *      those simulate the next frame meanwhile, NULL without a blitter.
+ *  - seed:
+ *      What the random generator is seeded with.
+ *  - seeded:
+ *      Whether the seed was given, in which case every frame is a
+ *      fixed step apart so runs play out the same.
+ *  - capture_frames:
+ *      The frames read back, numbers separated by commas, NULL for
+ *      the last one.
+ *  - capture_directory:
+ *      Where captured frames are saved, NULL to not save them.
+ *  - golden_directory:
+ *      Where captured frames are compared to, NULL to not compare.
+ *  - capture_tolerance:
+ *      How far apart a channel of a pixel may be from the golden one.
+ *  - capture:
+ *      Reads back the chosen frames, NULL if there is nowhere to
+ *      save or compare them.
+ *  - track_allocs:
+ *      Count the allocations made each frame and log them on exit.
+ *  - alloc_warmup:
+ *      The number of frames allocating is allowed in, after which an
+ *      allocation aborts the game, 0 to always allow it.
+ *  - compact_enemies:
+ *      Keep enemies as PackedEnemy rather than in floats.
  */
 typedef struct {
     int32_t         width;
     int32_t         height;
+    int32_t         world_width;
+    int32_t         world_height;
     SDL_Window*     window;
     SDL_Renderer*   renderer;
+    Uint32          texture_format;
+    Atlas*          atlas;
     bool            running;
     GameClock*      gclock;
     GameEvents*     gevts;
+    World*          world;
     Player*         player;
     Enemies*        enemies;
+    FlowField*      flow;
+    TileMap*        map;
+    const char*     map_path;
+    Camera*         camera;
     Floor*          floor;
     Sound*          sound;
+    int32_t         audio_frequency;
+    int32_t         audio_chunk_size;
+    bool            headless;
+    bool            vsync;
+    int32_t         fps_cap;
+    uint64_t        frame;
+    uint64_t        max_frames;
+    int32_t         latency_interval;
+    LatencyProbe*   latency;
+    int32_t         threads;
+    JobSystem*      jobs;
+    Task*           enemy_rows;
+    bool            pipelined;
+    Snapshot*       snapshots[2];
+    int32_t         front;
+    GameEvents      sim_events;
+    float           sim_dt;
+    RenderBuffer*   commands;
+    Arena*          scratch;
+    bool            software_blit;
+    bool            window_surface;
+    Blitter*        blitter;
+    JobSystem*      draw_jobs;
+    uint32_t        seed;
+    bool            seeded;
+    const char*     capture_frames;
+    const char*     capture_directory;
+    const char*     golden_directory;
+    int32_t         capture_tolerance;
+    FrameCapture*   capture;
+    bool            track_allocs;
+    uint64_t        alloc_warmup;
+    bool            compact_enemies;
 } Game;
 
 /**
@@ -94,9 +246,10 @@ Game* init_game(int32_t argc, char** argv);
  *  A Game object
  *
  * Returns:
- *  Nothing.
+ *  EXIT_SUCCESS, or EXIT_FAILURE if a captured frame did not match
+ *  its golden image.
  */
-void start_game(Game* game);
+int32_t start_game(Game* game);
 
 /**
  * Function:
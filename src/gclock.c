@@ -28,6 +28,23 @@ void update_game_clock(GameClock* gclock) {
     gclock->fps = 1.0f/gclock->dt;
 }
 
+/**
+ * GameClock::now holds the start of the frame. SDL_Delay only has
+ * millisecond resolution, so we sleep the whole milliseconds left
+ * and spin for the remainder.
+ */
+void limit_frame_rate(GameClock* gclock, int32_t fps) {
+    Uint64 frequency = SDL_GetPerformanceFrequency();
+    Uint64 end = gclock->now + frequency / fps;
+    Uint64 now = SDL_GetPerformanceCounter();
+
+    if (now >= end) return;
+
+    Uint32 ms = (Uint32)((end - now) * 1000 / frequency);
+    if (ms > 1) SDL_Delay(ms - 1);
+    while (SDL_GetPerformanceCounter() < end);
+}
+
 /**
  * Free memory of GameClock struct.
  */
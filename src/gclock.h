@@ -2,6 +2,7 @@
 #define JqdBnUmofN_GCLOCK_H
 
 #include <stdlib.h>
+#include <stdint.h>
 
 #include <SDL2/SDL.h>
 
@@ -59,6 +60,25 @@ GameClock* init_game_clock(void);
  */
 void update_game_clock(GameClock* gclock);
 
+/**
+ * Function:
+ *  limit_frame_rate
+ *
+ * Purpose:
+ *  Sleep out the rest of the frame so the game runs no
+ *  faster than the given frame rate.
+ *
+ * Parameters:
+ *  - gclock:
+ *      The GameClock object.
+ *  - fps:
+ *      The highest allowed frames per second.
+ *
+ * Returns:
+ *  Nothing.
+ */
+void limit_frame_rate(GameClock* gclock, int32_t fps);
+
 /**
  * Function:
  *  destroy_game_clock
@@ -1,5 +1,8 @@
 #include "gevent.h"
 
+// Warning when input was lost because the queue was full
+static const char DROPPED_INPUT_LOG[] = "Input queue overflowed, %u events dropped";
+
 /**
  * Function:
  *  __set_to_default
@@ -33,6 +36,33 @@ static void __set_to_default(GameEvents* gevts);
  */
 static void __poll_events(GameEvents* gevts);
 
+/**
+ * Function:
+ *  __push_input
+ *
+ * Purpose:
+ *  Append an input event to the queue, overwriting the
+ *  oldest one if the queue is full.
+ *
+ * Parameters:
+ *  - queue:
+ *      The InputQueue object.
+ *  - type:
+ *      The kind of event.
+ *  - timestamp:
+ *      When the event happened.
+ *  - x:
+ *      The horizontal mouse coordinate.
+ *  - y:
+ *      The vertical mouse coordinate.
+ *  - code:
+ *      The mouse button or scancode.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __push_input(InputQueue* queue, InputType type, Uint32 timestamp, int32_t x, int32_t y, int32_t code);
+
 /**
  * Function:
  *  __keyboard_state
@@ -57,27 +87,60 @@ static void __keyboard_state(GameEvents* gevts);
 GameEvents* init_game_events(void) {
     GameEvents* gevts = (GameEvents*)malloc(sizeof(GameEvents));
     __set_to_default(gevts);
+    gevts->queue.head = gevts->queue.tail = gevts->queue.dropped = 0;
+    SDL_GetMouseState(&gevts->mouseX, &gevts->mouseY);
     return gevts;
 }
 
 /**
- * Default all values to false, check for exits and then movement and finally
- * updates mouse position and checks if mouse button 1 is down.
+ * Default all values to false and drop whatever input was left unread
+ * last frame. The poll then queues this frame's input, checks for exits
+ * and tracks the mouse position, then we check movement and finally if
+ * mouse button 1 is down.
  */
 void process_events(GameEvents* gevts) {
     __set_to_default(gevts);
+    gevts->queue.head = gevts->queue.tail;
     __poll_events(gevts);
     __keyboard_state(gevts);
 
-    // Pointers are set to mouse position, while the masked value that
-    // SDL_GetMouseState returns is 1 if mouse button 1 is down, otherwise 0.
-    gevts->shoot = SDL_GetMouseState(&gevts->mouseX, &gevts->mouseY) & SDL_BUTTON(1);
+    // The masked value that SDL_GetMouseState returns is 1 if mouse
+    // button 1 is down, otherwise 0.
+    gevts->shoot = SDL_GetMouseState(NULL, NULL) & SDL_BUTTON(1);
+}
+
+/**
+ * Reads from the head of the ring buffer, head and tail only
+ * ever grow so they are equal when the queue is empty.
+ */
+bool next_input(GameEvents* gevts, InputEvent* evt) {
+    InputQueue* queue = &gevts->queue;
+    if (queue->head == queue->tail) return false;
+    *evt = queue->events[queue->head++ & (INPUT_QUEUE_CAPACITY - 1)];
+    return true;
 }
 
 /**
- * Free memory of GameEvent struct.
+ * Everything before the queue is a few bytes, while the ring
+ * buffer is 20 KB of which a frame uses a handful of events.
+ * The events keep their slots, so head and tail carry over.
+ */
+void copy_game_events(GameEvents* dst, GameEvents* src) {
+    memcpy(dst, src, offsetof(GameEvents, queue));
+    dst->queue.head = src->queue.head;
+    dst->queue.tail = src->queue.tail;
+    dst->queue.dropped = src->queue.dropped;
+    for (uint32_t i = src->queue.head; i != src->queue.tail; i++) {
+        dst->queue.events[i & (INPUT_QUEUE_CAPACITY - 1)] = src->queue.events[i & (INPUT_QUEUE_CAPACITY - 1)];
+    }
+}
+
+/**
+ * Free memory of GameEvent struct, warn first if the
+ * input queue ever had to drop events.
  */
 void destroy_game_events(GameEvents* gevts) {
+    if (gevts->queue.dropped > 0) SDL_Log(DROPPED_INPUT_LOG, gevts->queue.dropped);
     free(gevts);
 }
 
@@ -96,10 +159,13 @@ void __set_to_default(GameEvents* gevts) {
 }
 
 /**
- * The standard SDL event loop, looking for game exits.
+ * The standard SDL event loop, looking for game exits. Mouse and key
+ * edges are queued in order so sub-frame input is not lost, and the
+ * mouse position follows the latest motion event.
  */
 static void __poll_events(GameEvents* gevts) {
     SDL_Event event;
+    InputQueue* queue = &gevts->queue;
     while (SDL_PollEvent(&event)) {
         switch (event.type) {
             case SDL_KEYDOWN:
@@ -108,6 +174,28 @@ static void __poll_events(GameEvents* gevts) {
                         gevts->quit = true;
                         break;
                 }
+                if (!event.key.repeat) {
+                    __push_input(queue, INPUT_KEY_DOWN, event.key.timestamp,
+                        gevts->mouseX, gevts->mouseY, event.key.keysym.scancode);
+                }
+                break;
+            case SDL_KEYUP:
+                __push_input(queue, INPUT_KEY_UP, event.key.timestamp,
+                    gevts->mouseX, gevts->mouseY, event.key.keysym.scancode);
+                break;
+            case SDL_MOUSEMOTION:
+                gevts->mouseX = event.motion.x;
+                gevts->mouseY = event.motion.y;
+                __push_input(queue, INPUT_MOUSE_MOTION, event.motion.timestamp,
+                    event.motion.x, event.motion.y, 0);
+                break;
+            case SDL_MOUSEBUTTONDOWN:
+                __push_input(queue, INPUT_MOUSE_DOWN, event.button.timestamp,
+                    event.button.x, event.button.y, event.button.button);
+                break;
+            case SDL_MOUSEBUTTONUP:
+                __push_input(queue, INPUT_MOUSE_UP, event.button.timestamp,
+                    event.button.x, event.button.y, event.button.button);
                 break;
             case SDL_QUIT:
                 gevts->quit = true;
@@ -116,6 +204,19 @@ static void __poll_events(GameEvents* gevts) {
     }
 }
 
+/**
+ * If the queue is full, the oldest event is overwritten since the
+ * newest input matters the most. The capacity is a power of two
+ * so wrapping is a mask.
+ */
+static void __push_input(InputQueue* queue, InputType type, Uint32 timestamp, int32_t x, int32_t y, int32_t code) {
+    if (queue->tail - queue->head == INPUT_QUEUE_CAPACITY) {
+        queue->head++;
+        queue->dropped++;
+    }
+    queue->events[queue->tail++ & (INPUT_QUEUE_CAPACITY - 1)] = (InputEvent){ type, timestamp, x, y, code };
+}
+
 /**
  * A player is moving left if he presses A but not D.
  * A player is moving right if he presses D but not A.
@@ -2,11 +2,96 @@
 #define CupWKT1yp6_GEVENT_H
 
 #include <stdint.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
 
 #include <SDL2/SDL.h>
 
+// Number of input events the queue holds, must be a power of two.
+// A 1000 Hz mouse fills roughly a second's worth of frames.
+#define INPUT_QUEUE_CAPACITY 1024
+
+/**
+ * Enum:
+ *  InputType
+ *
+ * Purpose:
+ *  The kind of input event stored in the input queue.
+ *
+ * Constants:
+ *  - INPUT_MOUSE_MOTION:
+ *      The mouse moved.
+ *  - INPUT_MOUSE_DOWN:
+ *      A mouse button was pressed.
+ *  - INPUT_MOUSE_UP:
+ *      A mouse button was released.
+ *  - INPUT_KEY_DOWN:
+ *      A key was pressed (repeats are ignored).
+ *  - INPUT_KEY_UP:
+ *      A key was released.
+ */
+typedef enum {
+    INPUT_MOUSE_MOTION,
+    INPUT_MOUSE_DOWN,
+    INPUT_MOUSE_UP,
+    INPUT_KEY_DOWN,
+    INPUT_KEY_UP
+} InputType;
+
+/**
+ * Struct:
+ *  InputEvent
+ *
+ * Purpose:
+ *  A single timestamped input event.
+ *
+ * Fields:
+ *  - type:
+ *      What kind of event this is.
+ *  - timestamp:
+ *      When SDL received the event, in milliseconds.
+ *  - x:
+ *      The horizontal mouse coordinate when the event happened.
+ *  - y:
+ *      The vertical mouse coordinate when the event happened.
+ *  - code:
+ *      The mouse button or keyboard scancode, unused for motion.
+ */
+typedef struct {
+    InputType   type;
+    Uint32      timestamp;
+    int32_t     x;
+    int32_t     y;
+    int32_t     code;
+} InputEvent;
+
+/**
+ * Struct:
+ *  InputQueue
+ *
+ * Purpose:
+ *  A fixed size ring buffer of the input events polled this
+ *  frame, in the order they happened.
+ *
+ * Fields:
+ *  - events:
+ *      The ring buffer.
+ *  - head:
+ *      Counts events read, the oldest unread event is at head % capacity.
+ *  - tail:
+ *      Counts events written, the next event is written at tail % capacity.
+ *  - dropped:
+ *      How many events were overwritten before being read.
+ */
+typedef struct {
+    InputEvent  events[INPUT_QUEUE_CAPACITY];
+    uint32_t    head;
+    uint32_t    tail;
+    uint32_t    dropped;
+} InputQueue;
+
 /**
  * Struct:
  *  GameEvents
@@ -31,6 +116,8 @@
  *      The horizontal coordinate of the mouse this frame.
  *  - mouseY:
  *      The vertical coordinate of the mouse this frame.
+ *  - queue:
+ *      The input events of this frame in the order they happened.
  */
 typedef struct {
     bool        quit:1;
@@ -41,6 +128,7 @@ typedef struct {
     bool        shoot:1;
     int32_t     mouseX;
     int32_t     mouseY;
+    InputQueue  queue;
 } GameEvents;
 
 /**
@@ -74,6 +162,43 @@ GameEvents* init_game_events(void);
  */
 void process_events(GameEvents* gevts);
 
+/**
+ * Function:
+ *  next_input
+ *
+ * Purpose:
+ *  Take the oldest unread input event of this frame.
+ *
+ * Parameters:
+ *  - gevts:
+ *      The GameEvents object to read from.
+ *  - evt:
+ *      Set to the event read.
+ *
+ * Returns:
+ *  true if an event was read, false if there are none left.
+ */
+bool next_input(GameEvents* gevts, InputEvent* evt);
+
+/**
+ * Function:
+ *  copy_game_events
+ *
+ * Purpose:
+ *  Copy the state of this frame and its unread input events,
+ *  leaving the rest of the queue's ring buffer alone.
+ *
+ * Parameters:
+ *  - dst:
+ *      The GameEvents object to copy to.
+ *  - src:
+ *      The GameEvents object to copy from.
+ *
+ * Returns:
+ *  Nothing.
+ */
+void copy_game_events(GameEvents* dst, GameEvents* src);
+
 /**
  * Function:
  *  destroy_game_events
@@ -1,33 +1,86 @@
 #include "gmath.h"
 
+#if defined(__x86_64__) || defined(__i386__)
+#define GMATH_X86
+#include <immintrin.h>
+#endif
+
+// A float representation of PI
+static const float PI = 3.14159265358979323846f;
 // A float representation of PI/2
 static const float HALF_PI = 1.570796326794896619231f;
 // A float representation of 180 / PI
 static const float DEGREES_IN_ONE_RADIAN = 57.29577951308232f;
+// Coefficients of the fast_acos rational approximation
+static const float ACOS_A = 0.9217841528914573f;
+static const float ACOS_B = 0.939115566365855f;
+static const float ACOS_C = 0.295624144969963174f;
+static const float ACOS_D = 1.2845906244690837f;
+// Coefficients of the atan polynomial on [-1,1], odd powers 1 to 11
+static const float ATAN_C1 = 0.99997726f;
+static const float ATAN_C3 = -0.33262347f;
+static const float ATAN_C5 = 0.19354346f;
+static const float ATAN_C7 = -0.11643287f;
+static const float ATAN_C9 = 0.05265332f;
+static const float ATAN_C11 = -0.01172120f;
+// A float representation of PI / 180
+static const float RADIANS_IN_ONE_DEGREE = 0.017453292519943295f;
+// A float representation of 1 / (2*PI)
+static const float INV_TWO_PI = 0.15915494309189535f;
+// Coefficients of the sin polynomial on [-PI/2,PI/2], odd powers 1 to 9
+static const float SIN_C1 = 1.0f;
+static const float SIN_C3 = -0.16666667f;
+static const float SIN_C5 = 0.0083333333f;
+static const float SIN_C7 = -0.00019841270f;
+static const float SIN_C9 = 0.0000027557319f;
+
+/**
+ * Struct:
+ *  MathKernels
+ *
+ * Purpose:
+ *  The array functions of a single backend.
+ *
+ * Fields:
+ *  - inverse_sqrt:
+ *      Implementation of inverse_sqrt_array.
+ *  - acos:
+ *      Implementation of fast_acos_array.
+ *  - atan2:
+ *      Implementation of fast_atan2_array.
+ *  - normalize:
+ *      Implementation of normalize_array.
+ */
+typedef struct {
+	void (*inverse_sqrt)(const float*, float*, int32_t);
+	void (*acos)(const float*, float*, int32_t);
+	void (*atan2)(const float*, const float*, float*, int32_t);
+	void (*normalize)(float*, float*, int32_t);
+} MathKernels;
+
+// The backend in use, -1 until first chosen
+static int32_t backend = -1;
 
 
 /**
  * John Carmack's infamous inverse sqrt from Quake3 Arena.
  * (Not really his but he famously utilised it)
  *
- * Preprocessor directive added to supress warnings the
- * original code produces, otherwise directly taken from
- * Quake3's source.
+ * The original punned the float through a long, which is undefined
+ * behaviour and 64 bits wide on LP64. Here the bits are copied into a
+ * 32 bit integer instead, which compilers turn into a single move.
  */
 float carmack_inverse_sqrt(float x)
 {
-	long i;
+	uint32_t i;
 	float x2, y;
 	const float threehalfs = 1.5F;
 
 	x2 = x * 0.5F;
 	y  = x;
-	#pragma GCC diagnostic push
-	#pragma GCC diagnostic ignored "-Wstrict-aliasing"
-	i  = * (( long * ) &y);                       // evil floating point bit level hacking
+	memcpy(&i, &y, sizeof(i));                  // evil floating point bit level hacking
 	i  = 0x5f3759df - ( i >> 1 );               // what the fuck?
-	y  = * ( float * ) &i;
-	#pragma GCC diagnostic pop
+	memcpy(&y, &i, sizeof(y));
 	y  = y * ( threehalfs - ( x2 * y * y ) );   // 1st iteration
 	//	y  = y * ( threehalfs - ( x2 * y * y ) );   // 2nd iteration, this can be removed
 
@@ -40,8 +93,33 @@ float carmack_inverse_sqrt(float x)
  */
 float fast_acos(float x) {
 	float sq = x*x;
-	return HALF_PI + x * (0.9217841528914573f * sq - 0.939115566365855f) /
-		(1 + sq * (0.295624144969963174f * sq - 1.2845906244690837f));
+	return HALF_PI + x * (ACOS_A * sq - ACOS_B) /
+		(1 + sq * (ACOS_C * sq - ACOS_D));
+}
+
+/**
+ * Reduce to the first octant where the ratio a = min/max is in
+ * [0,1] and a polynomial approximates atan(a) well, then mirror
+ * the angle back:
+ *
+ *  |y| > |x|  =>  r = PI/2 - r
+ *  x < 0      =>  r = PI - r
+ *  y < 0      =>  r = -r
+ */
+float fast_atan2(float y, float x) {
+	float ax = x < 0 ? -x : x;
+	float ay = y < 0 ? -y : y;
+	float mx = ax > ay ? ax : ay;
+	float mn = ax > ay ? ay : ax;
+	if (mx == 0) return 0;
+
+	float a = mn / mx;
+	float s = a * a;
+	float r = a * (ATAN_C1 + s * (ATAN_C3 + s * (ATAN_C5 + s * (ATAN_C7 + s * (ATAN_C9 + s * ATAN_C11)))));
+
+	if (ay > ax) r = HALF_PI - r;
+	if (x < 0) r = PI - r;
+	return y < 0 ? -r : r;
 }
 
 /**
@@ -59,6 +137,36 @@ float rad_to_deg(float radians) {
 	return DEGREES_IN_ONE_RADIAN * radians;
 }
 
+float deg_to_rad(float degrees) {
+	return RADIANS_IN_ONE_DEGREE * degrees;
+}
+
+/**
+ * Remove whole turns to land in [-PI, PI], then mirror onto
+ * [-PI/2, PI/2] where the polynomial is accurate to about 1e-6:
+ *
+ *  x > PI/2   =>  sin(x) = sin(PI - x)
+ *  x < -PI/2  =>  sin(x) = sin(-PI - x)
+ *
+ * The turns are rounded by hand, which avoids libm.
+ */
+float fast_sin(float x) {
+	float turns = x * INV_TWO_PI;
+	x -= 2 * PI * (float)(int32_t)(turns + (turns < 0 ? -0.5f : 0.5f));
+	if (x > HALF_PI) x = PI - x;
+	else if (x < -HALF_PI) x = -PI - x;
+
+	float s = x * x;
+	return x * (SIN_C1 + s * (SIN_C3 + s * (SIN_C5 + s * (SIN_C7 + s * SIN_C9))));
+}
+
+/**
+ * A quarter turn ahead of the sine.
+ */
+float fast_cos(float x) {
+	return fast_sin(x + HALF_PI);
+}
+
 /**
  * if (x < 0) {
  *     return -1;
@@ -75,4 +183,329 @@ int sign(float x) {
  */
 float length_squared(Vector2d* vec) {
     return vec->x * vec->x + vec->y * vec->y;
+}
+
+/*****************
+ * Scalar arrays *
+ *****************/
+
+static void __inverse_sqrt_scalar(const float* in, float* out, int32_t n) {
+	for (int32_t i = 0; i < n; i++) out[i] = carmack_inverse_sqrt(in[i]);
+}
+
+static void __acos_scalar(const float* in, float* out, int32_t n) {
+	for (int32_t i = 0; i < n; i++) out[i] = fast_acos(in[i]);
+}
+
+static void __atan2_scalar(const float* y, const float* x, float* out, int32_t n) {
+	for (int32_t i = 0; i < n; i++) out[i] = fast_atan2(y[i], x[i]);
+}
+
+static void __normalize_scalar(float* x, float* y, int32_t n) {
+	for (int32_t i = 0; i < n; i++) {
+		float len_sq = x[i] * x[i] + y[i] * y[i];
+		if (len_sq > 0) {
+			float inv = carmack_inverse_sqrt(len_sq);
+			x[i] *= inv;
+			y[i] *= inv;
+		}
+	}
+}
+
+#ifdef GMATH_X86
+
+/**************
+ * SSE arrays *
+ **************
+ *
+ * Each loop handles four elements at a time. The last few
+ * elements are copied into a padded block so the tail runs
+ * through the same vector code as the rest.
+ */
+
+__attribute__((target("sse2")))
+static inline __m128 __rsqrt_ps(__m128 x) {
+	// One Newton step on the ~12 bit hardware estimate: y * (1.5 - 0.5*x*y*y)
+	__m128 y = _mm_rsqrt_ps(x);
+	__m128 hx = _mm_mul_ps(x, _mm_set1_ps(0.5f));
+	return _mm_mul_ps(y, _mm_sub_ps(_mm_set1_ps(1.5f), _mm_mul_ps(hx, _mm_mul_ps(y, y))));
+}
+
+__attribute__((target("sse2")))
+static inline __m128 __acos_ps(__m128 x) {
+	__m128 sq = _mm_mul_ps(x, x);
+	__m128 num = _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(ACOS_A), sq), _mm_set1_ps(ACOS_B));
+	__m128 den = _mm_add_ps(_mm_set1_ps(1.0f),
+		_mm_mul_ps(sq, _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(ACOS_C), sq), _mm_set1_ps(ACOS_D))));
+	return _mm_add_ps(_mm_set1_ps(HALF_PI), _mm_div_ps(_mm_mul_ps(x, num), den));
+}
+
+__attribute__((target("sse2")))
+static inline __m128 __atan2_ps(__m128 y, __m128 x) {
+	__m128 sign_bit = _mm_set1_ps(-0.0f);
+	__m128 ax = _mm_andnot_ps(sign_bit, x);
+	__m128 ay = _mm_andnot_ps(sign_bit, y);
+	__m128 mx = _mm_max_ps(ax, ay);
+	__m128 mn = _mm_min_ps(ax, ay);
+
+	// Guard the zero vector, 0/tiny is 0 which gives an angle of 0
+	__m128 a = _mm_div_ps(mn, _mm_max_ps(mx, _mm_set1_ps(1e-30f)));
+	__m128 s = _mm_mul_ps(a, a);
+	__m128 p = _mm_set1_ps(ATAN_C11);
+	p = _mm_add_ps(_mm_mul_ps(p, s), _mm_set1_ps(ATAN_C9));
+	p = _mm_add_ps(_mm_mul_ps(p, s), _mm_set1_ps(ATAN_C7));
+	p = _mm_add_ps(_mm_mul_ps(p, s), _mm_set1_ps(ATAN_C5));
+	p = _mm_add_ps(_mm_mul_ps(p, s), _mm_set1_ps(ATAN_C3));
+	p = _mm_add_ps(_mm_mul_ps(p, s), _mm_set1_ps(ATAN_C1));
+	__m128 r = _mm_mul_ps(a, p);
+
+	__m128 steep = _mm_cmpgt_ps(ay, ax);
+	r = _mm_or_ps(_mm_and_ps(steep, _mm_sub_ps(_mm_set1_ps(HALF_PI), r)), _mm_andnot_ps(steep, r));
+	__m128 left = _mm_cmplt_ps(x, _mm_setzero_ps());
+	r = _mm_or_ps(_mm_and_ps(left, _mm_sub_ps(_mm_set1_ps(PI), r)), _mm_andnot_ps(left, r));
+	return _mm_or_ps(r, _mm_and_ps(sign_bit, y));
+}
+
+__attribute__((target("sse2")))
+static void __inverse_sqrt_sse(const float* in, float* out, int32_t n) {
+	int32_t i = 0;
+	for (; i + 4 <= n; i += 4) _mm_storeu_ps(out + i, __rsqrt_ps(_mm_loadu_ps(in + i)));
+	if (i < n) {
+		float block[4] = { 1, 1, 1, 1 };
+		memcpy(block, in + i, (n - i) * sizeof(float));
+		_mm_storeu_ps(block, __rsqrt_ps(_mm_loadu_ps(block)));
+		memcpy(out + i, block, (n - i) * sizeof(float));
+	}
+}
+
+__attribute__((target("sse2")))
+static void __acos_sse(const float* in, float* out, int32_t n) {
+	int32_t i = 0;
+	for (; i + 4 <= n; i += 4) _mm_storeu_ps(out + i, __acos_ps(_mm_loadu_ps(in + i)));
+	if (i < n) {
+		float block[4] = { 0, 0, 0, 0 };
+		memcpy(block, in + i, (n - i) * sizeof(float));
+		_mm_storeu_ps(block, __acos_ps(_mm_loadu_ps(block)));
+		memcpy(out + i, block, (n - i) * sizeof(float));
+	}
+}
+
+__attribute__((target("sse2")))
+static void __atan2_sse(const float* y, const float* x, float* out, int32_t n) {
+	int32_t i = 0;
+	for (; i + 4 <= n; i += 4) _mm_storeu_ps(out + i, __atan2_ps(_mm_loadu_ps(y + i), _mm_loadu_ps(x + i)));
+	if (i < n) {
+		float by[4] = { 0, 0, 0, 0 }, bx[4] = { 0, 0, 0, 0 };
+		memcpy(by, y + i, (n - i) * sizeof(float));
+		memcpy(bx, x + i, (n - i) * sizeof(float));
+		_mm_storeu_ps(by, __atan2_ps(_mm_loadu_ps(by), _mm_loadu_ps(bx)));
+		memcpy(out + i, by, (n - i) * sizeof(float));
+	}
+}
+
+__attribute__((target("sse2")))
+static inline void __normalize_block_sse(float* x, float* y) {
+	__m128 vx = _mm_loadu_ps(x);
+	__m128 vy = _mm_loadu_ps(y);
+	__m128 len_sq = _mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy));
+	// Zero vectors would get an infinite scale, keep them as they are
+	__m128 nonzero = _mm_cmpgt_ps(len_sq, _mm_setzero_ps());
+	__m128 inv = _mm_and_ps(nonzero, __rsqrt_ps(len_sq));
+	inv = _mm_or_ps(inv, _mm_andnot_ps(nonzero, _mm_set1_ps(1.0f)));
+	_mm_storeu_ps(x, _mm_mul_ps(vx, inv));
+	_mm_storeu_ps(y, _mm_mul_ps(vy, inv));
+}
+
+__attribute__((target("sse2")))
+static void __normalize_sse(float* x, float* y, int32_t n) {
+	int32_t i = 0;
+	for (; i + 4 <= n; i += 4) __normalize_block_sse(x + i, y + i);
+	if (i < n) {
+		float bx[4] = { 0, 0, 0, 0 }, by[4] = { 0, 0, 0, 0 };
+		memcpy(bx, x + i, (n - i) * sizeof(float));
+		memcpy(by, y + i, (n - i) * sizeof(float));
+		__normalize_block_sse(bx, by);
+		memcpy(x + i, bx, (n - i) * sizeof(float));
+		memcpy(y + i, by, (n - i) * sizeof(float));
+	}
+}
+
+/***************
+ * AVX2 arrays *
+ ***************
+ *
+ * Same formulas as the SSE versions, eight elements at a time
+ * with fused multiply-adds.
+ */
+
+__attribute__((target("avx2,fma")))
+static inline __m256 __rsqrt_ps256(__m256 x) {
+	__m256 y = _mm256_rsqrt_ps(x);
+	__m256 hx = _mm256_mul_ps(x, _mm256_set1_ps(0.5f));
+	return _mm256_mul_ps(y, _mm256_fnmadd_ps(hx, _mm256_mul_ps(y, y), _mm256_set1_ps(1.5f)));
+}
+
+__attribute__((target("avx2,fma")))
+static inline __m256 __acos_ps256(__m256 x) {
+	__m256 sq = _mm256_mul_ps(x, x);
+	__m256 num = _mm256_fmsub_ps(_mm256_set1_ps(ACOS_A), sq, _mm256_set1_ps(ACOS_B));
+	__m256 den = _mm256_fmadd_ps(sq, _mm256_fmsub_ps(_mm256_set1_ps(ACOS_C), sq, _mm256_set1_ps(ACOS_D)),
+		_mm256_set1_ps(1.0f));
+	return _mm256_add_ps(_mm256_set1_ps(HALF_PI), _mm256_div_ps(_mm256_mul_ps(x, num), den));
+}
+
+__attribute__((target("avx2,fma")))
+static inline __m256 __atan2_ps256(__m256 y, __m256 x) {
+	__m256 sign_bit = _mm256_set1_ps(-0.0f);
+	__m256 ax = _mm256_andnot_ps(sign_bit, x);
+	__m256 ay = _mm256_andnot_ps(sign_bit, y);
+	__m256 mx = _mm256_max_ps(ax, ay);
+	__m256 mn = _mm256_min_ps(ax, ay);
+
+	__m256 a = _mm256_div_ps(mn, _mm256_max_ps(mx, _mm256_set1_ps(1e-30f)));
+	__m256 s = _mm256_mul_ps(a, a);
+	__m256 p = _mm256_set1_ps(ATAN_C11);
+	p = _mm256_fmadd_ps(p, s, _mm256_set1_ps(ATAN_C9));
+	p = _mm256_fmadd_ps(p, s, _mm256_set1_ps(ATAN_C7));
+	p = _mm256_fmadd_ps(p, s, _mm256_set1_ps(ATAN_C5));
+	p = _mm256_fmadd_ps(p, s, _mm256_set1_ps(ATAN_C3));
+	p = _mm256_fmadd_ps(p, s, _mm256_set1_ps(ATAN_C1));
+	__m256 r = _mm256_mul_ps(a, p);
+
+	r = _mm256_blendv_ps(r, _mm256_sub_ps(_mm256_set1_ps(HALF_PI), r), _mm256_cmp_ps(ay, ax, _CMP_GT_OQ));
+	r = _mm256_blendv_ps(r, _mm256_sub_ps(_mm256_set1_ps(PI), r), _mm256_cmp_ps(x, _mm256_setzero_ps(), _CMP_LT_OQ));
+	return _mm256_or_ps(r, _mm256_and_ps(sign_bit, y));
+}
+
+__attribute__((target("avx2,fma")))
+static void __inverse_sqrt_avx2(const float* in, float* out, int32_t n) {
+	int32_t i = 0;
+	for (; i + 8 <= n; i += 8) _mm256_storeu_ps(out + i, __rsqrt_ps256(_mm256_loadu_ps(in + i)));
+	if (i < n) {
+		float block[8] = { 1, 1, 1, 1, 1, 1, 1, 1 };
+		memcpy(block, in + i, (n - i) * sizeof(float));
+		_mm256_storeu_ps(block, __rsqrt_ps256(_mm256_loadu_ps(block)));
+		memcpy(out + i, block, (n - i) * sizeof(float));
+	}
+}
+
+__attribute__((target("avx2,fma")))
+static void __acos_avx2(const float* in, float* out, int32_t n) {
+	int32_t i = 0;
+	for (; i + 8 <= n; i += 8) _mm256_storeu_ps(out + i, __acos_ps256(_mm256_loadu_ps(in + i)));
+	if (i < n) {
+		float block[8] = { 0 };
+		memcpy(block, in + i, (n - i) * sizeof(float));
+		_mm256_storeu_ps(block, __acos_ps256(_mm256_loadu_ps(block)));
+		memcpy(out + i, block, (n - i) * sizeof(float));
+	}
+}
+
+__attribute__((target("avx2,fma")))
+static void __atan2_avx2(const float* y, const float* x, float* out, int32_t n) {
+	int32_t i = 0;
+	for (; i + 8 <= n; i += 8) _mm256_storeu_ps(out + i, __atan2_ps256(_mm256_loadu_ps(y + i), _mm256_loadu_ps(x + i)));
+	if (i < n) {
+		float by[8] = { 0 }, bx[8] = { 0 };
+		memcpy(by, y + i, (n - i) * sizeof(float));
+		memcpy(bx, x + i, (n - i) * sizeof(float));
+		_mm256_storeu_ps(by, __atan2_ps256(_mm256_loadu_ps(by), _mm256_loadu_ps(bx)));
+		memcpy(out + i, by, (n - i) * sizeof(float));
+	}
+}
+
+__attribute__((target("avx2,fma")))
+static inline void __normalize_block_avx2(float* x, float* y) {
+	__m256 vx = _mm256_loadu_ps(x);
+	__m256 vy = _mm256_loadu_ps(y);
+	__m256 len_sq = _mm256_fmadd_ps(vx, vx, _mm256_mul_ps(vy, vy));
+	__m256 nonzero = _mm256_cmp_ps(len_sq, _mm256_setzero_ps(), _CMP_GT_OQ);
+	__m256 inv = _mm256_blendv_ps(_mm256_set1_ps(1.0f), __rsqrt_ps256(len_sq), nonzero);
+	_mm256_storeu_ps(x, _mm256_mul_ps(vx, inv));
+	_mm256_storeu_ps(y, _mm256_mul_ps(vy, inv));
+}
+
+__attribute__((target("avx2,fma")))
+static void __normalize_avx2(float* x, float* y, int32_t n) {
+	int32_t i = 0;
+	for (; i + 8 <= n; i += 8) __normalize_block_avx2(x + i, y + i);
+	if (i < n) {
+		float bx[8] = { 0 }, by[8] = { 0 };
+		memcpy(bx, x + i, (n - i) * sizeof(float));
+		memcpy(by, y + i, (n - i) * sizeof(float));
+		__normalize_block_avx2(bx, by);
+		memcpy(x + i, bx, (n - i) * sizeof(float));
+		memcpy(y + i, by, (n - i) * sizeof(float));
+	}
+}
+
+#endif
+
+/************
+ * Dispatch *
+ ************/
+
+// Kernels for each backend, indexed by MathBackend
+static const MathKernels KERNELS[] = {
+	{ __inverse_sqrt_scalar, __acos_scalar, __atan2_scalar, __normalize_scalar },
+#ifdef GMATH_X86
+	{ __inverse_sqrt_sse, __acos_sse, __atan2_sse, __normalize_sse },
+	{ __inverse_sqrt_avx2, __acos_avx2, __atan2_avx2, __normalize_avx2 }
+#endif
+};
+
+/**
+ * Scalar always works, the SIMD backends need an x86 build
+ * and a CPU that reports the instruction sets.
+ */
+bool math_backend_supported(MathBackend b) {
+	switch (b) {
+		case MATH_SCALAR:
+			return true;
+#ifdef GMATH_X86
+		case MATH_SSE:
+			return __builtin_cpu_supports("sse2");
+		case MATH_AVX2:
+			return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+		default:
+			return false;
+	}
+}
+
+/**
+ * Pick the widest supported backend the first time we are asked.
+ */
+MathBackend get_math_backend(void) {
+	if (backend < 0) {
+		backend = MATH_SCALAR;
+		if (math_backend_supported(MATH_SSE)) backend = MATH_SSE;
+		if (math_backend_supported(MATH_AVX2)) backend = MATH_AVX2;
+	}
+	return (MathBackend)backend;
+}
+
+/**
+ * Leave the backend as it is if the requested one is not supported.
+ */
+bool set_math_backend(MathBackend b) {
+	if (!math_backend_supported(b)) return false;
+	backend = b;
+	return true;
+}
+
+void inverse_sqrt_array(const float* in, float* out, int32_t n) {
+	KERNELS[get_math_backend()].inverse_sqrt(in, out, n);
+}
+
+void fast_acos_array(const float* in, float* out, int32_t n) {
+	KERNELS[get_math_backend()].acos(in, out, n);
+}
+
+void fast_atan2_array(const float* y, const float* x, float* out, int32_t n) {
+	KERNELS[get_math_backend()].atan2(y, x, out, n);
+}
+
+void normalize_array(float* x, float* y, int32_t n) {
+	KERNELS[get_math_backend()].normalize(x, y, n);
 }
\ No newline at end of file
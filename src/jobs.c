@@ -0,0 +1,490 @@
+#include "jobs.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define JOBS_X86
+#include <immintrin.h>
+#endif
+
+// Message when a worker thread cannot be created
+static const char CREATE_THREAD_LOG[] = "Could not create worker thread: %s";
+// Message when the wake semaphore cannot be created
+static const char CREATE_SEM_LOG[] = "Could not create job semaphore: %s";
+// The name of the worker threads
+static const char THREAD_NAME[] = "worker";
+// The number of chunks allocated up front
+static const int32_t INITIAL_JOB_CAPACITY = 256;
+// Failed attempts at finding a job before a thread gives up its core for a moment
+static const int32_t SPINS_BEFORE_YIELD = 64;
+
+/**
+ * Function:
+ *  __alloc_worker
+ *
+ * Purpose:
+ *  Create a worker with an empty deque.
+ *
+ * Parameters:
+ *  - jobs:
+ *      The JobSystem object.
+ *  - index:
+ *      The worker's index, which seeds its random choices.
+ *
+ * Returns:
+ *  The worker.
+ */
+static Worker* __alloc_worker(JobSystem* jobs, int32_t index);
+
+/**
+ * Function:
+ *  __worker_main
+ *
+ * Purpose:
+ *  Sleep until a run starts, take part in it and sleep again,
+ *  until the JobSystem is destroyed.
+ *
+ * Parameters:
+ *  - data:
+ *      The worker.
+ *
+ * Returns:
+ *  0.
+ */
+static int __worker_main(void* data);
+
+/**
+ * Function:
+ *  __work
+ *
+ * Purpose:
+ *  Run jobs, own ones first and then stolen ones, until every
+ *  task of the run is done.
+ *
+ * Parameters:
+ *  - worker:
+ *      The worker doing the work.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __work(Worker* worker);
+
+/**
+ * Function:
+ *  __push
+ *
+ * Purpose:
+ *  Put a job at the bottom of a worker's own deque.
+ *
+ * Parameters:
+ *  - worker:
+ *      The worker, which must be the calling thread.
+ *  - job:
+ *      The job.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __push(Worker* worker, Job* job);
+
+/**
+ * Function:
+ *  __pop
+ *
+ * Purpose:
+ *  Take the job at the bottom of a worker's own deque.
+ *
+ * Parameters:
+ *  - worker:
+ *      The worker, which must be the calling thread.
+ *
+ * Returns:
+ *  The job, NULL if the deque is empty.
+ */
+static Job* __pop(Worker* worker);
+
+/**
+ * Function:
+ *  __steal
+ *
+ * Purpose:
+ *  Take the job at the top of another worker's deque.
+ *
+ * Parameters:
+ *  - victim:
+ *      The worker stolen from.
+ *
+ * Returns:
+ *  The job, NULL if the deque is empty or another thief got it first.
+ */
+static Job* __steal(Worker* victim);
+
+/**
+ * Function:
+ *  __release
+ *
+ * Purpose:
+ *  Split a task whose dependencies are done into chunks and
+ *  queue them on a worker.
+ *
+ * Parameters:
+ *  - worker:
+ *      The worker, which must be the calling thread.
+ *  - task:
+ *      The task.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __release(Worker* worker, Task* task);
+
+/**
+ * Function:
+ *  __finish
+ *
+ * Purpose:
+ *  Mark a task as done, releasing the tasks only waiting for it.
+ *
+ * Parameters:
+ *  - worker:
+ *      The worker, which must be the calling thread.
+ *  - task:
+ *      The task.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __finish(Worker* worker, Task* task);
+
+/**
+ * Function:
+ *  __back_off
+ *
+ * Purpose:
+ *  Wait a little before checking again for something another
+ *  thread does.
+ *
+ * Parameters:
+ *  - attempt:
+ *      How many times in a row the check failed.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __back_off(int32_t attempt);
+
+/**
+ * The first worker is the calling thread and gets no thread of its
+ * own. Threads that fail to start are logged and everything started
+ * so far is stopped again.
+ */
+JobSystem* init_job_system(int32_t threads) {
+    if (threads < 0) threads = SDL_GetCPUCount() - 1;
+    if (threads < 0) threads = 0;
+
+    JobSystem* jobs = (JobSystem*)malloc(sizeof(JobSystem));
+    jobs->worker_count = threads + 1;
+    jobs->task_count = 0;
+    jobs->job_count = 0;
+    jobs->job_capacity = INITIAL_JOB_CAPACITY;
+    jobs->jobs = (Job*)malloc(sizeof(Job) * jobs->job_capacity);
+    jobs->deque_size = 0;
+    SDL_AtomicSet(&jobs->pending, 0);
+    SDL_AtomicSet(&jobs->busy, 0);
+    SDL_AtomicSet(&jobs->quit, 0);
+    jobs->workers = (Worker**)malloc(sizeof(Worker*) * jobs->worker_count);
+    for (int32_t i = 0; i < jobs->worker_count; i++) jobs->workers[i] = __alloc_worker(jobs, i);
+
+    jobs->wake = SDL_CreateSemaphore(0);
+    if (jobs->wake == NULL) {
+        SDL_Log(CREATE_SEM_LOG, SDL_GetError());
+        destroy_job_system(jobs);
+        return NULL;
+    }
+
+    for (int32_t i = 1; i < jobs->worker_count; i++) {
+        jobs->workers[i]->thread = SDL_CreateThread(__worker_main, THREAD_NAME, jobs->workers[i]);
+        if (jobs->workers[i]->thread == NULL) {
+            SDL_Log(CREATE_THREAD_LOG, SDL_GetError());
+            destroy_job_system(jobs);
+            return NULL;
+        }
+    }
+
+    return jobs;
+}
+
+/**
+ * A task's chunks are reserved when it is added, while no thread
+ * is running, so the pool can grow and stays put during a run.
+ */
+Task* add_task(JobSystem* jobs, JobFunction function, void* data, int32_t count, int32_t chunk) {
+    if (jobs->task_count == JOB_MAX_TASKS) return NULL;
+    if (chunk < 1) chunk = 1;
+    if (count < 0) count = 0;
+
+    int32_t chunks = (count + chunk - 1) / chunk;
+    if (jobs->job_count + chunks > jobs->job_capacity) {
+        while (jobs->job_count + chunks > jobs->job_capacity) jobs->job_capacity *= 2;
+        jobs->jobs = (Job*)realloc(jobs->jobs, sizeof(Job) * jobs->job_capacity);
+    }
+
+    Task* task = &jobs->tasks[jobs->task_count++];
+    task->function = function;
+    task->data = data;
+    task->count = count;
+    task->max_count = count;
+    task->chunk = chunk;
+    task->first_job = jobs->job_count;
+    task->dependencies = 0;
+    task->successor_count = 0;
+    jobs->job_count += chunks;
+    return task;
+}
+
+bool add_dependency(Task* before, Task* after) {
+    if (before->successor_count == JOB_MAX_SUCCESSORS) return false;
+    before->successors[before->successor_count++] = after;
+    after->dependencies++;
+    return true;
+}
+
+/**
+ * The task is only read once it is released, which happens after
+ * whatever sets its count is done.
+ */
+void set_task_count(Task* task, int32_t count) {
+    task->count = count < 0 ? 0 : count < task->max_count ? count : task->max_count;
+}
+
+void run_tasks(JobSystem* jobs) {
+    start_tasks(jobs);
+    wait_tasks(jobs);
+}
+
+/**
+ * Threads are woken only for the run and wait_tasks waits until
+ * all of them are asleep again, so between runs nothing is shared
+ * and the tasks and pools can be changed freely. The deques are
+ * reset before pending is set, which is what a waking thread checks
+ * before touching them.
+ */
+void start_tasks(JobSystem* jobs) {
+    if (jobs->task_count == 0) return;
+
+    if (jobs->deque_size < jobs->job_count) {
+        int32_t size = 1;
+        while (size < jobs->job_count) size *= 2;
+        for (int32_t i = 0; i < jobs->worker_count; i++) {
+            jobs->workers[i]->deque = (Job**)realloc(jobs->workers[i]->deque, sizeof(Job*) * size);
+            jobs->workers[i]->mask = size - 1;
+        }
+        jobs->deque_size = size;
+    }
+    for (int32_t i = 0; i < jobs->worker_count; i++) {
+        SDL_AtomicSet(&jobs->workers[i]->top, 0);
+        SDL_AtomicSet(&jobs->workers[i]->bottom, 0);
+    }
+    for (int32_t t = 0; t < jobs->task_count; t++) {
+        SDL_AtomicSet(&jobs->tasks[t].waiting, jobs->tasks[t].dependencies);
+    }
+    SDL_AtomicSet(&jobs->pending, jobs->task_count);
+
+    for (int32_t i = 1; i < jobs->worker_count; i++) SDL_SemPost(jobs->wake);
+    Worker* self = jobs->workers[0];
+    for (int32_t t = 0; t < jobs->task_count; t++) {
+        if (jobs->tasks[t].dependencies == 0) __release(self, &jobs->tasks[t]);
+    }
+}
+
+/**
+ * The tasks stay added until the run is done, so an empty list
+ * means there is nothing to wait for.
+ */
+void wait_tasks(JobSystem* jobs) {
+    if (jobs->task_count == 0) return;
+
+    Worker* self = jobs->workers[0];
+    __work(self);
+    for (int32_t attempt = 0; SDL_AtomicGet(&jobs->busy) != 0; attempt++) __back_off(attempt);
+
+    jobs->task_count = 0;
+    jobs->job_count = 0;
+}
+
+/**
+ * Threads are woken by a post each, which makes them see quit.
+ */
+void destroy_job_system(JobSystem* jobs) {
+    SDL_AtomicSet(&jobs->quit, 1);
+    for (int32_t i = 1; i < jobs->worker_count; i++) {
+        if (jobs->workers[i]->thread) SDL_SemPost(jobs->wake);
+    }
+    for (int32_t i = 1; i < jobs->worker_count; i++) {
+        if (jobs->workers[i]->thread) SDL_WaitThread(jobs->workers[i]->thread, NULL);
+    }
+    for (int32_t i = 0; i < jobs->worker_count; i++) {
+        free(jobs->workers[i]->deque);
+        free(jobs->workers[i]);
+    }
+    if (jobs->wake) SDL_DestroySemaphore(jobs->wake);
+    free(jobs->workers);
+    free(jobs->jobs);
+    free(jobs);
+}
+
+/**
+ * Each worker is allocated on its own, so the deque indices of two
+ * workers are not on the same cache line.
+ */
+static Worker* __alloc_worker(JobSystem* jobs, int32_t index) {
+    Worker* worker = (Worker*)calloc(1, sizeof(Worker));
+    worker->system = jobs;
+    worker->thread = NULL;
+    worker->deque = NULL;
+    worker->mask = 0;
+    SDL_AtomicSet(&worker->top, 0);
+    SDL_AtomicSet(&worker->bottom, 0);
+    worker->seed = 2654435761u * (uint32_t)(index + 1);
+    return worker;
+}
+
+/**
+ * A thread counts itself busy before checking for work, so the
+ * caller of wait_tasks never returns while it might touch the deques.
+ */
+static int __worker_main(void* data) {
+    Worker* worker = (Worker*)data;
+    JobSystem* jobs = worker->system;
+    while (true) {
+        SDL_SemWait(jobs->wake);
+        if (SDL_AtomicGet(&jobs->quit)) break;
+        SDL_AtomicAdd(&jobs->busy, 1);
+        __work(worker);
+        SDL_AtomicAdd(&jobs->busy, -1);
+    }
+    return 0;
+}
+
+/**
+ * Victims are picked at random, which spreads thieves over the
+ * deques without them agreeing on anything.
+ */
+static void __work(Worker* worker) {
+    JobSystem* jobs = worker->system;
+    int32_t misses = 0;
+    while (SDL_AtomicGet(&jobs->pending) > 0) {
+        Job* job = __pop(worker);
+        if (job == NULL && jobs->worker_count > 1) {
+            worker->seed ^= worker->seed << 13;
+            worker->seed ^= worker->seed >> 17;
+            worker->seed ^= worker->seed << 5;
+            Worker* victim = jobs->workers[worker->seed % jobs->worker_count];
+            if (victim != worker) job = __steal(victim);
+        }
+        if (job == NULL) {
+            __back_off(misses++);
+            continue;
+        }
+        misses = 0;
+
+        Task* task = job->task;
+        task->function(task->data, job->begin, job->end);
+        if (SDL_AtomicAdd(&task->remaining, -1) == 1) __finish(worker, task);
+    }
+}
+
+/**
+ * Only the owner moves bottom, so it is read without a race and
+ * published after the job is in place.
+ */
+static void __push(Worker* worker, Job* job) {
+    int32_t bottom = SDL_AtomicGet(&worker->bottom);
+    SDL_AtomicSetPtr((void**)&worker->deque[bottom & worker->mask], job);
+    SDL_AtomicSet(&worker->bottom, bottom + 1);
+}
+
+/**
+ * The Chase-Lev deque: bottom is lowered before top is read, so a
+ * thief either sees the job gone or the owner sees the thief's top.
+ * Only for the last job do the two race, and top decides.
+ */
+static Job* __pop(Worker* worker) {
+    int32_t bottom = SDL_AtomicGet(&worker->bottom) - 1;
+    SDL_AtomicSet(&worker->bottom, bottom);
+    int32_t top = SDL_AtomicGet(&worker->top);
+    if (top > bottom) {
+        SDL_AtomicSet(&worker->bottom, bottom + 1);
+        return NULL;
+    }
+
+    Job* job = (Job*)SDL_AtomicGetPtr((void**)&worker->deque[bottom & worker->mask]);
+    if (top == bottom) {
+        if (!SDL_AtomicCAS(&worker->top, top, top + 1)) job = NULL;
+        SDL_AtomicSet(&worker->bottom, bottom + 1);
+    }
+    return job;
+}
+
+/**
+ * The job is read before top is claimed, the ring never wraps
+ * during a run, so what was read is still the job at top if the
+ * claim succeeds.
+ */
+static Job* __steal(Worker* victim) {
+    int32_t top = SDL_AtomicGet(&victim->top);
+    int32_t bottom = SDL_AtomicGet(&victim->bottom);
+    if (top >= bottom) return NULL;
+
+    Job* job = (Job*)SDL_AtomicGetPtr((void**)&victim->deque[top & victim->mask]);
+    if (!SDL_AtomicCAS(&victim->top, top, top + 1)) return NULL;
+    return job;
+}
+
+/**
+ * Chunks are pushed last to first, so the owner pops them in order
+ * and thieves take from the far end. A task without items is done
+ * as soon as it is released.
+ */
+static void __release(Worker* worker, Task* task) {
+    int32_t chunks = (task->count + task->chunk - 1) / task->chunk;
+    if (chunks == 0) {
+        __finish(worker, task);
+        return;
+    }
+
+    SDL_AtomicSet(&task->remaining, chunks);
+    Job* first = &worker->system->jobs[task->first_job];
+    for (int32_t c = chunks - 1; c >= 0; c--) {
+        first[c].task = task;
+        first[c].begin = c * task->chunk;
+        first[c].end = c == chunks - 1 ? task->count : (c + 1) * task->chunk;
+        __push(worker, &first[c]);
+    }
+}
+
+/**
+ * Successors are released before the task stops counting as
+ * pending, so pending never reaches 0 while work is left.
+ */
+static void __finish(Worker* worker, Task* task) {
+    for (int32_t i = 0; i < task->successor_count; i++) {
+        if (SDL_AtomicAdd(&task->successors[i]->waiting, -1) == 1) __release(worker, task->successors[i]);
+    }
+    SDL_AtomicAdd(&worker->system->pending, -1);
+}
+
+/**
+ * Spinning with a pause keeps the wait short and leaves a
+ * hyperthread sharing the core its cycles. A thread that keeps
+ * waiting yields, so when there are more threads than cores the
+ * one being waited for gets to run.
+ */
+static void __back_off(int32_t attempt) {
+    if (attempt >= SPINS_BEFORE_YIELD) {
+        SDL_Delay(0);
+        return;
+    }
+#ifdef JOBS_X86
+    _mm_pause();
+#endif
+}
\ No newline at end of file
@@ -0,0 +1,325 @@
+#ifndef Xk4Rb9TmQv_JOBS_H
+#define Xk4Rb9TmQv_JOBS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include <SDL2/SDL.h>
+
+// The most tasks added between two runs
+#define JOB_MAX_TASKS 64
+// The most tasks that can depend on a single task
+#define JOB_MAX_SUCCESSORS 8
+
+// Does the work of one chunk of a task, the items from begin up to end
+typedef void (*JobFunction)(void* data, int32_t begin, int32_t end);
+
+struct Task;
+
+/**
+ * Struct:
+ *  Job
+ *
+ * Purpose:
+ *  One chunk of a task, the unit that is queued and stolen.
+ *
+ * Fields:
+ *  - task:
+ *      The task the chunk belongs to.
+ *  - begin:
+ *      The first item of the chunk.
+ *  - end:
+ *      One past the last item of the chunk.
+ */
+typedef struct {
+    struct Task*    task;
+    int32_t         begin;
+    int32_t         end;
+} Job;
+
+/**
+ * Struct:
+ *  Task
+ *
+ * Purpose:
+ *  A function to run over a number of items, split into chunks
+ *  that run in parallel, once every task it depends on is done.
+ *
+ * Fields:
+ *  - function:
+ *      Runs a chunk.
+ *  - data:
+ *      Passed on to the function.
+ *  - count:
+ *      The number of items.
+ *  - max_count:
+ *      The number of items the task was added with, which its
+ *      chunks are reserved for.
+ *  - chunk:
+ *      The most items per chunk.
+ *  - first_job:
+ *      The index of the task's first reserved chunk in the pool.
+ *  - dependencies:
+ *      The number of tasks the task depends on.
+ *  - waiting:
+ *      The number of those not done yet during a run.
+ *  - remaining:
+ *      The number of the task's chunks not done yet during a run.
+ *  - successors:
+ *      The tasks that depend on this one.
+ *  - successor_count:
+ *      The number of successors.
+ */
+typedef struct Task {
+    JobFunction     function;
+    void*           data;
+    int32_t         count;
+    int32_t         max_count;
+    int32_t         chunk;
+    int32_t         first_job;
+    int32_t         dependencies;
+    SDL_atomic_t    waiting;
+    SDL_atomic_t    remaining;
+    struct Task*    successors[JOB_MAX_SUCCESSORS];
+    int32_t         successor_count;
+} Task;
+
+struct JobSystem;
+
+/**
+ * Struct:
+ *  Worker
+ *
+ * Purpose:
+ *  A thread with its own deque of jobs. It pushes and pops at the
+ *  bottom without contention, others steal from the top when they
+ *  run out of work.
+ *
+ * Fields:
+ *  - system:
+ *      The JobSystem the worker belongs to.
+ *  - thread:
+ *      The thread, NULL for the one that runs the tasks.
+ *  - deque:
+ *      A ring of jobs, large enough for every job of a run.
+ *  - mask:
+ *      The size of the ring minus one, the size is a power of two.
+ *  - top:
+ *      Where the next job is stolen from.
+ *  - bottom:
+ *      Where the next job is pushed.
+ *  - seed:
+ *      The state of the random choice of whom to steal from.
+ */
+typedef struct {
+    struct JobSystem*   system;
+    SDL_Thread*         thread;
+    Job**               deque;
+    int32_t             mask;
+    SDL_atomic_t        top;
+    SDL_atomic_t        bottom;
+    uint32_t            seed;
+} Worker;
+
+/**
+ * Struct:
+ *  JobSystem
+ *
+ * Purpose:
+ *  Runs a graph of tasks added each frame on every core. The
+ *  worker threads sleep between runs and steal each other's jobs
+ *  during them.
+ *
+ * Fields:
+ *  - worker_count:
+ *      The number of workers, the thread running the tasks included.
+ *  - workers:
+ *      The workers, the first being the thread running the tasks.
+ *  - tasks:
+ *      The tasks added since the last run.
+ *  - task_count:
+ *      The number of tasks.
+ *  - jobs:
+ *      The pool of chunks reserved by the tasks.
+ *  - job_count:
+ *      The number of chunks reserved.
+ *  - job_capacity:
+ *      The number of chunks allocated.
+ *  - deque_size:
+ *      The size of each worker's ring.
+ *  - pending:
+ *      The number of tasks not done yet during a run.
+ *  - busy:
+ *      The number of worker threads awake.
+ *  - quit:
+ *      1 once the threads should exit.
+ *  - wake:
+ *      Posted once per worker thread when a run starts.
+ */
+typedef struct JobSystem {
+    int32_t         worker_count;
+    Worker**        workers;
+    Task            tasks[JOB_MAX_TASKS];
+    int32_t         task_count;
+    Job*            jobs;
+    int32_t         job_count;
+    int32_t         job_capacity;
+    int32_t         deque_size;
+    SDL_atomic_t    pending;
+    SDL_atomic_t    busy;
+    SDL_atomic_t    quit;
+    SDL_sem*        wake;
+} JobSystem;
+
+/**
+ * Function:
+ *  init_job_system
+ *
+ * Purpose:
+ *  Create a JobSystem and start its threads.
+ *
+ * Parameters:
+ *  - threads:
+ *      The number of threads besides the one running the tasks,
+ *      0 to run everything on it, negative for one per other core.
+ *
+ * Returns:
+ *  The JobSystem object, NULL if it could not be created.
+ */
+JobSystem* init_job_system(int32_t threads);
+
+/**
+ * Function:
+ *  add_task
+ *
+ * Purpose:
+ *  Add a task to the next run.
+ *
+ * Parameters:
+ *  - jobs:
+ *      The JobSystem object.
+ *  - function:
+ *      Runs a chunk.
+ *  - data:
+ *      Passed on to the function.
+ *  - count:
+ *      The number of items, or the most if the task is told the
+ *      actual number with set_task_count. 0 runs nothing, but the
+ *      task still orders those depending on it.
+ *  - chunk:
+ *      The most items per chunk.
+ *
+ * Returns:
+ *  The task, NULL if JOB_MAX_TASKS have been added.
+ */
+Task* add_task(JobSystem* jobs, JobFunction function, void* data, int32_t count, int32_t chunk);
+
+/**
+ * Function:
+ *  add_dependency
+ *
+ * Purpose:
+ *  Make a task wait for another to be done before it starts.
+ *
+ * Parameters:
+ *  - before:
+ *      The task that runs first.
+ *  - after:
+ *      The task that waits for it.
+ *
+ * Returns:
+ *  true if successful, false if before has JOB_MAX_SUCCESSORS already.
+ */
+bool add_dependency(Task* before, Task* after);
+
+/**
+ * Function:
+ *  set_task_count
+ *
+ * Purpose:
+ *  Change the number of items of a task that has not started,
+ *  such as from a task it depends on that finds the number out.
+ *
+ * Parameters:
+ *  - task:
+ *      The task.
+ *  - count:
+ *      The number of items, capped at the number it was added with.
+ *
+ * Returns:
+ *  Nothing.
+ */
+void set_task_count(Task* task, int32_t count);
+
+/**
+ * Function:
+ *  run_tasks
+ *
+ * Purpose:
+ *  Run every task added since the last run, with the calling thread
+ *  taking part, and remove them once they are all done.
+ *
+ * Parameters:
+ *  - jobs:
+ *      The JobSystem object.
+ *
+ * Returns:
+ *  Nothing.
+ */
+void run_tasks(JobSystem* jobs);
+
+/**
+ * Function:
+ *  start_tasks
+ *
+ * Purpose:
+ *  Start running every task added since the last run on the worker
+ *  threads and return, leaving the calling thread free for other
+ *  work. No task may be added until wait_tasks is called. With no
+ *  worker threads nothing runs until then.
+ *
+ * Parameters:
+ *  - jobs:
+ *      The JobSystem object.
+ *
+ * Returns:
+ *  Nothing.
+ */
+void start_tasks(JobSystem* jobs);
+
+/**
+ * Function:
+ *  wait_tasks
+ *
+ * Purpose:
+ *  Take part in the run begun by start_tasks until all its tasks
+ *  are done, and remove them. Returns at once if no run was begun.
+ *
+ * Parameters:
+ *  - jobs:
+ *      The JobSystem object.
+ *
+ * Returns:
+ *  Nothing.
+ */
+void wait_tasks(JobSystem* jobs);
+
+/**
+ * Function:
+ *  destroy_job_system
+ *
+ * Purpose:
+ *  Stop the threads and release the JobSystem object.
+ *
+ * Parameters:
+ *  - jobs:
+ *      The JobSystem object to destroy.
+ *
+ * Returns:
+ *  Nothing.
+ */
+void destroy_job_system(JobSystem* jobs);
+
+#endif
\ No newline at end of file
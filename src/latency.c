@@ -0,0 +1,219 @@
+#include "latency.h"
+
+// Error message when the injection timer can't be started
+static const char ADD_TIMER_LOG[] = "Could not start latency probe timer: %s";
+// Error message when injecting an event fails
+static const char PUSH_EVENT_LOG[] = "Could not inject latency probe event: %s";
+// Summary of the latency distribution
+static const char LATENCY_REPORT_LOG[] =
+    "Latency [%s]: %d samples, min %.2f ms, p50 %.2f ms, p95 %.2f ms, p99 %.2f ms, max %.2f ms";
+// Histogram of the latency in frames
+static const char LATENCY_FRAMES_LOG[] =
+    "Latency [%s]: 0 frames %d, 1 frame %d, 2 frames %d, 3+ frames %d";
+// How far from the player the injected cursor is placed, along each axis
+static const float PROBE_DISTANCE = 100.0f;
+// How close the player facing must be to the target to count as reflected, cos(0.1)
+static const float FACING_TOLERANCE = 0.995f;
+// One over the square root of two, the length of each diagonal component
+static const float DIAGONAL = 0.70710678118654752f;
+
+/**
+ * Function:
+ *  __inject
+ *
+ * Purpose:
+ *  Timer callback that pushes a synthetic mouse motion event,
+ *  unless the previous one has not been presented yet.
+ *
+ * Parameters:
+ *  - interval:
+ *      The timer interval.
+ *  - param:
+ *      The LatencyProbe object.
+ *
+ * Returns:
+ *  The interval, so the timer keeps firing.
+ */
+static Uint32 __inject(Uint32 interval, void* param);
+
+/**
+ * Function:
+ *  __compare_floats
+ *
+ * Purpose:
+ *  Order floats ascending for qsort.
+ *
+ * Parameters:
+ *  - a:
+ *      A pointer to the first float.
+ *  - b:
+ *      A pointer to the second float.
+ *
+ * Returns:
+ *  Negative if a < b, positive if a > b and 0 otherwise.
+ */
+static int __compare_floats(const void* a, const void* b);
+
+/**
+ * Function:
+ *  __log_report
+ *
+ * Purpose:
+ *  Log the latency distribution in milliseconds and frames.
+ *
+ * Parameters:
+ *  - probe:
+ *      The LatencyProbe object.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __log_report(LatencyProbe* probe);
+
+/**
+ * The timer fires on its own thread, so events arrive at arbitrary
+ * points within a frame just like real input. Returns NULL if the
+ * timer can't be started.
+ */
+LatencyProbe* init_latency_probe(int32_t interval, const char* label) {
+    LatencyProbe* probe = (LatencyProbe*)malloc(sizeof(LatencyProbe));
+
+    SDL_AtomicSet(&probe->pending, 0);
+    SDL_AtomicSet(&probe->frame, 0);
+    SDL_AtomicSet(&probe->anchor_x, 0);
+    SDL_AtomicSet(&probe->anchor_y, 0);
+    probe->direction = 0;
+    probe->reflected = false;
+    probe->count = 0;
+    snprintf(probe->label, sizeof(probe->label), "%s", label);
+
+    probe->timer = SDL_AddTimer(interval, __inject, probe);
+    if (probe->timer == 0) {
+        SDL_Log(ADD_TIMER_LOG, SDL_GetError());
+        free(probe);
+        return NULL;
+    }
+
+    return probe;
+}
+
+/**
+ * Publish the frame number and the player position for the timer thread.
+ */
+void latency_frame_begin(LatencyProbe* probe, Point2d* position) {
+    SDL_AtomicAdd(&probe->frame, 1);
+    SDL_AtomicSet(&probe->anchor_x, (int)position->x);
+    SDL_AtomicSet(&probe->anchor_y, (int)position->y);
+}
+
+/**
+ * The probe directions are a quarter turn apart, so the facing only
+ * gets within the tolerance once the injected motion has been handled.
+ * Both are unit vectors, so the dot product is the cosine of the angle
+ * between them.
+ */
+void latency_after_update(LatencyProbe* probe, Vector2d* facing) {
+    if (SDL_AtomicGet(&probe->pending) == 0 || probe->reflected) return;
+
+    float cos_diff = facing->x * probe->target.x + facing->y * probe->target.y;
+    probe->reflected = cos_diff > FACING_TOLERANCE;
+}
+
+/**
+ * The sample is taken once the frame is presented, then the timer
+ * thread is allowed to inject the next event.
+ */
+void latency_after_present(LatencyProbe* probe) {
+    if (!probe->reflected) return;
+
+    if (probe->count < MAX_LATENCY_SAMPLES) {
+        Uint64 elapsed = SDL_GetPerformanceCounter() - probe->injected_at;
+        probe->samples[probe->count] = 1000.0f * elapsed / (float)SDL_GetPerformanceFrequency();
+        probe->frames[probe->count] = SDL_AtomicGet(&probe->frame) - probe->injected_frame;
+        probe->count++;
+    }
+
+    probe->reflected = false;
+    SDL_AtomicSet(&probe->pending, 0);
+}
+
+/**
+ * Removing the timer waits for a running callback to finish,
+ * so the probe can be freed afterwards.
+ */
+void destroy_latency_probe(LatencyProbe* probe) {
+    SDL_RemoveTimer(probe->timer);
+    __log_report(probe);
+    free(probe);
+}
+
+/**
+ * The fields describing the event are written before pending is set,
+ * and the atomic set acts as a full barrier, so the main thread never
+ * sees a half written probe. Pushing to the event queue is thread safe.
+ */
+static Uint32 __inject(Uint32 interval, void* param) {
+    LatencyProbe* probe = (LatencyProbe*)param;
+    if (SDL_AtomicGet(&probe->pending) != 0) return interval;
+
+    // The four diagonals, so neither axis of the aim vector is ever zero
+    static const int32_t dx[] = { 1, -1, -1, 1 };
+    static const int32_t dy[] = { 1, 1, -1, -1 };
+    int32_t d = probe->direction;
+    probe->direction = (d + 1) % 4;
+
+    SDL_Event event;
+    SDL_memset(&event, 0, sizeof(event));
+    event.type = SDL_MOUSEMOTION;
+    event.motion.x = SDL_AtomicGet(&probe->anchor_x) + (int32_t)(dx[d] * PROBE_DISTANCE);
+    event.motion.y = SDL_AtomicGet(&probe->anchor_y) + (int32_t)(dy[d] * PROBE_DISTANCE);
+
+    probe->target = (Vector2d){ dx[d] * DIAGONAL, dy[d] * DIAGONAL };
+    probe->injected_frame = SDL_AtomicGet(&probe->frame);
+    probe->injected_at = SDL_GetPerformanceCounter();
+    SDL_AtomicSet(&probe->pending, 1);
+
+    if (SDL_PushEvent(&event) < 0) {
+        SDL_Log(PUSH_EVENT_LOG, SDL_GetError());
+        SDL_AtomicSet(&probe->pending, 0);
+    }
+
+    return interval;
+}
+
+/**
+ * Can't subtract since the difference may not fit an int.
+ */
+static int __compare_floats(const void* a, const void* b) {
+    float x = *(const float*)a, y = *(const float*)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Percentiles are read from the sorted samples, nearest rank.
+ */
+static void __log_report(LatencyProbe* probe) {
+    int32_t n = probe->count;
+    if (n == 0) {
+        SDL_Log(LATENCY_REPORT_LOG, probe->label, 0, 0.0, 0.0, 0.0, 0.0, 0.0);
+        return;
+    }
+
+    int32_t histogram[4] = { 0, 0, 0, 0 };
+    for (int32_t i = 0; i < n; i++) {
+        histogram[probe->frames[i] < 3 ? probe->frames[i] : 3]++;
+    }
+
+    qsort(probe->samples, n, sizeof(float), __compare_floats);
+    SDL_Log(
+        LATENCY_REPORT_LOG,
+        probe->label,
+        n,
+        probe->samples[0],
+        probe->samples[n / 2],
+        probe->samples[(int32_t)(n * 0.95f)],
+        probe->samples[(int32_t)(n * 0.99f)],
+        probe->samples[n - 1]
+    );
+    SDL_Log(LATENCY_FRAMES_LOG, probe->label, histogram[0], histogram[1], histogram[2], histogram[3]);
+}
\ No newline at end of file
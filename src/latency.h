@@ -0,0 +1,158 @@
+#ifndef Qe7TzkW2sL_LATENCY_H
+#define Qe7TzkW2sL_LATENCY_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include <SDL2/SDL.h>
+
+#include "gmath.h"
+
+// The most latency samples kept by a probe.
+#define MAX_LATENCY_SAMPLES 4096
+
+/**
+ * Struct:
+ *  LatencyProbe
+ *
+ * Purpose:
+ *  Measures input-to-photon latency by injecting synthetic mouse
+ *  motion from a timer thread and timing how long it takes until
+ *  a presented frame reflects it.
+ *
+ * Fields:
+ *  - timer:
+ *      The SDL timer that injects the events.
+ *  - pending:
+ *      1 while an injected event has not been presented, 0 otherwise.
+ *  - frame:
+ *      The frame currently being simulated.
+ *  - anchor_x:
+ *      The horizontal player position, injected motion is relative to it.
+ *  - anchor_y:
+ *      The vertical player position, injected motion is relative to it.
+ *  - direction:
+ *      Which of the four probe directions to inject next.
+ *  - injected_at:
+ *      The performance counter value when the event was pushed.
+ *  - injected_frame:
+ *      The frame being simulated when the event was pushed.
+ *  - target:
+ *      The unit vector the player should be facing once the event is handled.
+ *  - reflected:
+ *      Has the simulation picked up the pending event?
+ *  - samples:
+ *      The measured latencies in milliseconds.
+ *  - frames:
+ *      The measured latencies in frames.
+ *  - count:
+ *      How many samples have been taken.
+ *  - label:
+ *      A description of the pacing and buffering settings, used in the report.
+ */
+typedef struct {
+    SDL_TimerID     timer;
+    SDL_atomic_t    pending;
+    SDL_atomic_t    frame;
+    SDL_atomic_t    anchor_x;
+    SDL_atomic_t    anchor_y;
+    int32_t         direction;
+    Uint64          injected_at;
+    int32_t         injected_frame;
+    Vector2d        target;
+    bool            reflected;
+    float           samples[MAX_LATENCY_SAMPLES];
+    int32_t         frames[MAX_LATENCY_SAMPLES];
+    int32_t         count;
+    char            label[128];
+} LatencyProbe;
+
+/**
+ * Function:
+ *  init_latency_probe
+ *
+ * Purpose:
+ *  Create a LatencyProbe and start injecting events.
+ *
+ * Parameters:
+ *  - interval:
+ *      Milliseconds between injected events.
+ *  - label:
+ *      A description of the settings being measured.
+ *
+ * Returns:
+ *  A LatencyProbe object if successful, NULL otherwise.
+ */
+LatencyProbe* init_latency_probe(int32_t interval, const char* label);
+
+/**
+ * Function:
+ *  latency_frame_begin
+ *
+ * Purpose:
+ *  Tell the probe a new frame has started and where the player is.
+ *
+ * Parameters:
+ *  - probe:
+ *      The LatencyProbe object.
+ *  - position:
+ *      The player's position.
+ *
+ * Returns:
+ *  Nothing.
+ */
+void latency_frame_begin(LatencyProbe* probe, Point2d* position);
+
+/**
+ * Function:
+ *  latency_after_update
+ *
+ * Purpose:
+ *  Check if the simulation reflects the pending injected event.
+ *
+ * Parameters:
+ *  - probe:
+ *      The LatencyProbe object.
+ *  - facing:
+ *      The direction the player faces after this frame's update.
+ *
+ * Returns:
+ *  Nothing.
+ */
+void latency_after_update(LatencyProbe* probe, Vector2d* facing);
+
+/**
+ * Function:
+ *  latency_after_present
+ *
+ * Purpose:
+ *  Take a sample if this frame was the first to show the pending event.
+ *
+ * Parameters:
+ *  - probe:
+ *      The LatencyProbe object.
+ *
+ * Returns:
+ *  Nothing.
+ */
+void latency_after_present(LatencyProbe* probe);
+
+/**
+ * Function:
+ *  destroy_latency_probe
+ *
+ * Purpose:
+ *  Stop injecting, log the latency distribution and release the probe.
+ *
+ * Parameters:
+ *  - probe:
+ *      The LatencyProbe object to destroy.
+ *
+ * Returns:
+ *  Nothing.
+ */
+void destroy_latency_probe(LatencyProbe* probe);
+
+#endif
\ No newline at end of file
@@ -25,10 +25,10 @@ int32_t main(int32_t argc, char** argv) {
     Game* game = init_game(argc, argv);
 
     // Play game
-    start_game(game);
+    int32_t status = start_game(game);
 
     // Clean resources of game
     destroy_game(game);
 
-    return EXIT_SUCCESS;
+    return status;
 }
\ No newline at end of file
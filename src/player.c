@@ -5,21 +5,11 @@
  *************/
 // Release all resources
 static const uint32_t FREE_ALL = 0xFFFFFFFFu;
-// Release SDL surface data
-static const uint32_t FREE_SURFACE = 1u<<0;
 // Free Player object
-static const uint32_t FREE_MEMORY = 1u<<1;
-// Release SDL texture data
-static const uint32_t FREE_TEXTURE = 1u<<2;
-
-// Path to sprite file
-static const char SPRITE_PATH[] = "assets/sprites/player.png";
-// Error message when loading image failed
-static const char LOAD_IMG_LOG[] = "Player sprite not found: %s\n";
-// Error message when fails to create surface
-static const char CREATE_TEXTURE_LOG[] = "Could not create texture from surface: %s\n";
-// Error message when texture query fails
-static const char QUERY_TEXTURE_LOG[] = "Could not query texture: %s\n";
+static const uint32_t FREE_MEMORY = 1u<<0;
+
+// Error message when the world has no room for the player
+static const char ENTITY_LOG[] = "Could not add the player to the world\n";
 // The scaling factor for all movement directions
 static const float PLAYER_SPEED = 0.2f;
 
@@ -35,11 +25,13 @@ static const float PLAYER_SPEED = 0.2f;
  *      The player object.
  *  - dt:
  *      Delta time.
+ *  - map:
+ *      The map with walls to stop at.
  *
  * Returns:
  *  Nothing
  */
-static void __move_left(Player* player, float dt);
+static void __move_left(Player* player, float dt, TileMap* map);
 
 /**
  * Function:
@@ -54,12 +46,14 @@ static void __move_left(Player* player, float dt);
  *  - dt:
  *      Delta time.
  *  - w:
- *      The width of the window.
+ *      The width of the world.
+ *  - map:
+ *      The map with walls to stop at.
  *
  * Returns:
  *  Nothing.
  */
-static void __move_right(Player* player, float dt, int32_t w);
+static void __move_right(Player* player, float dt, float w, TileMap* map);
 
 /**
  * Function:
@@ -73,11 +67,13 @@ static void __move_right(Player* player, float dt, int32_t w);
  *      The player object.
  *  - dt:
  *      Delta time.
+ *  - map:
+ *      The map with walls to stop at.
  *
  * Returns:
  *  Nothing.
  */
-static void __move_up(Player* player, float dt);
+static void __move_up(Player* player, float dt, TileMap* map);
 
 /**
  * Function:
@@ -92,240 +88,334 @@ static void __move_up(Player* player, float dt);
  *  - dt:
  *      Delta time.
  *  - h:
- *      The height of the window.
+ *      The height of the world.
+ *  - map:
+ *      The map with walls to stop at.
  *
  * Returns:
  *  Nothing.
  */
-static void __move_down(Player* player, float dt, int32_t h);
+static void __move_down(Player* player, float dt, float h, TileMap* map);
 
 /**
  * Function:
- *  __rotate
+ *  __hits_wall
  *
  * Purpose:
- *  Rotate the player towards the mouse.
+ *  Check if moving the player's collider would put it in a wall.
+ *
+ * Parameters:
+ *  - player:
+ *      The player object.
+ *  - map:
+ *      The map with the walls.
+ *  - dx:
+ *      The horizontal move.
+ *  - dy:
+ *      The vertical move.
+ *
+ * Returns:
+ *  true if the moved collider overlaps a wall, false otherwise.
+ */
+static bool __hits_wall(Player* player, TileMap* map, float dx, float dy);
+
+/**
+ * Function:
+ *  __consume_input
+ *
+ * Purpose:
+ *  Handle this frame's queued input events in order.
  *
  * Parameters:
  *  - player:
  *      The player object.
  *  - gevts:
  *      The game events that occured.
+ *  - camera:
+ *      The camera the mouse positions are relative to.
  *
  * Returns:
  *  Nothing.
  */
-static void __rotate(Player* player, GameEvents* gevts);
+static void __consume_input(Player* player, GameEvents* gevts, Camera* camera);
 
 /**
  * Function:
- *  __update_collider
+ *  __aim
  *
  * Purpose:
- *  Update the center position of the collider object around
- *  the player.
+ *  Compute the direction from the player towards a point.
  *
  * Parameters:
  *  - player:
  *      The player object.
+ *  - x:
+ *      The horizontal coordinate of the point.
+ *  - y:
+ *      The vertical coordinate of the point.
  *
  * Returns:
- *  Nothing.
+ *  The direction as a unit vector.
  */
-static void __update_collider(Player* player);
+static Vector2d __aim(Player* player, float x, float y);
 
 /**
  * Function:
- *  __destroy
+ *  __rotate
  *
  * Purpose:
- *  Release resources of the Player object.
+ *  Rotate the player towards the mouse.
  *
  * Parameters:
  *  - player:
  *      The player object.
- *  - surface:
- *      SDL_Surface that only lives in function scopes.
- *  - mask:
- *      A mask to choose which resources are destroyed.
- *      FREE_ALL
- *      FREE_SURFACE
- *      FREE_MEMORY
- *      FREE_TEXTURE
+ *  - gevts:
+ *      The game events that occured.
+ *  - camera:
+ *      The camera the mouse position is relative to.
  *
  * Returns:
  *  Nothing.
  */
-static void __destroy(Player* player, SDL_Surface* surface, uint32_t mask);
+static void __rotate(Player* player, GameEvents* gevts, Camera* camera);
 
 /**
  * Function:
- *  __create_texture
+ *  __update_collider
  *
  * Purpose:
- *  Create a texture from an existing surface.
+ *  Update the center position of the collider object around
+ *  the player.
  *
  * Parameters:
- *  - renderer:
- *      A structure that contains a rendering state.
- *  - surface:
- *      A structure that contains a collection of pixels used in software blitting.
- *  - player
+ *  - player:
  *      The player object.
  *
  * Returns:
- *  true if successful, false otherwise.
+ *  Nothing.
  */
-static bool __create_texture(SDL_Renderer* renderer, SDL_Surface* surface, Player* player);
+static void __update_collider(Player* player);
 
 /**
  * Function:
- *  __query_texture
+ *  __destroy
  *
  * Purpose:
- *  Query texture for its dimension.
+ *  Release resources of the Player object.
  *
  * Parameters:
  *  - player:
- *      The Player object.
- *  - surface:
- *      A structure that contains a collection of pixels used in software blitting.
+ *      The player object.
+ *  - mask:
+ *      A mask to choose which resources are destroyed.
+ *      FREE_ALL
+ *      FREE_MEMORY
  *
  * Returns:
- *  true if successful, false otherwise.
+ *  Nothing.
  */
-static bool __query_texture(Player* player, SDL_Surface* surface);
+static void __destroy(Player* player, uint32_t mask);
 
 /**
- * We begin by loading image and if that fails, we stop there.
- * At any point when the initialization fails, we must release
- * previously allocated resources at that point. SDL_Surface
- * does not need to be stored.
+ * The player is drawn from its part of the atlas, which outlives
+ * it. If the world has no room for it, we release it and stop.
+ * The player is the only entity of its archetype, so its components
+ * never move.
  */
-Player* init_player(SDL_Renderer* renderer, float x, float y) {
-    SDL_Surface* surface = IMG_Load(SPRITE_PATH);
-    if (surface == NULL) {
-        SDL_Log(LOAD_IMG_LOG, SDL_GetError());
-        return NULL;
-    }
-
+Player* init_player(Atlas* atlas, World* world, float x, float y) {
     Player* p = (Player*)malloc(sizeof(Player));
+    p->world = world;
+    p->entity = ENTITY_NONE;
+    p->texture = atlas->texture;
+    p->sprite = atlas->rects[SPRITE_PLAYER];
+    p->texture_width = p->sprite.w;
+    p->texture_height = p->sprite.h;
 
-    if (!__create_texture(renderer, surface, p)) return NULL;
-    if (!__query_texture(p, surface)) return NULL;
+    set_component_size(world, COMPONENT_COLLIDER, sizeof(Collider));
+    Archetype* archetype = create_archetype(world, PLAYER_COMPONENTS, 1);
+    if (archetype != NULL) p->entity = create_entity(world, archetype);
+    if (p->entity == ENTITY_NONE) {
+        SDL_Log(ENTITY_LOG);
+        __destroy(p, FREE_ALL);
+        return NULL;
+    }
 
     // The lesser of the two.
-    p->collider.radius = (p->texture_width < p->texture_height ? p->texture_width : p->texture_height) >> 1;
-    p->position = (Point2d){x, y};
-
-    SDL_FreeSurface(surface);
+    player_collider(p)->radius = (p->texture_width < p->texture_height ? p->texture_width : p->texture_height) >> 1;
+    *player_position(p) = (Point2d){x, y};
+    *player_facing(p) = (Vector2d){1.0f, 0.0f};
+    __update_collider(p);
+    p->shots = 0;
 
     return p;
 }
 
 /**
- * Move the player in any requested direction as long as he
- * will not leave the screen and then rotate him towards
- * the mouse. Checks for wall collision.
+ * Move the player in any requested direction as long as it
+ * will not leave the world, handle queued input and then
+ * rotate it towards the mouse. Checks for wall collision,
+ * both the world's borders and the map's walls. The mouse
+ * is in window coordinates, so the camera the last frame was
+ * drawn with turns it into a world position.
  */
-void update_player(Player* player, GameEvents* gevts, float dt, int32_t w, int32_t h) {
-    if (gevts->move_left) __move_left(player, dt);
-    if (gevts->move_right) __move_right(player, dt, w);
-    if (gevts->move_up) __move_up(player, dt);
-    if (gevts->move_down) __move_down(player, dt, h);
-    __rotate(player, gevts);
+void update_player(Player* player, GameEvents* gevts, float dt, Camera* camera, TileMap* map) {
+    if (gevts->move_left) __move_left(player, dt, map);
+    if (gevts->move_right) __move_right(player, dt, camera->world_width, map);
+    if (gevts->move_up) __move_up(player, dt, map);
+    if (gevts->move_down) __move_down(player, dt, camera->world_height, map);
+    __consume_input(player, gevts, camera);
+    __rotate(player, gevts, camera);
     __update_collider(player);
 }
 
+/**
+ * Looked up in the world each time, the player is a single entity.
+ */
+Point2d* player_position(Player* player) {
+    return (Point2d*)get_component(player->world, player->entity, COMPONENT_POSITION);
+}
+
+/**
+ * Same as player_position.
+ */
+Vector2d* player_facing(Player* player) {
+    return (Vector2d*)get_component(player->world, player->entity, COMPONENT_FACING);
+}
+
+/**
+ * Same as player_position.
+ */
+Collider* player_collider(Player* player) {
+    return (Collider*)get_component(player->world, player->entity, COMPONENT_COLLIDER);
+}
+
+/**
+ * The rotation is clockwise, and the sprite faces east with
+ * no rotation. The player has a single animation state.
+ */
+void capture_player(Player* player, Snapshot* snapshot) {
+    Vector2d* facing = player_facing(player);
+    snapshot->player = (Sprite){ *player_position(player), rad_to_deg(fast_atan2(facing->y, facing->x)), 0 };
+}
+
 /**
  * Convert the player position into integers before
- * rendering. The rotation is clockwise.
+ * rendering.
  */
-void draw_player(SDL_Renderer* renderer,Player* player) {
+void draw_player(RenderBuffer* commands, Player* player, Snapshot* snapshot) {
+    Sprite* sprite = &snapshot->player;
     SDL_Rect rect = {
-        (int)player->position.x,
-        (int)player->position.y,
+        (int)(sprite->position.x - snapshot->camera.position.x),
+        (int)(sprite->position.y - snapshot->camera.position.y),
         player->texture_width,
         player->texture_height
     };
-    SDL_RenderCopyEx(
-        renderer,
-        player->texture,
-        NULL,
-        &rect,
-        rad_to_deg(player->rotation),
-        NULL,
-        SDL_FLIP_NONE
-    );
+    push_sprite(commands, LAYER_PLAYER, player->texture, &player->sprite, &rect, sprite->angle);
 }
 
 /**
- * Does not need to release the surface, hence we
- * do not use the FREE_ALL mask.
+ * The atlas is not the player's to release.
  */
 void destroy_player(Player* player) {
-    __destroy(player, NULL, FREE_TEXTURE | FREE_MEMORY);
+    __destroy(player, FREE_ALL);
 }
 
 /**
- * Moves left if we are not too close to the left border.
+ * Moves left if we are not too close to the left border
+ * and there is no wall in the way.
  */
-static void __move_left(Player* player, float dt) {
-    if (player->collider.center.x - player->collider.radius >= 0) {
-        player->position.x -= PLAYER_SPEED * dt;
+static void __move_left(Player* player, float dt, TileMap* map) {
+    Collider* collider = player_collider(player);
+    if (collider->center.x - collider->radius >= 0 && !__hits_wall(player, map, -PLAYER_SPEED * dt, 0)) {
+        player_position(player)->x -= PLAYER_SPEED * dt;
     }
 }
 
 /**
- * Moves right if we are not too close to the right border.
+ * Moves right if we are not too close to the right border
+ * and there is no wall in the way.
  */
-static void __move_right(Player* player, float dt, int32_t w) {
-    if (player->collider.center.x + player->collider.radius <= w) {
-        player->position.x += PLAYER_SPEED * dt;
+static void __move_right(Player* player, float dt, float w, TileMap* map) {
+    Collider* collider = player_collider(player);
+    if (collider->center.x + collider->radius <= w && !__hits_wall(player, map, PLAYER_SPEED * dt, 0)) {
+        player_position(player)->x += PLAYER_SPEED * dt;
     }
 }
 
 /**
- * Moves up if we are not too close to the upper border.
+ * Moves up if we are not too close to the upper border
+ * and there is no wall in the way.
  */
-static void __move_up(Player* player, float dt) {
-    if (player->collider.center.y - player->collider.radius >= 0) {
-        player->position.y -= PLAYER_SPEED * dt;
+static void __move_up(Player* player, float dt, TileMap* map) {
+    Collider* collider = player_collider(player);
+    if (collider->center.y - collider->radius >= 0 && !__hits_wall(player, map, 0, -PLAYER_SPEED * dt)) {
+        player_position(player)->y -= PLAYER_SPEED * dt;
     }
 }
 
 /**
- * Moves down if we are not too close to the lower border.
+ * Moves down if we are not too close to the lower border
+ * and there is no wall in the way.
  */
-static void __move_down(Player* player, float dt, int32_t h) {
-    if (player->collider.center.y + player->collider.radius <= h) {
-        player->position.y += PLAYER_SPEED * dt;
+static void __move_down(Player* player, float dt, float h, TileMap* map) {
+    Collider* collider = player_collider(player);
+    if (collider->center.y + collider->radius <= h && !__hits_wall(player, map, 0, PLAYER_SPEED * dt)) {
+        player_position(player)->y += PLAYER_SPEED * dt;
+    }
+}
+
+/**
+ * Tests the corners of the box around the collider. Walls are at
+ * least as wide as the collider, so no wall fits between them.
+ */
+static bool __hits_wall(Player* player, TileMap* map, float dx, float dy) {
+    Collider* collider = player_collider(player);
+    float x = collider->center.x + dx, y = collider->center.y + dy, r = collider->radius;
+    return is_wall_at(map, x - r, y - r) || is_wall_at(map, x + r, y - r)
+        || is_wall_at(map, x - r, y + r) || is_wall_at(map, x + r, y + r);
+}
+
+/**
+ * Every press of mouse button 1 is a shot, aimed at where the
+ * mouse was when the button went down rather than where it ends
+ * up at the end of the frame. Shots beyond the per frame limit
+ * are ignored.
+ */
+static void __consume_input(Player* player, GameEvents* gevts, Camera* camera) {
+    InputEvent evt;
+    player->shots = 0;
+    while (next_input(gevts, &evt)) {
+        if (evt.type == INPUT_MOUSE_DOWN && evt.code == SDL_BUTTON_LEFT && player->shots < MAX_SHOTS_PER_FRAME) {
+            player->shot_directions[player->shots++] = __aim(player, evt.x + camera->position.x, evt.y + camera->position.y);
+        }
     }
 }
 
 /**
  * Let P be the position of the player and M the position of the mouse.
- * Then the angle between the vector v=[P to M] and u=[1,0] is the angle
- * we are looking for. Note the u=[1,0] is chosen because the sprite
- * faces east with no rotation.
- *
- * cos(x) = (v*u) / (|v|*|u|)
- *        = (1*v_x + 0*v_y) / ( sqrt(1*1+0+0) + sqrt(v_x*v_x + v_y*v_y))
- *        = v_x / (sqrt(1) * sqrt(|v|*|v|))
- *        = v_x / sqrt(|v|*|v|)
- * => x = arccos(v_x / sqrt(|v| * |v|))
- *
- * Since arccos always chooses the lesser of angles betwee two vectorss
- * (if there is a 120° angle between some vectors, there is also a 240°
- * angle between them in the other direction), we multiply with the sign
- * of v_y to rotate in the correct direction.
+ * The direction is v=[P to M] scaled to unit length. Keeping the vector
+ * rather than its angle means no inverse trigonometry per frame, and
+ * both the collider and the shots want the vector anyway. If the mouse
+ * is right on top of the player there is no direction, so the previous
+ * facing is kept.
  */
-static void __rotate(Player* player, GameEvents* gevts) {
+static Vector2d __aim(Player* player, float x, float y) {
+    Point2d* position = player_position(player);
     Vector2d d = {
-        gevts->mouseX - player->position.x,
-        gevts->mouseY - player->position.y
+        x - position->x,
+        y - position->y
     };
-    player->rotation = sign(d.y) * fast_acos(d.x * carmack_inverse_sqrt(length_squared(&d)));
+    float len_sq = length_squared(&d);
+    if (len_sq == 0.0f) return *player_facing(player);
+    float norm_factor = carmack_inverse_sqrt(len_sq);
+    return (Vector2d){ d.x * norm_factor, d.y * norm_factor };
+}
+
+/**
+ * Face the latest mouse position.
+ */
+static void __rotate(Player* player, GameEvents* gevts, Camera* camera) {
+    *player_facing(player) = __aim(player, gevts->mouseX + camera->position.x, gevts->mouseY + camera->position.y);
 }
 
 /**
@@ -340,44 +430,21 @@ static void __rotate(Player* player, GameEvents* gevts) {
  */
 static void __update_collider(Player* player) {
     int32_t scale = player->texture_width / 4;
-    player->collider.center.x = (player->position.x + player->texture_width / 2)
-        - SDL_cosf(player->rotation) * scale;
-    player->collider.center.y = (player->position.y + player->texture_height / 2)
-        - SDL_sinf(player->rotation) * scale;
+    Point2d* position = player_position(player);
+    Vector2d* facing = player_facing(player);
+    Collider* collider = player_collider(player);
+    collider->center.x = (position->x + player->texture_width / 2)
+        - facing->x * scale;
+    collider->center.y = (position->y + player->texture_height / 2)
+        - facing->y * scale;
 }
 
 /**
  * Check each resources against mask before releasing.
  */
-static void __destroy(Player* player, SDL_Surface* surface, uint32_t mask) {
-    if (mask & FREE_SURFACE) SDL_FreeSurface(surface);
-    if (mask & FREE_TEXTURE) SDL_DestroyTexture(player->texture);
-    if (mask & FREE_MEMORY) free(player);
-}
-
-/**
- * Releases the surface resources and Player memory if we fail
- * to create the texture.
- */
-static bool __create_texture(SDL_Renderer* renderer, SDL_Surface* surface, Player* player) {
-    player->texture = SDL_CreateTextureFromSurface(renderer, surface);
-    if (player->texture == NULL) {
-        SDL_Log(CREATE_TEXTURE_LOG, SDL_GetError());
-        __destroy(player, surface, FREE_SURFACE | FREE_MEMORY);
-        return false;
-    }
-    return true;
-}
-
-/**
- * Releases the surface and texture resources and Player memory
- * if we fail to query the texture.
- */
-static bool __query_texture(Player* player, SDL_Surface* surface) {
-    if (SDL_QueryTexture(player->texture, NULL, NULL, &player->texture_width, &player->texture_height) < 0) {
-        SDL_Log(QUERY_TEXTURE_LOG, SDL_GetError());
-        __destroy(player, surface, FREE_ALL);
-        return false;
+static void __destroy(Player* player, uint32_t mask) {
+    if (mask & FREE_MEMORY) {
+        destroy_entity(player->world, player->entity);
+        free(player);
     }
-    return true;
 }
\ No newline at end of file
@@ -11,7 +11,18 @@
 
 #include "gevent.h"
 #include "gmath.h"
+#include "tilemap.h"
+#include "camera.h"
 #include "collision.h"
+#include "ecs.h"
+#include "snapshot.h"
+#include "render.h"
+#include "atlas.h"
+
+// The most shots a player can fire within a single frame.
+#define MAX_SHOTS_PER_FRAME 8
+// The components of the player: where it is, where it faces and what it collides with
+#define PLAYER_COMPONENTS ((1u << COMPONENT_POSITION) | (1u << COMPONENT_FACING) | (1u << COMPONENT_COLLIDER))
 
 /**
  * Struct:
@@ -22,26 +33,32 @@
  *
  * Fields
  *  - texture:
- *      A structure that contains an efficient, driver-specific
- *      representation of pixel data for the player.
+ *      The atlas the player is drawn from, not owned.
+ *  - sprite:
+ *      The player's part of the atlas.
  *  - texture_width:
- *      The width of the player texture in pixels.
+ *      The width of the player sprite in pixels.
  *  - texture_height:
- *      The height of the player texture in pixels.
- *  - position:
- *      The 2d position of the player.
- *  - rotation:
- *      The direction the player is facing in radians.
- *  - collider:
- *      The geometric object to calculate collision for.
+ *      The height of the player sprite in pixels.
+ *  - world:
+ *      The entities, shared with the enemies.
+ *  - entity:
+ *      The player's entity, which holds its position, facing and collider.
+ *  - shots:
+ *      How many times the player fired this frame.
+ *  - shot_directions:
+ *      The direction the player was aiming, as a unit vector, at
+ *      the moment of each shot this frame, in the order fired.
  */
 typedef struct {
     SDL_Texture*    texture;
+    SDL_Rect        sprite;
     int32_t         texture_width;
     int32_t         texture_height;
-    Point2d         position;
-    float           rotation;
-    Collider        collider;
+    World*          world;
+    Entity          entity;
+    int32_t         shots;
+    Vector2d        shot_directions[MAX_SHOTS_PER_FRAME];
 } Player;
 
 /**
@@ -52,8 +69,10 @@ typedef struct {
  *  Create and initialize a Player object.
  *
  * Parameters:
- *  - renderer:
- *      A structure that contains a rendering state.
+ *  - atlas:
+ *      The sprites, the player's among them.
+ *  - world:
+ *      The entities, with room for the player.
  *  - x:
  *      The horizontal starting position of the player.
  *  - y:
@@ -62,14 +81,64 @@ typedef struct {
  * Returns:
  *  Player object if successful, NULL otherwise.
  */
-Player* init_player(SDL_Renderer* renderer, float x, float y);
+Player* init_player(Atlas* atlas, World* world, float x, float y);
+
+/**
+ * Function:
+ *  player_position
+ *
+ * Purpose:
+ *  Find the player's position, the top left corner of its sprite.
+ *
+ * Parameters:
+ *  - player:
+ *      The player object.
+ *
+ * Returns:
+ *  The position, good until another entity with the same
+ *  components is created or destroyed.
+ */
+Point2d* player_position(Player* player);
+
+/**
+ * Function:
+ *  player_facing
+ *
+ * Purpose:
+ *  Find the direction the player is facing, as a unit vector.
+ *
+ * Parameters:
+ *  - player:
+ *      The player object.
+ *
+ * Returns:
+ *  The facing, good for as long as the position is.
+ */
+Vector2d* player_facing(Player* player);
+
+/**
+ * Function:
+ *  player_collider
+ *
+ * Purpose:
+ *  Find the geometric object to calculate collision for.
+ *
+ * Parameters:
+ *  - player:
+ *      The player object.
+ *
+ * Returns:
+ *  The collider, good for as long as the position is.
+ */
+Collider* player_collider(Player* player);
 
 /**
  * Function:
  *  update_player
  *
  * Purpose:
- *  Update the player based on events.
+ *  Update the player based on events. Consumes this
+ *  frame's input queue.
  *
  * Parameters:
  *  - player:
@@ -78,33 +147,55 @@ Player* init_player(SDL_Renderer* renderer, float x, float y);
  *      The events that occured this frame.
  *  - dt:
  *      Delta time.
- *  - w:
- *      The window's width.
- *  - h:
- *      The window's height.
+ *  - camera:
+ *      The camera the last frame was drawn with, which also
+ *      holds the world's size the player is kept within.
+ *  - map:
+ *      The map whose walls the player can't walk through.
  *
  * Returns:
  *  Nothing.
  */
-void update_player(Player* player, GameEvents* gevts, float dt, int32_t w, int32_t h);
+void update_player(Player* player, GameEvents* gevts, float dt, Camera* camera, TileMap* map);
 
 /**
  * Function:
- *  draw_player
+ *  capture_player
  *
  * Purpose:
- *  Draw the player. This should always be called after update_player.
+ *  Copy the player into a snapshot. This should always be called
+ *  after update_player.
  *
  * Parameters:
- *  - renderer:
- *      A structure that contains a rendering state.
  *  - player:
  *      The player object.
+ *  - snapshot:
+ *      The Snapshot object.
+ *
+ * Returns:
+ *  Nothing.
+ */
+void capture_player(Player* player, Snapshot* snapshot);
+
+/**
+ * Function:
+ *  draw_player
+ *
+ * Purpose:
+ *  Draw the player of a snapshot.
+ *
+ * Parameters:
+ *  - commands:
+ *      The RenderBuffer the player is drawn into.
+ *  - player:
+ *      The player object, for its texture.
+ *  - snapshot:
+ *      The Snapshot object, which the player was captured into.
  *
  * Returns:
  *  Nothing.
  */
-void draw_player(SDL_Renderer* renderer, Player* player);
+void draw_player(RenderBuffer* commands, Player* player, Snapshot* snapshot);
 
 /**
  * Free any resources used by the player.
@@ -0,0 +1,220 @@
+#include "render.h"
+
+// The number of commands allocated up front
+static const int32_t INITIAL_COMMAND_CAPACITY = 4096;
+// The number of values a digit of the sort key takes
+static const int32_t RADIX = 256;
+// The number of bits in the sort key
+static const int32_t KEY_BITS = 16;
+
+/**
+ * Function:
+ *  __add_command
+ *
+ * Purpose:
+ *  Make room for one more command.
+ *
+ * Parameters:
+ *  - buffer:
+ *      The RenderBuffer object.
+ *
+ * Returns:
+ *  The command, for the caller to fill in.
+ */
+static RenderCommand* __add_command(RenderBuffer* buffer);
+
+/**
+ * Function:
+ *  __texture_slot
+ *
+ * Purpose:
+ *  Find the slot of a texture, giving it one if it has none.
+ *
+ * Parameters:
+ *  - buffer:
+ *      The RenderBuffer object.
+ *  - texture:
+ *      The texture.
+ *
+ * Returns:
+ *  The slot, between 1 and RENDER_MAX_TEXTURES.
+ */
+static uint32_t __texture_slot(RenderBuffer* buffer, SDL_Texture* texture);
+
+/**
+ * Slot 0 stands for fills, which have no texture.
+ */
+RenderBuffer* init_render_buffer(void) {
+    RenderBuffer* buffer = (RenderBuffer*)calloc(1, sizeof(RenderBuffer));
+    buffer->capacity = INITIAL_COMMAND_CAPACITY;
+    buffer->commands = (RenderCommand*)malloc(sizeof(RenderCommand) * buffer->capacity);
+    buffer->sorted = (RenderCommand*)malloc(sizeof(RenderCommand) * buffer->capacity);
+    buffer->textures[0] = NULL;
+    buffer->texture_count = 1;
+    buffer->last_texture = NULL;
+    buffer->last_slot = 0;
+    return buffer;
+}
+
+void push_sprite(RenderBuffer* buffer, RenderLayer layer, SDL_Texture* texture, SDL_Rect* src, SDL_Rect* dst, float angle) {
+    RenderCommand* command = __add_command(buffer);
+    command->texture = texture;
+    command->src = *src;
+    command->dst = *dst;
+    command->angle = angle;
+    command->key = ((uint32_t)layer << 8) | __texture_slot(buffer, texture);
+}
+
+void push_fill(RenderBuffer* buffer, RenderLayer layer, SDL_Color color, SDL_Rect* dst) {
+    RenderCommand* command = __add_command(buffer);
+    command->texture = NULL;
+    command->dst = *dst;
+    command->angle = 0.0f;
+    command->color = color;
+    command->key = (uint32_t)layer << 8;
+}
+
+/**
+ * A least significant digit radix sort, a byte at a time, which
+ * is stable, so commands with the same key keep their order. A
+ * frame has few layers and textures, so a pass where every key
+ * has the same digit is common and skipped.
+ */
+void sort_render_buffer(RenderBuffer* buffer) {
+    if (buffer->count == 0) return;
+
+    for (int32_t shift = 0; shift < KEY_BITS; shift += 8) {
+        int32_t offsets[RADIX];
+        memset(offsets, 0, sizeof(offsets));
+        for (int32_t i = 0; i < buffer->count; i++) offsets[(buffer->commands[i].key >> shift) & (RADIX - 1)]++;
+        if (offsets[(buffer->commands[0].key >> shift) & (RADIX - 1)] == buffer->count) continue;
+
+        for (int32_t d = 0, sum = 0; d < RADIX; d++) {
+            int32_t n = offsets[d];
+            offsets[d] = sum;
+            sum += n;
+        }
+        for (int32_t i = 0; i < buffer->count; i++) {
+            buffer->sorted[offsets[(buffer->commands[i].key >> shift) & (RADIX - 1)]++] = buffer->commands[i];
+        }
+
+        RenderCommand* swap = buffer->commands;
+        buffer->commands = buffer->sorted;
+        buffer->sorted = swap;
+    }
+}
+
+/**
+ * Fills of the same color in a row are gathered into one call.
+ * SDL2 has no call drawing many sprites, but it queues consecutive
+ * copies from the same texture into one batch for the GPU, which is
+ * what grouping by texture gives it. The draw color is only set when
+ * it changes, and left as the last fill's. The fills are gathered in
+ * scratch memory taken at the first fill, enough for every command
+ * from there on. If the arena is out of room and may not grow, each
+ * fill is drawn on its own instead.
+ */
+void submit_render_buffer(RenderBuffer* buffer, SDL_Renderer* renderer, Arena* scratch) {
+    sort_render_buffer(buffer);
+
+    RenderStats stats = { (uint64_t)buffer->count, 0, 0 };
+    SDL_Rect* rects = NULL;
+    bool gathered = false;
+    SDL_Texture* bound = NULL;
+    SDL_Color color = { 0, 0, 0, 0 };
+    bool first = true, colored = false;
+    for (int32_t i = 0; i < buffer->count;) {
+        RenderCommand* command = &buffer->commands[i];
+        if (first || command->texture != bound) stats.texture_switches++;
+        bound = command->texture;
+        first = false;
+
+        if (command->texture == NULL) {
+            SDL_Color c = command->color;
+            if (!colored || c.r != color.r || c.g != color.g || c.b != color.b || c.a != color.a) {
+                SDL_SetRenderDrawColor(renderer, c.r, c.g, c.b, c.a);
+                color = c;
+                colored = true;
+            }
+            if (!gathered) {
+                rects = ARENA_NEW(scratch, SDL_Rect, buffer->count - i);
+                gathered = true;
+            }
+            if (rects == NULL) {
+                SDL_RenderFillRect(renderer, &command->dst);
+                i++;
+                stats.draw_calls++;
+                continue;
+            }
+            int32_t n = 0;
+            while (i < buffer->count && buffer->commands[i].texture == NULL
+                && memcmp(&buffer->commands[i].color, &c, sizeof(SDL_Color)) == 0) {
+                rects[n++] = buffer->commands[i++].dst;
+            }
+            SDL_RenderFillRects(renderer, rects, n);
+        } else if (command->angle == 0.0f) {
+            SDL_RenderCopy(renderer, command->texture, &command->src, &command->dst);
+            i++;
+        } else {
+            SDL_RenderCopyEx(renderer, command->texture, &command->src, &command->dst, command->angle, NULL, SDL_FLIP_NONE);
+            i++;
+        }
+        stats.draw_calls++;
+    }
+
+    finish_render_buffer(buffer, &stats);
+}
+
+void finish_render_buffer(RenderBuffer* buffer, RenderStats* stats) {
+    buffer->frame = *stats;
+    buffer->total.commands += stats->commands;
+    buffer->total.draw_calls += stats->draw_calls;
+    buffer->total.texture_switches += stats->texture_switches;
+    buffer->frames++;
+    buffer->count = 0;
+}
+
+void destroy_render_buffer(RenderBuffer* buffer) {
+    free(buffer->commands);
+    free(buffer->sorted);
+    free(buffer);
+}
+
+/**
+ * Doubling keeps growing rare, and it stops once the busiest
+ * frame fits. The sort buffer grows along, so it always fits
+ * every command.
+ */
+static RenderCommand* __add_command(RenderBuffer* buffer) {
+    if (buffer->count == buffer->capacity) {
+        buffer->capacity *= 2;
+        buffer->commands = (RenderCommand*)realloc(buffer->commands, sizeof(RenderCommand) * buffer->capacity);
+        buffer->sorted = (RenderCommand*)realloc(buffer->sorted, sizeof(RenderCommand) * buffer->capacity);
+    }
+    return &buffer->commands[buffer->count++];
+}
+
+/**
+ * Commands come in runs from the same texture, so the last one
+ * looked up usually matches. Otherwise the few textures seen so
+ * far are searched. Past RENDER_MAX_TEXTURES, textures share the
+ * last slot, which only costs them being grouped together.
+ */
+static uint32_t __texture_slot(RenderBuffer* buffer, SDL_Texture* texture) {
+    if (texture == buffer->last_texture && buffer->last_slot != 0) return buffer->last_slot;
+
+    int32_t slot = 1;
+    while (slot < buffer->texture_count && buffer->textures[slot] != texture) slot++;
+    if (slot == buffer->texture_count) {
+        if (slot <= RENDER_MAX_TEXTURES) {
+            buffer->textures[slot] = texture;
+            buffer->texture_count++;
+        } else {
+            slot = RENDER_MAX_TEXTURES;
+        }
+    }
+
+    buffer->last_texture = texture;
+    buffer->last_slot = (uint32_t)slot;
+    return buffer->last_slot;
+}
\ No newline at end of file
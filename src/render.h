@@ -0,0 +1,279 @@
+#ifndef Qm7Lc2XvNe_RENDER_H
+#define Qm7Lc2XvNe_RENDER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <SDL2/SDL.h>
+
+#include "arena.h"
+
+// The most textures told apart when sorting, later ones share the last slot
+#define RENDER_MAX_TEXTURES 255
+
+/**
+ * Enum:
+ *  RenderLayer
+ *
+ * Purpose:
+ *  The order commands are drawn in, lower layers first. Within a
+ *  layer, commands are grouped by texture and otherwise keep the
+ *  order they were added in.
+ *
+ * Constants:
+ *  - LAYER_FLOOR:
+ *      The floor tiles.
+ *  - LAYER_WALLS:
+ *      The map's walls.
+ *  - LAYER_ENEMIES:
+ *      The enemies.
+ *  - LAYER_PLAYER:
+ *      The player.
+ */
+typedef enum {
+    LAYER_FLOOR     = 0,
+    LAYER_WALLS     = 1,
+    LAYER_ENEMIES   = 2,
+    LAYER_PLAYER    = 3
+} RenderLayer;
+
+/**
+ * Struct:
+ *  RenderCommand
+ *
+ * Purpose:
+ *  One sprite or filled rectangle to draw.
+ *
+ * Fields:
+ *  - texture:
+ *      The texture drawn from, NULL to fill dst with color.
+ *  - src:
+ *      The part of the texture drawn.
+ *  - dst:
+ *      Where it is drawn in the window.
+ *  - angle:
+ *      The rotation in degrees, clockwise, around dst's center.
+ *  - color:
+ *      The color filled with, unused for textures.
+ *  - key:
+ *      The layer in the high byte and the texture's slot in the low
+ *      byte, what the commands are sorted by.
+ */
+typedef struct {
+    SDL_Texture*    texture;
+    SDL_Rect        src;
+    SDL_Rect        dst;
+    float           angle;
+    SDL_Color       color;
+    uint32_t        key;
+} RenderCommand;
+
+/**
+ * Struct:
+ *  RenderStats
+ *
+ * Purpose:
+ *  Counts what submitting commands cost.
+ *
+ * Fields:
+ *  - commands:
+ *      The number of commands submitted.
+ *  - draw_calls:
+ *      The number of SDL draw calls made for them.
+ *  - texture_switches:
+ *      The number of times a draw call used another texture, or
+ *      switched between textures and fills, than the one before.
+ */
+typedef struct {
+    uint64_t    commands;
+    uint64_t    draw_calls;
+    uint64_t    texture_switches;
+} RenderStats;
+
+/**
+ * Struct:
+ *  RenderBuffer
+ *
+ * Purpose:
+ *  The commands of a frame, collected by the draw functions and
+ *  sorted by layer and texture before they are submitted.
+ *
+ * Fields:
+ *  - commands:
+ *      The commands added since the last submit.
+ *  - sorted:
+ *      Where the commands are sorted into.
+ *  - count:
+ *      The number of commands.
+ *  - capacity:
+ *      The number of commands allocated.
+ *  - textures:
+ *      The textures seen so far, indexed by slot, slot 0 being fills.
+ *  - texture_count:
+ *      The number of slots taken.
+ *  - last_texture:
+ *      The texture looked up last.
+ *  - last_slot:
+ *      Its slot.
+ *  - frame:
+ *      The stats of the last submit.
+ *  - total:
+ *      The stats of every submit.
+ *  - frames:
+ *      The number of submits.
+ */
+typedef struct {
+    RenderCommand*  commands;
+    RenderCommand*  sorted;
+    int32_t         count;
+    int32_t         capacity;
+    SDL_Texture*    textures[RENDER_MAX_TEXTURES + 1];
+    int32_t         texture_count;
+    SDL_Texture*    last_texture;
+    uint32_t        last_slot;
+    RenderStats     frame;
+    RenderStats     total;
+    uint64_t        frames;
+} RenderBuffer;
+
+/**
+ * Function:
+ *  init_render_buffer
+ *
+ * Purpose:
+ *  Create an empty RenderBuffer.
+ *
+ * Parameters:
+ *  None.
+ *
+ * Returns:
+ *  The RenderBuffer object.
+ */
+RenderBuffer* init_render_buffer(void);
+
+/**
+ * Function:
+ *  push_sprite
+ *
+ * Purpose:
+ *  Add a command drawing part of a texture.
+ *
+ * Parameters:
+ *  - buffer:
+ *      The RenderBuffer object.
+ *  - layer:
+ *      The layer drawn in.
+ *  - texture:
+ *      The texture drawn from.
+ *  - src:
+ *      The part of the texture drawn.
+ *  - dst:
+ *      Where it is drawn in the window.
+ *  - angle:
+ *      The rotation in degrees, clockwise, around dst's center.
+ *
+ * Returns:
+ *  Nothing.
+ */
+void push_sprite(RenderBuffer* buffer, RenderLayer layer, SDL_Texture* texture, SDL_Rect* src, SDL_Rect* dst, float angle);
+
+/**
+ * Function:
+ *  push_fill
+ *
+ * Purpose:
+ *  Add a command filling a rectangle with a color.
+ *
+ * Parameters:
+ *  - buffer:
+ *      The RenderBuffer object.
+ *  - layer:
+ *      The layer drawn in.
+ *  - color:
+ *      The color filled with.
+ *  - dst:
+ *      The rectangle in the window.
+ *
+ * Returns:
+ *  Nothing.
+ */
+void push_fill(RenderBuffer* buffer, RenderLayer layer, SDL_Color color, SDL_Rect* dst);
+
+/**
+ * Function:
+ *  sort_render_buffer
+ *
+ * Purpose:
+ *  Sort the commands by layer and texture, keeping the order they
+ *  were added in otherwise.
+ *
+ * Parameters:
+ *  - buffer:
+ *      The RenderBuffer object.
+ *
+ * Returns:
+ *  Nothing.
+ */
+void sort_render_buffer(RenderBuffer* buffer);
+
+/**
+ * Function:
+ *  submit_render_buffer
+ *
+ * Purpose:
+ *  Sort the commands, draw them with as few SDL calls as possible,
+ *  count what it took and empty the buffer.
+ *
+ * Parameters:
+ *  - buffer:
+ *      The RenderBuffer object.
+ *  - renderer:
+ *      A structure that contains a rendering state.
+ *  - scratch:
+ *      The frame's scratch arena, the rectangles of consecutive
+ *      fills are gathered in memory taken from it.
+ *
+ * Returns:
+ *  Nothing.
+ */
+void submit_render_buffer(RenderBuffer* buffer, SDL_Renderer* renderer, Arena* scratch);
+
+/**
+ * Function:
+ *  finish_render_buffer
+ *
+ * Purpose:
+ *  Count the stats of a frame's commands once they are drawn,
+ *  and empty the buffer.
+ *
+ * Parameters:
+ *  - buffer:
+ *      The RenderBuffer object.
+ *  - stats:
+ *      What drawing the commands took.
+ *
+ * Returns:
+ *  Nothing.
+ */
+void finish_render_buffer(RenderBuffer* buffer, RenderStats* stats);
+
+/**
+ * Function:
+ *  destroy_render_buffer
+ *
+ * Purpose:
+ *  Release the RenderBuffer object.
+ *
+ * Parameters:
+ *  - buffer:
+ *      The RenderBuffer object to destroy.
+ *
+ * Returns:
+ *  Nothing.
+ */
+void destroy_render_buffer(RenderBuffer* buffer);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,43 @@
+#include "snapshot.h"
+
+// The number of enemies allocated up front
+static const int32_t INITIAL_ENEMY_CAPACITY = 1024;
+
+/**
+ * The player is left for capture_player to fill in.
+ */
+Snapshot* init_snapshot(Camera* camera) {
+    Snapshot* snapshot = (Snapshot*)malloc(sizeof(Snapshot));
+    snapshot->camera = *camera;
+    snapshot->player = (Sprite){ camera->position, 0.0f, 0 };
+    snapshot->enemy_count = 0;
+    snapshot->enemy_capacity = INITIAL_ENEMY_CAPACITY;
+    snapshot->enemies = (Sprite*)malloc(sizeof(Sprite) * snapshot->enemy_capacity);
+    return snapshot;
+}
+
+/**
+ * The enemies are kept allocated, a frame usually shows about
+ * as many as the last one.
+ */
+void clear_snapshot(Snapshot* snapshot, Camera* camera) {
+    snapshot->camera = *camera;
+    snapshot->enemy_count = 0;
+}
+
+/**
+ * Doubling keeps growing rare, and it stops once the most
+ * enemies ever in view fit.
+ */
+Sprite* add_enemy_sprite(Snapshot* snapshot) {
+    if (snapshot->enemy_count == snapshot->enemy_capacity) {
+        snapshot->enemy_capacity *= 2;
+        snapshot->enemies = (Sprite*)realloc(snapshot->enemies, sizeof(Sprite) * snapshot->enemy_capacity);
+    }
+    return &snapshot->enemies[snapshot->enemy_count++];
+}
+
+void destroy_snapshot(Snapshot* snapshot) {
+    free(snapshot->enemies);
+    free(snapshot);
+}
\ No newline at end of file
@@ -0,0 +1,127 @@
+#ifndef Tf6NcR1wHy_SNAPSHOT_H
+#define Tf6NcR1wHy_SNAPSHOT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "gmath.h"
+#include "camera.h"
+
+/**
+ * Struct:
+ *  Sprite
+ *
+ * Purpose:
+ *  Everything needed to draw one entity, worked out ahead of time.
+ *
+ * Fields:
+ *  - position:
+ *      The top left corner in world coordinates.
+ *  - angle:
+ *      The rotation in degrees, clockwise.
+ *  - state:
+ *      The frame of the entity's animation.
+ */
+typedef struct {
+    Point2d     position;
+    float       angle;
+    int32_t     state;
+} Sprite;
+
+/**
+ * Struct:
+ *  Snapshot
+ *
+ * Purpose:
+ *  What a frame shows, copied out of the simulation when it is
+ *  done so the frame can be drawn while the next one is simulated.
+ *
+ * Fields:
+ *  - camera:
+ *      The camera at the end of the frame.
+ *  - player:
+ *      The player.
+ *  - enemies:
+ *      The enemies in view.
+ *  - enemy_count:
+ *      The number of enemies in view.
+ *  - enemy_capacity:
+ *      The number of enemies allocated.
+ */
+typedef struct {
+    Camera      camera;
+    Sprite      player;
+    Sprite*     enemies;
+    int32_t     enemy_count;
+    int32_t     enemy_capacity;
+} Snapshot;
+
+/**
+ * Function:
+ *  init_snapshot
+ *
+ * Purpose:
+ *  Create an empty Snapshot.
+ *
+ * Parameters:
+ *  - camera:
+ *      The camera, copied into the snapshot.
+ *
+ * Returns:
+ *  The Snapshot object.
+ */
+Snapshot* init_snapshot(Camera* camera);
+
+/**
+ * Function:
+ *  clear_snapshot
+ *
+ * Purpose:
+ *  Empty a Snapshot to take a new frame.
+ *
+ * Parameters:
+ *  - snapshot:
+ *      The Snapshot object.
+ *  - camera:
+ *      The camera, copied into the snapshot.
+ *
+ * Returns:
+ *  Nothing.
+ */
+void clear_snapshot(Snapshot* snapshot, Camera* camera);
+
+/**
+ * Function:
+ *  add_enemy_sprite
+ *
+ * Purpose:
+ *  Make room for one more enemy in a Snapshot.
+ *
+ * Parameters:
+ *  - snapshot:
+ *      The Snapshot object.
+ *
+ * Returns:
+ *  The enemy's sprite, for the caller to fill in.
+ */
+Sprite* add_enemy_sprite(Snapshot* snapshot);
+
+/**
+ * Function:
+ *  destroy_snapshot
+ *
+ * Purpose:
+ *  Release the Snapshot object.
+ *
+ * Parameters:
+ *  - snapshot:
+ *      The Snapshot object to destroy.
+ *
+ * Returns:
+ *  Nothing.
+ */
+void destroy_snapshot(Snapshot* snapshot);
+
+#endif
\ No newline at end of file
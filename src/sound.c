@@ -26,6 +26,16 @@ static const char PLAY_MUSIC_LOG[] = "Can't play music: %s";
 static const int32_t MUSIC_VOLUME = 40;
 // How loud the gunshot is [0-128]
 static const int32_t GUN_VOLUME = 30;
+// Error message when querying the opened audio device fails
+static const char QUERY_SPEC_LOG[] = "Can't query audio device: %s";
+// Summary of the audio telemetry, logged on exit
+static const char AUDIO_STATS_LOG[] =
+    "Audio: %d Hz, %d frames per buffer (%.1f ms), %llu callbacks, "
+    "%llu underruns, %llu overruns, longest gap %.1f ms";
+// A callback later than this many buffer periods counts as an underrun
+static const float UNDERRUN_RATIO = 1.5f;
+// A callback sooner than this many buffer periods counts as an overrun
+static const float OVERRUN_RATIO = 0.5f;
 
 /**
  * Function:
@@ -75,6 +85,60 @@ static bool __load_chunks(Sound* sound);
  */
 static bool __play_music(Sound* sound);
 
+/**
+ * Function:
+ *  __start_telemetry
+ *
+ * Purpose:
+ *  Query the opened audio device and start recording
+ *  mixer callback statistics.
+ *
+ * Parameters:
+ *  - sound:
+ *      A Sound object that stores the statistics.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __start_telemetry(Sound* sound);
+
+/**
+ * Function:
+ *  __post_mix
+ *
+ * Purpose:
+ *  Mixer post-processing hook that records the time between
+ *  callbacks. Runs on the audio thread.
+ *
+ * Parameters:
+ *  - udata:
+ *      The Sound object.
+ *  - stream:
+ *      The mixed audio buffer (left untouched).
+ *  - len:
+ *      The size of the buffer in bytes.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __post_mix(void* udata, Uint8* stream, int len);
+
+/**
+ * Function:
+ *  __log_stats
+ *
+ * Purpose:
+ *  Log the gathered audio telemetry.
+ *
+ * Parameters:
+ *  - stats:
+ *      The telemetry to log.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __log_stats(AudioStats* stats);
+
 /**
  * Function:
  *  __destroy
@@ -114,14 +178,27 @@ Sound* init_sound(void) {
     // Play music
     if (!__play_music(s)) return NULL;
 
+    __start_telemetry(s);
+
     return s;
 }
 
 /**
- * First free all SDL related resources before
- * releasing the memory of the object.
+ * Plays on the first free channel, if all channels are
+ * busy the shot is simply not heard.
+ */
+void play_shot(Sound* sound) {
+    Mix_PlayChannel(-1, sound->shoot, 0);
+}
+
+/**
+ * Unhook the mixer callback before logging so the audio thread
+ * no longer touches the statistics, then free all SDL related
+ * resources before releasing the memory of the object.
  */
 void destroy_sound(Sound* sound) {
+    Mix_SetPostMix(NULL, NULL);
+    __log_stats(&sound->stats);
     __destroy(sound, FREE_ALL);
 }
 
@@ -180,6 +257,68 @@ static bool __play_music(Sound* sound) {
     return true;
 }
 
+/**
+ * The frame size is derived from the format the device actually
+ * opened with, which may differ from what was requested. If the
+ * query fails we still play sound, just without telemetry.
+ */
+static void __start_telemetry(Sound* sound) {
+    int frequency, channels;
+    Uint16 format;
+
+    sound->stats = (AudioStats){ 0 };
+    if (Mix_QuerySpec(&frequency, &format, &channels) == 0) {
+        SDL_Log(QUERY_SPEC_LOG, SDL_GetError());
+        return;
+    }
+
+    sound->stats.frequency = frequency;
+    sound->stats.frame_bytes = SDL_AUDIO_BITSIZE(format) / 8 * channels;
+    Mix_SetPostMix(__post_mix, sound);
+}
+
+/**
+ * The buffer length tells us how many frames the device asks for
+ * per callback, which is the latency we actually got. A callback
+ * that arrives much later than one buffer period after the last
+ * one means the device has played everything we gave it (underrun),
+ * while one arriving much sooner means it is draining a backlog
+ * after a stall (overrun).
+ */
+static void __post_mix(void* udata, Uint8* stream, int len) {
+    (void)stream;
+    AudioStats* stats = &((Sound*)udata)->stats;
+    Uint64 now = SDL_GetPerformanceCounter();
+
+    stats->buffer_frames = len / stats->frame_bytes;
+    if (stats->callbacks++ > 0) {
+        Uint64 interval = now - stats->last;
+        float period = (float)SDL_GetPerformanceFrequency() * stats->buffer_frames / stats->frequency;
+
+        if (interval > stats->max_interval) stats->max_interval = interval;
+        if (interval > UNDERRUN_RATIO * period) stats->underruns++;
+        else if (interval < OVERRUN_RATIO * period) stats->overruns++;
+    }
+    stats->last = now;
+}
+
+/**
+ * Latency is the time it takes the device to play one buffer.
+ */
+static void __log_stats(AudioStats* stats) {
+    if (stats->frequency == 0) return;
+    SDL_Log(
+        AUDIO_STATS_LOG,
+        stats->frequency,
+        stats->buffer_frames,
+        1000.0f * stats->buffer_frames / stats->frequency,
+        (unsigned long long)stats->callbacks,
+        (unsigned long long)stats->underruns,
+        (unsigned long long)stats->overruns,
+        1000.0f * stats->max_interval / (float)SDL_GetPerformanceFrequency()
+    );
+}
+
 /**
  * Check each resources against mask before releasing.
  */
@@ -9,6 +9,45 @@
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_mixer.h>
 
+/**
+ * Struct:
+ *  AudioStats
+ *
+ * Purpose:
+ *  Telemetry gathered from the mixer callback, used to find the
+ *  smallest buffer that plays without gaps on a given machine.
+ *
+ * Fields:
+ *  - frequency:
+ *      The output frequency the device was opened with.
+ *  - buffer_frames:
+ *      The number of sample frames mixed per callback.
+ *  - frame_bytes:
+ *      The size of a single sample frame (all channels) in bytes.
+ *  - callbacks:
+ *      How many times the mixer callback has run.
+ *  - underruns:
+ *      Callbacks that came later than 1.5 buffer periods after the
+ *      previous one, meaning the device most likely ran dry.
+ *  - overruns:
+ *      Callbacks that came sooner than half a buffer period after the
+ *      previous one, meaning the device was catching up on a backlog.
+ *  - last:
+ *      The performance counter value at the previous callback.
+ *  - max_interval:
+ *      The longest time between two callbacks in counter ticks.
+ */
+typedef struct {
+    int32_t     frequency;
+    int32_t     buffer_frames;
+    int32_t     frame_bytes;
+    Uint64      callbacks;
+    Uint64      underruns;
+    Uint64      overruns;
+    Uint64      last;
+    Uint64      max_interval;
+} AudioStats;
+
 /**
  * Struct:
  *  Sound
@@ -21,10 +60,13 @@
  *      This is an opaque data type used for Music data.
  *  - shoot:
  *      The internal format for an audio chunk.
+ *  - stats:
+ *      Mixer callback telemetry, logged when the sound is destroyed.
  */
 typedef struct {
-    Mix_Music* music;
-    Mix_Chunk* shoot;
+    Mix_Music*  music;
+    Mix_Chunk*  shoot;
+    AudioStats  stats;
 } Sound;
 
 /**
@@ -42,12 +84,28 @@ typedef struct {
  */
 Sound* init_sound(void);
 
+/**
+ * Function:
+ *  play_shot
+ *
+ * Purpose:
+ *  Play the gunshot sound effect once.
+ *
+ * Parameters:
+ *  - sound:
+ *      The Sound object.
+ *
+ * Returns:
+ *  Nothing.
+ */
+void play_shot(Sound* sound);
+
 /**
  * Function:
  *  destroy_sound
  *
  * Purpose:
- *  Release all resources of a Sound object.
+ *  Log the audio telemetry and release all resources of a Sound object.
  *
  * Parameters:
  *  - sound:
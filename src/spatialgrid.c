@@ -0,0 +1,226 @@
+#include "spatialgrid.h"
+
+/**
+ * Function:
+ *  __cell_of
+ *
+ * Purpose:
+ *  Find the cell holding a position.
+ *
+ * Parameters:
+ *  - grid:
+ *      The SpatialGrid object.
+ *  - position:
+ *      The position to look up.
+ *
+ * Returns:
+ *  The cell's index, clamped to the grid.
+ */
+static int32_t __cell_of(SpatialGrid* grid, Point2d* position);
+
+/**
+ * Function:
+ *  __clamp_col
+ *
+ * Purpose:
+ *  Find the column of a horizontal coordinate.
+ *
+ * Parameters:
+ *  - grid:
+ *      The SpatialGrid object.
+ *  - x:
+ *      The horizontal coordinate.
+ *
+ * Returns:
+ *  The column, clamped to the grid.
+ */
+static int32_t __clamp_col(SpatialGrid* grid, float x);
+
+/**
+ * Function:
+ *  __clamp_row
+ *
+ * Purpose:
+ *  Find the row of a vertical coordinate.
+ *
+ * Parameters:
+ *  - grid:
+ *      The SpatialGrid object.
+ *  - y:
+ *      The vertical coordinate.
+ *
+ * Returns:
+ *  The row, clamped to the grid.
+ */
+static int32_t __clamp_row(SpatialGrid* grid, float y);
+
+/**
+ * Function:
+ *  __link
+ *
+ * Purpose:
+ *  Push an item onto the front of a cell's list.
+ *
+ * Parameters:
+ *  - grid:
+ *      The SpatialGrid object.
+ *  - item:
+ *      The item, not in any cell.
+ *  - cell:
+ *      The cell's index.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __link(SpatialGrid* grid, int32_t item, int32_t cell);
+
+/**
+ * Function:
+ *  __unlink
+ *
+ * Purpose:
+ *  Take an item out of its cell's list.
+ *
+ * Parameters:
+ *  - grid:
+ *      The SpatialGrid object.
+ *  - item:
+ *      The item, in a cell.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __unlink(SpatialGrid* grid, int32_t item);
+
+/**
+ * The grid is rounded up to whole cells, so it covers at least
+ * the world. Every cell starts empty and no item is in the grid.
+ */
+SpatialGrid* init_spatial_grid(float w, float h, float cell_size, int32_t capacity) {
+    SpatialGrid* grid = (SpatialGrid*)malloc(sizeof(SpatialGrid));
+    grid->cols = (int32_t)(w / cell_size) + 1;
+    grid->rows = (int32_t)(h / cell_size) + 1;
+    grid->cell_size = cell_size;
+    grid->inverse_cell_size = 1.0f / cell_size;
+    grid->capacity = capacity;
+
+    int32_t n = grid->cols * grid->rows;
+    grid->heads = (int32_t*)malloc(sizeof(int32_t) * n);
+    grid->next = (int32_t*)malloc(sizeof(int32_t) * capacity);
+    grid->prev = (int32_t*)malloc(sizeof(int32_t) * capacity);
+    grid->cells = (int32_t*)malloc(sizeof(int32_t) * capacity);
+    for (int32_t i = 0; i < n; i++) grid->heads[i] = -1;
+    for (int32_t i = 0; i < capacity; i++) grid->cells[i] = -1;
+
+    return grid;
+}
+
+/**
+ * Items go to the front of the list, nothing is walked.
+ */
+void insert_into_spatial_grid(SpatialGrid* grid, int32_t item, Point2d* position) {
+    __link(grid, item, __cell_of(grid, position));
+}
+
+/**
+ * Items not in the grid are ignored, so removing twice is harmless.
+ */
+void remove_from_spatial_grid(SpatialGrid* grid, int32_t item) {
+    if (grid->cells[item] == -1) return;
+    __unlink(grid, item);
+}
+
+/**
+ * Cells are much larger than a frame's step, so most moves stay
+ * within the cell. Those are told apart from the two positions
+ * alone, without loading anything kept per item, which would be
+ * a cache miss for each of a large crowd.
+ */
+void move_in_spatial_grid(SpatialGrid* grid, int32_t item, Point2d* from, Point2d* to) {
+    int32_t cell = __cell_of(grid, to);
+    if (cell == __cell_of(grid, from)) return;
+    __unlink(grid, item);
+    __link(grid, item, cell);
+}
+
+/**
+ * The same test move_in_spatial_grid starts with.
+ */
+bool is_same_cell(SpatialGrid* grid, Point2d* a, Point2d* b) {
+    return __cell_of(grid, a) == __cell_of(grid, b);
+}
+
+/**
+ * The far edges are included, an item on a cell border is in the
+ * cell to its right or below.
+ */
+GridRange spatial_grid_range(SpatialGrid* grid, float x, float y, float w, float h) {
+    return (GridRange){
+        __clamp_col(grid, x),
+        __clamp_row(grid, y),
+        __clamp_col(grid, x + w),
+        __clamp_row(grid, y + h)
+    };
+}
+
+/**
+ * Release all arrays and then the grid.
+ */
+void destroy_spatial_grid(SpatialGrid* grid) {
+    free(grid->heads);
+    free(grid->next);
+    free(grid->prev);
+    free(grid->cells);
+    free(grid);
+}
+
+/**
+ * Rows are laid out one after the other.
+ */
+static int32_t __cell_of(SpatialGrid* grid, Point2d* position) {
+    return __clamp_row(grid, position->y) * grid->cols + __clamp_col(grid, position->x);
+}
+
+/**
+ * Negative coordinates are clamped before converting, since
+ * truncating rounds them towards zero.
+ */
+static int32_t __clamp_col(SpatialGrid* grid, float x) {
+    int32_t col = x <= 0.0f ? 0 : (int32_t)(x * grid->inverse_cell_size);
+    return col < grid->cols ? col : grid->cols - 1;
+}
+
+/**
+ * Same as __clamp_col, along the other axis.
+ */
+static int32_t __clamp_row(SpatialGrid* grid, float y) {
+    int32_t row = y <= 0.0f ? 0 : (int32_t)(y * grid->inverse_cell_size);
+    return row < grid->rows ? row : grid->rows - 1;
+}
+
+/**
+ * The item becomes the cell's head.
+ */
+static void __link(SpatialGrid* grid, int32_t item, int32_t cell) {
+    int32_t head = grid->heads[cell];
+    grid->next[item] = head;
+    grid->prev[item] = -1;
+    if (head != -1) grid->prev[head] = item;
+    grid->heads[cell] = item;
+    grid->cells[item] = cell;
+}
+
+/**
+ * The first item has no previous one, so the cell's head
+ * is pointed past it instead.
+ */
+static void __unlink(SpatialGrid* grid, int32_t item) {
+    int32_t prev = grid->prev[item], next = grid->next[item];
+    if (prev == -1) {
+        grid->heads[grid->cells[item]] = next;
+    } else {
+        grid->next[prev] = next;
+    }
+    if (next != -1) grid->prev[next] = prev;
+    grid->cells[item] = -1;
+}
\ No newline at end of file
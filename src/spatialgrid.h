@@ -0,0 +1,222 @@
+#ifndef Qe7tHw3NbZ_SPATIALGRID_H
+#define Qe7tHw3NbZ_SPATIALGRID_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "gmath.h"
+
+/**
+ * Struct:
+ *  SpatialGrid
+ *
+ * Purpose:
+ *  Buckets items by position on a uniform grid over the world, so
+ *  finding what is within a rectangle only visits the cells it
+ *  overlaps. Each cell is an intrusive doubly linked list threaded
+ *  through arrays indexed by item, so moving an item to another
+ *  cell takes constant time and never allocates. Positions outside
+ *  the world are kept in the closest cell.
+ *
+ * Fields:
+ *  - cols:
+ *      The number of cells along the horizontal axis.
+ *  - rows:
+ *      The number of cells along the vertical axis.
+ *  - cell_size:
+ *      The width (and height) of a cell.
+ *  - inverse_cell_size:
+ *      One over the cell size, to find cells without dividing.
+ *  - capacity:
+ *      The number of items the grid can hold, items are 0 to capacity-1.
+ *  - heads:
+ *      The first item of each cell, -1 if the cell is empty.
+ *  - next:
+ *      The item after each item within its cell, -1 for the last one.
+ *  - prev:
+ *      The item before each item within its cell, -1 for the first one.
+ *  - cells:
+ *      The cell each item is in, -1 if it is not in the grid.
+ */
+typedef struct {
+    int32_t     cols;
+    int32_t     rows;
+    float       cell_size;
+    float       inverse_cell_size;
+    int32_t     capacity;
+    int32_t*    heads;
+    int32_t*    next;
+    int32_t*    prev;
+    int32_t*    cells;
+} SpatialGrid;
+
+/**
+ * Struct:
+ *  GridRange
+ *
+ * Purpose:
+ *  A rectangle of cells, bounds included.
+ *
+ * Fields:
+ *  - col0:
+ *      The leftmost column.
+ *  - row0:
+ *      The topmost row.
+ *  - col1:
+ *      The rightmost column.
+ *  - row1:
+ *      The bottommost row.
+ */
+typedef struct {
+    int32_t     col0;
+    int32_t     row0;
+    int32_t     col1;
+    int32_t     row1;
+} GridRange;
+
+/**
+ * Function:
+ *  init_spatial_grid
+ *
+ * Purpose:
+ *  Create an empty SpatialGrid covering the world.
+ *
+ * Parameters:
+ *  - w:
+ *      The world's width.
+ *  - h:
+ *      The world's height.
+ *  - cell_size:
+ *      The width (and height) of a cell.
+ *  - capacity:
+ *      The number of items the grid can hold.
+ *
+ * Returns:
+ *  The SpatialGrid object.
+ */
+SpatialGrid* init_spatial_grid(float w, float h, float cell_size, int32_t capacity);
+
+/**
+ * Function:
+ *  insert_into_spatial_grid
+ *
+ * Purpose:
+ *  Add an item that is not in the grid.
+ *
+ * Parameters:
+ *  - grid:
+ *      The SpatialGrid object.
+ *  - item:
+ *      The item to add.
+ *  - position:
+ *      The item's position.
+ *
+ * Returns:
+ *  Nothing.
+ */
+void insert_into_spatial_grid(SpatialGrid* grid, int32_t item, Point2d* position);
+
+/**
+ * Function:
+ *  remove_from_spatial_grid
+ *
+ * Purpose:
+ *  Take an item out of the grid, if it is in it.
+ *
+ * Parameters:
+ *  - grid:
+ *      The SpatialGrid object.
+ *  - item:
+ *      The item to remove.
+ *
+ * Returns:
+ *  Nothing.
+ */
+void remove_from_spatial_grid(SpatialGrid* grid, int32_t item);
+
+/**
+ * Function:
+ *  move_in_spatial_grid
+ *
+ * Purpose:
+ *  Update the cell of an item in the grid after it moved.
+ *
+ * Parameters:
+ *  - grid:
+ *      The SpatialGrid object.
+ *  - item:
+ *      The item that moved.
+ *  - from:
+ *      The item's position before moving, the one it is bucketed by.
+ *  - to:
+ *      The item's new position.
+ *
+ * Returns:
+ *  Nothing.
+ */
+void move_in_spatial_grid(SpatialGrid* grid, int32_t item, Point2d* from, Point2d* to);
+
+/**
+ * Function:
+ *  is_same_cell
+ *
+ * Purpose:
+ *  Check if two positions are bucketed in the same cell. Only
+ *  reads the grid, so any number of threads may call it at once.
+ *
+ * Parameters:
+ *  - grid:
+ *      The SpatialGrid object.
+ *  - a:
+ *      The first position.
+ *  - b:
+ *      The second position.
+ *
+ * Returns:
+ *  true if both positions are in the same cell, false otherwise.
+ */
+bool is_same_cell(SpatialGrid* grid, Point2d* a, Point2d* b);
+
+/**
+ * Function:
+ *  spatial_grid_range
+ *
+ * Purpose:
+ *  Find the cells overlapping a rectangle of the world.
+ *
+ * Parameters:
+ *  - grid:
+ *      The SpatialGrid object.
+ *  - x:
+ *      The rectangle's left edge.
+ *  - y:
+ *      The rectangle's top edge.
+ *  - w:
+ *      The rectangle's width.
+ *  - h:
+ *      The rectangle's height.
+ *
+ * Returns:
+ *  The cells to visit, clamped to the grid.
+ */
+GridRange spatial_grid_range(SpatialGrid* grid, float x, float y, float w, float h);
+
+/**
+ * Function:
+ *  destroy_spatial_grid
+ *
+ * Purpose:
+ *  Release the SpatialGrid object.
+ *
+ * Parameters:
+ *  - grid:
+ *      The SpatialGrid object to destroy.
+ *
+ * Returns:
+ *  Nothing.
+ */
+void destroy_spatial_grid(SpatialGrid* grid);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,160 @@
+#include "tilemap.h"
+
+// Error message when the map file can't be opened
+static const char OPEN_MAP_LOG[] = "Could not open map %s\n";
+// Error message when the map file has no tiles
+static const char EMPTY_MAP_LOG[] = "Map %s has no tiles\n";
+// The character marking a wall in map files
+static const int WALL_CHAR = '#';
+
+/**
+ * Function:
+ *  __measure
+ *
+ * Purpose:
+ *  Count the rows of a map file and the length of its longest row.
+ *
+ * Parameters:
+ *  - file:
+ *      The map file, read from the start.
+ *  - cols:
+ *      Set to the length of the longest row.
+ *  - rows:
+ *      Set to the number of rows.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __measure(FILE* file, int32_t* cols, int32_t* rows);
+
+/**
+ * Function:
+ *  __read_walls
+ *
+ * Purpose:
+ *  Set the walls of a map from its file.
+ *
+ * Parameters:
+ *  - map:
+ *      The TileMap object, sized to fit the file.
+ *  - file:
+ *      The map file, read from the start.
+ *
+ * Returns:
+ *  Nothing.
+ */
+static void __read_walls(TileMap* map, FILE* file);
+
+/**
+ * Rows are padded to whole words, so a row never shares a word
+ * with the next one.
+ */
+TileMap* init_tile_map(int32_t cols, int32_t rows, int32_t tile_size) {
+    TileMap* map = (TileMap*)malloc(sizeof(TileMap));
+    map->cols = cols;
+    map->rows = rows;
+    map->tile_size = tile_size;
+    map->inverse_tile_size = 1.0f / tile_size;
+    map->words_per_row = (cols + 63) / 64;
+    map->walls = (uint64_t*)calloc((size_t)map->words_per_row * rows, sizeof(uint64_t));
+    return map;
+}
+
+/**
+ * The file is read twice, first to size the map and then to fill
+ * it, so rows can be of any length. Short rows are padded with floor.
+ */
+TileMap* load_tile_map(const char* path, int32_t tile_size) {
+    FILE* file = fopen(path, "r");
+    if (file == NULL) {
+        SDL_Log(OPEN_MAP_LOG, path);
+        return NULL;
+    }
+
+    int32_t cols, rows;
+    __measure(file, &cols, &rows);
+    if (cols == 0 || rows == 0) {
+        SDL_Log(EMPTY_MAP_LOG, path);
+        fclose(file);
+        return NULL;
+    }
+
+    TileMap* map = init_tile_map(cols, rows, tile_size);
+    rewind(file);
+    __read_walls(map, file);
+    fclose(file);
+
+    return map;
+}
+
+/**
+ * Set or clear the tile's bit.
+ */
+void set_wall(TileMap* map, int32_t col, int32_t row, bool wall) {
+    if (col < 0 || col >= map->cols || row < 0 || row >= map->rows) return;
+    uint64_t* word = &map->walls[row * map->words_per_row + (col >> 6)];
+    uint64_t bit = 1ull << (col & 63);
+    *word = wall ? *word | bit : *word & ~bit;
+}
+
+/**
+ * Negative tiles turn into huge unsigned ones, so one
+ * comparison per axis checks both ends of the map.
+ */
+bool is_wall(TileMap* map, int32_t col, int32_t row) {
+    if ((uint32_t)col >= (uint32_t)map->cols || (uint32_t)row >= (uint32_t)map->rows) return false;
+    return (map->walls[row * map->words_per_row + (col >> 6)] >> (col & 63)) & 1u;
+}
+
+/**
+ * Truncating rounds towards zero, so anything left of or above
+ * the origin is ruled out before finding the tile.
+ */
+bool is_wall_at(TileMap* map, float x, float y) {
+    if (x < 0 || y < 0) return false;
+    return is_wall(map, (int32_t)(x * map->inverse_tile_size), (int32_t)(y * map->inverse_tile_size));
+}
+
+/**
+ * Release the bitmap and then the map.
+ */
+void destroy_tile_map(TileMap* map) {
+    free(map->walls);
+    free(map);
+}
+
+/**
+ * Carriage returns are not tiles, so files with Windows line
+ * endings measure the same. A last row without a newline counts.
+ */
+static void __measure(FILE* file, int32_t* cols, int32_t* rows) {
+    int32_t c, col = 0;
+    *cols = 0;
+    *rows = 0;
+    while ((c = getc(file)) != EOF) {
+        if (c == '\n') {
+            (*rows)++;
+            col = 0;
+        } else if (c != '\r') {
+            col++;
+            if (col > *cols) *cols = col;
+        }
+    }
+    if (col > 0) (*rows)++;
+}
+
+/**
+ * Mirrors __measure, setting a bit for each wall character.
+ */
+static void __read_walls(TileMap* map, FILE* file) {
+    int32_t c, col = 0, row = 0;
+    while ((c = getc(file)) != EOF) {
+        if (c == '\n') {
+            row++;
+            col = 0;
+        } else if (c != '\r') {
+            if (c == WALL_CHAR) set_wall(map, col, row, true);
+            col++;
+        }
+    }
+}
\ No newline at end of file
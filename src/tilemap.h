@@ -0,0 +1,162 @@
+#ifndef Lr5cW0mZ8e_TILEMAP_H
+#define Lr5cW0mZ8e_TILEMAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include <SDL2/SDL.h>
+
+/**
+ * Struct:
+ *  TileMap
+ *
+ * Purpose:
+ *  The level's walls, laid out on a grid of square tiles starting
+ *  at the world's origin. Each tile is a single bit, so testing a
+ *  position for a wall is a shift and a mask. Anything outside the
+ *  map is open.
+ *
+ * Fields:
+ *  - cols:
+ *      The number of tiles along the horizontal axis.
+ *  - rows:
+ *      The number of tiles along the vertical axis.
+ *  - tile_size:
+ *      The width (and height) of a tile in pixels.
+ *  - inverse_tile_size:
+ *      One over the tile size, to find tiles without dividing.
+ *  - words_per_row:
+ *      The number of 64 bit words holding each row.
+ *  - walls:
+ *      One bit per tile, set for walls, row by row.
+ */
+typedef struct {
+    int32_t     cols;
+    int32_t     rows;
+    int32_t     tile_size;
+    float       inverse_tile_size;
+    int32_t     words_per_row;
+    uint64_t*   walls;
+} TileMap;
+
+/**
+ * Function:
+ *  init_tile_map
+ *
+ * Purpose:
+ *  Create a TileMap without any walls.
+ *
+ * Parameters:
+ *  - cols:
+ *      The number of tiles along the horizontal axis.
+ *  - rows:
+ *      The number of tiles along the vertical axis.
+ *  - tile_size:
+ *      The width (and height) of a tile in pixels.
+ *
+ * Returns:
+ *  The TileMap object.
+ */
+TileMap* init_tile_map(int32_t cols, int32_t rows, int32_t tile_size);
+
+/**
+ * Function:
+ *  load_tile_map
+ *
+ * Purpose:
+ *  Create a TileMap from a text file, where each line is a row
+ *  of tiles and '#' marks a wall. Any other character is floor.
+ *
+ * Parameters:
+ *  - path:
+ *      The path to the map file.
+ *  - tile_size:
+ *      The width (and height) of a tile in pixels.
+ *
+ * Returns:
+ *  The TileMap object if successful, NULL otherwise.
+ */
+TileMap* load_tile_map(const char* path, int32_t tile_size);
+
+/**
+ * Function:
+ *  set_wall
+ *
+ * Purpose:
+ *  Make a tile a wall or floor. Tiles outside the map are ignored.
+ *
+ * Parameters:
+ *  - map:
+ *      The TileMap object.
+ *  - col:
+ *      The tile's column.
+ *  - row:
+ *      The tile's row.
+ *  - wall:
+ *      Should the tile be a wall?
+ *
+ * Returns:
+ *  Nothing.
+ */
+void set_wall(TileMap* map, int32_t col, int32_t row, bool wall);
+
+/**
+ * Function:
+ *  is_wall
+ *
+ * Purpose:
+ *  Check if a tile is a wall.
+ *
+ * Parameters:
+ *  - map:
+ *      The TileMap object.
+ *  - col:
+ *      The tile's column.
+ *  - row:
+ *      The tile's row.
+ *
+ * Returns:
+ *  true if the tile is within the map and a wall, false otherwise.
+ */
+bool is_wall(TileMap* map, int32_t col, int32_t row);
+
+/**
+ * Function:
+ *  is_wall_at
+ *
+ * Purpose:
+ *  Check if a position is within a wall.
+ *
+ * Parameters:
+ *  - map:
+ *      The TileMap object.
+ *  - x:
+ *      The position's horizontal coordinate.
+ *  - y:
+ *      The position's vertical coordinate.
+ *
+ * Returns:
+ *  true if the position is within a wall, false otherwise.
+ */
+bool is_wall_at(TileMap* map, float x, float y);
+
+/**
+ * Function:
+ *  destroy_tile_map
+ *
+ * Purpose:
+ *  Release the TileMap object.
+ *
+ * Parameters:
+ *  - map:
+ *      The TileMap object to destroy.
+ *
+ * Returns:
+ *  Nothing.
+ */
+void destroy_tile_map(TileMap* map);
+
+#endif
\ No newline at end of file
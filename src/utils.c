@@ -8,4 +8,18 @@ int32_t string_to_int(const char* str) {
     if (!str) return -1;
     int32_t port = (int)strtoul(str, NULL, 0);
     return errno == ERANGE || port == 0 ? -1 : port;
+}
+
+/**
+ * Smear the highest set bit of x-1 into all lower bits, so
+ * adding one carries into the next power of two.
+ */
+int32_t next_power_of_two(int32_t x) {
+    uint32_t v = (uint32_t)x - 1;
+    v |= v >> 1;
+    v |= v >> 2;
+    v |= v >> 4;
+    v |= v >> 8;
+    v |= v >> 16;
+    return (int32_t)(v + 1);
 }
\ No newline at end of file
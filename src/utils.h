@@ -22,4 +22,20 @@
  */
 int32_t string_to_int(const char* str);
 
+/**
+ * Function:
+ *  next_power_of_two
+ * 
+ * Purpose:
+ *  Round a positive integer up to the nearest power of two.
+ * 
+ * Parameters:
+ * - x: 
+ *      A positive integer, no larger than 2^30.
+ * 
+ * returns: 
+ *  The smallest power of two that is at least x.
+ */
+int32_t next_power_of_two(int32_t x);
+
 #endif
\ No newline at end of file